@@ -0,0 +1,776 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Conversions of 10-bit frames between the layouts of the software codecs and the ones
+// of the graphic buffers: YUV 4:2:0 planar 16 bit, P010, Y410 and RGBA1010102.
+//
+// Each conversion works one row at a time. The rows are converted with NEON or SSE4.1
+// intrinsics, with AVX2 ones selected at run time for YUV to RGBA1010102, and the few
+// pixels left at the end of a row in plain C. All of them give the same result as the
+// plain C conversions, quirks included. Frames larger than 1080p are converted by bands
+// of rows on the process-wide WorkerPool, whose threads are shared with the other
+// conversions of the process.
+
+#include <algorithm>
+
+#include <C2Config.h>
+#include <SimpleC2Component.h>
+#include <media/stagefright/foundation/WorkerPool.h>
+
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#define USE_NEON (true)
+#define USE_SSE (false)
+#include <arm_neon.h>
+#elif defined(__SSE4_1__)
+#define USE_NEON (false)
+#define USE_SSE (true)
+#include <smmintrin.h>
+#else
+#define USE_NEON (false)
+#define USE_SSE (false)
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define USE_AVX2_DISPATCH (true)  // AVX2 intrinsics for run time selection
+#include <immintrin.h>
+#else
+#define USE_AVX2_DISPATCH (false)
+#endif
+
+namespace android {
+
+namespace {
+
+constexpr uint16_t kNeutralUVBitDepth10 = 512;
+
+// Frames with more pixels are converted by bands of rows on the WorkerPool.
+constexpr size_t kMaxSingleThreadPixels = 1920 * 1088;
+
+#define CLIP3(min, v, max) (((v) < (min)) ? (min) : (((max) > (v)) ? (v) : (max)))
+
+// Calls convertRows(begin, end) for bands of rows covering [0, height): one band for frames
+// up to 1080p or if |parallel| is false, otherwise WorkerPool::kMaxConcurrency bands run on
+// the WorkerPool and the calling thread. The band count does not depend on the cores, so that
+// frames are split the same way on every device. Bands begin at even rows, so that they map
+// to whole rows of chroma.
+template <typename F>
+void forEachRowBand(size_t width, size_t height, bool parallel, const F &convertRows) {
+    if (!parallel || width * height <= kMaxSingleThreadPixels) {
+        convertRows(0, height);
+        return;
+    }
+    const size_t bands = WorkerPool::kMaxConcurrency;
+    const size_t bandRows = ((height + bands - 1) / bands + 1) & ~(size_t)1;
+    const size_t usedBands = (height + bandRows - 1) / bandRows;
+    WorkerPool::Run(usedBands, [&convertRows, bandRows, height](size_t band) {
+        const size_t begin = band * bandRows;
+        convertRows(begin, std::min(begin + bandRows, height));
+    });
+}
+
+// Each xxxSimd() and xxxAVX2() function below converts the pixels of a row from |x| on, as
+// many as fit in its vectors, and returns the index of the first pixel left.
+
+#if USE_AVX2_DISPATCH
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX2_TARGET_INLINE __attribute__((target("avx2"), always_inline))
+
+static inline bool cpuSupportsAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif  // USE_AVX2_DISPATCH
+
+//
+// YUV 4:2:0 planar 16 bit to Y410
+//
+
+size_t convertRowToY410Simd(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                            const uint16_t *srcV, size_t x, size_t width) {
+#if USE_NEON
+    // like the plain C conversion, the samples at even indices are masked to 10 bits and the
+    // ones at odd indices are not.
+    static const uint32_t kMask[4] = { 0x3FF, 0xFFFF, 0x3FF, 0xFFFF };
+    const uint32x4_t mask = vld1q_u32(kMask);
+    const uint32x4_t alpha = vdupq_n_u32(3u << 30);
+    for (; x + 8 <= width; x += 8) {
+        const uint32x4_t u = vandq_u32(vmovl_u16(vld1_u16(srcU + x / 2)), mask);
+        const uint32x4_t v = vandq_u32(vmovl_u16(vld1_u16(srcV + x / 2)), mask);
+        const uint32x4_t uv0 = vorrq_u32(u, vshlq_n_u32(v, 20));
+        const uint32x4x2_t uv = vzipq_u32(uv0, uv0);
+        const uint16x8_t y = vld1q_u16(srcY + x);
+        const uint32x4_t y0 = vandq_u32(vmovl_u16(vget_low_u16(y)), mask);
+        const uint32x4_t y1 = vandq_u32(vmovl_u16(vget_high_u16(y)), mask);
+        vst1q_u32(dst + x, vorrq_u32(vorrq_u32(alpha, vshlq_n_u32(y0, 10)), uv.val[0]));
+        vst1q_u32(dst + x + 4, vorrq_u32(vorrq_u32(alpha, vshlq_n_u32(y1, 10)), uv.val[1]));
+    }
+#elif USE_SSE
+    // like the plain C conversion, the samples at even indices are masked to 10 bits and the
+    // ones at odd indices are not.
+    const __m128i mask = _mm_setr_epi32(0x3FF, 0xFFFF, 0x3FF, 0xFFFF);
+    const __m128i alpha = _mm_set1_epi32((int32_t)(3u << 30));
+    for (; x + 8 <= width; x += 8) {
+        const __m128i u = _mm_and_si128(
+                _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(srcU + x / 2))), mask);
+        const __m128i v = _mm_and_si128(
+                _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(srcV + x / 2))), mask);
+        const __m128i uv = _mm_or_si128(u, _mm_slli_epi32(v, 20));
+        const __m128i y = _mm_loadu_si128((const __m128i *)(srcY + x));
+        const __m128i y0 = _mm_and_si128(_mm_cvtepu16_epi32(y), mask);
+        const __m128i y1 = _mm_and_si128(_mm_unpackhi_epi16(y, _mm_setzero_si128()), mask);
+        _mm_storeu_si128((__m128i *)(dst + x),
+                _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(y0, 10)),
+                             _mm_unpacklo_epi32(uv, uv)));
+        _mm_storeu_si128((__m128i *)(dst + x + 4),
+                _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(y1, 10)),
+                             _mm_unpackhi_epi32(uv, uv)));
+    }
+#else
+    (void)dst; (void)srcY; (void)srcU; (void)srcV; (void)width;
+#endif
+    return x;
+}
+
+// Converts 4 pixels at a time. If the width is not a multiple of 4, the 2 pixels after the
+// last group of 4 are converted without alpha, as they have always been.
+void convertRowToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                      const uint16_t *srcV, size_t width) {
+    size_t x = convertRowToY410Simd(dst, srcY, srcU, srcV, 0, width);
+    for (; x + 4 <= width; x += 4) {
+        const uint32_t uv0 = (srcU[x / 2] & 0x3FF) | ((srcV[x / 2] & 0x3FF) << 20);
+        const uint32_t uv1 = srcU[x / 2 + 1] | ((uint32_t)srcV[x / 2 + 1] << 20);
+        dst[x] = 3u << 30 | ((srcY[x] & 0x3FF) << 10) | uv0;
+        dst[x + 1] = 3u << 30 | ((uint32_t)srcY[x + 1] << 10) | uv0;
+        dst[x + 2] = 3u << 30 | ((srcY[x + 2] & 0x3FF) << 10) | uv1;
+        dst[x + 3] = 3u << 30 | ((uint32_t)srcY[x + 3] << 10) | uv1;
+    }
+    if (x < width) {
+        const uint32_t uv0 = (srcU[x / 2] & 0x3FF) | ((srcV[x / 2] & 0x3FF) << 20);
+        dst[x] = ((srcY[x] & 0x3FF) << 10) | uv0;
+        dst[x + 1] = ((uint32_t)srcY[x + 1] << 10) | uv0;
+    }
+}
+
+//
+// YUV 4:2:0 planar 16 bit to RGBA1010102
+//
+
+static C2ColorAspectsStruct FillMissingColorAspects(
+        std::shared_ptr<const C2ColorAspectsStruct> aspects,
+        int32_t width, int32_t height) {
+    C2ColorAspectsStruct _aspects;
+    if (aspects) {
+        _aspects = *aspects;
+    }
+
+    // use matrix for conversion
+    if (_aspects.matrix == C2Color::MATRIX_UNSPECIFIED) {
+        // if not specified, deduce matrix from primaries
+        if (_aspects.primaries == C2Color::PRIMARIES_UNSPECIFIED) {
+            // if those are also not specified, deduce primaries first from transfer, then from
+            // width and height
+            if (_aspects.transfer == C2Color::TRANSFER_ST2084
+                    || _aspects.transfer == C2Color::TRANSFER_HLG) {
+                _aspects.primaries = C2Color::PRIMARIES_BT2020;
+            } else if (width >= 3840 || height >= 3840 || width * (int64_t)height >= 3840 * 1634) {
+                // TODO: stagefright defaults to BT.2020 for UHD, but perhaps we should default to
+                // BT.709 for non-HDR 10-bit UHD content
+                // (see media/libstagefright/foundation/ColorUtils.cpp)
+                _aspects.primaries = C2Color::PRIMARIES_BT2020;
+            } else if ((width <= 720 && height <= 576)
+                    || (height <= 720 && width <= 576)) {
+                // note: it does not actually matter whether to use 525 or 625 here as the
+                // conversion is the same
+                _aspects.primaries = C2Color::PRIMARIES_BT601_625;
+            } else {
+                _aspects.primaries = C2Color::PRIMARIES_BT709;
+            }
+        }
+
+        switch (_aspects.primaries) {
+        case C2Color::PRIMARIES_BT601_525:
+        case C2Color::PRIMARIES_BT601_625:
+            _aspects.matrix = C2Color::MATRIX_BT601;
+            break;
+
+        case C2Color::PRIMARIES_BT709:
+            _aspects.matrix = C2Color::MATRIX_BT709;
+            break;
+
+        case C2Color::PRIMARIES_BT2020:
+        default:
+            _aspects.matrix = C2Color::MATRIX_BT2020;
+        }
+    }
+
+    return _aspects;
+}
+
+// matrix conversion coefficients
+// (see media/libstagefright/colorconverter/ColorConverter.cpp for more details)
+struct Coeffs {
+    int32_t _y, _r_v, _g_u, _g_v, _b_u, _c16;
+};
+
+static const struct Coeffs GetCoeffsForAspects(const C2ColorAspectsStruct &aspects) {
+    bool isFullRange = aspects.range == C2Color::RANGE_FULL;
+
+    switch (aspects.matrix) {
+    case C2Color::MATRIX_BT601:
+        /**
+         * BT.601:  K_R = 0.299;  K_B = 0.114
+         */
+        if (isFullRange) {
+            return Coeffs { 1024, 1436, 352, 731, 1815, 0 };
+        } else {
+            return Coeffs { 1196, 1639, 402, 835, 2072, 64 };
+        }
+        break;
+
+    case C2Color::MATRIX_BT709:
+        /**
+         * BT.709:  K_R = 0.2126;  K_B = 0.0722
+         */
+        if (isFullRange) {
+            return Coeffs { 1024, 1613, 192, 479, 1900, 0 };
+        } else {
+            return Coeffs { 1196, 1841, 219, 547, 2169, 64 };
+        }
+        break;
+
+    case C2Color::MATRIX_BT2020:
+    default:
+        /**
+         * BT.2020:  K_R = 0.2627;  K_B = 0.0593
+         */
+        if (isFullRange) {
+            return Coeffs { 1024, 1510, 169, 585, 1927, 0 };
+        } else {
+            return Coeffs { 1196, 1724, 192, 668, 2200, 64 };
+        }
+    }
+}
+
+// The color components are computed as (yMult + chroma terms) >> 10, clipped to [0, 1023].
+// Shifting instead of dividing by 1024 only changes the quotients in (-1024, 0), which both
+// clip to 0.
+
+#if USE_AVX2_DISPATCH
+
+AVX2_TARGET_INLINE static inline __m256i packRGBA1010102AVX2(
+        __m256i y, __m256i uB, __m256i uvG, __m256i vR, const Coeffs &coeffs) {
+    const __m256i max = _mm256_set1_epi32(1023);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i yMult = _mm256_add_epi32(
+            _mm256_mullo_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(coeffs._c16)),
+                               _mm256_set1_epi32(coeffs._y)),
+            _mm256_set1_epi32(512));
+    __m256i b = _mm256_srai_epi32(_mm256_add_epi32(yMult, uB), 10);
+    __m256i g = _mm256_srai_epi32(_mm256_add_epi32(yMult, uvG), 10);
+    __m256i r = _mm256_srai_epi32(_mm256_add_epi32(yMult, vR), 10);
+    b = _mm256_min_epi32(_mm256_max_epi32(b, zero), max);
+    g = _mm256_min_epi32(_mm256_max_epi32(g, zero), max);
+    r = _mm256_min_epi32(_mm256_max_epi32(r, zero), max);
+    return _mm256_or_si256(
+            _mm256_or_si256(_mm256_set1_epi32((int32_t)(3u << 30)), _mm256_slli_epi32(b, 20)),
+            _mm256_or_si256(_mm256_slli_epi32(g, 10), r));
+}
+
+AVX2_TARGET size_t convertRowToRGBA1010102AVX2(
+        uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU, const uint16_t *srcV,
+        size_t x, size_t width, const Coeffs &coeffs) {
+    const __m256i neutral = _mm256_set1_epi32(512);
+    const __m256i low = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i high = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+    for (; x + 16 <= width; x += 16) {
+        const __m256i u = _mm256_sub_epi32(
+                _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(srcU + x / 2))), neutral);
+        const __m256i v = _mm256_sub_epi32(
+                _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(srcV + x / 2))), neutral);
+        const __m256i uB = _mm256_mullo_epi32(u, _mm256_set1_epi32(coeffs._b_u));
+        const __m256i uvG = _mm256_add_epi32(
+                _mm256_mullo_epi32(v, _mm256_set1_epi32(-coeffs._g_v)),
+                _mm256_mullo_epi32(u, _mm256_set1_epi32(-coeffs._g_u)));
+        const __m256i vR = _mm256_mullo_epi32(v, _mm256_set1_epi32(coeffs._r_v));
+        const __m256i y0 =
+                _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(srcY + x)));
+        const __m256i y1 =
+                _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(srcY + x + 8)));
+        _mm256_storeu_si256((__m256i *)(dst + x), packRGBA1010102AVX2(y0,
+                _mm256_permutevar8x32_epi32(uB, low), _mm256_permutevar8x32_epi32(uvG, low),
+                _mm256_permutevar8x32_epi32(vR, low), coeffs));
+        _mm256_storeu_si256((__m256i *)(dst + x + 8), packRGBA1010102AVX2(y1,
+                _mm256_permutevar8x32_epi32(uB, high), _mm256_permutevar8x32_epi32(uvG, high),
+                _mm256_permutevar8x32_epi32(vR, high), coeffs));
+    }
+    return x;
+}
+
+#endif  // USE_AVX2_DISPATCH
+
+#if USE_NEON
+
+static inline uint32x4_t packRGBA1010102Neon(
+        int32x4_t y, int32x4_t uB, int32x4_t uvG, int32x4_t vR, const Coeffs &coeffs) {
+    const int32x4_t max = vdupq_n_s32(1023);
+    const int32x4_t zero = vdupq_n_s32(0);
+    const int32x4_t yMult = vmlaq_s32(vdupq_n_s32(512), vsubq_s32(y, vdupq_n_s32(coeffs._c16)),
+                                      vdupq_n_s32(coeffs._y));
+    const int32x4_t b = vminq_s32(vmaxq_s32(vshrq_n_s32(vaddq_s32(yMult, uB), 10), zero), max);
+    const int32x4_t g = vminq_s32(vmaxq_s32(vshrq_n_s32(vaddq_s32(yMult, uvG), 10), zero), max);
+    const int32x4_t r = vminq_s32(vmaxq_s32(vshrq_n_s32(vaddq_s32(yMult, vR), 10), zero), max);
+    return vorrq_u32(
+            vorrq_u32(vdupq_n_u32(3u << 30), vshlq_n_u32(vreinterpretq_u32_s32(b), 20)),
+            vorrq_u32(vshlq_n_u32(vreinterpretq_u32_s32(g), 10), vreinterpretq_u32_s32(r)));
+}
+
+#elif USE_SSE
+
+static inline __m128i packRGBA1010102Sse(
+        __m128i y, __m128i uB, __m128i uvG, __m128i vR, const Coeffs &coeffs) {
+    const __m128i max = _mm_set1_epi32(1023);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yMult = _mm_add_epi32(
+            _mm_mullo_epi32(_mm_sub_epi32(y, _mm_set1_epi32(coeffs._c16)),
+                            _mm_set1_epi32(coeffs._y)),
+            _mm_set1_epi32(512));
+    __m128i b = _mm_srai_epi32(_mm_add_epi32(yMult, uB), 10);
+    __m128i g = _mm_srai_epi32(_mm_add_epi32(yMult, uvG), 10);
+    __m128i r = _mm_srai_epi32(_mm_add_epi32(yMult, vR), 10);
+    b = _mm_min_epi32(_mm_max_epi32(b, zero), max);
+    g = _mm_min_epi32(_mm_max_epi32(g, zero), max);
+    r = _mm_min_epi32(_mm_max_epi32(r, zero), max);
+    return _mm_or_si128(_mm_or_si128(_mm_set1_epi32((int32_t)(3u << 30)), _mm_slli_epi32(b, 20)),
+                        _mm_or_si128(_mm_slli_epi32(g, 10), r));
+}
+
+#endif
+
+size_t convertRowToRGBA1010102Simd(
+        uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU, const uint16_t *srcV,
+        size_t x, size_t width, const Coeffs &coeffs) {
+#if USE_NEON
+    const int32x4_t neutral = vdupq_n_s32(512);
+    for (; x + 8 <= width; x += 8) {
+        const int32x4_t u = vsubq_s32(
+                vreinterpretq_s32_u32(vmovl_u16(vld1_u16(srcU + x / 2))), neutral);
+        const int32x4_t v = vsubq_s32(
+                vreinterpretq_s32_u32(vmovl_u16(vld1_u16(srcV + x / 2))), neutral);
+        const int32x4_t uB = vmulq_n_s32(u, coeffs._b_u);
+        const int32x4_t uvG = vmlaq_n_s32(vmulq_n_s32(v, -coeffs._g_v), u, -coeffs._g_u);
+        const int32x4_t vR = vmulq_n_s32(v, coeffs._r_v);
+        const int32x4x2_t uBs = vzipq_s32(uB, uB);
+        const int32x4x2_t uvGs = vzipq_s32(uvG, uvG);
+        const int32x4x2_t vRs = vzipq_s32(vR, vR);
+        const uint16x8_t y = vld1q_u16(srcY + x);
+        const int32x4_t y0 = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y)));
+        const int32x4_t y1 = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y)));
+        vst1q_u32(dst + x, packRGBA1010102Neon(y0, uBs.val[0], uvGs.val[0], vRs.val[0], coeffs));
+        vst1q_u32(dst + x + 4,
+                  packRGBA1010102Neon(y1, uBs.val[1], uvGs.val[1], vRs.val[1], coeffs));
+    }
+#elif USE_SSE
+    const __m128i neutral = _mm_set1_epi32(512);
+    for (; x + 8 <= width; x += 8) {
+        const __m128i u = _mm_sub_epi32(
+                _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(srcU + x / 2))), neutral);
+        const __m128i v = _mm_sub_epi32(
+                _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(srcV + x / 2))), neutral);
+        const __m128i uB = _mm_mullo_epi32(u, _mm_set1_epi32(coeffs._b_u));
+        const __m128i uvG = _mm_add_epi32(_mm_mullo_epi32(v, _mm_set1_epi32(-coeffs._g_v)),
+                                          _mm_mullo_epi32(u, _mm_set1_epi32(-coeffs._g_u)));
+        const __m128i vR = _mm_mullo_epi32(v, _mm_set1_epi32(coeffs._r_v));
+        const __m128i y = _mm_loadu_si128((const __m128i *)(srcY + x));
+        const __m128i y0 = _mm_cvtepu16_epi32(y);
+        const __m128i y1 = _mm_unpackhi_epi16(y, _mm_setzero_si128());
+        _mm_storeu_si128((__m128i *)(dst + x), packRGBA1010102Sse(y0,
+                _mm_unpacklo_epi32(uB, uB), _mm_unpacklo_epi32(uvG, uvG),
+                _mm_unpacklo_epi32(vR, vR), coeffs));
+        _mm_storeu_si128((__m128i *)(dst + x + 4), packRGBA1010102Sse(y1,
+                _mm_unpackhi_epi32(uB, uB), _mm_unpackhi_epi32(uvG, uvG),
+                _mm_unpackhi_epi32(vR, vR), coeffs));
+    }
+#else
+    (void)dst; (void)srcY; (void)srcU; (void)srcV; (void)width; (void)coeffs;
+#endif
+    return x;
+}
+
+// Converts 2 pixels at a time, so a row of odd width gets one more pixel.
+void convertRowToRGBA1010102(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                             const uint16_t *srcV, size_t width, const Coeffs &coeffs) {
+    size_t x = 0;
+#if USE_AVX2_DISPATCH
+    if (cpuSupportsAvx2()) {
+        x = convertRowToRGBA1010102AVX2(dst, srcY, srcU, srcV, x, width, coeffs);
+    }
+#endif
+    x = convertRowToRGBA1010102Simd(dst, srcY, srcU, srcV, x, width, coeffs);
+    for (; x < width; x += 2) {
+        const int32_t u = srcU[x / 2] - 512;
+        const int32_t v = srcV[x / 2] - 512;
+        const int32_t uB = u * coeffs._b_u;
+        const int32_t uvG = v * -coeffs._g_v + u * -coeffs._g_u;
+        const int32_t vR = v * coeffs._r_v;
+        for (size_t i = x; i < x + 2; ++i) {
+            const int32_t yMult = (srcY[i] - coeffs._c16) * coeffs._y + 512;
+            const int32_t b = CLIP3(0, (yMult + uB) >> 10, 1023);
+            const int32_t g = CLIP3(0, (yMult + uvG) >> 10, 1023);
+            const int32_t r = CLIP3(0, (yMult + vR) >> 10, 1023);
+            dst[i] = 3u << 30 | (b << 20) | (g << 10) | r;
+        }
+    }
+}
+
+//
+// P010 to and from YUV 4:2:0 planar 16 bit
+//
+
+void shiftRowLeft6(uint16_t *dst, const uint16_t *src, size_t width) {
+    size_t x = 0;
+#if USE_NEON
+    for (; x + 8 <= width; x += 8) {
+        vst1q_u16(dst + x, vshlq_n_u16(vld1q_u16(src + x), 6));
+    }
+#elif USE_SSE
+    for (; x + 8 <= width; x += 8) {
+        _mm_storeu_si128((__m128i *)(dst + x),
+                _mm_slli_epi16(_mm_loadu_si128((const __m128i *)(src + x)), 6));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x] = src[x] << 6;
+    }
+}
+
+void shiftRowRight6(uint16_t *dst, const uint16_t *src, size_t width) {
+    size_t x = 0;
+#if USE_NEON
+    for (; x + 8 <= width; x += 8) {
+        vst1q_u16(dst + x, vshrq_n_u16(vld1q_u16(src + x), 6));
+    }
+#elif USE_SSE
+    for (; x + 8 <= width; x += 8) {
+        _mm_storeu_si128((__m128i *)(dst + x),
+                _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(src + x)), 6));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x] = src[x] >> 6;
+    }
+}
+
+// |width| is the number of chroma samples per plane.
+void interleaveRowToP010(uint16_t *dstUV, const uint16_t *srcU, const uint16_t *srcV,
+                         size_t width) {
+    size_t x = 0;
+#if USE_NEON
+    for (; x + 8 <= width; x += 8) {
+        uint16x8x2_t uv;
+        uv.val[0] = vshlq_n_u16(vld1q_u16(srcU + x), 6);
+        uv.val[1] = vshlq_n_u16(vld1q_u16(srcV + x), 6);
+        vst2q_u16(dstUV + 2 * x, uv);
+    }
+#elif USE_SSE
+    for (; x + 8 <= width; x += 8) {
+        const __m128i u = _mm_slli_epi16(_mm_loadu_si128((const __m128i *)(srcU + x)), 6);
+        const __m128i v = _mm_slli_epi16(_mm_loadu_si128((const __m128i *)(srcV + x)), 6);
+        _mm_storeu_si128((__m128i *)(dstUV + 2 * x), _mm_unpacklo_epi16(u, v));
+        _mm_storeu_si128((__m128i *)(dstUV + 2 * x + 8), _mm_unpackhi_epi16(u, v));
+    }
+#endif
+    for (; x < width; ++x) {
+        dstUV[2 * x] = srcU[x] << 6;
+        dstUV[2 * x + 1] = srcV[x] << 6;
+    }
+}
+
+// |width| is the number of chroma samples per plane.
+void deinterleaveRowFromP010(uint16_t *dstU, uint16_t *dstV, const uint16_t *srcUV,
+                             size_t width) {
+    size_t x = 0;
+#if USE_NEON
+    for (; x + 8 <= width; x += 8) {
+        const uint16x8x2_t uv = vld2q_u16(srcUV + 2 * x);
+        vst1q_u16(dstU + x, vshrq_n_u16(uv.val[0], 6));
+        vst1q_u16(dstV + x, vshrq_n_u16(uv.val[1], 6));
+    }
+#elif USE_SSE
+    for (; x + 8 <= width; x += 8) {
+        // one U and V pair per 32 bit lane, U in the low half
+        const __m128i uv0 = _mm_loadu_si128((const __m128i *)(srcUV + 2 * x));
+        const __m128i uv1 = _mm_loadu_si128((const __m128i *)(srcUV + 2 * x + 8));
+        _mm_storeu_si128((__m128i *)(dstU + x),
+                _mm_packus_epi32(_mm_srli_epi32(_mm_slli_epi32(uv0, 16), 22),
+                                 _mm_srli_epi32(_mm_slli_epi32(uv1, 16), 22)));
+        _mm_storeu_si128((__m128i *)(dstV + x),
+                _mm_packus_epi32(_mm_srli_epi32(uv0, 22), _mm_srli_epi32(uv1, 22)));
+    }
+#endif
+    for (; x < width; ++x) {
+        dstU[x] = srcUV[2 * x] >> 6;
+        dstV[x] = srcUV[2 * x + 1] >> 6;
+    }
+}
+
+//
+// RGBA1010102 to YUV 4:2:0 planar 16 bit
+//
+
+static const int16_t bt709Matrix_10bit[2][3][3] = {
+    { { 218, 732, 74 }, { -117, -395, 512 }, { 512, -465, -47 } }, /* RANGE_FULL */
+    { { 186, 627, 63 }, { -103, -345, 448 }, { 448, -407, -41 } }, /* RANGE_LIMITED */
+};
+
+static const int16_t bt2020Matrix_10bit[2][3][3] = {
+    { { 269, 694, 61 }, { -143, -369, 512 }, { 512, -471, -41 } }, /* RANGE_FULL */
+    { { 230, 594, 52 }, { -125, -323, 448 }, { 448, -412, -36 } }, /* RANGE_LIMITED */
+};
+
+struct RGBToYUVParams {
+    const int16_t (*weights)[3];
+    int32_t zeroLvl, maxLvlLuma, maxLvlChroma;
+};
+
+#if USE_NEON
+
+static inline int32x4_t weighRGBNeon(uint32x4_t rgba, const int16_t *weights, int32_t offset,
+                                     int32_t minLvl, int32_t maxLvl) {
+    const uint32x4_t mask = vdupq_n_u32(0x3FF);
+    const int32x4_t r = vreinterpretq_s32_u32(vandq_u32(rgba, mask));
+    const int32x4_t g = vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(rgba, 10), mask));
+    const int32x4_t b = vreinterpretq_s32_u32(vandq_u32(vshrq_n_u32(rgba, 20), mask));
+    int32x4_t sum = vmlaq_n_s32(vmlaq_n_s32(vmlaq_n_s32(vdupq_n_s32(512), r, weights[0]),
+                                            g, weights[1]), b, weights[2]);
+    sum = vaddq_s32(vshrq_n_s32(sum, 10), vdupq_n_s32(offset));
+    return vminq_s32(vmaxq_s32(sum, vdupq_n_s32(minLvl)), vdupq_n_s32(maxLvl));
+}
+
+#elif USE_SSE
+
+static inline __m128i weighRGBSse(__m128i rgba, const int16_t *weights, int32_t offset,
+                                  int32_t minLvl, int32_t maxLvl) {
+    const __m128i mask = _mm_set1_epi32(0x3FF);
+    const __m128i r = _mm_and_si128(rgba, mask);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(rgba, 10), mask);
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(rgba, 20), mask);
+    __m128i sum = _mm_add_epi32(
+            _mm_add_epi32(_mm_mullo_epi32(r, _mm_set1_epi32(weights[0])),
+                          _mm_mullo_epi32(g, _mm_set1_epi32(weights[1]))),
+            _mm_add_epi32(_mm_mullo_epi32(b, _mm_set1_epi32(weights[2])),
+                          _mm_set1_epi32(512)));
+    sum = _mm_add_epi32(_mm_srai_epi32(sum, 10), _mm_set1_epi32(offset));
+    return _mm_min_epi32(_mm_max_epi32(sum, _mm_set1_epi32(minLvl)), _mm_set1_epi32(maxLvl));
+}
+
+#endif
+
+// |dstU| and |dstV| are null for the rows without chroma.
+size_t convertRowFromRGBA1010102Simd(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                                     const uint32_t *srcRGBA, size_t width,
+                                     const RGBToYUVParams &params) {
+    size_t x = 0;
+    const int32_t zeroLvl = params.zeroLvl;
+#if USE_NEON
+    for (; x + 8 <= width; x += 8) {
+        // even pixels in val[0], odd ones in val[1]
+        const uint32x4x2_t rgba = vld2q_u32(srcRGBA + x);
+        uint16x4x2_t y;
+        y.val[0] = vmovn_u32(vreinterpretq_u32_s32(weighRGBNeon(
+                rgba.val[0], params.weights[0], zeroLvl, zeroLvl, params.maxLvlLuma)));
+        y.val[1] = vmovn_u32(vreinterpretq_u32_s32(weighRGBNeon(
+                rgba.val[1], params.weights[0], zeroLvl, zeroLvl, params.maxLvlLuma)));
+        vst2_u16(dstY + x, y);
+        if (dstU != nullptr) {
+            vst1_u16(dstU + x / 2, vmovn_u32(vreinterpretq_u32_s32(weighRGBNeon(
+                    rgba.val[0], params.weights[1], 512, zeroLvl, params.maxLvlChroma))));
+            vst1_u16(dstV + x / 2, vmovn_u32(vreinterpretq_u32_s32(weighRGBNeon(
+                    rgba.val[0], params.weights[2], 512, zeroLvl, params.maxLvlChroma))));
+        }
+    }
+#elif USE_SSE
+    for (; x + 8 <= width; x += 8) {
+        const __m128i rgba0 = _mm_loadu_si128((const __m128i *)(srcRGBA + x));
+        const __m128i rgba1 = _mm_loadu_si128((const __m128i *)(srcRGBA + x + 4));
+        _mm_storeu_si128((__m128i *)(dstY + x), _mm_packus_epi32(
+                weighRGBSse(rgba0, params.weights[0], zeroLvl, zeroLvl, params.maxLvlLuma),
+                weighRGBSse(rgba1, params.weights[0], zeroLvl, zeroLvl, params.maxLvlLuma)));
+        if (dstU != nullptr) {
+            const __m128i even = _mm_castps_si128(_mm_shuffle_ps(
+                    _mm_castsi128_ps(rgba0), _mm_castsi128_ps(rgba1), _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i u = weighRGBSse(
+                    even, params.weights[1], 512, zeroLvl, params.maxLvlChroma);
+            const __m128i v = weighRGBSse(
+                    even, params.weights[2], 512, zeroLvl, params.maxLvlChroma);
+            _mm_storel_epi64((__m128i *)(dstU + x / 2), _mm_packus_epi32(u, u));
+            _mm_storel_epi64((__m128i *)(dstV + x / 2), _mm_packus_epi32(v, v));
+        }
+    }
+#else
+    (void)dstY; (void)dstU; (void)dstV; (void)srcRGBA; (void)width; (void)params; (void)zeroLvl;
+#endif
+    return x;
+}
+
+void convertRowFromRGBA1010102(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                               const uint32_t *srcRGBA, size_t width,
+                               const RGBToYUVParams &params) {
+    const int16_t (*weights)[3] = params.weights;
+    const int32_t zeroLvl = params.zeroLvl;
+    size_t x = convertRowFromRGBA1010102Simd(dstY, dstU, dstV, srcRGBA, width, params);
+    for (; x < width; ++x) {
+        const int32_t b = (srcRGBA[x] >> 20) & 0x3FF;
+        const int32_t g = (srcRGBA[x] >> 10) & 0x3FF;
+        const int32_t r = srcRGBA[x] & 0x3FF;
+
+        const int32_t i32Y =
+                ((r * weights[0][0] + g * weights[0][1] + b * weights[0][2] + 512) >> 10) +
+                zeroLvl;
+        dstY[x] = CLIP3(zeroLvl, i32Y, params.maxLvlLuma);
+        if (dstU != nullptr && x % 2 == 0) {
+            const int32_t i32U =
+                    ((r * weights[1][0] + g * weights[1][1] + b * weights[1][2] + 512) >> 10) +
+                    512;
+            const int32_t i32V =
+                    ((r * weights[2][0] + g * weights[2][1] + b * weights[2][2] + 512) >> 10) +
+                    512;
+            dstU[x >> 1] = CLIP3(zeroLvl, i32U, params.maxLvlChroma);
+            dstV[x >> 1] = CLIP3(zeroLvl, i32V, params.maxLvlChroma);
+        }
+    }
+}
+
+}  // namespace
+
+void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                                 const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+                                 size_t srcVStride, size_t dstStride, size_t width, size_t height) {
+    // Converting two lines at a time, which share their chroma
+    forEachRowBand(width, height, true /* parallel */, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y += 2) {
+            const uint16_t *u = srcU + (y / 2) * srcUStride;
+            const uint16_t *v = srcV + (y / 2) * srcVStride;
+            convertRowToY410(dst + y * dstStride, srcY + y * srcYStride, u, v, width);
+            convertRowToY410(dst + (y + 1) * dstStride, srcY + (y + 1) * srcYStride, u, v,
+                             width);
+        }
+    });
+}
+
+void convertYUV420Planar16ToRGBA1010102(
+        uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+        const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+        size_t srcVStride, size_t dstStride, size_t width,
+        size_t height,
+        std::shared_ptr<const C2ColorAspectsStruct> aspects) {
+
+    C2ColorAspectsStruct _aspects = FillMissingColorAspects(aspects, width, height);
+
+    const struct Coeffs coeffs = GetCoeffsForAspects(_aspects);
+
+    // Converting two lines at a time, which share their chroma
+    forEachRowBand(width, height, true /* parallel */, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y += 2) {
+            const uint16_t *u = srcU + (y / 2) * srcUStride;
+            const uint16_t *v = srcV + (y / 2) * srcVStride;
+            convertRowToRGBA1010102(dst + y * dstStride, srcY + y * srcYStride, u, v, width,
+                                    coeffs);
+            convertRowToRGBA1010102(dst + (y + 1) * dstStride, srcY + (y + 1) * srcYStride,
+                                    u, v, width, coeffs);
+        }
+    });
+}
+
+void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
+                                 const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
+                                 size_t srcUStride, size_t srcVStride, size_t dstYStride,
+                                 size_t dstUVStride, size_t width, size_t height,
+                                 bool isMonochrome) {
+    const size_t chromaWidth = (width + 1) / 2;
+    forEachRowBand(width, height, true /* parallel */, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            shiftRowLeft6(dstY + y * dstYStride, srcY + y * srcYStride, width);
+        }
+        for (size_t y = begin / 2; y < (end + 1) / 2; ++y) {
+            uint16_t *uv = dstUV + y * dstUVStride;
+            if (isMonochrome) {
+                // Fill with neutral U/V values.
+                std::fill(uv, uv + 2 * chromaWidth, (uint16_t)(kNeutralUVBitDepth10 << 6));
+            } else {
+                interleaveRowToP010(uv, srcU + y * srcUStride, srcV + y * srcVStride,
+                                    chromaWidth);
+            }
+        }
+    });
+}
+
+void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
+                                 const uint16_t *srcY, const uint16_t *srcUV,
+                                 size_t srcYStride, size_t srcUVStride, size_t dstYStride,
+                                 size_t dstUStride, size_t dstVStride, size_t width,
+                                 size_t height, bool isMonochrome) {
+    const size_t chromaWidth = (width + 1) / 2;
+    forEachRowBand(width, height, true /* parallel */, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            shiftRowRight6(dstY + y * dstYStride, srcY + y * srcYStride, width);
+        }
+        for (size_t y = begin / 2; y < (end + 1) / 2; ++y) {
+            uint16_t *u = dstU + y * dstUStride;
+            uint16_t *v = dstV + y * dstVStride;
+            if (isMonochrome) {
+                // Fill with neutral U/V values.
+                std::fill(u, u + chromaWidth, kNeutralUVBitDepth10);
+                std::fill(v, v + chromaWidth, kNeutralUVBitDepth10);
+            } else {
+                deinterleaveRowFromP010(u, v, srcUV + y * srcUVStride, chromaWidth);
+            }
+        }
+    });
+}
+
+void convertRGBA1010102ToYUV420Planar16(uint16_t* dstY, uint16_t* dstU, uint16_t* dstV,
+                                        const uint32_t* srcRGBA, size_t srcRGBStride, size_t width,
+                                        size_t height, C2Color::matrix_t colorMatrix,
+                                        C2Color::range_t colorRange) {
+    RGBToYUVParams params;
+    params.zeroLvl = colorRange == C2Color::RANGE_FULL ? 0 : 64;
+    params.maxLvlLuma = colorRange == C2Color::RANGE_FULL ? 1023 : 940;
+    params.maxLvlChroma = colorRange == C2Color::RANGE_FULL ? 1023 : 960;
+    // set default range as limited
+    if (colorRange != C2Color::RANGE_FULL) {
+        colorRange = C2Color::RANGE_LIMITED;
+    }
+    params.weights = (colorMatrix == C2Color::MATRIX_BT709)
+                             ? bt709Matrix_10bit[colorRange - 1]
+                             : bt2020Matrix_10bit[colorRange - 1];
+
+    // The planes are packed: the luma rows are |width| apart and the chroma rows |width / 2|
+    // apart. The chroma of an odd width row then overlaps the next row's, so those frames are
+    // converted in order on a single thread.
+    forEachRowBand(width, height, width % 2 == 0 /* parallel */, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            const bool hasChroma = y % 2 == 0;
+            convertRowFromRGBA1010102(dstY + y * width,
+                                      hasChroma ? dstU + (y / 2) * (width / 2) : nullptr,
+                                      hasChroma ? dstV + (y / 2) * (width / 2) : nullptr,
+                                      srcRGBA + y * srcRGBStride, width, params);
+        }
+    });
+}
+
+}  // namespace android
@@ -44,7 +44,6 @@ namespace android {
 #endif
 
 constexpr uint8_t kNeutralUVBitDepth8 = 128;
-constexpr uint16_t kNeutralUVBitDepth10 = 512;
 
 void convertYUV420Planar8ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, const uint8_t *srcY,
                                 const uint8_t *srcU, const uint8_t *srcV, size_t srcYStride,
@@ -81,264 +80,6 @@ void convertYUV420Planar8ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, con
     }
 }
 
-void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
-                                 const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
-                                 size_t srcVStride, size_t dstStride, size_t width, size_t height) {
-    // Converting two lines at a time, slightly faster
-    for (size_t y = 0; y < height; y += 2) {
-        uint32_t *dstTop = (uint32_t *)dst;
-        uint32_t *dstBot = (uint32_t *)(dst + dstStride);
-        uint16_t *ySrcTop = (uint16_t *)srcY;
-        uint16_t *ySrcBot = (uint16_t *)(srcY + srcYStride);
-        uint16_t *uSrc = (uint16_t *)srcU;
-        uint16_t *vSrc = (uint16_t *)srcV;
-
-        uint32_t u01, v01, y01, y23, y45, y67, uv0, uv1;
-        size_t x = 0;
-        for (; x < width - 3; x += 4) {
-            u01 = *((uint32_t *)uSrc);
-            uSrc += 2;
-            v01 = *((uint32_t *)vSrc);
-            vSrc += 2;
-
-            y01 = *((uint32_t *)ySrcTop);
-            ySrcTop += 2;
-            y23 = *((uint32_t *)ySrcTop);
-            ySrcTop += 2;
-            y45 = *((uint32_t *)ySrcBot);
-            ySrcBot += 2;
-            y67 = *((uint32_t *)ySrcBot);
-            ySrcBot += 2;
-
-            uv0 = (u01 & 0x3FF) | ((v01 & 0x3FF) << 20);
-            uv1 = (u01 >> 16) | ((v01 >> 16) << 20);
-
-            *dstTop++ = 3 << 30 | ((y01 & 0x3FF) << 10) | uv0;
-            *dstTop++ = 3 << 30 | ((y01 >> 16) << 10) | uv0;
-            *dstTop++ = 3 << 30 | ((y23 & 0x3FF) << 10) | uv1;
-            *dstTop++ = 3 << 30 | ((y23 >> 16) << 10) | uv1;
-
-            *dstBot++ = 3 << 30 | ((y45 & 0x3FF) << 10) | uv0;
-            *dstBot++ = 3 << 30 | ((y45 >> 16) << 10) | uv0;
-            *dstBot++ = 3 << 30 | ((y67 & 0x3FF) << 10) | uv1;
-            *dstBot++ = 3 << 30 | ((y67 >> 16) << 10) | uv1;
-        }
-
-        // There should be at most 2 more pixels to process. Note that we don't
-        // need to consider odd case as the buffer is always aligned to even.
-        if (x < width) {
-            u01 = *uSrc;
-            v01 = *vSrc;
-            y01 = *((uint32_t *)ySrcTop);
-            y45 = *((uint32_t *)ySrcBot);
-            uv0 = (u01 & 0x3FF) | ((v01 & 0x3FF) << 20);
-            *dstTop++ = ((y01 & 0x3FF) << 10) | uv0;
-            *dstTop++ = ((y01 >> 16) << 10) | uv0;
-            *dstBot++ = ((y45 & 0x3FF) << 10) | uv0;
-            *dstBot++ = ((y45 >> 16) << 10) | uv0;
-        }
-
-        srcY += srcYStride * 2;
-        srcU += srcUStride;
-        srcV += srcVStride;
-        dst += dstStride * 2;
-    }
-}
-
-namespace {
-
-static C2ColorAspectsStruct FillMissingColorAspects(
-        std::shared_ptr<const C2ColorAspectsStruct> aspects,
-        int32_t width, int32_t height) {
-    C2ColorAspectsStruct _aspects;
-    if (aspects) {
-        _aspects = *aspects;
-    }
-
-    // use matrix for conversion
-    if (_aspects.matrix == C2Color::MATRIX_UNSPECIFIED) {
-        // if not specified, deduce matrix from primaries
-        if (_aspects.primaries == C2Color::PRIMARIES_UNSPECIFIED) {
-            // if those are also not specified, deduce primaries first from transfer, then from
-            // width and height
-            if (_aspects.transfer == C2Color::TRANSFER_ST2084
-                    || _aspects.transfer == C2Color::TRANSFER_HLG) {
-                _aspects.primaries = C2Color::PRIMARIES_BT2020;
-            } else if (width >= 3840 || height >= 3840 || width * (int64_t)height >= 3840 * 1634) {
-                // TODO: stagefright defaults to BT.2020 for UHD, but perhaps we should default to
-                // BT.709 for non-HDR 10-bit UHD content
-                // (see media/libstagefright/foundation/ColorUtils.cpp)
-                _aspects.primaries = C2Color::PRIMARIES_BT2020;
-            } else if ((width <= 720 && height <= 576)
-                    || (height <= 720 && width <= 576)) {
-                // note: it does not actually matter whether to use 525 or 625 here as the
-                // conversion is the same
-                _aspects.primaries = C2Color::PRIMARIES_BT601_625;
-            } else {
-                _aspects.primaries = C2Color::PRIMARIES_BT709;
-            }
-        }
-
-        switch (_aspects.primaries) {
-        case C2Color::PRIMARIES_BT601_525:
-        case C2Color::PRIMARIES_BT601_625:
-            _aspects.matrix = C2Color::MATRIX_BT601;
-            break;
-
-        case C2Color::PRIMARIES_BT709:
-            _aspects.matrix = C2Color::MATRIX_BT709;
-            break;
-
-        case C2Color::PRIMARIES_BT2020:
-        default:
-            _aspects.matrix = C2Color::MATRIX_BT2020;
-        }
-    }
-
-    return _aspects;
-}
-
-// matrix conversion coefficients
-// (see media/libstagefright/colorconverter/ColorConverter.cpp for more details)
-struct Coeffs {
-    int32_t _y, _r_v, _g_u, _g_v, _b_u, _c16;
-};
-
-static const struct Coeffs GetCoeffsForAspects(const C2ColorAspectsStruct &aspects) {
-    bool isFullRange = aspects.range == C2Color::RANGE_FULL;
-
-    switch (aspects.matrix) {
-    case C2Color::MATRIX_BT601:
-        /**
-         * BT.601:  K_R = 0.299;  K_B = 0.114
-         */
-        if (isFullRange) {
-            return Coeffs { 1024, 1436, 352, 731, 1815, 0 };
-        } else {
-            return Coeffs { 1196, 1639, 402, 835, 2072, 64 };
-        }
-        break;
-
-    case C2Color::MATRIX_BT709:
-        /**
-         * BT.709:  K_R = 0.2126;  K_B = 0.0722
-         */
-        if (isFullRange) {
-            return Coeffs { 1024, 1613, 192, 479, 1900, 0 };
-        } else {
-            return Coeffs { 1196, 1841, 219, 547, 2169, 64 };
-        }
-        break;
-
-    case C2Color::MATRIX_BT2020:
-    default:
-        /**
-         * BT.2020:  K_R = 0.2627;  K_B = 0.0593
-         */
-        if (isFullRange) {
-            return Coeffs { 1024, 1510, 169, 585, 1927, 0 };
-        } else {
-            return Coeffs { 1196, 1724, 192, 668, 2200, 64 };
-        }
-    }
-}
-
-}
-
-#define CLIP3(min, v, max) (((v) < (min)) ? (min) : (((max) > (v)) ? (v) : (max)))
-void convertYUV420Planar16ToRGBA1010102(
-        uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
-        const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
-        size_t srcVStride, size_t dstStride, size_t width,
-        size_t height,
-        std::shared_ptr<const C2ColorAspectsStruct> aspects) {
-
-    C2ColorAspectsStruct _aspects = FillMissingColorAspects(aspects, width, height);
-
-    struct Coeffs coeffs = GetCoeffsForAspects(_aspects);
-
-    int32_t _y = coeffs._y;
-    int32_t _b_u = coeffs._b_u;
-    int32_t _neg_g_u = -coeffs._g_u;
-    int32_t _neg_g_v = -coeffs._g_v;
-    int32_t _r_v = coeffs._r_v;
-    int32_t _c16 = coeffs._c16;
-
-    // Converting two lines at a time, slightly faster
-    for (size_t y = 0; y < height; y += 2) {
-        uint32_t *dstTop = (uint32_t *)dst;
-        uint32_t *dstBot = (uint32_t *)(dst + dstStride);
-        uint16_t *ySrcTop = (uint16_t *)srcY;
-        uint16_t *ySrcBot = (uint16_t *)(srcY + srcYStride);
-        uint16_t *uSrc = (uint16_t *)srcU;
-        uint16_t *vSrc = (uint16_t *)srcV;
-
-        for (size_t x = 0; x < width; x += 2) {
-            int32_t u, v, y00, y01, y10, y11;
-            u = *uSrc - 512;
-            uSrc += 1;
-            v = *vSrc - 512;
-            vSrc += 1;
-
-            y00 = *ySrcTop - _c16;
-            ySrcTop += 1;
-            y01 = *ySrcTop - _c16;
-            ySrcTop += 1;
-            y10 = *ySrcBot - _c16;
-            ySrcBot += 1;
-            y11 = *ySrcBot - _c16;
-            ySrcBot += 1;
-
-            int32_t u_b = u * _b_u;
-            int32_t u_g = u * _neg_g_u;
-            int32_t v_g = v * _neg_g_v;
-            int32_t v_r = v * _r_v;
-
-            int32_t yMult, b, g, r;
-            yMult = y00 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstTop++ = 3 << 30 | (b << 20) | (g << 10) | r;
-
-            yMult = y01 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstTop++ = 3 << 30 | (b << 20) | (g << 10) | r;
-
-            yMult = y10 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstBot++ = 3 << 30 | (b << 20) | (g << 10) | r;
-
-            yMult = y11 * _y + 512;
-            b = (yMult + u_b) / 1024;
-            g = (yMult + v_g + u_g) / 1024;
-            r = (yMult + v_r) / 1024;
-            b = CLIP3(0, b, 1023);
-            g = CLIP3(0, g, 1023);
-            r = CLIP3(0, r, 1023);
-            *dstBot++ = 3 << 30 | (b << 20) | (g << 10) | r;
-        }
-
-        srcY += srcYStride * 2;
-        srcU += srcUStride;
-        srcV += srcVStride;
-        dst += dstStride * 2;
-    }
-}
-
 void convertYUV420Planar16ToY410OrRGBA1010102(
         uint32_t *dst, const uint16_t *srcY,
         const uint16_t *srcU, const uint16_t *srcV,
@@ -390,133 +131,6 @@ void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, co
     }
 }
 
-void convertYUV420Planar16ToP010(uint16_t *dstY, uint16_t *dstUV, const uint16_t *srcY,
-                                 const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
-                                 size_t srcUStride, size_t srcVStride, size_t dstYStride,
-                                 size_t dstUVStride, size_t width, size_t height,
-                                 bool isMonochrome) {
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            dstY[x] = srcY[x] << 6;
-        }
-        srcY += srcYStride;
-        dstY += dstYStride;
-    }
-
-    if (isMonochrome) {
-        // Fill with neutral U/V values.
-        for (size_t y = 0; y < (height + 1) / 2; ++y) {
-            for (size_t x = 0; x < (width + 1) / 2; ++x) {
-                dstUV[2 * x] = kNeutralUVBitDepth10 << 6;
-                dstUV[2 * x + 1] = kNeutralUVBitDepth10 << 6;
-            }
-            dstUV += dstUVStride;
-        }
-        return;
-    }
-
-    for (size_t y = 0; y < (height + 1) / 2; ++y) {
-        for (size_t x = 0; x < (width + 1) / 2; ++x) {
-            dstUV[2 * x] = srcU[x] << 6;
-            dstUV[2 * x + 1] = srcV[x] << 6;
-        }
-        srcU += srcUStride;
-        srcV += srcVStride;
-        dstUV += dstUVStride;
-    }
-}
-
-void convertP010ToYUV420Planar16(uint16_t *dstY, uint16_t *dstU, uint16_t *dstV,
-                                 const uint16_t *srcY, const uint16_t *srcUV,
-                                 size_t srcYStride, size_t srcUVStride, size_t dstYStride,
-                                 size_t dstUStride, size_t dstVStride, size_t width,
-                                 size_t height, bool isMonochrome) {
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            dstY[x] = srcY[x] >> 6;
-        }
-        srcY += srcYStride;
-        dstY += dstYStride;
-    }
-
-    if (isMonochrome) {
-        // Fill with neutral U/V values.
-        for (size_t y = 0; y < (height + 1) / 2; ++y) {
-            for (size_t x = 0; x < (width + 1) / 2; ++x) {
-                dstU[x] = kNeutralUVBitDepth10;
-                dstV[x] = kNeutralUVBitDepth10;
-            }
-            dstU += dstUStride;
-            dstV += dstVStride;
-        }
-        return;
-    }
-
-    for (size_t y = 0; y < (height + 1) / 2; ++y) {
-        for (size_t x = 0; x < (width + 1) / 2; ++x) {
-            dstU[x] = srcUV[2 * x] >> 6;
-            dstV[x] = srcUV[2 * x + 1] >> 6;
-        }
-        dstU += dstUStride;
-        dstV += dstVStride;
-        srcUV += srcUVStride;
-    }
-}
-
-static const int16_t bt709Matrix_10bit[2][3][3] = {
-    { { 218, 732, 74 }, { -117, -395, 512 }, { 512, -465, -47 } }, /* RANGE_FULL */
-    { { 186, 627, 63 }, { -103, -345, 448 }, { 448, -407, -41 } }, /* RANGE_LIMITED */
-};
-
-static const int16_t bt2020Matrix_10bit[2][3][3] = {
-    { { 269, 694, 61 }, { -143, -369, 512 }, { 512, -471, -41 } }, /* RANGE_FULL */
-    { { 230, 594, 52 }, { -125, -323, 448 }, { 448, -412, -36 } }, /* RANGE_LIMITED */
-};
-
-void convertRGBA1010102ToYUV420Planar16(uint16_t* dstY, uint16_t* dstU, uint16_t* dstV,
-                                        const uint32_t* srcRGBA, size_t srcRGBStride, size_t width,
-                                        size_t height, C2Color::matrix_t colorMatrix,
-                                        C2Color::range_t colorRange) {
-    uint16_t r, g, b;
-    int32_t i32Y, i32U, i32V;
-    uint16_t zeroLvl =  colorRange == C2Color::RANGE_FULL ? 0 : 64;
-    uint16_t maxLvlLuma =  colorRange == C2Color::RANGE_FULL ? 1023 : 940;
-    uint16_t maxLvlChroma =  colorRange == C2Color::RANGE_FULL ? 1023 : 960;
-    // set default range as limited
-    if (colorRange != C2Color::RANGE_FULL) {
-        colorRange = C2Color::RANGE_LIMITED;
-    }
-    const int16_t(*weights)[3] = (colorMatrix == C2Color::MATRIX_BT709)
-                                         ? bt709Matrix_10bit[colorRange - 1]
-                                         : bt2020Matrix_10bit[colorRange - 1];
-
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            b = (srcRGBA[x]  >> 20) & 0x3FF;
-            g = (srcRGBA[x]  >> 10) & 0x3FF;
-            r = srcRGBA[x] & 0x3FF;
-
-            i32Y = ((r * weights[0][0] + g * weights[0][1] + b * weights[0][2] + 512) >> 10) +
-                   zeroLvl;
-            dstY[x] = CLIP3(zeroLvl, i32Y, maxLvlLuma);
-            if (y % 2 == 0 && x % 2 == 0) {
-                i32U = ((r * weights[1][0] + g * weights[1][1] + b * weights[1][2] + 512) >> 10) +
-                       512;
-                i32V = ((r * weights[2][0] + g * weights[2][1] + b * weights[2][2] + 512) >> 10) +
-                       512;
-                dstU[x >> 1] = CLIP3(zeroLvl, i32U, maxLvlChroma);
-                dstV[x >> 1] = CLIP3(zeroLvl, i32V, maxLvlChroma);
-            }
-        }
-        srcRGBA += srcRGBStride;
-        dstY += width;
-        if (y % 2 == 0) {
-            dstU += width / 2;
-            dstV += width / 2;
-        }
-    }
-}
-
 void convertPlanar16ToY410OrRGBA1010102(uint8_t* dst, const uint16_t* srcY, const uint16_t* srcU,
                                         const uint16_t* srcV, size_t srcYStride, size_t srcUStride,
                                         size_t srcVStride, size_t dstStride, size_t width,
@@ -692,7 +306,9 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
     switch (msg->what()) {
         case kWhatProcess: {
             if (mRunning) {
-                if (thiz->processQueue()) {
+                // Process the queued work without a message round trip for each. The
+                // batch is bounded so that other messages are not held back for long.
+                if (thiz->processQueue(kMaxWorkPerMessage)) {
                     (new AMessage(kWhatProcess, this))->post();
                 }
             } else {
@@ -739,7 +355,9 @@ void SimpleC2Component::WorkHandler::onMessageReceived(const sp<AMessage> &msg)
 
 class SimpleC2Component::BlockingBlockPool : public C2BlockPool {
 public:
-    BlockingBlockPool(const std::shared_ptr<C2BlockPool>& base): mBase{base} {}
+    BlockingBlockPool(const std::shared_ptr<C2BlockPool>& base,
+                      const std::function<void()>& onBlocking)
+        : mBase{base}, mOnBlocking{onBlocking} {}
 
     virtual local_id_t getLocalId() const override {
         return mBase->getLocalId();
@@ -753,38 +371,45 @@ public:
             uint32_t capacity,
             C2MemoryUsage usage,
             std::shared_ptr<C2LinearBlock>* block) {
-        c2_status_t status;
-        do {
-            status = mBase->fetchLinearBlock(capacity, usage, block);
-        } while (status == C2_BLOCKING);
-        return status;
+        return fetchBlocking([&] {
+            return mBase->fetchLinearBlock(capacity, usage, block);
+        });
     }
 
     virtual c2_status_t fetchCircularBlock(
             uint32_t capacity,
             C2MemoryUsage usage,
             std::shared_ptr<C2CircularBlock>* block) {
-        c2_status_t status;
-        do {
-            status = mBase->fetchCircularBlock(capacity, usage, block);
-        } while (status == C2_BLOCKING);
-        return status;
+        return fetchBlocking([&] {
+            return mBase->fetchCircularBlock(capacity, usage, block);
+        });
     }
 
     virtual c2_status_t fetchGraphicBlock(
             uint32_t width, uint32_t height, uint32_t format,
             C2MemoryUsage usage,
             std::shared_ptr<C2GraphicBlock>* block) {
-        c2_status_t status;
-        do {
-            status = mBase->fetchGraphicBlock(width, height, format, usage,
-                                              block);
-        } while (status == C2_BLOCKING);
-        return status;
+        return fetchBlocking([&] {
+            return mBase->fetchGraphicBlock(width, height, format, usage, block);
+        });
     }
 
 private:
+    template <typename Fetch>
+    c2_status_t fetchBlocking(Fetch fetch) {
+        c2_status_t status = fetch();
+        if (status == C2_BLOCKING) {
+            // The client may need the work done so far to release blocks.
+            mOnBlocking();
+            do {
+                status = fetch();
+            } while (status == C2_BLOCKING);
+        }
+        return status;
+    }
+
     std::shared_ptr<C2BlockPool> mBase;
+    std::function<void()> mOnBlocking;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -882,6 +507,10 @@ c2_status_t SimpleC2Component::flush_sm(
             queue->pending().erase(queue->pending().begin());
         }
     }
+    // Work done before the flush but held back for the rest of the batch is returned to
+    // the listener, with its output, before the flush returns. Work done after the
+    // generation changed is returned as C2_NOT_FOUND.
+    returnDoneWork();
 
     return C2_OK;
 }
@@ -1007,8 +636,7 @@ void SimpleC2Component::finish(
     }
     if (work) {
         fillWork(work);
-        std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        returnWork(std::move(work));
         ALOGV("returning pending work");
     }
 }
@@ -1033,13 +661,54 @@ void SimpleC2Component::cloneAndSend(
     work->worklets.emplace_back(new C2Worklet);
     if (work) {
         fillWork(work);
-        std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        returnWork(std::move(work));
         ALOGV("cloned and sending work");
     }
 }
 
-bool SimpleC2Component::processQueue() {
+void SimpleC2Component::returnWork(std::unique_ptr<C2Work> work) {
+    if (mProcessingThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        mWorkQueue.lock()->done().push_back(std::move(work));
+        return;
+    }
+    std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
+    listener->onWorkDone_nb(shared_from_this(), vec(work));
+}
+
+void SimpleC2Component::returnDoneWork() {
+    // Held until the listener has the work, so that a flush returns after it.
+    std::lock_guard<std::mutex> lock(mReturnLock);
+    std::list<std::unique_ptr<C2Work>> doneWork;
+    doneWork.swap(mWorkQueue.lock()->done());
+    if (doneWork.empty()) {
+        return;
+    }
+    std::shared_ptr<C2Component::Listener> listener = mExecState.lock()->mListener;
+    listener->onWorkDone_nb(shared_from_this(), std::move(doneWork));
+}
+
+bool SimpleC2Component::processQueue(size_t maxWork) {
+    // Work finished or cloned while processing the batch, and the processed work itself,
+    // are returned to the listener together. Done work is not held back for longer than
+    // kMaxDoneWorkDelayUs, so that a backlog does not delay the first output.
+    mProcessingThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    size_t processed = 0;
+    int64_t batchStartUs = ALooper::GetNowUs();
+    bool hasQueuedWork;
+    do {
+        hasQueuedWork = processNextWork();
+        int64_t nowUs = ALooper::GetNowUs();
+        if (nowUs - batchStartUs >= WorkHandler::kMaxDoneWorkDelayUs) {
+            returnDoneWork();
+            batchStartUs = nowUs;
+        }
+    } while (hasQueuedWork && ++processed < maxWork);
+    mProcessingThread.store(std::thread::id(), std::memory_order_relaxed);
+    returnDoneWork();
+    return hasQueuedWork;
+}
+
+bool SimpleC2Component::processNextWork() {
     std::unique_ptr<C2Work> work;
     uint64_t generation;
     int32_t drainMode;
@@ -1100,7 +769,12 @@ bool SimpleC2Component::processQueue() {
                             blockPool ? blockPool->getLocalId() : 111000111),
                     err);
             if (err == C2_OK) {
-                mOutputBlockPool = std::make_shared<BlockingBlockPool>(blockPool);
+                mOutputBlockPool = std::make_shared<BlockingBlockPool>(blockPool, [this] {
+                    if (mProcessingThread.load(std::memory_order_relaxed)
+                            == std::this_thread::get_id()) {
+                        returnDoneWork();
+                    }
+                });
             }
             return err;
         }();
@@ -1116,6 +790,8 @@ bool SimpleC2Component::processQueue() {
     if (!work) {
         c2_status_t err = drain(drainMode, mOutputBlockPool);
         if (err != C2_OK) {
+            // Return the work finished by drain() before the error.
+            returnDoneWork();
             Mutexed<ExecState>::Locked state(mExecState);
             std::shared_ptr<C2Component::Listener> listener = state->mListener;
             state.unlock();
@@ -1154,20 +830,15 @@ bool SimpleC2Component::processQueue() {
                 queue->generation(), generation);
         work->result = C2_NOT_FOUND;
         queue.unlock();
-
-        Mutexed<ExecState>::Locked state(mExecState);
-        std::shared_ptr<C2Component::Listener> listener = state->mListener;
-        state.unlock();
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        returnWork(std::move(work));
         return hasQueuedWork;
     }
     if (work->workletsProcessed != 0u) {
-        queue.unlock();
-        Mutexed<ExecState>::Locked state(mExecState);
         ALOGV("returning this work");
-        std::shared_ptr<C2Component::Listener> listener = state->mListener;
-        state.unlock();
-        listener->onWorkDone_nb(shared_from_this(), vec(work));
+        // Kept with the rest of the batch while the generation is known to be current, so
+        // that a flush returns it before returning.
+        queue->done().push_back(std::move(work));
+        queue.unlock();
     } else {
         ALOGV("queue pending work");
         work->input.buffers.clear();
@@ -1184,10 +855,7 @@ bool SimpleC2Component::processQueue() {
         if (unexpected) {
             ALOGD("unexpected pending work");
             unexpected->result = C2_CORRUPTED;
-            Mutexed<ExecState>::Locked state(mExecState);
-            std::shared_ptr<C2Component::Listener> listener = state->mListener;
-            state.unlock();
-            listener->onWorkDone_nb(shared_from_this(), vec(unexpected));
+            returnWork(std::move(unexpected));
         }
     }
     return hasQueuedWork;
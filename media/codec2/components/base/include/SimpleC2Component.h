@@ -17,7 +17,10 @@
 #ifndef SIMPLE_C2_COMPONENT_H_
 #define SIMPLE_C2_COMPONENT_H_
 
+#include <atomic>
 #include <list>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include <C2Component.h>
@@ -50,6 +53,16 @@ void convertYUV420Planar16ToY410OrRGBA1010102(
         size_t srcVStride, size_t dstStride, size_t width, size_t height,
         std::shared_ptr<const C2ColorAspectsStruct> aspects = nullptr);
 
+void convertYUV420Planar16ToY410(uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+                                 const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+                                 size_t srcVStride, size_t dstStride, size_t width, size_t height);
+
+void convertYUV420Planar16ToRGBA1010102(
+        uint32_t *dst, const uint16_t *srcY, const uint16_t *srcU,
+        const uint16_t *srcV, size_t srcYStride, size_t srcUStride,
+        size_t srcVStride, size_t dstStride, size_t width, size_t height,
+        std::shared_ptr<const C2ColorAspectsStruct> aspects = nullptr);
+
 void convertYUV420Planar16ToYV12(uint8_t *dstY, uint8_t *dstU, uint8_t *dstV, const uint16_t *srcY,
                                  const uint16_t *srcU, const uint16_t *srcV, size_t srcYStride,
                                  size_t srcUStride, size_t srcVStride, size_t dstYStride,
@@ -119,8 +132,9 @@ public:
     virtual c2_status_t release() override;
     virtual std::shared_ptr<C2ComponentInterface> intf() override;
 
-    // for handler
-    bool processQueue();
+    // for handler; processes up to |maxWork| queued work, and returns true if there is
+    // more work in the queue.
+    bool processQueue(size_t maxWork);
 
 protected:
     /**
@@ -221,6 +235,25 @@ protected:
     int getHalPixelFormatForBitDepth10(bool allowRGBA1010102);
 
 private:
+    /**
+     * Process the next work of the queue, or drain.
+     *
+     * \return true if there is more work in the queue.
+     */
+    bool processNextWork();
+
+    /**
+     * Return |work| to the listener. On the work thread, while processQueue() runs,
+     * the work is kept in the done work of mWorkQueue instead to be returned with the
+     * rest of the batch, or by flush_sm() before it returns.
+     */
+    void returnWork(std::unique_ptr<C2Work> work);
+
+    /**
+     * Return the done work kept in mWorkQueue to the listener, in a single call.
+     */
+    void returnDoneWork();
+
     const std::shared_ptr<C2ComponentInterface> mIntf;
 
     class WorkHandler : public AHandler {
@@ -234,6 +267,11 @@ private:
             kWhatRelease,
         };
 
+        // Maximum number of work processed for a single kWhatProcess message.
+        static constexpr size_t kMaxWorkPerMessage = 16;
+        // Maximum time done work is held back to be returned with the rest of the batch.
+        static constexpr int64_t kMaxDoneWorkDelayUs = 2000;
+
         WorkHandler();
         ~WorkHandler() override = default;
 
@@ -285,6 +323,7 @@ private:
         }
         void clear();
         PendingWork &pending() { return mPendingWork; }
+        std::list<std::unique_ptr<C2Work>> &done() { return mDoneWork; }
 
     private:
         struct Entry {
@@ -296,9 +335,16 @@ private:
         uint64_t mGeneration;
         std::list<Entry> mQueue;
         PendingWork mPendingWork;
+        // Work done during processQueue() and not yet returned to the listener.
+        std::list<std::unique_ptr<C2Work>> mDoneWork;
     };
     Mutexed<WorkQueue> mWorkQueue;
 
+    // Thread running processQueue(), if any.
+    std::atomic<std::thread::id> mProcessingThread;
+    // Held by returnDoneWork() while it returns the done work to the listener.
+    std::mutex mReturnLock;
+
     class BlockingBlockPool;
     std::shared_ptr<BlockingBlockPool> mOutputBlockPool;
 
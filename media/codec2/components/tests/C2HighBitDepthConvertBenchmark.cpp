@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts 10-bit 1080p and 4K frames with the conversions of SimpleC2Component, and with
+// the plain C conversions they replaced (the *Reference benchmarks).
+//
+// $ atest C2HighBitDepthConvertBenchmark
+
+#include <random>
+#include <vector>
+
+#include <C2Config.h>
+#include <SimpleC2Component.h>
+#include <benchmark/benchmark.h>
+
+#include "HighBitDepthConvertReference.h"
+
+using namespace android;
+
+namespace {
+
+// A frame in each of the layouts, with 10-bit samples.
+struct Frames {
+    Frames(size_t width, size_t height)
+        : width(width), height(height),
+          y(width * height), u(width * height / 4), v(width * height / 4),
+          uv(width * height / 2), rgba(width * height) {
+        std::mt19937 random(1);
+        std::uniform_int_distribution<uint32_t> sample(0, 1023);
+        for (std::vector<uint16_t>* plane : { &y, &u, &v, &uv }) {
+            for (uint16_t& s : *plane) {
+                s = sample(random);
+            }
+        }
+        for (uint32_t& pixel : rgba) {
+            pixel = 3u << 30 | sample(random) << 20 | sample(random) << 10 | sample(random);
+        }
+    }
+
+    const size_t width, height;
+    std::vector<uint16_t> y, u, v, uv;
+    std::vector<uint32_t> rgba;
+};
+
+// Arguments: width and height.
+template <bool kReference>
+void BM_Planar16ToRGBA1010102(benchmark::State& state) {
+    Frames src(state.range(0), state.range(1));
+    Frames dst(src.width, src.height);
+    auto aspects = std::make_shared<C2ColorAspectsStruct>();
+    aspects->matrix = C2Color::MATRIX_BT2020;
+    aspects->range = C2Color::RANGE_LIMITED;
+    for (auto _ : state) {
+        (kReference ? reference::convertYUV420Planar16ToRGBA1010102
+                    : convertYUV420Planar16ToRGBA1010102)(
+                dst.rgba.data(), src.y.data(), src.u.data(), src.v.data(), src.width,
+                src.width / 2, src.width / 2, src.width, src.width, src.height, aspects);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * src.width * src.height);
+}
+
+template <bool kReference>
+void BM_Planar16ToY410(benchmark::State& state) {
+    Frames src(state.range(0), state.range(1));
+    Frames dst(src.width, src.height);
+    for (auto _ : state) {
+        (kReference ? reference::convertYUV420Planar16ToY410 : convertYUV420Planar16ToY410)(
+                dst.rgba.data(), src.y.data(), src.u.data(), src.v.data(), src.width,
+                src.width / 2, src.width / 2, src.width, src.width, src.height);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * src.width * src.height);
+}
+
+template <bool kReference>
+void BM_Planar16ToP010(benchmark::State& state) {
+    Frames src(state.range(0), state.range(1));
+    Frames dst(src.width, src.height);
+    for (auto _ : state) {
+        (kReference ? reference::convertYUV420Planar16ToP010 : convertYUV420Planar16ToP010)(
+                dst.y.data(), dst.uv.data(), src.y.data(), src.u.data(), src.v.data(),
+                src.width, src.width / 2, src.width / 2, src.width, src.width, src.width,
+                src.height, false /* isMonochrome */);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * src.width * src.height);
+}
+
+template <bool kReference>
+void BM_P010ToPlanar16(benchmark::State& state) {
+    Frames src(state.range(0), state.range(1));
+    Frames dst(src.width, src.height);
+    for (auto _ : state) {
+        (kReference ? reference::convertP010ToYUV420Planar16 : convertP010ToYUV420Planar16)(
+                dst.y.data(), dst.u.data(), dst.v.data(), src.y.data(), src.uv.data(),
+                src.width, src.width, src.width, src.width / 2, src.width / 2, src.width,
+                src.height, false /* isMonochrome */);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * src.width * src.height);
+}
+
+template <bool kReference>
+void BM_RGBA1010102ToPlanar16(benchmark::State& state) {
+    Frames src(state.range(0), state.range(1));
+    Frames dst(src.width, src.height);
+    for (auto _ : state) {
+        (kReference ? reference::convertRGBA1010102ToYUV420Planar16
+                    : convertRGBA1010102ToYUV420Planar16)(
+                dst.y.data(), dst.u.data(), dst.v.data(), src.rgba.data(), src.width,
+                src.width, src.height, C2Color::MATRIX_BT2020, C2Color::RANGE_LIMITED);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * src.width * src.height);
+}
+
+#define CONVERT_BENCHMARK(name)                                                      \
+    BENCHMARK_TEMPLATE(name, false)->Name(#name)                                     \
+            ->Args({1920, 1080})->Args({3840, 2160})                                 \
+            ->Unit(benchmark::kMicrosecond)->UseRealTime();                          \
+    BENCHMARK_TEMPLATE(name, true)->Name(#name "Reference")                          \
+            ->Args({1920, 1080})->Args({3840, 2160})                                 \
+            ->Unit(benchmark::kMicrosecond)->UseRealTime()
+
+CONVERT_BENCHMARK(BM_Planar16ToRGBA1010102);
+CONVERT_BENCHMARK(BM_Planar16ToY410);
+CONVERT_BENCHMARK(BM_Planar16ToP010);
+CONVERT_BENCHMARK(BM_P010ToPlanar16);
+CONVERT_BENCHMARK(BM_RGBA1010102ToPlanar16);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that the vectorized, and for large frames banded, 10-bit conversions of
+// SimpleC2Component give the same output as the plain C ones, including the samples they
+// write past the width or the height of the frame.
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <C2Config.h>
+#include <SimpleC2Component.h>
+#include <gtest/gtest.h>
+
+#include "HighBitDepthConvertReference.h"
+
+using namespace android;
+
+namespace {
+
+// Padding of the rows and extra rows of the buffers, for the samples that the conversions
+// read or write past the width or the height.
+constexpr size_t kPadding = 24;
+constexpr size_t kExtraRows = 2;
+constexpr uint8_t kFill = 0xA5;
+
+// Parameters: width and height, and whether the samples use all of their 16 bits.
+class HighBitDepthConvertTest
+    : public ::testing::TestWithParam<std::tuple<std::pair<size_t, size_t>, bool>> {
+public:
+    void SetUp() override {
+        std::tie(mWidth, mHeight) = std::get<0>(GetParam());
+        mFull16Bit = std::get<1>(GetParam());
+        mYStride = mWidth + kPadding;
+        mUVStride = (mWidth + 1) / 2 + kPadding;
+        mRGBAStride = mWidth + kPadding;
+        mRandom.seed(mWidth * 31 + mHeight);
+    }
+
+    template <typename T>
+    std::vector<T> randomPlane(size_t stride, size_t height, uint32_t max) {
+        std::uniform_int_distribution<uint32_t> distribution(0, max);
+        std::vector<T> plane(stride * (height + kExtraRows));
+        for (T &sample : plane) {
+            sample = distribution(mRandom);
+        }
+        return plane;
+    }
+
+    std::vector<uint16_t> randomSamples(size_t stride, size_t height) {
+        return randomPlane<uint16_t>(stride, height, mFull16Bit ? 0xFFFF : 0x3FF);
+    }
+
+    template <typename T>
+    static std::vector<T> filledPlane(size_t stride, size_t height) {
+        std::vector<T> plane(stride * (height + kExtraRows));
+        memset(plane.data(), kFill, plane.size() * sizeof(T));
+        return plane;
+    }
+
+    size_t chromaHeight() const { return (mHeight + 1) / 2; }
+
+    size_t mWidth;
+    size_t mHeight;
+    bool mFull16Bit;
+    size_t mYStride;
+    size_t mUVStride;
+    size_t mRGBAStride;
+    std::mt19937 mRandom;
+};
+
+TEST_P(HighBitDepthConvertTest, Y410) {
+    const std::vector<uint16_t> srcY = randomSamples(mYStride, mHeight);
+    const std::vector<uint16_t> srcU = randomSamples(mUVStride, chromaHeight());
+    const std::vector<uint16_t> srcV = randomSamples(mUVStride, chromaHeight());
+    std::vector<uint32_t> expected = filledPlane<uint32_t>(mRGBAStride, mHeight);
+    std::vector<uint32_t> actual = filledPlane<uint32_t>(mRGBAStride, mHeight);
+
+    reference::convertYUV420Planar16ToY410(
+            expected.data(), srcY.data(), srcU.data(), srcV.data(), mYStride, mUVStride,
+            mUVStride, mRGBAStride, mWidth, mHeight);
+    convertYUV420Planar16ToY410(
+            actual.data(), srcY.data(), srcU.data(), srcV.data(), mYStride, mUVStride,
+            mUVStride, mRGBAStride, mWidth, mHeight);
+    ASSERT_EQ(expected, actual);
+}
+
+TEST_P(HighBitDepthConvertTest, RGBA1010102) {
+    const std::vector<uint16_t> srcY = randomSamples(mYStride, mHeight);
+    const std::vector<uint16_t> srcU = randomSamples(mUVStride, chromaHeight());
+    const std::vector<uint16_t> srcV = randomSamples(mUVStride, chromaHeight());
+
+    std::vector<std::shared_ptr<C2ColorAspectsStruct>> aspectsList = { nullptr };
+    for (C2Color::matrix_t matrix : { C2Color::MATRIX_UNSPECIFIED, C2Color::MATRIX_BT601,
+                                      C2Color::MATRIX_BT709, C2Color::MATRIX_BT2020 }) {
+        for (C2Color::range_t range : { C2Color::RANGE_FULL, C2Color::RANGE_LIMITED }) {
+            auto aspects = std::make_shared<C2ColorAspectsStruct>();
+            aspects->matrix = matrix;
+            aspects->range = range;
+            aspectsList.push_back(aspects);
+        }
+    }
+
+    for (const std::shared_ptr<C2ColorAspectsStruct> &aspects : aspectsList) {
+        SCOPED_TRACE(aspects ? "matrix " + std::to_string(aspects->matrix) + " range "
+                                       + std::to_string(aspects->range)
+                             : std::string("no aspects"));
+        std::vector<uint32_t> expected = filledPlane<uint32_t>(mRGBAStride, mHeight);
+        std::vector<uint32_t> actual = filledPlane<uint32_t>(mRGBAStride, mHeight);
+        reference::convertYUV420Planar16ToRGBA1010102(
+                expected.data(), srcY.data(), srcU.data(), srcV.data(), mYStride, mUVStride,
+                mUVStride, mRGBAStride, mWidth, mHeight, aspects);
+        convertYUV420Planar16ToRGBA1010102(
+                actual.data(), srcY.data(), srcU.data(), srcV.data(), mYStride, mUVStride,
+                mUVStride, mRGBAStride, mWidth, mHeight, aspects);
+        ASSERT_EQ(expected, actual);
+    }
+}
+
+TEST_P(HighBitDepthConvertTest, Planar16ToP010) {
+    const std::vector<uint16_t> srcY = randomSamples(mYStride, mHeight);
+    const std::vector<uint16_t> srcU = randomSamples(mUVStride, chromaHeight());
+    const std::vector<uint16_t> srcV = randomSamples(mUVStride, chromaHeight());
+
+    for (bool isMonochrome : { false, true }) {
+        SCOPED_TRACE(isMonochrome ? "monochrome" : "color");
+        std::vector<uint16_t> expectedY = filledPlane<uint16_t>(mYStride, mHeight);
+        std::vector<uint16_t> expectedUV = filledPlane<uint16_t>(mYStride, chromaHeight());
+        std::vector<uint16_t> actualY = filledPlane<uint16_t>(mYStride, mHeight);
+        std::vector<uint16_t> actualUV = filledPlane<uint16_t>(mYStride, chromaHeight());
+        reference::convertYUV420Planar16ToP010(
+                expectedY.data(), expectedUV.data(), srcY.data(), srcU.data(), srcV.data(),
+                mYStride, mUVStride, mUVStride, mYStride, mYStride, mWidth, mHeight,
+                isMonochrome);
+        convertYUV420Planar16ToP010(
+                actualY.data(), actualUV.data(), srcY.data(), srcU.data(), srcV.data(),
+                mYStride, mUVStride, mUVStride, mYStride, mYStride, mWidth, mHeight,
+                isMonochrome);
+        ASSERT_EQ(expectedY, actualY);
+        ASSERT_EQ(expectedUV, actualUV);
+    }
+}
+
+TEST_P(HighBitDepthConvertTest, P010ToPlanar16) {
+    const std::vector<uint16_t> srcY = randomPlane<uint16_t>(mYStride, mHeight, 0xFFFF);
+    const std::vector<uint16_t> srcUV = randomPlane<uint16_t>(mYStride, chromaHeight(), 0xFFFF);
+
+    for (bool isMonochrome : { false, true }) {
+        SCOPED_TRACE(isMonochrome ? "monochrome" : "color");
+        std::vector<uint16_t> expectedY = filledPlane<uint16_t>(mYStride, mHeight);
+        std::vector<uint16_t> expectedU = filledPlane<uint16_t>(mUVStride, chromaHeight());
+        std::vector<uint16_t> expectedV = filledPlane<uint16_t>(mUVStride, chromaHeight());
+        std::vector<uint16_t> actualY = filledPlane<uint16_t>(mYStride, mHeight);
+        std::vector<uint16_t> actualU = filledPlane<uint16_t>(mUVStride, chromaHeight());
+        std::vector<uint16_t> actualV = filledPlane<uint16_t>(mUVStride, chromaHeight());
+        reference::convertP010ToYUV420Planar16(
+                expectedY.data(), expectedU.data(), expectedV.data(), srcY.data(), srcUV.data(),
+                mYStride, mYStride, mYStride, mUVStride, mUVStride, mWidth, mHeight,
+                isMonochrome);
+        convertP010ToYUV420Planar16(
+                actualY.data(), actualU.data(), actualV.data(), srcY.data(), srcUV.data(),
+                mYStride, mYStride, mYStride, mUVStride, mUVStride, mWidth, mHeight,
+                isMonochrome);
+        ASSERT_EQ(expectedY, actualY);
+        ASSERT_EQ(expectedU, actualU);
+        ASSERT_EQ(expectedV, actualV);
+    }
+}
+
+TEST_P(HighBitDepthConvertTest, RGBA1010102ToPlanar16) {
+    const std::vector<uint32_t> srcRGBA =
+            randomPlane<uint32_t>(mRGBAStride, mHeight, 0xFFFFFFFF);
+
+    for (C2Color::matrix_t matrix : { C2Color::MATRIX_UNSPECIFIED, C2Color::MATRIX_BT709,
+                                      C2Color::MATRIX_BT2020 }) {
+        for (C2Color::range_t range : { C2Color::RANGE_UNSPECIFIED, C2Color::RANGE_FULL,
+                                        C2Color::RANGE_LIMITED }) {
+            SCOPED_TRACE("matrix " + std::to_string(matrix) + " range " + std::to_string(range));
+            // the planes are packed, with chroma rows of width / 2 samples.
+            std::vector<uint16_t> expectedY = filledPlane<uint16_t>(mWidth, mHeight);
+            std::vector<uint16_t> expectedU = filledPlane<uint16_t>(mUVStride, chromaHeight());
+            std::vector<uint16_t> expectedV = filledPlane<uint16_t>(mUVStride, chromaHeight());
+            std::vector<uint16_t> actualY = filledPlane<uint16_t>(mWidth, mHeight);
+            std::vector<uint16_t> actualU = filledPlane<uint16_t>(mUVStride, chromaHeight());
+            std::vector<uint16_t> actualV = filledPlane<uint16_t>(mUVStride, chromaHeight());
+            reference::convertRGBA1010102ToYUV420Planar16(
+                    expectedY.data(), expectedU.data(), expectedV.data(), srcRGBA.data(),
+                    mRGBAStride, mWidth, mHeight, matrix, range);
+            convertRGBA1010102ToYUV420Planar16(
+                    actualY.data(), actualU.data(), actualV.data(), srcRGBA.data(),
+                    mRGBAStride, mWidth, mHeight, matrix, range);
+            ASSERT_EQ(expectedY, actualY);
+            ASSERT_EQ(expectedU, actualU);
+            ASSERT_EQ(expectedV, actualV);
+        }
+    }
+}
+
+// Widths that are and are not multiples of the vectors, odd heights, and frames above 1920x1088,
+// which are converted by bands of rows on the WorkerPool, except for the odd widths of
+// RGBA1010102 to YUV420Planar16.
+INSTANTIATE_TEST_SUITE_P(
+        Sizes, HighBitDepthConvertTest,
+        ::testing::Combine(
+                ::testing::Values(std::make_pair(64, 48), std::make_pair(70, 34),
+                                  std::make_pair(99, 37), std::make_pair(1922, 1090),
+                                  std::make_pair(1923, 1089),
+                                  std::make_pair(3840, 2160), std::make_pair(4098, 2163)),
+                ::testing::Bool()),
+        [](const auto &info) {
+            return std::to_string(std::get<0>(info.param).first) + "x"
+                    + std::to_string(std::get<0>(info.param).second)
+                    + (std::get<1>(info.param) ? "_16bit" : "_10bit");
+        });
+
+}  // namespace
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "C2MultiAccessUnitHelperTest"
+#include <utils/Log.h>
+
+#include <gtest/gtest.h>
+
+#include <codec2/common/MultiAccessUnitHelper.h>
+
+namespace android {
+
+TEST(C2MultiAccessUnitHelperTest, AudioTimestampCountsWholeFrames) {
+    // 48 kHz stereo: 4 bytes per frame, 48 frames per ms.
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(1000, 0, 4, 48000), 1000);
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(1000, 48 * 4, 4, 48000), 2000);
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(1000, 48000 * 4, 4, 48000), 1001000);
+    // a partial frame does not advance the timestamp.
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(1000, 48 * 4 + 3, 4, 48000), 2000);
+}
+
+TEST(C2MultiAccessUnitHelperTest, AudioTimestampDoesNotDrift) {
+    // 44.1 kHz mono: a frame lasts 22.67 us, which a per-byte duration truncates.
+    for (uint32_t seconds = 1; seconds <= 60; ++seconds) {
+        EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(
+                0, seconds * 44100 * 2, 2, 44100), seconds * 1000000ll);
+    }
+    // 1024 frames of 6 channels at 44.1 kHz, as an AAC 5.1 access unit.
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(0, 1024 * 12, 12, 44100), 23219);
+    // offsets up to the largest buffer do not overflow.
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(0, UINT32_MAX, 1, 8000),
+            (int64_t)UINT32_MAX * 1000000 / 8000);
+}
+
+TEST(C2MultiAccessUnitHelperTest, AudioTimestampWithoutFormat) {
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(1234, 4096, 0, 48000), 1234);
+    EXPECT_EQ(MultiAccessUnitHelper::getAudioTimestampUs(1234, 4096, 4, 0), 1234);
+}
+
+}  // namespace android
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Flushes C2SoftRawDec while it processes batches of work, to check that
+// SimpleC2Component returns every work exactly once: either to the listener
+// with its output, or unprocessed in the flushed work.
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "C2SimpleComponentFlushTest"
+#include <utils/Log.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include <C2Buffer.h>
+#include <C2ComponentFactory.h>
+#include <C2PlatformSupport.h>
+
+extern "C" ::C2ComponentFactory* CreateCodec2Factory();
+extern "C" void DestroyCodec2Factory(::C2ComponentFactory* factory);
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t kInputSize = 256;
+constexpr size_t kWorksPerQueue = 16;
+constexpr size_t kRounds = 200;
+constexpr std::chrono::seconds kTimeout(5);
+
+struct Listener : public C2Component::Listener {
+    void onWorkDone_nb(std::weak_ptr<C2Component>,
+                       std::list<std::unique_ptr<C2Work>> workItems) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const std::unique_ptr<C2Work>& work : workItems) {
+            mFrameIndices.push_back(work->input.ordinal.frameIndex.peeku());
+            if (mFlushed && work->result != C2_NOT_FOUND) {
+                ++mLateWork;
+            }
+        }
+        mCondition.notify_one();
+    }
+
+    void onTripped_nb(std::weak_ptr<C2Component>,
+                      std::vector<std::shared_ptr<C2SettingResult>>) override {}
+
+    void onError_nb(std::weak_ptr<C2Component>, uint32_t) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mErrors;
+        mCondition.notify_one();
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::list<uint64_t> mFrameIndices;
+    // Set once flush_sm() returned: only work processed across the flush may come after.
+    bool mFlushed = false;
+    size_t mLateWork = 0;
+    size_t mErrors = 0;
+};
+
+}  // namespace
+
+TEST(C2SimpleComponentFlushTest, FlushMidBatchReturnsEachWorkOnce) {
+    ::C2ComponentFactory* factory = CreateCodec2Factory();
+    ASSERT_NE(factory, nullptr);
+    std::shared_ptr<C2Component> component;
+    ASSERT_EQ(factory->createComponent(0 /* id */, &component,
+                                       std::default_delete<C2Component>()), C2_OK);
+    std::shared_ptr<C2BlockPool> pool;
+    std::shared_ptr<C2LinearBlock> block;
+    ASSERT_EQ(GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, component, &pool), C2_OK);
+    ASSERT_EQ(pool->fetchLinearBlock(kInputSize,
+                                     {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE},
+                                     &block), C2_OK);
+    std::shared_ptr<C2Buffer> input =
+            C2Buffer::CreateLinearBuffer(block->share(0, kInputSize, C2Fence()));
+
+    auto listener = std::make_shared<Listener>();
+    ASSERT_EQ(component->setListener_vb(listener, C2_MAY_BLOCK), C2_OK);
+    ASSERT_EQ(component->start(), C2_OK);
+
+    uint64_t frameIndex = 0;
+    for (size_t round = 0; round < kRounds; ++round) {
+        {
+            std::lock_guard<std::mutex> lock(listener->mLock);
+            listener->mFrameIndices.clear();
+            listener->mFlushed = false;
+        }
+        std::list<std::unique_ptr<C2Work>> items;
+        for (size_t i = 0; i < kWorksPerQueue; ++i) {
+            std::unique_ptr<C2Work> work(new C2Work);
+            work->input.flags = C2FrameData::flags_t(0);
+            work->input.ordinal.timestamp = frameIndex * 20000;
+            work->input.ordinal.frameIndex = frameIndex++;
+            work->input.buffers.push_back(input);
+            work->worklets.emplace_back(new C2Worklet);
+            items.push_back(std::move(work));
+        }
+        ASSERT_EQ(component->queue_nb(&items), C2_OK);
+
+        std::list<std::unique_ptr<C2Work>> flushedWork;
+        ASSERT_EQ(component->flush_sm(C2Component::FLUSH_COMPONENT, &flushedWork), C2_OK);
+        std::set<uint64_t> returned;
+        for (const std::unique_ptr<C2Work>& work : flushedWork) {
+            EXPECT_EQ(work->workletsProcessed, 0u) << "processed work was flushed";
+            EXPECT_TRUE(returned.insert(work->input.ordinal.frameIndex.peeku()).second);
+        }
+
+        std::unique_lock<std::mutex> lock(listener->mLock);
+        listener->mFlushed = true;
+        // The work being processed during the flush may still be returned.
+        listener->mCondition.wait_for(lock, kTimeout, [&] {
+            return listener->mErrors > 0
+                    || flushedWork.size() + listener->mFrameIndices.size() >= kWorksPerQueue;
+        });
+        ASSERT_EQ(listener->mErrors, 0u);
+        for (uint64_t index : listener->mFrameIndices) {
+            EXPECT_TRUE(returned.insert(index).second) << "work " << index << " returned twice";
+        }
+        EXPECT_EQ(returned.size(), kWorksPerQueue);
+        EXPECT_EQ(listener->mLateWork, 0u) << "work processed before the flush came after it";
+    }
+
+    component->stop();
+    component->release();
+    component.reset();
+    DestroyCodec2Factory(factory);
+}
+
+}  // namespace android
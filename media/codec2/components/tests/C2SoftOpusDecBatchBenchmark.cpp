@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Decodes a one minute Opus stream with C2SoftOpusDec, queueing several access units per
+// input as with large audio frames: MultiAccessUnitHelper scatters each input into one work
+// per access unit and gathers the decoded access units back into large output buffers.
+//
+// $ atest C2SoftOpusDecBatchBenchmark
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <C2Buffer.h>
+#include <C2ComponentFactory.h>
+#include <C2Config.h>
+#include <C2PlatformSupport.h>
+#include <benchmark/benchmark.h>
+#include <codec2/common/MultiAccessUnitHelper.h>
+#include <media/stagefright/foundation/OpusHeader.h>
+#include <opus.h>
+
+extern "C" ::C2ComponentFactory* CreateCodec2Factory();
+extern "C" void DestroyCodec2Factory(::C2ComponentFactory* factory);
+
+using namespace android;
+
+namespace {
+
+constexpr int kSampleRate = 48000;
+constexpr int kChannelCount = 2;
+constexpr int kFrameSamples = 960;  // 20 ms
+constexpr int64_t kFrameDurationUs = 20000;
+constexpr size_t kStreamFrames = 3000;  // 1 minute
+constexpr uint64_t kSeekPreRollNs = 80000000;
+// Inputs queued and not yet returned, as the input buffers of MediaCodec would allow.
+constexpr size_t kMaxInFlight = 4;
+constexpr std::chrono::seconds kTimeout(5);
+
+// Encoded access units of the stream and the codec specific data for the decoder.
+struct OpusStream {
+    OpusStream() {
+        int err = OPUS_OK;
+        OpusEncoder* encoder = opus_encoder_create(kSampleRate, kChannelCount,
+                                                   OPUS_APPLICATION_AUDIO, &err);
+        if (encoder == nullptr || err != OPUS_OK) {
+            return;
+        }
+        int32_t lookahead = 0;
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE(128000));
+        opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+
+        OpusHeader header = {};
+        header.channels = kChannelCount;
+        header.channel_mapping = 0;
+        header.num_streams = 1;
+        header.num_coupled = 1;
+        header.skip_samples = lookahead;
+        csd.resize(AOPUS_UNIFIED_CSD_MAXSIZE);
+        int csdSize = WriteOpusHeaders(header, kSampleRate, csd.data(), csd.size(),
+                                       lookahead * 1000000000ll / kSampleRate, kSeekPreRollNs);
+        csd.resize(csdSize > 0 ? csdSize : 0);
+
+        // two tones and some noise, so that the encoder does not fall back to silence frames.
+        std::vector<int16_t> pcm(kFrameSamples * kChannelCount);
+        uint32_t noise = 1;
+        uint8_t packet[1275];
+        for (size_t frame = 0; frame < kStreamFrames; ++frame) {
+            for (int i = 0; i < kFrameSamples; ++i) {
+                double t = double(frame * kFrameSamples + i) / kSampleRate;
+                noise = noise * 1664525u + 1013904223u;
+                for (int c = 0; c < kChannelCount; ++c) {
+                    pcm[i * kChannelCount + c] = int16_t(
+                            8000 * std::sin(2 * M_PI * (440 + 110 * c) * t)
+                            + 4000 * std::sin(2 * M_PI * 3000 * t)
+                            + int16_t(noise >> 16) / 64);
+                }
+            }
+            int size = opus_encode(encoder, pcm.data(), kFrameSamples, packet, sizeof(packet));
+            if (size <= 0) {
+                units.clear();
+                break;
+            }
+            units.emplace_back(packet, packet + size);
+        }
+        opus_encoder_destroy(encoder);
+    }
+
+    std::vector<uint8_t> csd;
+    std::vector<std::vector<uint8_t>> units;
+};
+
+const OpusStream& GetStream() {
+    static const OpusStream stream;
+    return stream;
+}
+
+struct Listener : public C2Component::Listener {
+    void onWorkDone_nb(std::weak_ptr<C2Component>,
+                       std::list<std::unique_ptr<C2Work>> workItems) override {
+        std::list<std::unique_ptr<C2Work>> gathered;
+        mHelper->gather(workItems, &gathered);
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const std::unique_ptr<C2Work>& work : gathered) {
+            if (work->result != C2_OK) {
+                ++mErrors;
+                continue;
+            }
+            if (work->worklets.empty() || !work->worklets.front()) {
+                continue;
+            }
+            const C2FrameData& output = work->worklets.front()->output;
+            mOutputs += output.buffers.size();
+            if ((output.flags & C2FrameData::FLAG_INCOMPLETE) == 0) {
+                ++mDone;
+            }
+        }
+        mCondition.notify_one();
+    }
+
+    void onTripped_nb(std::weak_ptr<C2Component>,
+                      std::vector<std::shared_ptr<C2SettingResult>>) override {}
+
+    void onError_nb(std::weak_ptr<C2Component>, uint32_t) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mErrors;
+        mCondition.notify_one();
+    }
+
+    // Waits until |count| inputs in total were done, returns false on error or timeout.
+    bool waitForDone(size_t count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCondition.wait_for(lock, kTimeout,
+                                   [this, count] { return mErrors > 0 || mDone >= count; })
+                && mErrors == 0;
+    }
+
+    std::shared_ptr<MultiAccessUnitHelper> mHelper;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    size_t mDone = 0;
+    size_t mOutputs = 0;
+    size_t mErrors = 0;
+};
+
+// Argument: number of access units per input.
+void BM_OpusDecodeBatch(benchmark::State& state) {
+    const size_t batchSize = state.range(0);
+    const OpusStream& stream = GetStream();
+    if (stream.csd.empty() || stream.units.empty()) {
+        state.SkipWithError("cannot encode the Opus stream");
+        return;
+    }
+    ::C2ComponentFactory* factory = CreateCodec2Factory();
+    std::shared_ptr<C2Component> component;
+    if (factory == nullptr
+            || factory->createComponent(0 /* id */, &component,
+                                        std::default_delete<C2Component>()) != C2_OK) {
+        state.SkipWithError("cannot create c2.android.opus.decoder");
+        return;
+    }
+
+    // The whole stream in one block, each input shares the access units of one batch.
+    size_t streamSize = stream.csd.size();
+    for (const std::vector<uint8_t>& unit : stream.units) {
+        streamSize += unit.size();
+    }
+    std::shared_ptr<C2BlockPool> pool;
+    std::shared_ptr<C2LinearBlock> block;
+    if (GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, component, &pool) != C2_OK
+            || pool->fetchLinearBlock(streamSize,
+                                      {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE},
+                                      &block) != C2_OK) {
+        state.SkipWithError("cannot allocate the input buffer");
+        return;
+    }
+    C2WriteView view = block->map().get();
+    memcpy(view.data(), stream.csd.data(), stream.csd.size());
+    std::shared_ptr<C2Buffer> csd =
+            C2Buffer::CreateLinearBuffer(block->share(0, stream.csd.size(), C2Fence()));
+    std::vector<std::shared_ptr<C2Buffer>> batches;
+    for (size_t first = 0, offset = stream.csd.size(); first < stream.units.size();
+            first += batchSize) {
+        std::vector<C2AccessUnitInfosStruct> infos;
+        size_t size = 0;
+        for (size_t i = first; i < std::min(first + batchSize, stream.units.size()); ++i) {
+            const std::vector<uint8_t>& unit = stream.units[i];
+            memcpy(view.data() + offset + size, unit.data(), unit.size());
+            infos.emplace_back(0u /* flags */, unit.size(), i * kFrameDurationUs);
+            size += unit.size();
+        }
+        std::shared_ptr<C2Buffer> buffer =
+                C2Buffer::CreateLinearBuffer(block->share(offset, size, C2Fence()));
+        buffer->setInfo(C2AccessUnitInfos::input::AllocShared(infos.size(), 0u, infos));
+        batches.push_back(std::move(buffer));
+        offset += size;
+    }
+
+    // Gather the decoded access units of each input into one output buffer.
+    auto intf = std::make_shared<MultiAccessUnitInterface>(
+            component->intf(), std::make_shared<C2ReflectorHelper>());
+    const uint32_t outputSize = batchSize * kFrameSamples * kChannelCount * sizeof(int16_t);
+    C2LargeFrame::output largeFrame(0u /* stream */, outputSize, outputSize);
+    std::vector<std::unique_ptr<C2SettingResult>> failures;
+    auto listener = std::make_shared<Listener>();
+    listener->mHelper = std::make_shared<MultiAccessUnitHelper>(intf, pool);
+    if (intf->config({&largeFrame}, C2_MAY_BLOCK, &failures) != C2_OK
+            || component->setListener_vb(listener, C2_MAY_BLOCK) != C2_OK
+            || component->start() != C2_OK) {
+        state.SkipWithError("cannot start the component");
+        return;
+    }
+
+    uint64_t frameIndex = 0;
+    auto queue = [&](const std::shared_ptr<C2Buffer>& buffer, uint32_t flags) {
+        std::list<std::unique_ptr<C2Work>> items;
+        std::unique_ptr<C2Work> work(new C2Work);
+        work->input.flags = C2FrameData::flags_t(flags);
+        work->input.ordinal.timestamp = 0;
+        work->input.ordinal.frameIndex = frameIndex++;
+        work->input.buffers.push_back(buffer);
+        work->worklets.emplace_back(new C2Worklet);
+        items.push_back(std::move(work));
+        std::list<std::list<std::unique_ptr<C2Work>>> scattered;
+        if (listener->mHelper->scatter(items, &scattered) != C2_OK) {
+            return false;
+        }
+        std::list<std::unique_ptr<C2Work>> units;
+        for (std::list<std::unique_ptr<C2Work>>& works : scattered) {
+            units.splice(units.end(), works);
+        }
+        return component->queue_nb(&units) == C2_OK;
+    };
+
+    if (!queue(csd, C2FrameData::FLAG_CODEC_CONFIG)) {
+        state.SkipWithError("failed to queue the codec specific data");
+    }
+    for (auto _ : state) {
+        bool ok = true;
+        for (const std::shared_ptr<C2Buffer>& batch : batches) {
+            if ((frameIndex >= kMaxInFlight
+                    && !listener->waitForDone(frameIndex + 1 - kMaxInFlight))
+                    || !queue(batch, 0u)) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok || !listener->waitForDone(frameIndex)) {
+            state.SkipWithError("failed to decode the stream");
+            break;
+        }
+    }
+    component->stop();
+    component->release();
+    component.reset();
+    DestroyCodec2Factory(factory);
+
+    const size_t units = state.iterations() * stream.units.size();
+    state.SetItemsProcessed(units);
+    state.counters["us/AU"] = benchmark::Counter(units / 1e6,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["AU/output"] = listener->mOutputs > 0
+            ? (double)units / listener->mOutputs : 0;
+}
+
+BENCHMARK(BM_OpusDecodeBatch)->ArgName("batch")->RangeMultiplier(2)->Range(1, 64)
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Pushes small works through C2SoftRawDec, which only passes its input buffer to
+// the output, to measure the per work overhead of SimpleC2Component: queueing,
+// the work thread hand-off and returning the work to the listener.
+//
+// $ atest C2SoftRawDecBenchmark
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include <C2Buffer.h>
+#include <C2ComponentFactory.h>
+#include <C2PlatformSupport.h>
+#include <benchmark/benchmark.h>
+
+extern "C" ::C2ComponentFactory* CreateCodec2Factory();
+extern "C" void DestroyCodec2Factory(::C2ComponentFactory* factory);
+
+using namespace android;
+
+namespace {
+
+constexpr uint32_t kInputSize = 256;  // bytes, about a 20 ms Opus packet
+constexpr std::chrono::seconds kTimeout(5);
+
+struct Listener : public C2Component::Listener {
+    void onWorkDone_nb(std::weak_ptr<C2Component>,
+                       std::list<std::unique_ptr<C2Work>> workItems) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        for (const std::unique_ptr<C2Work>& work : workItems) {
+            if (work->result != C2_OK) {
+                ++mErrors;
+            }
+        }
+        mDone += workItems.size();
+        ++mCallbacks;
+        mCondition.notify_one();
+    }
+
+    void onTripped_nb(std::weak_ptr<C2Component>,
+                      std::vector<std::shared_ptr<C2SettingResult>>) override {}
+
+    void onError_nb(std::weak_ptr<C2Component>, uint32_t) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        ++mErrors;
+        mCondition.notify_one();
+    }
+
+    // Waits until |count| work in total were done, returns false on error or timeout.
+    bool waitForDone(size_t count) {
+        std::unique_lock<std::mutex> lock(mLock);
+        return mCondition.wait_for(lock, kTimeout,
+                                   [this, count] { return mErrors > 0 || mDone >= count; })
+                && mErrors == 0;
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    size_t mDone = 0;
+    size_t mCallbacks = 0;
+    size_t mErrors = 0;
+};
+
+// Argument: number of work queued at once.
+void BM_RawDecodeWork(benchmark::State& state) {
+    const size_t worksPerQueue = state.range(0);
+    ::C2ComponentFactory* factory = CreateCodec2Factory();
+    std::shared_ptr<C2Component> component;
+    if (factory == nullptr
+            || factory->createComponent(0 /* id */, &component,
+                                        std::default_delete<C2Component>()) != C2_OK) {
+        state.SkipWithError("cannot create c2.android.raw.decoder");
+        return;
+    }
+    std::shared_ptr<C2BlockPool> pool;
+    std::shared_ptr<C2LinearBlock> block;
+    if (GetCodec2BlockPool(C2BlockPool::BASIC_LINEAR, component, &pool) != C2_OK
+            || pool->fetchLinearBlock(kInputSize,
+                                      {C2MemoryUsage::CPU_READ, C2MemoryUsage::CPU_WRITE},
+                                      &block) != C2_OK) {
+        state.SkipWithError("cannot allocate the input buffer");
+        return;
+    }
+    // All the works share the same input, the decoder does not modify it.
+    std::shared_ptr<C2Buffer> input =
+            C2Buffer::CreateLinearBuffer(block->share(0, kInputSize, C2Fence()));
+
+    auto listener = std::make_shared<Listener>();
+    if (component->setListener_vb(listener, C2_MAY_BLOCK) != C2_OK
+            || component->start() != C2_OK) {
+        state.SkipWithError("cannot start the component");
+        return;
+    }
+
+    uint64_t frameIndex = 0;
+    for (auto _ : state) {
+        std::list<std::unique_ptr<C2Work>> items;
+        for (size_t i = 0; i < worksPerQueue; ++i) {
+            std::unique_ptr<C2Work> work(new C2Work);
+            work->input.flags = C2FrameData::flags_t(0);
+            work->input.ordinal.timestamp = frameIndex * 20000;
+            work->input.ordinal.frameIndex = frameIndex++;
+            work->input.buffers.push_back(input);
+            work->worklets.emplace_back(new C2Worklet);
+            items.push_back(std::move(work));
+        }
+        if (component->queue_nb(&items) != C2_OK || !listener->waitForDone(frameIndex)) {
+            state.SkipWithError("failed to process the work");
+            break;
+        }
+    }
+    component->stop();
+    component->release();
+    component.reset();
+    DestroyCodec2Factory(factory);
+
+    state.SetItemsProcessed(frameIndex);
+    state.counters["us/work"] = benchmark::Counter(frameIndex / 1e6,
+            benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["work/callback"] = listener->mCallbacks > 0
+            ? (double)listener->mDone / listener->mCallbacks : 0;
+}
+
+BENCHMARK(BM_RawDecodeWork)->ArgName("queued")->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -142,7 +142,11 @@ MultiAccessUnitHelper::MultiAccessUnitHelper(
         mMultiAccessOnOffAllowed(true),
         mInit(false),
         mInterface(intf),
-        mLinearPool(linearPool) {
+        mLinearPool(linearPool),
+        mAudioFormatQueried(false),
+        mAudioFormatValid(false),
+        mSampleRate(0),
+        mChannelCount(0) {
     if (mLinearPool) {
         mInit = true;
     }
@@ -153,6 +157,14 @@ MultiAccessUnitHelper::~MultiAccessUnitHelper() {
     mFrameHolder.clear();
 }
 
+int64_t MultiAccessUnitHelper::getAudioTimestampUs(
+        int64_t timestampUs, uint32_t offset, uint32_t frameSize, uint32_t sampleRate) {
+    if (frameSize == 0 || sampleRate == 0) {
+        return timestampUs;
+    }
+    return timestampUs + (int64_t)(offset / frameSize) * 1000000 / sampleRate;
+}
+
 bool MultiAccessUnitHelper::isEnabledOnPlatform() {
     bool result = com::android::media::codec::flags::provider_->large_audio_frame();
     if (!result) {
@@ -233,6 +245,8 @@ void MultiAccessUnitHelper::reset() {
     std::lock_guard<std::mutex> l(mLock);
     mFrameHolder.clear();
     mMultiAccessOnOffAllowed = true;
+    mAudioFormatQueried = false;
+    mAudioFormatValid = false;
 }
 
 c2_status_t MultiAccessUnitHelper::error(
@@ -597,19 +611,16 @@ c2_status_t MultiAccessUnitHelper::processWorklets(MultiAccessUnitInfo &frame,
             frame.reset();
             return C2_OK;
         }
-        int64_t sampleTimeUs = 0;
         uint32_t frameSize = 0;
-        uint32_t sampleRate = 0;
-        uint32_t channelCount = 0;
-        if (mInterface->getDecoderSampleRateAndChannelCount(&sampleRate, &channelCount)) {
-            sampleTimeUs = (1000000u) / (sampleRate * channelCount * 2);
-            frameSize = channelCount * 2;
-            if (mInterface->kind() == C2Component::KIND_DECODER) {
-                frame.mLargeFrameTuning.maxSize =
-                        (frame.mLargeFrameTuning.maxSize / frameSize) * frameSize;
-                frame.mLargeFrameTuning.thresholdSize =
-                        (frame.mLargeFrameTuning.thresholdSize / frameSize) * frameSize;
-            }
+        if (mInterface->kind() == C2Component::KIND_DECODER) {
+            updateAudioFormat((*worklet)->output.configUpdate);
+        }
+        if (mAudioFormatValid && mInterface->kind() == C2Component::KIND_DECODER) {
+            frameSize = mChannelCount * 2;
+            frame.mLargeFrameTuning.maxSize =
+                    (frame.mLargeFrameTuning.maxSize / frameSize) * frameSize;
+            frame.mLargeFrameTuning.thresholdSize =
+                    (frame.mLargeFrameTuning.thresholdSize / frameSize) * frameSize;
         }
         c2_status_t c2ret = allocateWork(frame, true);
         if (c2ret != C2_OK) {
@@ -703,10 +714,12 @@ c2_status_t MultiAccessUnitHelper::processWorklets(MultiAccessUnitInfo &frame,
                         toCopy = inputSize;
                     } else {
                         toCopy = c2_min(frame.mWview->size(), (inputSize - inputOffset));
-                        timestamp = workletTimestamp + inputOffset * sampleTimeUs;
+                        if (frameSize != 0) {
+                            timestamp = getAudioTimestampUs(
+                                    workletTimestamp, inputOffset, frameSize, mSampleRate);
+                        }
                         LOG(DEBUG) << "ts " << timestamp
-                                << " copiedOutput " << inputOffset
-                                << " sampleTimeUs " << sampleTimeUs;
+                                << " copiedOutput " << inputOffset;
                     }
                     LOG(DEBUG) << " Copy size " << toCopy
                             << " ts " << timestamp;
@@ -844,6 +857,24 @@ void MultiAccessUnitHelper::mergeAccessUnitInfo(
     }
 }
 
+void MultiAccessUnitHelper::updateAudioFormat(
+        const std::vector<std::unique_ptr<C2Param>> &configUpdate) {
+    bool formatChanged = !mAudioFormatQueried;
+    for (const std::unique_ptr<C2Param> &param : configUpdate) {
+        if (param && (param->index() == C2StreamSampleRateInfo::output::PARAM_TYPE
+                || param->index() == C2StreamChannelCountInfo::output::PARAM_TYPE)) {
+            formatChanged = true;
+        }
+    }
+    if (formatChanged) {
+        mAudioFormatQueried = true;
+        mAudioFormatValid =
+                mInterface->getDecoderSampleRateAndChannelCount(&mSampleRate, &mChannelCount);
+        LOG(DEBUG) << "Decoder output format " << (mAudioFormatValid ? "" : "not ")
+                << "known, sample rate " << mSampleRate << " channel count " << mChannelCount;
+    }
+}
+
 void MultiAccessUnitHelper::MultiAccessUnitInfo::reset() {
     mBlock.reset();
     mWview.reset();
@@ -66,6 +66,14 @@ public:
 
     static bool isEnabledOnPlatform();
 
+    /*
+     * Gets the timestamp of the audio |offset| bytes into a decoder output
+     * starting at |timestampUs|, from the number of whole frames of
+     * |frameSize| bytes before it at |sampleRate|.
+     */
+    static int64_t getAudioTimestampUs(
+            int64_t timestampUs, uint32_t offset, uint32_t frameSize, uint32_t sampleRate);
+
     /*
      * Scatters the incoming linear buffer into access-unit sized buffers
      * based on the access-unit info.
@@ -206,6 +214,12 @@ protected:
             uint32_t size,
             int64_t timestamp);
 
+    /*
+     * Updates the decoder sample rate and channel count if they are not known
+     * yet or if configUpdate changes them.
+     */
+    void updateAudioFormat(const std::vector<std::unique_ptr<C2Param>> &configUpdate);
+
     // Flag to allow dynamic on/off settings on this helper.
     // Once enabled and buffers in transit, it is not possible
     // to turn this module off by setting the max output value
@@ -229,6 +243,13 @@ protected:
     // List of Infos that contains the input and
     // output work and buffer objects
     std::list<MultiAccessUnitInfo> mFrameHolder;
+
+    // Output format of the decoder, queried from the component only when
+    // the output config updates change it instead of for every worklet.
+    bool mAudioFormatQueried;
+    bool mAudioFormatValid;
+    uint32_t mSampleRate;
+    uint32_t mChannelCount;
 };
 
 }  // namespace android
@@ -434,7 +434,13 @@ status_t CCodecBufferChannel::queueInputBufferInternal(
                         now);
             }
         }
+        // the component may be done with the work before queue() returns.
+        nsecs_t queuedNs = systemTime(SYSTEM_TIME_MONOTONIC);
         err = mComponent->queue(&items);
+        if (err == C2_OK && mFrameLatencyTracer
+                && !(flags & C2FrameData::FLAG_CODEC_CONFIG) && buffer->size() > 0u) {
+            mFrameLatencyTracer->record(FrameLatencyTracer::COMPONENT_QUEUED, timeUs, queuedNs);
+        }
     }
     if (err != C2_OK) {
         Mutexed<PipelineWatcher>::Locked watcher(mPipelineWatcher);
@@ -2671,6 +2677,10 @@ bool CCodecBufferChannel::handleWork(
         }
     }
 
+    if (buffer && notifyClient && mFrameLatencyTracer) {
+        mFrameLatencyTracer->record(FrameLatencyTracer::WORK_DONE, timestamp.peekll());
+    }
+
     {
         Mutexed<Output>::Locked output(mOutput);
         if (!output->buffers) {
@@ -2868,6 +2878,11 @@ void CCodecBufferChannel::setDescrambler(const sp<IDescrambler> &descrambler) {
     mDescrambler = descrambler;
 }
 
+void CCodecBufferChannel::setFrameLatencyTracer(
+        const std::shared_ptr<FrameLatencyTracer> &tracer) {
+    mFrameLatencyTracer = tracer;
+}
+
 uint32_t CCodecBufferChannel::getBuffersPixelFormat(bool isEncoder) {
     if (isEncoder) {
         return getInputBuffersPixelFormat();
@@ -31,6 +31,7 @@
 #include <codec2/hidl/client.h>
 #include <media/stagefright/foundation/Mutexed.h>
 #include <media/stagefright/CodecBase.h>
+#include <media/stagefright/FrameLatencyTracer.h>
 
 #include "CCodecBuffers.h"
 #include "FrameReassembler.h"
@@ -62,6 +63,7 @@ public:
     // BufferChannelBase interface
     void setCrypto(const sp<ICrypto> &crypto) override;
     void setDescrambler(const sp<IDescrambler> &descrambler) override;
+    void setFrameLatencyTracer(const std::shared_ptr<FrameLatencyTracer> &tracer) override;
 
     status_t queueInputBuffer(const sp<MediaCodecBuffer> &buffer) override;
     status_t queueSecureInputBuffer(
@@ -408,6 +410,7 @@ private:
 
     sp<ICrypto> mCrypto;
     sp<IDescrambler> mDescrambler;
+    std::shared_ptr<FrameLatencyTracer> mFrameLatencyTracer;
 
     inline bool hasCryptoOrDescrambler() {
         return mCrypto != nullptr || mDescrambler != nullptr;
@@ -23,7 +23,9 @@
 #include <gui/Surface.h>
 #include <mediadrm/ICrypto.h>
 #include <media/MediaCodecBuffer.h>
+#include <media/MediaMetrics.h>
 #include <media/hardware/VideoAPI.h>
+#include <media/stagefright/FrameLatencyTracer.h>
 #include <media/stagefright/MediaCodec.h>
 #include <media/stagefright/MediaCodecConstants.h>
 #include <media/stagefright/foundation/ABuffer.h>
@@ -280,6 +282,85 @@ TEST_F(MediaCodecSanityTest, TestVideoDecoderHdrStaticInfo) {
     EXPECT_EQ(memcmp(oinfo->data(), &info, sizeof(info)),  0);
 }
 
+TEST_F(MediaCodecSanityTest, TestFrameLatencyStages) {
+    // the codec traces the frame latency unless the property turns it off.
+    codec = MediaCodec::CreateByComponentName(looper, "c2.android.raw.decoder");
+    ASSERT_NE(codec, nullptr);
+    if (codec->getFrameLatencyTracer() == nullptr) {
+        GTEST_SKIP() << "the frame latency tracer is turned off";
+    }
+    cfg->setInt32("sample-rate", 48000);
+    cfg->setInt32("channel-count", 2);
+    cfg->setString("mime", MIMETYPE_AUDIO_RAW);
+
+    ASSERT_EQ(codec->configure(cfg, nullptr, nullptr, 0), OK);
+    ASSERT_EQ(codec->start(), OK);
+
+    // 20 ms of 16-bit stereo per frame, then an empty end of stream buffer.
+    const size_t kFrames = 32;
+    const size_t kFrameSize = 960 * 2 * sizeof(int16_t);
+    size_t queued = 0;
+    size_t released = 0;
+    bool eos = false;
+    for (int i = 0; i < 1000 && !eos; ++i) {
+        size_t ix;
+        sp<MediaCodecBuffer> buf;
+        if (queued <= kFrames && codec->dequeueInputBuffer(&ix, 0) == OK) {
+            ASSERT_EQ(codec->getInputBuffer(ix, &buf), OK);
+            ASSERT_GE(buf->capacity(), kFrameSize);
+            const size_t size = queued < kFrames ? kFrameSize : 0;
+            memset(buf->base(), 0, size);
+            ASSERT_EQ(codec->queueInputBuffer(ix, 0, size, (queued + 1) * 20000,
+                                              size == 0 ? BUFFER_FLAG_END_OF_STREAM : 0), OK);
+            ++queued;
+        }
+        size_t offset, size;
+        int64_t ts;
+        uint32_t flags;
+        if (codec->dequeueOutputBuffer(&ix, &offset, &size, &ts, &flags, 10000) == OK) {
+            eos = (flags & BUFFER_FLAG_END_OF_STREAM) != 0;
+            if (size != 0) {
+                ++released;
+            }
+            ASSERT_EQ(codec->releaseOutputBuffer(ix), OK);
+        }
+    }
+    ASSERT_TRUE(eos);
+    ASSERT_EQ(released, kFrames);
+
+    // the frames went through the stages in order, and were not rendered.
+    std::shared_ptr<const FrameLatencyTracer> tracer = codec->getFrameLatencyTracer();
+    ASSERT_NE(tracer, nullptr);
+    std::vector<FrameLatencyTracer::Frame> frames = tracer->getFrames();
+    ASSERT_EQ(frames.size(), kFrames);
+    for (size_t i = 0; i < kFrames; ++i) {
+        const FrameLatencyTracer::Frame &frame = frames[i];
+        EXPECT_EQ(frame.mediaTimeUs, (int64_t)(i + 1) * 20000);
+        nsecs_t previousNs = 0;
+        for (uint32_t stage = FrameLatencyTracer::QUEUED; stage < FrameLatencyTracer::RENDERED;
+                ++stage) {
+            const char *name = FrameLatencyTracer::asString(FrameLatencyTracer::Stage(stage));
+            EXPECT_NE(frame.stageNs[stage], 0) << "frame " << i << " did not reach " << name;
+            EXPECT_GE(frame.stageNs[stage], previousNs) << "frame " << i << " reached " << name
+                    << " too early";
+            previousNs = frame.stageNs[stage];
+        }
+        EXPECT_EQ(frame.stageNs[FrameLatencyTracer::RENDERED], 0);
+    }
+
+    mediametrics_handle_t metrics = 0;
+    ASSERT_EQ(codec->getMetrics(metrics), OK);
+    int64_t p50Us = -1;
+    int64_t p99Us = -1;
+    EXPECT_TRUE(mediametrics_getInt64(metrics, "android.media.mediacodec.stage.codec.p50",
+                                      &p50Us));
+    EXPECT_TRUE(mediametrics_getInt64(metrics, "android.media.mediacodec.stage.codec.p99",
+                                      &p99Us));
+    EXPECT_GE(p50Us, 0);
+    EXPECT_GE(p99Us, p50Us);
+    mediametrics_delete(metrics);
+}
+
 class MediaCodecByteBufferTest : public MediaCodecSanityTest,
         public ::testing::WithParamInterface<int32_t> {
 };
@@ -95,18 +95,30 @@ void FifoBuffer::fillWrappingBuffer(WrappingBuffer *wrappingBuffer,
 }
 
 fifo_frames_t FifoBuffer::getFullDataAvailable(WrappingBuffer *wrappingBuffer) {
+    return getFullDataAvailable(wrappingBuffer, mFifo->getCapacity());
+}
+
+fifo_frames_t FifoBuffer::getFullDataAvailable(WrappingBuffer *wrappingBuffer,
+                                               fifo_frames_t maxFrames) {
     // The FIFO might be overfull so clip to capacity.
-    fifo_frames_t framesAvailable = std::min(mFifo->getFullFramesAvailable(),
-                                             mFifo->getCapacity());
+    fifo_frames_t framesAvailable = std::min({mFifo->getFullFramesAvailable(),
+                                              mFifo->getCapacity(),
+                                              std::max(maxFrames, 0)});
     fifo_frames_t startIndex = mFifo->getReadIndex();
     fillWrappingBuffer(wrappingBuffer, framesAvailable, startIndex);
     return framesAvailable;
 }
 
 fifo_frames_t FifoBuffer::getEmptyRoomAvailable(WrappingBuffer *wrappingBuffer) {
+    return getEmptyRoomAvailable(wrappingBuffer, mFifo->getCapacity());
+}
+
+fifo_frames_t FifoBuffer::getEmptyRoomAvailable(WrappingBuffer *wrappingBuffer,
+                                                fifo_frames_t maxFrames) {
     // The FIFO might have underrun so clip to capacity.
-    fifo_frames_t framesAvailable = std::min(mFifo->getEmptyFramesAvailable(),
-                                             mFifo->getCapacity());
+    fifo_frames_t framesAvailable = std::min({mFifo->getEmptyFramesAvailable(),
+                                              mFifo->getCapacity(),
+                                              std::max(maxFrames, 0)});
     fifo_frames_t startIndex = mFifo->getWriteIndex();
     fillWrappingBuffer(wrappingBuffer, framesAvailable, startIndex);
     return framesAvailable;
@@ -115,30 +127,17 @@ fifo_frames_t FifoBuffer::getEmptyRoomAvailable(WrappingBuffer *wrappingBuffer)
 fifo_frames_t FifoBuffer::read(void *buffer, fifo_frames_t numFrames) {
     WrappingBuffer wrappingBuffer;
     uint8_t *destination = (uint8_t *) buffer;
-    fifo_frames_t framesLeft = numFrames;
 
-    getFullDataAvailable(&wrappingBuffer);
+    fifo_frames_t framesRead = getFullDataAvailable(&wrappingBuffer, numFrames);
 
     // Read data in one or two parts.
-    int partIndex = 0;
-    while (framesLeft > 0 && partIndex < WrappingBuffer::SIZE) {
-        fifo_frames_t framesToRead = framesLeft;
-        fifo_frames_t framesAvailable = wrappingBuffer.numFrames[partIndex];
-        if (framesAvailable > 0) {
-            if (framesToRead > framesAvailable) {
-                framesToRead = framesAvailable;
-            }
-            int32_t numBytes = convertFramesToBytes(framesToRead);
+    for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+        int32_t numBytes = convertFramesToBytes(wrappingBuffer.numFrames[partIndex]);
+        if (numBytes > 0) {
             memcpy(destination, wrappingBuffer.data[partIndex], numBytes);
-
             destination += numBytes;
-            framesLeft -= framesToRead;
-        } else {
-            break;
         }
-        partIndex++;
     }
-    fifo_frames_t framesRead = numFrames - framesLeft;
     mFifo->advanceReadIndex(framesRead);
     return framesRead;
 }
@@ -146,30 +145,17 @@ fifo_frames_t FifoBuffer::read(void *buffer, fifo_frames_t numFrames) {
 fifo_frames_t FifoBuffer::write(const void *buffer, fifo_frames_t numFrames) {
     WrappingBuffer wrappingBuffer;
     uint8_t *source = (uint8_t *) buffer;
-    fifo_frames_t framesLeft = numFrames;
 
-    getEmptyRoomAvailable(&wrappingBuffer);
+    fifo_frames_t framesWritten = getEmptyRoomAvailable(&wrappingBuffer, numFrames);
 
     // Write data in one or two parts.
-    int partIndex = 0;
-    while (framesLeft > 0 && partIndex < WrappingBuffer::SIZE) {
-        fifo_frames_t framesToWrite = framesLeft;
-        fifo_frames_t framesAvailable = wrappingBuffer.numFrames[partIndex];
-        if (framesAvailable > 0) {
-            if (framesToWrite > framesAvailable) {
-                framesToWrite = framesAvailable;
-            }
-            int32_t numBytes = convertFramesToBytes(framesToWrite);
+    for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+        int32_t numBytes = convertFramesToBytes(wrappingBuffer.numFrames[partIndex]);
+        if (numBytes > 0) {
             memcpy(wrappingBuffer.data[partIndex], source, numBytes);
-
             source += numBytes;
-            framesLeft -= framesToWrite;
-        } else {
-            break;
         }
-        partIndex++;
     }
-    fifo_frames_t framesWritten = numFrames - framesLeft;
     mFifo->advanceWriteIndex(framesWritten);
     return framesWritten;
 }
@@ -195,26 +181,15 @@ void FifoBuffer::eraseMemory() {
 
 fifo_frames_t FifoBuffer::eraseEmptyMemory(fifo_frames_t numFrames) {
     WrappingBuffer wrappingBuffer;
-    fifo_frames_t framesLeft = numFrames;
 
-    getEmptyRoomAvailable(&wrappingBuffer);
+    fifo_frames_t framesErased = getEmptyRoomAvailable(&wrappingBuffer, numFrames);
 
     // Erase data in one or two parts.
-    int partIndex = 0;
-    while (framesLeft > 0 && partIndex < WrappingBuffer::SIZE) {
-        fifo_frames_t framesToWrite = framesLeft;
-        fifo_frames_t framesAvailable = wrappingBuffer.numFrames[partIndex];
-        if (framesAvailable > 0) {
-            if (framesToWrite > framesAvailable) {
-                framesToWrite = framesAvailable;
-            }
-            int32_t numBytes = convertFramesToBytes(framesToWrite);
+    for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+        int32_t numBytes = convertFramesToBytes(wrappingBuffer.numFrames[partIndex]);
+        if (numBytes > 0) {
             memset(wrappingBuffer.data[partIndex], 0, numBytes);
-            framesLeft -= framesToWrite;
-        } else {
-            break;
         }
-        partIndex++;
     }
-    return numFrames - framesLeft; // number erased
+    return framesErased;
 }
@@ -72,6 +72,26 @@ public:
      */
     fifo_frames_t getEmptyRoomAvailable(WrappingBuffer *wrappingBuffer);
 
+    /**
+     * Same as getFullDataAvailable() but limited to the first maxFrames full frames.
+     * This lets a caller consume the data in place, without copying it through
+     * an intermediate buffer, and then call advanceReadIndex().
+     * @param wrappingBuffer
+     * @param maxFrames
+     * @return total full frames in wrappingBuffer, at most maxFrames
+     */
+    fifo_frames_t getFullDataAvailable(WrappingBuffer *wrappingBuffer, fifo_frames_t maxFrames);
+
+    /**
+     * Same as getEmptyRoomAvailable() but limited to the first maxFrames empty frames.
+     * This lets a caller render the data in place, without copying it through
+     * an intermediate buffer, and then call advanceWriteIndex().
+     * @param wrappingBuffer
+     * @param maxFrames
+     * @return total empty frames in wrappingBuffer, at most maxFrames
+     */
+    fifo_frames_t getEmptyRoomAvailable(WrappingBuffer *wrappingBuffer, fifo_frames_t maxFrames);
+
     int32_t getBytesPerFrame() {
         return mBytesPerFrame;
     }
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Passes bursts of stereo float audio through a FifoBuffer, from a producer that
+// renders them to a consumer that sums them.
+//
+// BM_FifoCopy renders into a caller buffer that is then copied with write(), and
+// read()s into another caller buffer: two copies per burst.
+// BM_FifoInPlace renders into and sums from the regions returned by
+// getEmptyRoomAvailable() and getFullDataAvailable(): no copy.
+//
+// The FIFO is not a multiple of the burst long, so the regions regularly wrap.
+//
+// $ atest aaudio_fifo_benchmark
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "fifo/FifoBuffer.h"
+
+using android::fifo_frames_t;
+using android::FifoBufferAllocated;
+using android::WrappingBuffer;
+
+namespace {
+
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kFifoBursts = 4;
+
+void render(float *destination, int32_t numFrames, int32_t *phase) {
+    for (int32_t i = 0; i < numFrames * kChannelCount; i++) {
+        destination[i] = (float) *phase * (1.0f / 256.0f);
+        *phase = (*phase + 1) & 0xFF;
+    }
+}
+
+float sum(const float *source, int32_t numFrames) {
+    float total = 0.0f;
+    for (int32_t i = 0; i < numFrames * kChannelCount; i++) {
+        total += source[i];
+    }
+    return total;
+}
+
+// Argument: frames per burst.
+void BM_FifoCopy(benchmark::State& state) {
+    const int32_t framesPerBurst = state.range(0);
+    FifoBufferAllocated fifo(kChannelCount * sizeof(float),
+                             kFifoBursts * framesPerBurst + framesPerBurst / 3);
+    std::vector<float> renderBuffer(framesPerBurst * kChannelCount);
+    std::vector<float> readBuffer(framesPerBurst * kChannelCount);
+    int32_t phase = 0;
+    float total = 0.0f;
+    for (auto _ : state) {
+        render(renderBuffer.data(), framesPerBurst, &phase);
+        fifo.write(renderBuffer.data(), framesPerBurst);
+        fifo_frames_t framesRead = fifo.read(readBuffer.data(), framesPerBurst);
+        total += sum(readBuffer.data(), framesRead);
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetItemsProcessed(state.iterations() * framesPerBurst);
+}
+
+void BM_FifoInPlace(benchmark::State& state) {
+    const int32_t framesPerBurst = state.range(0);
+    FifoBufferAllocated fifo(kChannelCount * sizeof(float),
+                             kFifoBursts * framesPerBurst + framesPerBurst / 3);
+    int32_t phase = 0;
+    float total = 0.0f;
+    for (auto _ : state) {
+        WrappingBuffer wrappingBuffer;
+        fifo_frames_t framesWritten = fifo.getEmptyRoomAvailable(&wrappingBuffer,
+                                                                 framesPerBurst);
+        for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+            render((float *) wrappingBuffer.data[partIndex], wrappingBuffer.numFrames[partIndex],
+                   &phase);
+        }
+        fifo.advanceWriteIndex(framesWritten);
+
+        fifo_frames_t framesRead = fifo.getFullDataAvailable(&wrappingBuffer, framesPerBurst);
+        for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+            total += sum((const float *) wrappingBuffer.data[partIndex],
+                         wrappingBuffer.numFrames[partIndex]);
+        }
+        fifo.advanceReadIndex(framesRead);
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetItemsProcessed(state.iterations() * framesPerBurst);
+}
+
+// Low latency burst sizes, at 48 kHz from 0.33 to 4 msec.
+BENCHMARK(BM_FifoCopy)->ArgName("burst")->Arg(16)->Arg(32)->Arg(48)->Arg(96)->Arg(192);
+BENCHMARK(BM_FifoInPlace)->ArgName("burst")->Arg(16)->Arg(32)->Arg(48)->Arg(96)->Arg(192);
+
+}  // namespace
+
+BENCHMARK_MAIN();
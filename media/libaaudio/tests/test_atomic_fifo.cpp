@@ -296,6 +296,85 @@ public:
         verifyStorageIntegrity();
     }
 
+    // Render frames in place into at most numFrames of empty room.
+    fifo_frames_t writeFramesInPlace(fifo_frames_t numFrames) {
+        WrappingBuffer wrappingBuffer;
+        fifo_frames_t framesAvailable = mFifoBuffer.getEmptyRoomAvailable(&wrappingBuffer,
+                                                                          numFrames);
+        EXPECT_EQ(std::min(std::max(numFrames, 0), mFifoBuffer.getEmptyFramesAvailable()),
+                  framesAvailable);
+        EXPECT_EQ(framesAvailable, wrappingBuffer.numFrames[0] + wrappingBuffer.numFrames[1]);
+        for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+            int16_t *destination = (int16_t *) wrappingBuffer.data[partIndex];
+            for (fifo_frames_t i = 0; i < wrappingBuffer.numFrames[partIndex]; i++) {
+                destination[i] = mNextWriteIndex++;
+            }
+        }
+        mFifoBuffer.advanceWriteIndex(framesAvailable);
+        return framesAvailable;
+    }
+
+    // Verify at most numFrames full frames in place.
+    fifo_frames_t verifyFramesInPlace(fifo_frames_t numFrames) {
+        WrappingBuffer wrappingBuffer;
+        fifo_frames_t framesAvailable = mFifoBuffer.getFullDataAvailable(&wrappingBuffer,
+                                                                         numFrames);
+        EXPECT_EQ(std::min(std::max(numFrames, 0), mFifoBuffer.getFullFramesAvailable()),
+                  framesAvailable);
+        EXPECT_EQ(framesAvailable, wrappingBuffer.numFrames[0] + wrappingBuffer.numFrames[1]);
+        for (int partIndex = 0; partIndex < WrappingBuffer::SIZE; partIndex++) {
+            const int16_t *source = (const int16_t *) wrappingBuffer.data[partIndex];
+            for (fifo_frames_t i = 0; i < wrappingBuffer.numFrames[partIndex]; i++) {
+                EXPECT_EQ(mNextVerifyIndex++, source[i]);
+            }
+        }
+        mFifoBuffer.advanceReadIndex(framesAvailable);
+        return framesAvailable;
+    }
+
+    // Access limited regions that wrap around the end of the buffer.
+    void checkWrappingRegions() {
+        const fifo_frames_t capacity = mFifoBuffer.getBufferCapacityInFrames();
+        constexpr int frames1 = 9; // arbitrary, small
+        constexpr int gap = 5; // frames before the end of the buffer
+        // Move both indices close to the end of the buffer.
+        mFifoBuffer.setWriteCounter(capacity - gap);
+        mFifoBuffer.setReadCounter(capacity - gap);
+
+        // Limited to a single part before the end.
+        WrappingBuffer wrappingBuffer;
+        ASSERT_EQ(gap - 1, mFifoBuffer.getEmptyRoomAvailable(&wrappingBuffer, gap - 1));
+        EXPECT_EQ(gap - 1, wrappingBuffer.numFrames[0]);
+        EXPECT_EQ(0, wrappingBuffer.numFrames[1]);
+        EXPECT_EQ(nullptr, wrappingBuffer.data[1]);
+
+        // Nothing for zero or negative limits.
+        ASSERT_EQ(0, mFifoBuffer.getEmptyRoomAvailable(&wrappingBuffer, 0));
+        EXPECT_EQ(0, wrappingBuffer.numFrames[0] + wrappingBuffer.numFrames[1]);
+        ASSERT_EQ(0, mFifoBuffer.getEmptyRoomAvailable(&wrappingBuffer, -3));
+        EXPECT_EQ(0, wrappingBuffer.numFrames[0] + wrappingBuffer.numFrames[1]);
+
+        // Split in two parts across the end.
+        ASSERT_EQ(gap + frames1, mFifoBuffer.getEmptyRoomAvailable(&wrappingBuffer,
+                                                                  gap + frames1));
+        EXPECT_EQ(gap, wrappingBuffer.numFrames[0]);
+        EXPECT_EQ(frames1, wrappingBuffer.numFrames[1]);
+        EXPECT_EQ((void *) mFifoStorage, wrappingBuffer.data[1]);
+
+        ASSERT_EQ(gap + frames1, writeFramesInPlace(gap + frames1));
+        verifyWrappingBuffer();
+        ASSERT_EQ(gap - 1, verifyFramesInPlace(gap - 1));
+        ASSERT_EQ(frames1 + 1, verifyFramesInPlace(capacity)); // clipped to the data
+        verifyWrappingBuffer();
+
+        // Clipped to the room.
+        ASSERT_EQ(mThreshold, writeFramesInPlace(capacity + 1));
+        ASSERT_EQ(0, writeFramesInPlace(1));
+        ASSERT_EQ(mThreshold, verifyFramesInPlace(mThreshold));
+
+        verifyStorageIntegrity();
+    }
+
     // Write and Read a specific amount of data.
     void checkNegativeCounters() {
         fifo_counter_t counter = -9876;
@@ -387,3 +466,16 @@ TEST(test_fifo_buffer, fifo_full_wrap) {
     TestFifoBuffer tester(capacity);
     tester.checkFullWrap();
 }
+
+TEST(test_fifo_buffer, fifo_wrapping_regions) {
+    constexpr int capacity = 53; // arbitrary
+    TestFifoBuffer tester(capacity);
+    tester.checkWrappingRegions();
+}
+
+TEST(test_fifo_buffer, fifo_wrapping_regions_threshold) {
+    constexpr int capacity = 61; // arbitrary
+    constexpr int threshold = 43; // arbitrary
+    TestFifoBuffer tester(capacity, threshold);
+    tester.checkWrappingRegions();
+}
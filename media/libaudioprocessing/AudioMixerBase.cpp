@@ -27,6 +27,7 @@
 #include <media/AudioMixerBase.h>
 #include <utils/Log.h>
 
+#include "AudioMixerMultiOps.h"
 #include "AudioMixerOps.h"
 
 // The FCC_2 macro refers to the Fixed Channel Count of 2 for the legacy integer mixer.
@@ -1126,8 +1127,38 @@ void AudioMixerBase::process__genericNoResampling()
         do {
             const size_t frameCount = std::min((size_t)BLOCKSIZE, mFrameCount - numFrames);
             memset(outTemp, 0, sizeof(outTemp));
+
+            // Consecutive float tracks at constant volume are accumulated
+            // together by mixMultiTracks(); the batch is flushed before any other
+            // track so that the summation order, and thus the result, is unchanged.
+            const float *multiMixIn[kMaxMultiMixTracks];
+            MultiMixVolume multiMixVolume[kMaxMultiMixTracks];
+            size_t multiMixTracks = 0;
+            size_t multiMixSamples = 0;
+            const auto flushMultiMix = [&]() {
+                if (multiMixTracks > 0) {
+                    mixMultiTracks(reinterpret_cast<float *>(outTemp), multiMixSamples,
+                            multiMixIn, multiMixVolume, multiMixTracks);
+                    multiMixTracks = 0;
+                }
+            };
+
             for (const int name : group) {
                 const std::shared_ptr<TrackBase> &t = mTracks[name];
+                if (t->getMultiMixVolume(frameCount, &multiMixVolume[multiMixTracks])) {
+                    // All tracks of a group share the mixer channel count.
+                    const size_t sampleCount = frameCount * t->mMixerChannelCount;
+                    multiMixSamples = sampleCount;
+                    multiMixIn[multiMixTracks++] = static_cast<const float *>(t->mIn);
+                    t->mIn = static_cast<const float *>(t->mIn) + sampleCount;
+                    t->frameCount -= frameCount;
+                    if (multiMixTracks == kMaxMultiMixTracks) {
+                        flushMultiMix();
+                    }
+                    continue;
+                }
+                flushMultiMix();
+
                 int32_t *aux = NULL;
                 if (CC_UNLIKELY(t->needs & NEEDS_AUX)) {
                     aux = t->auxBuffer + numFrames;
@@ -1162,6 +1193,7 @@ void AudioMixerBase::process__genericNoResampling()
                     }
                 }
             }
+            flushMultiMix();
 
             const std::shared_ptr<TrackBase> &t1 = mTracks[group[0]];
             convertMixerFormat(out, t1->mMixerFormat, outTemp, t1->mMixerInFormat,
@@ -1450,6 +1482,30 @@ void AudioMixerBase::TrackBase::volumeMix(TO *out, size_t outFrames,
     }
 }
 
+bool AudioMixerBase::TrackBase::getMultiMixVolume(
+        size_t numFrames, MultiMixVolume *multiMixVolume)
+{
+    const hook_t hookStereoVolume = (AudioMixerBase::hook_t) &TrackBase::track__NoResample<
+            MIXTYPE_MULTI_STEREOVOL, float /*TO*/, float /*TI*/, TYPE_AUX>;
+    const hook_t hookMulti = (AudioMixerBase::hook_t) &TrackBase::track__NoResample<
+            MIXTYPE_MULTI, float /*TO*/, float /*TI*/, TYPE_AUX>;
+
+    // Only the float hooks with plain per-channel volumes qualify; anything
+    // with aux, a volume ramp, or a partial input buffer takes the regular path.
+    if (mMixerInFormat != AUDIO_FORMAT_PCM_FLOAT
+            || (needs & (NEEDS_AUX | NEEDS_RESAMPLE | NEEDS_MUTE)) != 0
+            || (hook != hookStereoVolume && hook != hookMulti)
+            || mMixerChannelCount > FCC_2
+            || mIn == nullptr || numFrames > frameCount
+            || needsRamp()) {
+        return false;
+    }
+
+    // A mono sink is AUDIO_CHANNEL_OUT_MONO (front left), so both hooks use mVolume[0].
+    multiMixSetVolume(multiMixVolume, mVolume, mMixerChannelCount);
+    return true;
+}
+
 /* This process hook is called when there is a single track without
  * aux buffer, volume ramp, or resampling.
  * TODO: Update the hook selection: this can properly handle aux and ramp.
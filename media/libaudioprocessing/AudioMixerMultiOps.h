@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_MIXER_MULTI_OPS_H
+#define ANDROID_AUDIO_MIXER_MULTI_OPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__aarch64__) || defined(__ARM_NEON__)
+#define MULTIMIX_USE_NEON (true)
+#include <arm_neon.h>
+#else
+#define MULTIMIX_USE_NEON (false)
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define MULTIMIX_USE_SSE (true)   // SSE2 is part of the x86 ABI, AVX2 is probed at runtime.
+#include <immintrin.h>
+#else
+#define MULTIMIX_USE_SSE (false)
+#endif
+
+namespace android {
+
+/*
+ * Fused multi-track accumulation for the float mixer engine.
+ *
+ * AudioMixerBase normally mixes each enabled track into the output temp
+ * buffer in turn, which reloads and stores the accumulator once per track.
+ * mixMultiTracks() instead adds up to kMaxMultiMixTracks tracks per pass:
+ *
+ *   out[i] += in[0][i] * vol[0][i % 8] + ... + in[n - 1][i] * vol[n - 1][i % 8]
+ *
+ * The products are added to the accumulator in track order with separate
+ * multiply and add operations (no fma), so the result is bit-exact with
+ * mixing the same tracks one at a time through volumeMulti().
+ *
+ * Volume ramps are not handled here; ramping tracks keep using the
+ * per-track hooks, which also update the ramp state.
+ */
+
+constexpr size_t kMaxMultiMixTracks = 8;
+
+// Volume for 8 consecutive interleaved samples. Any channel count dividing 8
+// is described by repeating its per-channel volumes, see multiMixSetVolume().
+struct MultiMixVolume {
+    alignas(32) float v[8];
+};
+
+inline void multiMixSetVolume(
+        MultiMixVolume *volume, const float *channelVolumes, uint32_t channelCount) {
+    for (size_t i = 0; i < 8; ++i) {
+        volume->v[i] = channelVolumes[i % channelCount];
+    }
+}
+
+namespace multimix {
+
+// Scalar version, also used for the tail of the vector versions.
+inline void mixTracksScalar(float *out, size_t begin, size_t end,
+        const float *const *in, const MultiMixVolume *vol, size_t numTracks) {
+    for (size_t i = begin; i < end; ++i) {
+        float accum = out[i];
+        for (size_t t = 0; t < numTracks; ++t) {
+            const float product = in[t][i] * vol[t].v[i & 7];
+            accum += product;
+        }
+        out[i] = accum;
+    }
+}
+
+#if MULTIMIX_USE_NEON
+inline void mixTracksNeon(float *out, size_t sampleCount,
+        const float *const *in, const MultiMixVolume *vol, size_t numTracks) {
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        float32x4_t accum0 = vld1q_f32(out + i);
+        float32x4_t accum1 = vld1q_f32(out + i + 4);
+        for (size_t t = 0; t < numTracks; ++t) {
+            accum0 = vaddq_f32(accum0,
+                    vmulq_f32(vld1q_f32(in[t] + i), vld1q_f32(vol[t].v)));
+            accum1 = vaddq_f32(accum1,
+                    vmulq_f32(vld1q_f32(in[t] + i + 4), vld1q_f32(vol[t].v + 4)));
+        }
+        vst1q_f32(out + i, accum0);
+        vst1q_f32(out + i + 4, accum1);
+    }
+    mixTracksScalar(out, i, sampleCount, in, vol, numTracks);
+}
+#endif // MULTIMIX_USE_NEON
+
+#if MULTIMIX_USE_SSE
+inline void mixTracksSse(float *out, size_t sampleCount,
+        const float *const *in, const MultiMixVolume *vol, size_t numTracks) {
+    size_t i = 0;
+    for (; i + 8 <= sampleCount; i += 8) {
+        __m128 accum0 = _mm_loadu_ps(out + i);
+        __m128 accum1 = _mm_loadu_ps(out + i + 4);
+        for (size_t t = 0; t < numTracks; ++t) {
+            accum0 = _mm_add_ps(accum0,
+                    _mm_mul_ps(_mm_loadu_ps(in[t] + i), _mm_load_ps(vol[t].v)));
+            accum1 = _mm_add_ps(accum1,
+                    _mm_mul_ps(_mm_loadu_ps(in[t] + i + 4), _mm_load_ps(vol[t].v + 4)));
+        }
+        _mm_storeu_ps(out + i, accum0);
+        _mm_storeu_ps(out + i + 4, accum1);
+    }
+    mixTracksScalar(out, i, sampleCount, in, vol, numTracks);
+}
+
+__attribute__((target("avx2")))
+inline void mixTracksAvx2(float *out, size_t sampleCount,
+        const float *const *in, const MultiMixVolume *vol, size_t numTracks) {
+    size_t i = 0;
+    for (; i + 16 <= sampleCount; i += 16) {
+        __m256 accum0 = _mm256_loadu_ps(out + i);
+        __m256 accum1 = _mm256_loadu_ps(out + i + 8);
+        for (size_t t = 0; t < numTracks; ++t) {
+            const __m256 volume = _mm256_load_ps(vol[t].v);
+            accum0 = _mm256_add_ps(accum0, _mm256_mul_ps(_mm256_loadu_ps(in[t] + i), volume));
+            accum1 = _mm256_add_ps(accum1, _mm256_mul_ps(_mm256_loadu_ps(in[t] + i + 8), volume));
+        }
+        _mm256_storeu_ps(out + i, accum0);
+        _mm256_storeu_ps(out + i + 8, accum1);
+    }
+    mixTracksScalar(out, i, sampleCount, in, vol, numTracks);
+}
+
+inline bool cpuHasAvx2() {
+#if defined(__AVX2__)
+    return true;
+#else
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+#endif
+}
+#endif // MULTIMIX_USE_SSE
+
+} // namespace multimix
+
+/*
+ * Accumulates numTracks (<= kMaxMultiMixTracks) float tracks of sampleCount
+ * interleaved samples each into out. The vector kernels process 8 samples at
+ * a time, so the volume pattern stays aligned with the interleaved channels.
+ */
+inline void mixMultiTracks(float *out, size_t sampleCount,
+        const float *const *in, const MultiMixVolume *vol, size_t numTracks) {
+#if MULTIMIX_USE_NEON
+    multimix::mixTracksNeon(out, sampleCount, in, vol, numTracks);
+#elif MULTIMIX_USE_SSE
+    if (multimix::cpuHasAvx2()) {
+        multimix::mixTracksAvx2(out, sampleCount, in, vol, numTracks);
+    } else {
+        multimix::mixTracksSse(out, sampleCount, in, vol, numTracks);
+    }
+#else
+    multimix::mixTracksScalar(out, 0, sampleCount, in, vol, numTracks);
+#endif
+}
+
+} // namespace android
+
+#endif // ANDROID_AUDIO_MIXER_MULTI_OPS_H
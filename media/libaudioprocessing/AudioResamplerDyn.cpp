@@ -30,6 +30,7 @@
 
 #include "AudioResamplerFirOps.h" // USE_NEON, USE_SSE and USE_INLINE_ASSEMBLY defined here
 #include "AudioResamplerFirProcess.h"
+#include "AudioResamplerFirProcessAVX2.h"
 #include "AudioResamplerFirProcessNeon.h"
 #include "AudioResamplerFirProcessSSE.h"
 #include "AudioResamplerFirGen.h" // requires math.h
@@ -548,6 +549,18 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
     LOG_ALWAYS_FATAL_IF(mChannelCount < 1 || mChannelCount > FCC_LIMIT,
             "Resampler channels(%d) must be between 1 to %d", mChannelCount, FCC_LIMIT);
     // stride 16 (falls back to stride 2 for machines that do not support NEON)
+    //
+    // For float, 1 to 8 channels, x86 CPUs supporting AVX2 and FMA use the STRIDE_AVX2
+    // specializations (which also require a multiple of 16 filter coefficients).
+#if USE_AVX2_DISPATCH
+    constexpr bool isFloat = is_same<TC, float>::value && is_same<TI, float>::value
+            && is_same<TO, float>::value;
+    const bool useAvx2 = isFloat && cpuSupportsAvx2();
+#else
+    constexpr bool isFloat = false;
+    [[maybe_unused]] constexpr bool useAvx2 = false;
+    [[maybe_unused]] constexpr int STRIDE_AVX2 = 16;
+#endif
 
 
 // For now use a #define as a compiler generated function table requires renaming.
@@ -555,6 +568,13 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
 #undef AUDIORESAMPLERDYN_CASE
 #define AUDIORESAMPLERDYN_CASE(CHANNEL, LOCKED) \
     case CHANNEL: if constexpr (CHANNEL <= FCC_LIMIT) {\
+        if constexpr (isFloat && CHANNEL <= 8) { \
+            if (useAvx2) { \
+                mResampleFunc = \
+                        &AudioResamplerDyn<TC, TI, TO>::resample<CHANNEL, LOCKED, STRIDE_AVX2>; \
+                break; \
+            } \
+        } \
         mResampleFunc = &AudioResamplerDyn<TC, TI, TO>::resample<CHANNEL, LOCKED, 16>; \
     } break
 
@@ -616,9 +636,9 @@ void AudioResamplerDyn<TC, TI, TO>::setSampleRate(int32_t inSampleRate)
 #pragma pop_macro("AUDIORESAMPLERDYN_CASE")
 
 #ifdef DEBUG_RESAMPLER
-    printf("channels:%d  %s  stride:%d  %s  coef:%d  shift:%d\n",
+    printf("channels:%d  %s  stride:%d  %s  coef:%d  shift:%d  avx2:%d\n",
             mChannelCount, locked ? "locked" : "interpolated",
-            stride, useS32 ? "S32" : "S16", 2*c.mHalfNumCoefs, c.mShift);
+            stride, useS32 ? "S32" : "S16", 2*c.mHalfNumCoefs, c.mShift, useAvx2);
 #endif
 }
 
@@ -49,6 +49,13 @@ namespace android {
 #define USE_AVX2(false)
 #endif
 
+#if defined(__i386__) || defined(__x86_64__)
+#define USE_AVX2_DISPATCH (true)  // AVX2/FMA intrinsics for run time selection
+#include <immintrin.h>
+#else
+#define USE_AVX2_DISPATCH (false)
+#endif
+
 
 template<typename T, typename U>
 struct is_same
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_AVX2_H
+#define ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_AVX2_H
+
+namespace android {
+
+// depends on AudioResamplerFirOps.h, AudioResamplerFirProcess.h
+
+#if USE_AVX2_DISPATCH
+
+//
+// AVX2/FMA specializations of Process() and ProcessL() for float, 1 to 8 channels.
+//
+// Unlike the SSE specializations, these are compiled for any x86 target and keyed on
+// STRIDE_AVX2 rather than 16; AudioResamplerDyn selects them at run time when the CPU
+// supports AVX2 and FMA (see cpuSupportsAvx2()).
+//
+// Each iteration fetches 8 coefficients per side and applies them to 8 input frames:
+// - for 1, 2, 4 and 8 channels, the interleaved input frames are loaded as is, 8 / CHANNELS
+//   frames per vector, and the coefficients are permuted to line up with their frames.
+// - for 3, 5, 6 and 7 channels, one frame is loaded per vector (masked) and each coefficient
+//   is broadcast across the channels.
+//
+
+constexpr int STRIDE_AVX2 = 32;
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#define AVX2_TARGET_INLINE __attribute__((target("avx2,fma"), always_inline))
+
+static inline bool cpuSupportsAvx2()
+{
+    static const bool supported =
+            __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+
+// Permutations of 8 consecutive coefficients lining them up with the samples of the vectors
+// of 8 / CHANNELS interleaved frames: for vector b, lane l holds a sample of the frame
+// b * FRAMES + l / CHANNELS on the negative side, and of the frame
+// b * FRAMES + FRAMES - 1 - l / CHANNELS on the (decrementing) positive side.
+template <int CHANNELS>
+struct CoefPermutationsAVX2 {
+    static_assert(8 % CHANNELS == 0, "CHANNELS must divide 8");
+    static constexpr int FRAMES = 8 / CHANNELS;
+
+    constexpr CoefPermutationsAVX2() : pos(), neg() {
+        for (int b = 0; b < CHANNELS; ++b) {
+            for (int l = 0; l < 8; ++l) {
+                pos[b][l] = b * FRAMES + FRAMES - 1 - l / CHANNELS;
+                neg[b][l] = b * FRAMES + l / CHANNELS;
+            }
+        }
+    }
+
+    alignas(32) int32_t pos[CHANNELS][8];
+    alignas(32) int32_t neg[CHANNELS][8];
+};
+
+// Sums the accumulated channels and adds them to the output frame, with volume.
+template <int CHANNELS, int FRAMES>
+AVX2_TARGET_INLINE static inline void accumulateAVX2(float* out, __m256 acc,
+        const float* volumeLR)
+{
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, acc);
+    float sums[CHANNELS];
+    for (int c = 0; c < CHANNELS; ++c) {
+        sums[c] = lanes[c];
+        for (int f = 1; f < FRAMES; ++f) {
+            sums[c] += lanes[f * CHANNELS + c];
+        }
+    }
+    if (CHANNELS == 1) {
+        out[0] += sums[0] * volumeLR[0];
+        out[1] += sums[0] * volumeLR[1];
+    } else if (CHANNELS == 2) {
+        out[0] += sums[0] * volumeLR[0];
+        out[1] += sums[1] * volumeLR[1];
+    } else {
+        for (int c = 0; c < CHANNELS; ++c) {
+            out[c] += sums[c] * volumeLR[0];
+        }
+    }
+}
+
+// Loads the coefficients of the next 8 taps of each side, interpolated if !FIXED.
+template <bool FIXED>
+AVX2_TARGET_INLINE static inline void loadCoefsAVX2(__m256& posCoef, __m256& negCoef,
+        const float*& coefsP, const float*& coefsN,
+        const float*& coefsP1, const float*& coefsN1, __m256 interp)
+{
+    posCoef = _mm256_loadu_ps(coefsP);
+    negCoef = _mm256_loadu_ps(coefsN);
+    coefsP += 8;
+    coefsN += 8;
+    if (!FIXED) {
+        // posCoef = interp * (posCoef1 - posCoef) + posCoef
+        // negCoef = interp * (negCoef - negCoef1) + negCoef1
+        const __m256 posCoef1 = _mm256_loadu_ps(coefsP1);
+        const __m256 negCoef1 = _mm256_loadu_ps(coefsN1);
+        coefsP1 += 8;
+        coefsN1 += 8;
+        posCoef = _mm256_fmadd_ps(_mm256_sub_ps(posCoef1, posCoef), interp, posCoef);
+        negCoef = _mm256_fmadd_ps(_mm256_sub_ps(negCoef, negCoef1), interp, negCoef1);
+    }
+}
+
+template <int CHANNELS, bool FIXED>
+AVX2_TARGET static void ProcessAVX2Interleaved(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    constexpr int FRAMES = 8 / CHANNELS;
+    static constexpr CoefPermutationsAVX2<CHANNELS> kPermutations{};
+
+    const __m256 interp = _mm256_set1_ps(lerpP);
+    __m256 accP = _mm256_setzero_ps();
+    __m256 accN = _mm256_setzero_ps();
+
+    // the lowest address of the first vector of frames on the positive side
+    sP -= (FRAMES - 1) * CHANNELS;
+    do {
+        __m256 posCoef, negCoef;
+        loadCoefsAVX2<FIXED>(posCoef, negCoef, coefsP, coefsN, coefsP1, coefsN1, interp);
+        for (int b = 0; b < CHANNELS; ++b) {
+            const __m256 posSamp = _mm256_loadu_ps(sP - b * 8);
+            const __m256 negSamp = _mm256_loadu_ps(sN + b * 8);
+            const __m256i posIndex = _mm256_load_si256(
+                    reinterpret_cast<const __m256i*>(kPermutations.pos[b]));
+            accP = _mm256_fmadd_ps(posSamp, _mm256_permutevar8x32_ps(posCoef, posIndex), accP);
+            if (CHANNELS == 1) {
+                accN = _mm256_fmadd_ps(negSamp, negCoef, accN);
+            } else {
+                const __m256i negIndex = _mm256_load_si256(
+                        reinterpret_cast<const __m256i*>(kPermutations.neg[b]));
+                accN = _mm256_fmadd_ps(negSamp, _mm256_permutevar8x32_ps(negCoef, negIndex),
+                        accN);
+            }
+        }
+        sP -= 8 * CHANNELS;
+        sN += 8 * CHANNELS;
+    } while (count -= 8);
+
+    accumulateAVX2<CHANNELS, FRAMES>(out, _mm256_add_ps(accP, accN), volumeLR);
+    _mm256_zeroupper(); // the caller may be built for SSE only
+}
+
+template <int CHANNELS, bool FIXED>
+AVX2_TARGET static void ProcessAVX2PerFrame(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    ALOG_ASSERT(count > 0 && (count & 7) == 0); // multiple of 8
+    static_assert(CHANNELS > 2 && CHANNELS < 8, "CHANNELS must be 3 to 7");
+
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(CHANNELS),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256 interp = _mm256_set1_ps(lerpP);
+    __m256 accP = _mm256_setzero_ps();
+    __m256 accN = _mm256_setzero_ps();
+
+    do {
+        __m256 posCoef, negCoef;
+        loadCoefsAVX2<FIXED>(posCoef, negCoef, coefsP, coefsN, coefsP1, coefsN1, interp);
+        for (int i = 0; i < 8; ++i) {
+            const __m256i broadcast = _mm256_set1_epi32(i);
+            const __m256 posSamp = _mm256_maskload_ps(sP - i * CHANNELS, mask);
+            const __m256 negSamp = _mm256_maskload_ps(sN + i * CHANNELS, mask);
+            accP = _mm256_fmadd_ps(posSamp, _mm256_permutevar8x32_ps(posCoef, broadcast), accP);
+            accN = _mm256_fmadd_ps(negSamp, _mm256_permutevar8x32_ps(negCoef, broadcast), accN);
+        }
+        sP -= 8 * CHANNELS;
+        sN += 8 * CHANNELS;
+    } while (count -= 8);
+
+    accumulateAVX2<CHANNELS, 1 /* FRAMES */>(out, _mm256_add_ps(accP, accN), volumeLR);
+    _mm256_zeroupper(); // the caller may be built for SSE only
+}
+
+template <int CHANNELS, bool FIXED>
+static inline void ProcessAVX2(float* out,
+        int count,
+        const float* coefsP,
+        const float* coefsN,
+        const float* sP,
+        const float* sN,
+        const float* volumeLR,
+        float lerpP,
+        const float* coefsP1,
+        const float* coefsN1)
+{
+    static_assert(CHANNELS >= 1 && CHANNELS <= 8, "CHANNELS must be 1 to 8");
+    if constexpr (8 % CHANNELS == 0) {
+        ProcessAVX2Interleaved<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    } else {
+        ProcessAVX2PerFrame<CHANNELS, FIXED>(out, count, coefsP, coefsN, sP, sN, volumeLR,
+                lerpP, coefsP1, coefsN1);
+    }
+}
+
+#pragma push_macro("PROCESS_AVX2_SPECIALIZATIONS")
+#undef PROCESS_AVX2_SPECIALIZATIONS
+#define PROCESS_AVX2_SPECIALIZATIONS(CHANNELS) \
+template<> \
+inline void ProcessL<CHANNELS, STRIDE_AVX2>(float* const out, \
+        int count, \
+        const float* coefsP, \
+        const float* coefsN, \
+        const float* sP, \
+        const float* sN, \
+        const float* const volumeLR) \
+{ \
+    ProcessAVX2<CHANNELS, true>(out, count, coefsP, coefsN, sP, sN, volumeLR, \
+            0 /*lerpP*/, NULL /*coefsP1*/, NULL /*coefsN1*/); \
+} \
+\
+template<> \
+inline void Process<CHANNELS, STRIDE_AVX2>(float* const out, \
+        int count, \
+        const float* coefsP, \
+        const float* coefsN, \
+        const float* coefsP1, \
+        const float* coefsN1, \
+        const float* sP, \
+        const float* sN, \
+        float lerpP, \
+        const float* const volumeLR) \
+{ \
+    ProcessAVX2<CHANNELS, false>(out, count, coefsP, coefsN, sP, sN, volumeLR, \
+            lerpP, coefsP1, coefsN1); \
+}
+
+PROCESS_AVX2_SPECIALIZATIONS(1)
+PROCESS_AVX2_SPECIALIZATIONS(2)
+PROCESS_AVX2_SPECIALIZATIONS(3)
+PROCESS_AVX2_SPECIALIZATIONS(4)
+PROCESS_AVX2_SPECIALIZATIONS(5)
+PROCESS_AVX2_SPECIALIZATIONS(6)
+PROCESS_AVX2_SPECIALIZATIONS(7)
+PROCESS_AVX2_SPECIALIZATIONS(8)
+#pragma pop_macro("PROCESS_AVX2_SPECIALIZATIONS")
+
+#endif //USE_AVX2_DISPATCH
+
+} // namespace android
+
+#endif /*ANDROID_AUDIO_RESAMPLER_FIR_PROCESS_AVX2_H*/
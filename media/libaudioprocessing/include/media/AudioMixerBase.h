@@ -36,6 +36,8 @@
 
 namespace android {
 
+struct MultiMixVolume;
+
 // ----------------------------------------------------------------------------
 
 // AudioMixerBase is functional on its own if only mixing and resampling
@@ -242,6 +244,10 @@ public:
             typename TO, typename TI, typename TA>
         void volumeMix(TO *out, size_t outFrames, const TI *in, TA *aux, bool ramp);
 
+        // Returns true if the next numFrames frames of this track can be mixed
+        // together with other tracks by mixMultiTracks(), and fills in the volume.
+        bool        getMultiMixVolume(size_t numFrames, MultiMixVolume *volume);
+
         uint32_t    needs;
 
         // TODO: Eventually remove legacy integer volume settings
@@ -18,9 +18,13 @@
 #include <type_traits>
 #define LOG_ALWAYS_FATAL(...)
 
+#include <../AudioMixerMultiOps.h>
 #include <../AudioMixerOps.h>
 #include <benchmark/benchmark.h>
 
+#include <random>
+#include <vector>
+
 using namespace android;
 
 template <int MIXTYPE, int NCHAN>
@@ -101,4 +105,75 @@ BENCHMARK_TEMPLATE(BM_VolumeMulti, MIXTYPE_MULTI_SAVEONLY_MONOVOL, 8);
 BENCHMARK_TEMPLATE(BM_VolumeMulti, MIXTYPE_MULTI_STEREOVOL, 8);
 BENCHMARK_TEMPLATE(BM_VolumeMulti, MIXTYPE_MULTI_SAVEONLY_STEREOVOL, 8);
 
+// Mixes NTRACKS stereo float tracks into a stereo output, one track at a time
+// as AudioMixerBase did before mixMultiTracks().
+template <int NTRACKS>
+static void BM_MixTracksSequential(benchmark::State& state) {
+    constexpr size_t NCHAN = 2;
+    const size_t frameCount = state.range(0);
+    const size_t sampleCount = frameCount * NCHAN;
+
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+    std::vector<float> out(sampleCount);
+    std::vector<std::vector<float>> in(NTRACKS, std::vector<float>(sampleCount));
+    float vol[NTRACKS][2];
+    for (int t = 0; t < NTRACKS; ++t) {
+        for (auto& sample : in[t]) sample = dis(gen);
+        vol[t][0] = dis(gen);
+        vol[t][1] = dis(gen);
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(out.data());
+        for (int t = 0; t < NTRACKS; ++t) {
+            volumeMulti<MIXTYPE_MULTI_STEREOVOL, NCHAN>(
+                    out.data(), frameCount, in[t].data(), (float *)nullptr, vol[t], 0.f);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frameCount * NTRACKS);
+}
+
+// Same mix through the fused kernel, kMaxMultiMixTracks tracks per pass.
+template <int NTRACKS>
+static void BM_MixTracksFused(benchmark::State& state) {
+    constexpr size_t NCHAN = 2;
+    const size_t frameCount = state.range(0);
+    const size_t sampleCount = frameCount * NCHAN;
+
+    std::minstd_rand gen(42);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+    std::vector<float> out(sampleCount);
+    std::vector<std::vector<float>> in(NTRACKS, std::vector<float>(sampleCount));
+    const float *inPtr[NTRACKS];
+    MultiMixVolume vol[NTRACKS];
+    for (int t = 0; t < NTRACKS; ++t) {
+        for (auto& sample : in[t]) sample = dis(gen);
+        const float channelVolumes[2] = {dis(gen), dis(gen)};
+        multiMixSetVolume(&vol[t], channelVolumes, NCHAN);
+        inPtr[t] = in[t].data();
+    }
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(out.data());
+        for (int t = 0; t < NTRACKS; t += kMaxMultiMixTracks) {
+            mixMultiTracks(out.data(), sampleCount, inPtr + t, vol + t,
+                    std::min<size_t>(kMaxMultiMixTracks, NTRACKS - t));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * frameCount * NTRACKS);
+}
+
+// 16 frames is the AudioMixerBase block size, 960 frames a 20 ms period at 48 kHz.
+BENCHMARK_TEMPLATE(BM_MixTracksSequential, 1)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksFused, 1)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksSequential, 4)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksFused, 4)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksSequential, 8)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksFused, 8)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksSequential, 32)->Arg(16)->Arg(960);
+BENCHMARK_TEMPLATE(BM_MixTracksFused, 32)->Arg(16)->Arg(960);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput of the dynamic resampler for float, in output frames per second,
+// for the sample rate conversions common on output devices.
+//
+// $ atest resampler_benchmark
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/AudioBufferProvider.h>
+#include <media/AudioResampler.h>
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kOutputFrames = 960;  // 20 ms at 48 kHz
+
+// Provides the same block of noise, over and over.
+class LoopingProvider : public AudioBufferProvider {
+public:
+    LoopingProvider(int channels, size_t frames)
+        : mChannels(channels), mFrames(frames), mData(channels * frames) {
+        std::minstd_rand gen(channels);
+        std::uniform_real_distribution<float> dis(-1.f, 1.f);
+        for (auto& sample : mData) sample = dis(gen);
+    }
+
+    status_t getNextBuffer(Buffer* buffer) override {
+        buffer->frameCount = std::min(buffer->frameCount, mFrames - mNextFrame);
+        buffer->raw = mData.data() + mNextFrame * mChannels;
+        return NO_ERROR;
+    }
+
+    void releaseBuffer(Buffer* buffer) override {
+        mNextFrame += buffer->frameCount;
+        if (mNextFrame >= mFrames) {
+            mNextFrame = 0;
+        }
+        buffer->frameCount = 0;
+        buffer->raw = nullptr;
+    }
+
+private:
+    const int mChannels;
+    const size_t mFrames;
+    std::vector<float> mData;
+    size_t mNextFrame = 0;
+};
+
+// Arguments: input sample rate, output sample rate, channel count.
+void BM_ResamplerDynFloat(benchmark::State& state) {
+    const int inSampleRate = state.range(0);
+    const int outSampleRate = state.range(1);
+    const int channels = state.range(2);
+
+    std::unique_ptr<AudioResampler> resampler(AudioResampler::create(AUDIO_FORMAT_PCM_FLOAT,
+            channels, outSampleRate, AudioResampler::DYN_HIGH_QUALITY));
+    resampler->setSampleRate(inSampleRate);
+    resampler->setVolume(AudioResampler::UNITY_GAIN_FLOAT, AudioResampler::UNITY_GAIN_FLOAT);
+    LoopingProvider provider(channels, 4096);
+    // the resampler accumulates into the output, which is at least stereo.
+    std::vector<float> out(kOutputFrames * std::max(channels, 2));
+
+    for (auto _ : state) {
+        resampler->resample(reinterpret_cast<int32_t*>(out.data()), kOutputFrames, &provider);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kOutputFrames);
+}
+
+void ResamplerArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"in", "out", "channels"});
+    for (const auto& [in, out] : std::vector<std::pair<int, int>>{
+            {44100, 48000}, {48000, 16000}, {96000, 48000}, {48000, 44100}}) {
+        for (int channels : {1, 2, 4, 6, 8, 12}) {
+            b->Args({in, out, channels});
+        }
+    }
+}
+
+BENCHMARK(BM_ResamplerDynFloat)->Apply(ResamplerArgs);
+
+}  // namespace
+
+BENCHMARK_MAIN();
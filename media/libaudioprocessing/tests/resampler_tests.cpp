@@ -30,6 +30,7 @@
 
 #include <iostream>
 #include <memory>
+#include <random>
 #include <utility>
 #include <vector>
 
@@ -40,6 +41,9 @@
 #include <media/AudioResampler.h>
 #include "../AudioResamplerDyn.h"
 #include "../AudioResamplerFirGen.h"
+#include "../AudioResamplerFirOps.h"
+#include "../AudioResamplerFirProcess.h"
+#include "../AudioResamplerFirProcessAVX2.h"
 #include "test_utils.h"
 
 template <typename T>
@@ -601,3 +605,62 @@ TEST(audioflinger_resampler, generalresponse) {
         }
     }
 }
+
+#if USE_AVX2_DISPATCH
+// Compares the AVX2/FMA dot products with the generic ones, for fixed and interpolated phase.
+template <int CHANNELS>
+void testProcessAVX2()
+{
+    constexpr int kHalfNumCoefs = 64;
+    std::minstd_rand gen(CHANNELS);
+    std::uniform_real_distribution<float> dis(-1.f, 1.f);
+
+    // two consecutive polyphases for each side, as laid out by fir().
+    std::vector<float> coefs(4 * kHalfNumCoefs);
+    std::vector<float> samples((2 * kHalfNumCoefs + 1) * CHANNELS);
+    for (auto& coef : coefs) coef = dis(gen);
+    for (auto& sample : samples) sample = dis(gen);
+    const float* coefsP = coefs.data();
+    const float* coefsN = coefs.data() + 2 * kHalfNumCoefs;
+    const float* sP = samples.data() + (kHalfNumCoefs - 1) * CHANNELS;
+    const float* sN = sP + CHANNELS;
+    const float volumeLR[2] = {0.5f, 0.75f};
+    constexpr int kOutSamples = CHANNELS == 1 ? 2 : CHANNELS;
+
+    float expected[kOutSamples]{};
+    float actual[kOutSamples]{};
+    android::ProcessL<CHANNELS, 16>(expected, kHalfNumCoefs, coefsP, coefsN, sP, sN, volumeLR);
+    android::ProcessL<CHANNELS, android::STRIDE_AVX2>(
+            actual, kHalfNumCoefs, coefsP, coefsN, sP, sN, volumeLR);
+    for (int i = 0; i < kOutSamples; ++i) {
+        EXPECT_NEAR(expected[i], actual[i], 1e-4) << "locked, channels " << CHANNELS;
+    }
+
+    for (float lerpP : {0.f, 0.3f, 0.999f}) {
+        float expected[kOutSamples]{};
+        float actual[kOutSamples]{};
+        android::Process<CHANNELS, 16>(expected, kHalfNumCoefs, coefsP, coefsN,
+                coefsP + kHalfNumCoefs, coefsN + kHalfNumCoefs, sP, sN, lerpP, volumeLR);
+        android::Process<CHANNELS, android::STRIDE_AVX2>(actual, kHalfNumCoefs, coefsP, coefsN,
+                coefsP + kHalfNumCoefs, coefsN + kHalfNumCoefs, sP, sN, lerpP, volumeLR);
+        for (int i = 0; i < kOutSamples; ++i) {
+            EXPECT_NEAR(expected[i], actual[i], 1e-4)
+                    << "lerpP " << lerpP << ", channels " << CHANNELS;
+        }
+    }
+}
+
+TEST(audioflinger_resampler, processavx2) {
+    if (!android::cpuSupportsAvx2()) {
+        GTEST_SKIP() << "AVX2 and FMA not supported";
+    }
+    testProcessAVX2<1>();
+    testProcessAVX2<2>();
+    testProcessAVX2<3>();
+    testProcessAVX2<4>();
+    testProcessAVX2<5>();
+    testProcessAVX2<6>();
+    testProcessAVX2<7>();
+    testProcessAVX2<8>();
+}
+#endif
@@ -16,6 +16,8 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+
 //#define LOG_NDEBUG 0
 #define LOG_TAG "NuCachedSource2"
 #include <utils/Log.h>
@@ -30,6 +32,15 @@
 
 namespace android {
 
+// Data before the last read position that is kept when releasing the rest.
+static const size_t kGrayArea = 1024 * 1024;
+
+// The cache consists of one active window, the byte range the prefetcher
+// is currently extending, and a small number of inactive windows that are
+// kept around after a seek. Reads that hit an inactive window are served
+// from it directly, and seeking into one makes it the active window again,
+// so seeking back and forth (e.g. to a 'moov' box at the end of the file,
+// or between tracks that are far apart) doesn't re-fetch data.
 struct PageCache {
     explicit PageCache(size_t pageSize);
     ~PageCache();
@@ -51,26 +62,67 @@ struct PageCache {
 
     void copy(size_t from, void *data, size_t size);
 
+    // Moves the active window starting at offset to the front of the
+    // inactive windows, leaving the active window empty.
+    void retireActive(off64_t offset);
+
+    // If an inactive window contains offset (or ends at it), it becomes the
+    // active window and its start is returned in *windowOffset. The current
+    // active window must be empty.
+    bool activate(off64_t offset, off64_t *windowOffset);
+
+    // Copies the range from an inactive window holding all of it.
+    bool copyFromInactive(off64_t offset, void *data, size_t size);
+
+    // Returns the start of the first inactive window at or after offset,
+    // or -1 if there is none.
+    off64_t nextInactiveOffset(off64_t offset) const;
+
+    // Appends the inactive window starting at offset to the active window.
+    bool mergeInactive(off64_t offset);
+
+    // Releases data in the least recently used inactive windows first,
+    // until at most maxBytes and maxWindows are left.
+    void trimInactive(size_t maxBytes, size_t maxWindows);
+
 private:
+    struct Window {
+        off64_t mOffset;
+        size_t mTotalSize;
+        List<Page *> mPages;
+    };
+
     size_t mPageSize;
     size_t mTotalSize;
+    size_t mInactiveSize;
 
     List<Page *> mActivePages;
     List<Page *> mFreePages;
 
+    // Most recently used first.
+    List<Window *> mInactiveWindows;
+
     void freePages(List<Page *> *list);
+    static void movePages(List<Page *> *from, List<Page *> *to);
+    static void copy(const List<Page *> &pages, size_t from, void *data, size_t size);
 
     DISALLOW_EVIL_CONSTRUCTORS(PageCache);
 };
 
 PageCache::PageCache(size_t pageSize)
     : mPageSize(pageSize),
-      mTotalSize(0) {
+      mTotalSize(0),
+      mInactiveSize(0) {
 }
 
 PageCache::~PageCache() {
     freePages(&mActivePages);
     freePages(&mFreePages);
+    for (List<Window *>::iterator it = mInactiveWindows.begin();
+            it != mInactiveWindows.end(); ++it) {
+        freePages(&(*it)->mPages);
+        delete *it;
+    }
 }
 
 void PageCache::freePages(List<Page *> *list) {
@@ -86,6 +138,14 @@ void PageCache::freePages(List<Page *> *list) {
     }
 }
 
+// static
+void PageCache::movePages(List<Page *> *from, List<Page *> *to) {
+    for (List<Page *>::iterator it = from->begin(); it != from->end(); ++it) {
+        to->push_back(*it);
+    }
+    from->clear();
+}
+
 PageCache::Page *PageCache::acquirePage() {
     if (!mFreePages.empty()) {
         List<Page *>::iterator it = mFreePages.begin();
@@ -145,8 +205,13 @@ void PageCache::copy(size_t from, void *data, size_t size) {
 
     CHECK_LE(from + size, mTotalSize);
 
+    copy(mActivePages, from, data, size);
+}
+
+// static
+void PageCache::copy(const List<Page *> &pages, size_t from, void *data, size_t size) {
     size_t offset = 0;
-    List<Page *>::iterator it = mActivePages.begin();
+    List<Page *>::const_iterator it = pages.begin();
     while (from >= offset + (*it)->mSize) {
         offset += (*it)->mSize;
         ++it;
@@ -177,6 +242,113 @@ void PageCache::copy(size_t from, void *data, size_t size) {
     }
 }
 
+void PageCache::retireActive(off64_t offset) {
+    if (mActivePages.empty()) {
+        return;
+    }
+
+    Window *window = new Window;
+    window->mOffset = offset;
+    window->mTotalSize = mTotalSize;
+    movePages(&mActivePages, &window->mPages);
+    mInactiveWindows.push_front(window);
+    mInactiveSize += mTotalSize;
+    mTotalSize = 0;
+}
+
+bool PageCache::activate(off64_t offset, off64_t *windowOffset) {
+    CHECK(mActivePages.empty());
+
+    for (List<Window *>::iterator it = mInactiveWindows.begin();
+            it != mInactiveWindows.end(); ++it) {
+        Window *window = *it;
+        if (offset >= window->mOffset
+                && offset <= window->mOffset + (off64_t)window->mTotalSize) {
+            movePages(&window->mPages, &mActivePages);
+            mTotalSize = window->mTotalSize;
+            mInactiveSize -= window->mTotalSize;
+            *windowOffset = window->mOffset;
+            mInactiveWindows.erase(it);
+            delete window;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PageCache::copyFromInactive(off64_t offset, void *data, size_t size) {
+    for (List<Window *>::iterator it = mInactiveWindows.begin();
+            it != mInactiveWindows.end(); ++it) {
+        Window *window = *it;
+        if (offset >= window->mOffset
+                && offset + (off64_t)size <= window->mOffset + (off64_t)window->mTotalSize) {
+            if (size > 0) {
+                copy(window->mPages, offset - window->mOffset, data, size);
+            }
+            if (it != mInactiveWindows.begin()) {
+                mInactiveWindows.erase(it);
+                mInactiveWindows.push_front(window);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+off64_t PageCache::nextInactiveOffset(off64_t offset) const {
+    off64_t next = -1;
+    for (List<Window *>::const_iterator it = mInactiveWindows.begin();
+            it != mInactiveWindows.end(); ++it) {
+        off64_t windowOffset = (*it)->mOffset;
+        if (windowOffset >= offset && (next < 0 || windowOffset < next)) {
+            next = windowOffset;
+        }
+    }
+    return next;
+}
+
+bool PageCache::mergeInactive(off64_t offset) {
+    for (List<Window *>::iterator it = mInactiveWindows.begin();
+            it != mInactiveWindows.end(); ++it) {
+        Window *window = *it;
+        if (window->mOffset == offset) {
+            movePages(&window->mPages, &mActivePages);
+            mTotalSize += window->mTotalSize;
+            mInactiveSize -= window->mTotalSize;
+            mInactiveWindows.erase(it);
+            delete window;
+            return true;
+        }
+    }
+    return false;
+}
+
+void PageCache::trimInactive(size_t maxBytes, size_t maxWindows) {
+    size_t numWindows = mInactiveWindows.size();
+    while (numWindows > 0 && (mInactiveSize > maxBytes || numWindows > maxWindows)) {
+        List<Window *>::iterator it = --mInactiveWindows.end();
+        Window *window = *it;
+
+        // Drop the tail of the least recently used window first, the part
+        // furthest away from where it was last read.
+        while (!window->mPages.empty()
+                && (mInactiveSize > maxBytes || numWindows > maxWindows)) {
+            List<Page *>::iterator last = --window->mPages.end();
+            Page *page = *last;
+            window->mPages.erase(last);
+            window->mTotalSize -= page->mSize;
+            mInactiveSize -= page->mSize;
+            releasePage(page);
+        }
+
+        if (window->mPages.empty()) {
+            mInactiveWindows.erase(it);
+            delete window;
+            --numWindows;
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 NuCachedSource2::NuCachedSource2(
@@ -194,6 +366,7 @@ NuCachedSource2::NuCachedSource2(
       mDisconnecting(false),
       mLastFetchTimeUs(-1),
       mNumRetriesLeft(kMaxNumRetries),
+      mReadAheadBytes(kDefaultHighWaterThreshold),
       mHighwaterThresholdBytes(kDefaultHighWaterThreshold),
       mLowwaterThresholdBytes(kDefaultLowWaterThreshold),
       mKeepAliveIntervalUs(kDefaultKeepAliveIntervalUs),
@@ -214,6 +387,9 @@ NuCachedSource2::NuCachedSource2(
         mKeepAliveIntervalUs = 0;
     }
 
+    // Playback starts out reading sequentially from the beginning.
+    mReadAheadBytes = mHighwaterThresholdBytes;
+
     mLooper->setName("NuCachedSource2");
     mLooper->registerHandler(mReflector);
 
@@ -326,11 +502,24 @@ void NuCachedSource2::fetchInternal() {
     ALOGV("fetchInternal");
 
     bool reconnect = false;
+    size_t fetchSize = kPageSize;
 
     {
         Mutex::Autolock autoLock(mLock);
         CHECK(mFinalStatus == OK || mNumRetriesLeft > 0);
 
+        // Don't fetch what an inactive window holds already, continue after
+        // it instead.
+        off64_t fetchOffset = mCacheOffset + mCache->totalSize();
+        off64_t nextOffset = mCache->nextInactiveOffset(fetchOffset);
+        if (nextOffset == fetchOffset) {
+            ALOGV("joining cached range at offset %lld", (long long)nextOffset);
+            CHECK(mCache->mergeInactive(nextOffset));
+            return;
+        } else if (nextOffset >= 0 && nextOffset - fetchOffset < (off64_t)fetchSize) {
+            fetchSize = nextOffset - fetchOffset;
+        }
+
         if (mFinalStatus != OK) {
             --mNumRetriesLeft;
 
@@ -364,7 +553,7 @@ void NuCachedSource2::fetchInternal() {
     PageCache::Page *page = mCache->acquirePage();
 
     ssize_t n = mSource->readAt(
-            mCacheOffset + mCache->totalSize(), page->mData, kPageSize);
+            mCacheOffset + mCache->totalSize(), page->mData, fetchSize);
 
     Mutex::Autolock autoLock(mLock);
 
@@ -430,6 +619,12 @@ void NuCachedSource2::onFetch() {
                 static_cast<HTTPBase *>(mSource.get())->disconnect();
                 mFinalStatus = -EAGAIN;
             }
+        } else if (mFetching) {
+            Mutex::Autolock autoLock(mLock);
+            if (mCacheOffset + mCache->totalSize() - mLastAccessPos >= mReadAheadBytes) {
+                ALOGV("read ahead %zu bytes, done prefetching for now", mReadAheadBytes);
+                mFetching = false;
+            }
         }
     } else {
         Mutex::Autolock autoLock(mLock);
@@ -486,18 +681,23 @@ void NuCachedSource2::onRead(const sp<AMessage> &msg) {
 
 void NuCachedSource2::restartPrefetcherIfNecessary_l(
         bool ignoreLowWaterThreshold, bool force) {
-    static const size_t kGrayArea = 1024 * 1024;
-
     if (mFetching || (mFinalStatus != OK && mNumRetriesLeft == 0)) {
         return;
     }
 
+    size_t lowwaterThresholdBytes = std::min(mLowwaterThresholdBytes, mReadAheadBytes / 2);
     if (!ignoreLowWaterThreshold && !force
             && mCacheOffset + mCache->totalSize() - mLastAccessPos
-                >= mLowwaterThresholdBytes) {
+                >= lowwaterThresholdBytes) {
         return;
     }
 
+    if (!ignoreLowWaterThreshold && !force) {
+        // The reader kept up with the read-ahead, so it is reading
+        // sequentially; read further ahead next time.
+        mReadAheadBytes = std::min(mReadAheadBytes * 2, mHighwaterThresholdBytes);
+    }
+
     size_t maxBytes = mLastAccessPos - mCacheOffset;
 
     if (!force) {
@@ -537,6 +737,12 @@ ssize_t NuCachedSource2::readAt(off64_t offset, void *data, size_t size) {
         return size;
     }
 
+    // Reads from an inactive window leave the prefetcher alone, e.g. while
+    // the reader alternates between tracks stored far apart.
+    if (mCache->copyFromInactive(offset, data, size)) {
+        return size;
+    }
+
     sp<AMessage> msg = new AMessage(kWhatRead, mReflector);
     msg->setInt64("offset", offset);
     msg->setPointer("data", data);
@@ -613,6 +819,11 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
         return ERROR_END_OF_STREAM;
     }
 
+    if (offset < mCacheOffset
+            || offset >= (off64_t)(mCacheOffset + mCache->totalSize())) {
+        seekInternal_l(offset);
+    }
+
     if (!mFetching) {
         mLastAccessPos = offset;
         restartPrefetcherIfNecessary_l(
@@ -620,19 +831,6 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
                 true); // force
     }
 
-    if (offset < mCacheOffset
-            || offset >= (off64_t)(mCacheOffset + mCache->totalSize())) {
-        static const off64_t kPadding = 256 * 1024;
-
-        // In the presence of multiple decoded streams, once of them will
-        // trigger this seek request, the other one will request data "nearby"
-        // soon, adjust the seek position so that that subsequent request
-        // does not trigger another seek.
-        off64_t seekOffset = (offset > kPadding) ? offset - kPadding : 0;
-
-        seekInternal_l(seekOffset);
-    }
-
     size_t delta = offset - mCacheOffset;
 
     if (mFinalStatus != OK && mNumRetriesLeft == 0) {
@@ -663,19 +861,46 @@ ssize_t NuCachedSource2::readInternal(off64_t offset, void *data, size_t size) {
 }
 
 status_t NuCachedSource2::seekInternal_l(off64_t offset) {
-    mLastAccessPos = offset;
+    static const off64_t kPadding = 256 * 1024;
 
-    if (offset >= mCacheOffset
-            && offset <= (off64_t)(mCacheOffset + mCache->totalSize())) {
+    // In the presence of multiple decoded streams, once of them will
+    // trigger this seek request, the other one will request data "nearby"
+    // soon, adjust the seek position so that that subsequent request
+    // does not trigger another seek.
+    off64_t seekOffset = (offset > kPadding) ? offset - kPadding : 0;
+
+    if (seekOffset >= mCacheOffset
+            && seekOffset <= (off64_t)(mCacheOffset + mCache->totalSize())) {
+        mLastAccessPos = seekOffset;
         return OK;
     }
 
-    ALOGI("new range: offset= %lld", (long long)offset);
+    // Keep the active window around, minus most of what has been read
+    // already. Trim only after activating the new window, which may be
+    // the least recently used one.
+    if (mLastAccessPos > mCacheOffset + (off64_t)kGrayArea) {
+        mCacheOffset += mCache->releaseFromStart(mLastAccessPos - mCacheOffset - kGrayArea);
+    }
+    mCache->retireActive(mCacheOffset);
 
-    mCacheOffset = offset;
+    off64_t windowOffset;
+    if (mCache->activate(offset, &windowOffset)) {
+        ALOGI("cached range: offset= %lld, resuming at %lld",
+                (long long)windowOffset, (long long)(windowOffset + mCache->totalSize()));
 
-    size_t totalSize = mCache->totalSize();
-    CHECK_EQ(mCache->releaseFromStart(totalSize), totalSize);
+        mCacheOffset = windowOffset;
+        mLastAccessPos = offset;
+    } else {
+        ALOGI("new range: offset= %lld", (long long)seekOffset);
+
+        mCacheOffset = seekOffset;
+        mLastAccessPos = seekOffset;
+
+        // Don't commit to a full read-ahead until the reader turns out to
+        // read sequentially from here.
+        mReadAheadBytes = std::min((size_t)kMinReadAheadBytes, mHighwaterThresholdBytes);
+    }
+    mCache->trimInactive(kMaxInactiveBytes, kMaxNumInactiveWindows);
 
     mNumRetriesLeft = kMaxNumRetries;
     mFetching = true;
@@ -91,6 +91,15 @@ private:
         // Read data after a 15 sec timeout whether we're actively
         // fetching or not.
         kDefaultKeepAliveIntervalUs     = 15000000,
+
+        // Ranges read before a seek are kept in up to this many windows
+        // of this many bytes in total.
+        kMaxInactiveBytes               = 8 * 1024 * 1024,
+        kMaxNumInactiveWindows          = 4,
+
+        // Initial read-ahead after a seek to a range that isn't cached,
+        // doubled whenever the reader catches up with it.
+        kMinReadAheadBytes              = 1024 * 1024,
     };
 
     enum {
@@ -122,6 +131,10 @@ private:
 
     int32_t mNumRetriesLeft;
 
+    // Fetching stops this far ahead of mLastAccessPos, or at the high
+    // water mark, whichever comes first.
+    size_t mReadAheadBytes;
+
     size_t mHighwaterThresholdBytes;
     size_t mLowwaterThresholdBytes;
 
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "NuCachedSource2Test"
+#include <utils/Log.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <datasource/HTTPBase.h>
+#include <datasource/NuCachedSource2.h>
+#include <gtest/gtest.h>
+
+namespace android {
+
+constexpr size_t kFileSize = 32 * 1024 * 1024;
+// Cost of every request that doesn't continue where the previous one ended,
+// as for a new HTTP range request.
+constexpr auto kRequestLatency = std::chrono::milliseconds(5);
+
+// Serves a local file through the HTTPBase interface and counts how many
+// bytes are fetched more than once.
+class FileBackedHTTPSource : public HTTPBase {
+  public:
+    FileBackedHTTPSource() : mFile(tmpfile()), mFetched(kFileSize, false) {
+        std::vector<uint8_t> data(kFileSize);
+        for (size_t i = 0; i < kFileSize; ++i) {
+            data[i] = expectedByte(i);
+        }
+        if (mFile != nullptr) {
+            mInitCheck = fwrite(data.data(), 1, kFileSize, mFile) == kFileSize ? OK : NO_INIT;
+        }
+    }
+
+    static uint8_t expectedByte(size_t offset) { return (offset * 7 + (offset >> 13)) & 0xff; }
+
+    status_t connect(const char * /* uri */, const KeyedVector<String8, String8> * /* headers */,
+            off64_t /* offset */) override {
+        return OK;
+    }
+
+    void disconnect() override {}
+
+    status_t initCheck() const override { return mInitCheck; }
+
+    status_t getSize(off64_t *size) override {
+        *size = kFileSize;
+        return OK;
+    }
+
+    uint32_t flags() override { return kWantsPrefetching | kIsHTTPBasedSource; }
+
+    status_t reconnectAtOffset(off64_t /* offset */) override { return OK; }
+
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (offset != mNextOffset) {
+            ++mNumRequests;
+            std::this_thread::sleep_for(kRequestLatency);
+        }
+        ssize_t n = pread(fileno(mFile), data, size, offset);
+        if (n <= 0) {
+            return n;
+        }
+        for (ssize_t i = 0; i < n; ++i) {
+            if (mFetched[offset + i]) {
+                ++mBytesRefetched;
+            }
+            mFetched[offset + i] = true;
+        }
+        mBytesFetched += n;
+        mNextOffset = offset + n;
+        return n;
+    }
+
+    size_t bytesFetched() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mBytesFetched;
+    }
+
+    size_t bytesRefetched() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mBytesRefetched;
+    }
+
+    size_t numRequests() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mNumRequests;
+    }
+
+  protected:
+    ~FileBackedHTTPSource() override {
+        if (mFile != nullptr) {
+            fclose(mFile);
+        }
+    }
+
+  private:
+    FILE *mFile;
+    status_t mInitCheck = NO_INIT;
+    std::mutex mLock;
+    std::vector<bool> mFetched;
+    size_t mBytesFetched = 0;
+    size_t mBytesRefetched = 0;
+    size_t mNumRequests = 0;
+    off64_t mNextOffset = -1;
+};
+
+class NuCachedSource2Test : public ::testing::Test {
+  public:
+    void SetUp() override {
+        mSource = new FileBackedHTTPSource;
+        ASSERT_EQ(mSource->initCheck(), OK);
+        mCache = NuCachedSource2::Create(mSource);
+    }
+
+    void TearDown() override {
+        if (mCache != nullptr) {
+            mCache->disconnect();
+        }
+        ALOGI("fetched %zu bytes in %zu requests, %zu bytes more than once",
+                mSource->bytesFetched(), mSource->numRequests(), mSource->bytesRefetched());
+        RecordProperty("bytes_fetched", std::to_string(mSource->bytesFetched()));
+        RecordProperty("bytes_refetched", std::to_string(mSource->bytesRefetched()));
+    }
+
+    // Reads and verifies the range, returns the time it took in microseconds.
+    int64_t readAndVerify(off64_t offset, size_t size) {
+        std::vector<uint8_t> data(size);
+        auto start = std::chrono::steady_clock::now();
+        ssize_t n = mCache->readAt(offset, data.data(), size);
+        auto end = std::chrono::steady_clock::now();
+        EXPECT_EQ(n, (ssize_t)size) << "offset " << offset;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (data[i] != FileBackedHTTPSource::expectedByte(offset + i)) {
+                ADD_FAILURE() << "mismatch at offset " << offset + i;
+                break;
+            }
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    }
+
+    sp<FileBackedHTTPSource> mSource;
+    sp<NuCachedSource2> mCache;
+};
+
+TEST_F(NuCachedSource2Test, SequentialRead) {
+    const size_t kReadSize = 188 * 7;
+    for (off64_t offset = 0; offset + kReadSize <= kFileSize; offset += kReadSize) {
+        readAndVerify(offset, kReadSize);
+        if (HasFailure()) {
+            return;
+        }
+    }
+    EXPECT_EQ(mSource->bytesRefetched(), 0u);
+}
+
+// Parsing a file with the 'moov' box at the end reads the header, then the
+// end of the file, then plays from the start.
+TEST_F(NuCachedSource2Test, MoovAtEnd) {
+    const size_t kMoovSize = 1024 * 1024;
+    readAndVerify(0, 4096);
+    readAndVerify(kFileSize - kMoovSize, kMoovSize);
+
+    int64_t seekBackUs = readAndVerify(4096, 65536);
+    for (off64_t offset = 4096 + 65536; offset < 8 * 1024 * 1024; offset += 65536) {
+        readAndVerify(offset, 65536);
+    }
+    ALOGI("seek back to the start took %lld us", (long long)seekBackUs);
+    RecordProperty("seek_back_us", std::to_string(seekBackUs));
+
+    // The start of the file is kept across the seek to the end, and fetching
+    // resumes where it stopped.
+    EXPECT_EQ(mSource->bytesRefetched(), 0u);
+}
+
+// Two tracks interleaved in large runs, read alternately.
+TEST_F(NuCachedSource2Test, InterleavedRanges) {
+    const off64_t kTrackOffsets[] = {0, kFileSize / 2};
+    const size_t kReadSize = 32768;
+    int64_t maxLatencyUs = 0;
+    for (off64_t position = 0; position < 6 * 1024 * 1024; position += kReadSize) {
+        for (off64_t trackOffset : kTrackOffsets) {
+            maxLatencyUs = std::max(maxLatencyUs, readAndVerify(trackOffset + position, kReadSize));
+        }
+        if (HasFailure()) {
+            return;
+        }
+    }
+    ALOGI("slowest read took %lld us", (long long)maxLatencyUs);
+    RecordProperty("max_read_us", std::to_string(maxLatencyUs));
+
+    EXPECT_LE(mSource->bytesRefetched(), 256u * 1024);
+}
+
+TEST_F(NuCachedSource2Test, RandomSeeks) {
+    srand(42);
+    for (int i = 0; i < 200; ++i) {
+        size_t size = 1 + rand() % 200000;
+        off64_t offset = rand() % (kFileSize - size);
+        readAndVerify(offset, size);
+        if (HasFailure()) {
+            return;
+        }
+    }
+}
+
+}  // namespace android
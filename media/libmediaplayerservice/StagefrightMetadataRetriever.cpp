@@ -25,12 +25,15 @@
 #include "StagefrightMetadataRetriever.h"
 #include "FrameDecoder.h"
 
+#include <android/IMediaExtractorService.h>
+#include <binder/IServiceManager.h>
 #include <datasource/PlayerServiceDataSourceFactory.h>
 #include <datasource/PlayerServiceFileSource.h>
 #include <media/IMediaHTTPService.h>
 #include <media/stagefright/MediaCodecConstants.h>
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/InterfaceUtils.h>
 #include <media/stagefright/MediaCodecList.h>
 #include <media/stagefright/MediaDefs.h>
 #include <media/stagefright/MediaErrors.h>
@@ -90,13 +93,31 @@ status_t StagefrightMetadataRetriever::setDataSource(
 // Warning caller retains ownership of the filedescriptor! Dup it if necessary.
 status_t StagefrightMetadataRetriever::setDataSource(
         int fd, int64_t offset, int64_t length) {
-    fd = dup(fd);
-
     ALOGV("setDataSource(%d, %" PRId64 ", %" PRId64 ")", fd, offset, length);
     AVUtils::get()->printFileName(fd);
 
     clearMetadata();
-    mSource = new PlayerServiceFileSource(fd, offset, length);
+    mSource.clear();
+    // As GenericSource does, read the file in the extractor service, which then knows
+    // the file and can reuse what it parsed when the file was last opened.
+    if (property_get_bool("media.stagefright.extractremote", true) &&
+            !PlayerServiceFileSource::requiresDrm(fd, offset, length, nullptr /* mime */)) {
+        sp<IBinder> binder = defaultServiceManager()->getService(String16("media.extractor"));
+        if (binder != nullptr) {
+            sp<IMediaExtractorService> mediaExService(
+                    interface_cast<IMediaExtractorService>(binder));
+            sp<IDataSource> source;
+            mediaExService->makeIDataSource(base::unique_fd(dup(fd)), offset, length, &source);
+            if (source != nullptr) {
+                mSource = CreateDataSourceFromIDataSource(source);
+            } else {
+                ALOGW("extractor service cannot make data source");
+            }
+        }
+    }
+    if (mSource == NULL) {
+        mSource = new PlayerServiceFileSource(dup(fd), offset, length);
+    }
 
     status_t err;
     if ((err = mSource->initCheck()) != OK) {
@@ -728,6 +728,8 @@ status_t VideoFrameDecoder::onOutputReceived(
         return captureSurface();
     }
     ColorConverter converter((OMX_COLOR_FORMATTYPE)srcFormat, dstFormat());
+    // a single frame is converted, spreading it over the cores pays off.
+    converter.setMaxThreads(0);
 
     uint32_t standard, range, transfer;
     if (!outputFormat->findInt32("color-standard", (int32_t*)&standard)) {
@@ -874,6 +876,8 @@ MediaImageDecoder::~MediaImageDecoder() {
         mThread->requestExitAndWait();
         mThread.clear();
     }
+    // after the output thread, which queues the tiles.
+    mTileWorkers.reset();
 }
 
 sp<AMessage> MediaImageDecoder::onGetFormatAndSeekOptions(
@@ -1014,9 +1018,9 @@ status_t MediaImageDecoder::onExtractRect(FrameRect *rect) {
     return OK;
 }
 
-status_t MediaImageDecoder::onOutputReceived(
-        const sp<MediaCodecBuffer> &videoFrameBuffer,
-        const sp<AMessage> &outputFormat, int64_t /*timeUs*/, bool *done) {
+status_t MediaImageDecoder::setUpTile(
+        const sp<AMessage> &outputFormat, const sp<MediaCodecBuffer> &videoFrameBuffer,
+        Tile *tile, bool *done) {
     if (outputFormat == NULL) {
         return ERROR_MALFORMED;
     }
@@ -1061,7 +1065,9 @@ status_t MediaImageDecoder::onOutputReceived(
         setFrame(frameMem);
     }
 
-    ColorConverter converter((OMX_COLOR_FORMATTYPE)srcFormat, dstFormat());
+    tile->converter = std::make_unique<ColorConverter>(
+            (OMX_COLOR_FORMATTYPE)srcFormat, dstFormat());
+    ColorConverter &converter = *tile->converter;
 
     uint32_t standard, range, transfer;
     if (!outputFormat->findInt32("color-standard", (int32_t*)&standard)) {
@@ -1120,20 +1126,66 @@ status_t MediaImageDecoder::onOutputReceived(
 
     *done = (++mTilesDecoded >= mTargetTiles);
 
-    if (converter.isValid()) {
-        converter.convert(
-                (const uint8_t *)videoFrameBuffer->data(),
-                width, height, stride,
-                crop_left, crop_top, crop_right, crop_bottom,
-                mFrame->getFlattenedData(),
-                mFrame->mWidth, mFrame->mHeight, mFrame->mRowBytes,
-                dstLeft, dstTop, dstRight, dstBottom);
-        return OK;
+    if (!converter.isValid()) {
+        ALOGE("Unable to convert from format 0x%08x to 0x%08x",
+                    srcFormat, dstFormat());
+        return ERROR_UNSUPPORTED;
     }
 
-    ALOGE("Unable to convert from format 0x%08x to 0x%08x",
-                srcFormat, dstFormat());
-    return ERROR_UNSUPPORTED;
+    tile->width = width;
+    tile->height = height;
+    tile->stride = stride;
+    tile->cropLeft = crop_left;
+    tile->cropTop = crop_top;
+    tile->cropRight = crop_right;
+    tile->cropBottom = crop_bottom;
+    tile->dstLeft = dstLeft;
+    tile->dstTop = dstTop;
+    tile->dstRight = dstRight;
+    tile->dstBottom = dstBottom;
+    return OK;
+}
+
+void MediaImageDecoder::convertTile(
+        const sp<MediaCodecBuffer> &videoFrameBuffer, const Tile &tile) {
+    tile.converter->convert(
+            (const uint8_t *)videoFrameBuffer->data(),
+            tile.width, tile.height, tile.stride,
+            tile.cropLeft, tile.cropTop, tile.cropRight, tile.cropBottom,
+            mFrame->getFlattenedData(),
+            mFrame->mWidth, mFrame->mHeight, mFrame->mRowBytes,
+            tile.dstLeft, tile.dstTop, tile.dstRight, tile.dstBottom);
+}
+
+status_t MediaImageDecoder::onOutputReceived(
+        const sp<MediaCodecBuffer> &videoFrameBuffer,
+        const sp<AMessage> &outputFormat, int64_t /*timeUs*/, bool *done) {
+    Tile tile;
+    status_t err = setUpTile(outputFormat, videoFrameBuffer, &tile, done);
+    if (err != OK) {
+        return err;
+    }
+    convertTile(videoFrameBuffer, tile);
+    return OK;
+}
+
+status_t MediaImageDecoder::onTileReceived(
+        const sp<MediaCodecBuffer> &videoFrameBuffer, size_t index,
+        const sp<AMessage> &outputFormat, bool *done) {
+    std::shared_ptr<Tile> tile = std::make_shared<Tile>();
+    status_t err = setUpTile(outputFormat, videoFrameBuffer, tile.get(), done);
+    if (err != OK) {
+        mDecoder->releaseOutputBuffer(index);
+        return err;
+    }
+    // the buffer goes back to the decoder once converted.
+    sp<MediaCodec> decoder = mDecoder;
+    mTileWorkers->queue([this, decoder, videoFrameBuffer, index, tile] {
+        ATRACE_NAME("MediaImageDecoder::convertTile");
+        convertTile(videoFrameBuffer, *tile);
+        decoder->releaseOutputBuffer(index);
+    });
+    return OK;
 }
 
 bool MediaImageDecoder::outputLoop() {
@@ -1215,6 +1267,8 @@ bool MediaImageDecoder::outputLoop() {
                         mDecoder->releaseOutputBuffer(index);
                     }
                     err = onOutputReceived(videoFrameBuffer, mOutputFormat, ptsUs, &done);
+                } else if (mTileWorkers != nullptr) {
+                    err = onTileReceived(videoFrameBuffer, index, mOutputFormat, &done);
                 } else {
                     err = onOutputReceived(videoFrameBuffer, mOutputFormat, ptsUs, &done);
                     mDecoder->releaseOutputBuffer(index);
@@ -1224,10 +1278,17 @@ bool MediaImageDecoder::outputLoop() {
                 done = true;
             }
             if(done) {
+                // the frame is handed out once done, its tiles must all be in.
+                if (mTileWorkers != nullptr) {
+                    mTileWorkers->wait();
+                }
                 mOutInfo.lock()->mDone = done;
             }
         }
     }
+    if (mTileWorkers != nullptr) {
+        mTileWorkers->wait();
+    }
     mOutInfo.lock()->mErrorCode = err;
 
     return done;
@@ -1246,6 +1307,13 @@ status_t MediaImageDecoder::extractInternal() {
         outInfo->mSignalType = NONE;
     }
 
+    // tiles cover disjoint areas of the frame, so the workers can convert them in any order
+    // while the output thread goes back to the decoder.
+    if (mUseMultiThread && mTileWorkers == nullptr
+            && WorkerPool::GetConcurrency() > 1 && mGridRows * mGridCols > 1) {
+        mTileWorkers = std::make_unique<WorkerPool::Group>();
+    }
+
     if (mUseMultiThread && mThread == NULL) {
         mThread = new ImageOutputThread(this);
         err = mThread->run("ImageDecoderOutput");
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameLatencyTracer"
+#define ATRACE_TAG ATRACE_TAG_VIDEO
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <media/stagefright/FrameLatencyTracer.h>
+#include <utils/Log.h>
+#include <utils/Trace.h>
+
+namespace android {
+
+static size_t roundUpToPowerOf2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static int64_t nsToUs(nsecs_t ns) {
+    return (ns + 500) / 1000;
+}
+
+// the cookie of the trace slices of the frame with |sequence|, as stored in its slot.
+static int32_t traceCookie(uint64_t sequence) {
+    return (int32_t)(sequence & INT32_MAX);
+}
+
+// static
+const char *FrameLatencyTracer::asString(Stage stage) {
+    switch (stage) {
+        case QUEUED:            return "queued";
+        case COMPONENT_QUEUED:  return "component-queued";
+        case WORK_DONE:         return "work-done";
+        case OUTPUT_AVAILABLE:  return "output-available";
+        case RELEASED:          return "released";
+        case RENDERED:          return "rendered";
+        default:                return "unknown";
+    }
+}
+
+FrameLatencyTracer::FrameLatencyTracer(size_t capacity)
+    : mSlots(roundUpToPowerOf2(std::max(capacity, (size_t)1))),
+      mMask(mSlots.size() - 1),
+      mNext(0) {
+    static std::atomic<uint32_t> sTracerCount(0);
+    const std::string prefix = "FrameLatency#"
+            + std::to_string(sTracerCount.fetch_add(1, std::memory_order_relaxed)) + " ";
+    for (uint32_t stage = QUEUED; stage < STAGE_COUNT; ++stage) {
+        mTraceNames[stage] = prefix + asString(Stage(stage));
+    }
+    clear();
+}
+
+void FrameLatencyTracer::record(Stage stage, int64_t mediaTimeUs, nsecs_t timeNs) {
+    if (stage >= STAGE_COUNT) {
+        return;
+    }
+    if (stage == QUEUED) {
+        uint64_t sequence = mNext.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = mSlots[sequence & mMask];
+        const bool tracing = ATRACE_ENABLED();
+        if (tracing) {
+            // the overwritten frame will not reach its next stage anymore.
+            endTraceSlice(slot, STAGE_COUNT);
+        }
+        // invalidate the slot before writing it, readers skip the frame until it is complete.
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.mediaTimeUs.store(mediaTimeUs, std::memory_order_relaxed);
+        for (std::atomic<int64_t> &stageNs : slot.stageNs) {
+            stageNs.store(0, std::memory_order_relaxed);
+        }
+        slot.stageNs[QUEUED].store(timeNs, std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_release);
+        if (tracing) {
+            ATRACE_ASYNC_BEGIN(mTraceNames[QUEUED].c_str(), traceCookie(sequence + 1));
+        }
+        return;
+    }
+
+    // the frame is usually one of the latest ones, look for it from the latest queued.
+    const uint64_t next = mNext.load(std::memory_order_acquire);
+    const uint64_t count = std::min({next, (uint64_t)mSlots.size(), (uint64_t)kMaxLookBack});
+    for (uint64_t i = 1; i <= count; ++i) {
+        Slot &slot = mSlots[(next - i) & mMask];
+        if (slot.sequence.load(std::memory_order_acquire) == 0
+                || slot.mediaTimeUs.load(std::memory_order_relaxed) != mediaTimeUs) {
+            continue;
+        }
+        int64_t unset = 0;
+        if (slot.stageNs[stage].compare_exchange_strong(
+                unset, timeNs, std::memory_order_relaxed)) {
+            if (ATRACE_ENABLED()) {
+                endTraceSlice(slot, stage);
+                if (stage < RELEASED) {
+                    ATRACE_ASYNC_BEGIN(mTraceNames[stage].c_str(),
+                                       traceCookie(slot.sequence.load(std::memory_order_relaxed)));
+                }
+            }
+            return;
+        }
+    }
+    ALOGV("no frame at %" PRId64 " us to record %s", mediaTimeUs, asString(stage));
+}
+
+void FrameLatencyTracer::endTraceSlice(const Slot &slot, uint32_t before) const {
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == 0) {
+        return;
+    }
+    // the slice open is the one of the latest stage that the frame reached before |before|,
+    // unless that stage does not open any.
+    for (uint32_t stage = before; stage-- > QUEUED; ) {
+        if (slot.stageNs[stage].load(std::memory_order_relaxed) != 0) {
+            if (stage < RELEASED) {
+                ATRACE_ASYNC_END(mTraceNames[stage].c_str(), traceCookie(sequence));
+            }
+            return;
+        }
+    }
+}
+
+void FrameLatencyTracer::clear() {
+    for (Slot &slot : mSlots) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+        slot.mediaTimeUs.store(0, std::memory_order_relaxed);
+        for (std::atomic<int64_t> &stageNs : slot.stageNs) {
+            stageNs.store(0, std::memory_order_relaxed);
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+bool FrameLatencyTracer::readSlot(const Slot &slot, uint64_t *sequence, Frame *frame) const {
+    *sequence = slot.sequence.load(std::memory_order_acquire);
+    if (*sequence == 0) {
+        return false;
+    }
+    frame->mediaTimeUs = slot.mediaTimeUs.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        frame->stageNs[i] = slot.stageNs[i].load(std::memory_order_relaxed);
+    }
+    // the frame is consistent if the slot was not rewritten while it was read.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == *sequence;
+}
+
+std::vector<FrameLatencyTracer::Frame> FrameLatencyTracer::getFrames() const {
+    std::vector<std::pair<uint64_t, Frame>> frames;
+    frames.reserve(mSlots.size());
+    for (const Slot &slot : mSlots) {
+        uint64_t sequence;
+        Frame frame;
+        if (readSlot(slot, &sequence, &frame)) {
+            frames.emplace_back(sequence, frame);
+        }
+    }
+    std::sort(frames.begin(), frames.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    std::vector<Frame> result;
+    result.reserve(frames.size());
+    for (const std::pair<uint64_t, Frame> &entry : frames) {
+        result.push_back(entry.second);
+    }
+    return result;
+}
+
+static FrameLatencyTracer::Percentiles computePercentiles(
+        const std::vector<FrameLatencyTracer::Frame> &frames,
+        FrameLatencyTracer::Stage from, FrameLatencyTracer::Stage to) {
+    std::vector<int64_t> latenciesUs;
+    latenciesUs.reserve(frames.size());
+    for (const FrameLatencyTracer::Frame &frame : frames) {
+        if (frame.stageNs[from] != 0 && frame.stageNs[to] != 0) {
+            latenciesUs.push_back(nsToUs(frame.stageNs[to] - frame.stageNs[from]));
+        }
+    }
+    FrameLatencyTracer::Percentiles percentiles = {};
+    percentiles.count = latenciesUs.size();
+    if (latenciesUs.empty()) {
+        return percentiles;
+    }
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    auto at = [&latenciesUs](size_t percentile) {
+        return latenciesUs[(latenciesUs.size() - 1) * percentile / 100];
+    };
+    percentiles.p50Us = at(50);
+    percentiles.p90Us = at(90);
+    percentiles.p99Us = at(99);
+    percentiles.maxUs = latenciesUs.back();
+    return percentiles;
+}
+
+FrameLatencyTracer::Percentiles FrameLatencyTracer::getPercentiles(Stage from, Stage to) const {
+    if (from >= STAGE_COUNT || to >= STAGE_COUNT) {
+        return Percentiles{};
+    }
+    return computePercentiles(getFrames(), from, to);
+}
+
+std::string FrameLatencyTracer::dump(size_t maxFrames) const {
+    const std::vector<Frame> frames = getFrames();
+    std::ostringstream out;
+    out << "frame latency over the last " << frames.size() << " frames (us):\n";
+    auto dumpPercentiles = [&out, &frames](Stage from, Stage to) {
+        Percentiles p = computePercentiles(frames, from, to);
+        if (p.count == 0) {
+            return;
+        }
+        out << "  " << asString(from) << " -> " << asString(to) << ": n=" << p.count
+            << " p50=" << p.p50Us << " p90=" << p.p90Us << " p99=" << p.p99Us
+            << " max=" << p.maxUs << "\n";
+    };
+    for (uint32_t stage = COMPONENT_QUEUED; stage < STAGE_COUNT; ++stage) {
+        dumpPercentiles(Stage(stage - 1), Stage(stage));
+    }
+    dumpPercentiles(QUEUED, OUTPUT_AVAILABLE);
+    dumpPercentiles(QUEUED, RENDERED);
+
+    out << "latest frames (us after queued):\n";
+    for (size_t i = frames.size() > maxFrames ? frames.size() - maxFrames : 0;
+            i < frames.size(); ++i) {
+        const Frame &frame = frames[i];
+        out << "  pts " << frame.mediaTimeUs << ":";
+        for (uint32_t stage = COMPONENT_QUEUED; stage < STAGE_COUNT; ++stage) {
+            if (frame.stageNs[stage] != 0) {
+                out << " " << asString(Stage(stage)) << "="
+                    << nsToUs(frame.stageNs[stage] - frame.stageNs[QUEUED]);
+            }
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+}  // namespace android
@@ -30,7 +30,12 @@
 
 #include <utils/Log.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <thread>
+#include <vector>
 
 #include <media/stagefright/MediaSource.h>
 #include <media/stagefright/foundation/ABitReader.h>
@@ -540,6 +545,210 @@ private:
     Track &operator=(const Track &);
 };
 
+/*
+ * Write-behind for the output file.
+ *
+ * Everything MPEG4Writer writes to mFd is collected into batches of up to
+ * kWriteBatchSize bytes that end on kWriteBatchAlignment boundaries. Full
+ * batches are handed to a background thread which writes them with
+ * pwrite64() in submission order, while the writer thread fills the other
+ * batch. Writes are positioned explicitly, so seeking only moves the write
+ * position; seeking inside the batch being filled (as endBox() does for
+ * small boxes) does not submit it.
+ */
+class MPEG4Writer::AsyncFileWriter {
+public:
+    AsyncFileWriter(MPEG4Writer *owner, int fd)
+        : mOwner(owner),
+          mFd(fd),
+          mPosition(0),
+          mCurrent(NULL),
+          mNumBatches(0),
+          mError(false),
+          mQuit(false),
+          mThread([this] { threadFunc(); }) {
+    }
+
+    ~AsyncFileWriter() {
+        drain();
+        {
+            std::lock_guard<std::mutex> l(mLock);
+            mQuit = true;
+            mCondition.notify_all();
+        }
+        mThread.join();
+        for (Batch *batch : mFreeBatches) {
+            free(batch->mData);
+            delete batch;
+        }
+    }
+
+    // Returns false if an earlier batch failed to be written.
+    bool write(const void *data, size_t size) {
+        const uint8_t *src = (const uint8_t *)data;
+        while (size > 0) {
+            if (mCurrent == NULL) {
+                mCurrent = acquireBatch();
+                if (mCurrent == NULL) {
+                    return false;
+                }
+                mCurrent->mOffset = mPosition;
+                mCurrent->mSize = 0;
+                mCurrent->mCapacity =
+                        kWriteBatchSize - (size_t)(mPosition % kWriteBatchAlignment);
+            }
+            size_t pos = mPosition - mCurrent->mOffset;
+            size_t n = std::min(size, mCurrent->mCapacity - pos);
+            memcpy(mCurrent->mData + pos, src, n);
+            mCurrent->mSize = std::max(mCurrent->mSize, pos + n);
+            mPosition += n;
+            src += n;
+            size -= n;
+            if (pos + n == mCurrent->mCapacity) {
+                submit();
+            }
+        }
+        return !mError.load(std::memory_order_relaxed);
+    }
+
+    off64_t seek(off64_t offset) {
+        if (mCurrent != NULL && (offset < mCurrent->mOffset
+                || offset > mCurrent->mOffset + (off64_t)mCurrent->mSize)) {
+            submit();
+        }
+        mPosition = offset;
+        return offset;
+    }
+
+    // Writes out everything and waits for it to complete.
+    status_t drain() {
+        if (mCurrent != NULL) {
+            submit();
+        }
+        std::unique_lock<std::mutex> l(mLock);
+        mCondition.wait(l, [this] { return mPendingBatches.empty(); });
+        return mError ? ERROR_IO : OK;
+    }
+
+private:
+    static constexpr size_t kWriteBatchSize = 1024 * 1024;
+    static constexpr size_t kWriteBatchAlignment = 4096;
+    static constexpr size_t kMaxNumBatches = 2;
+
+    struct Batch {
+        uint8_t *mData;
+        size_t mCapacity;
+        size_t mSize;
+        off64_t mOffset;
+    };
+
+    MPEG4Writer *mOwner;
+    int mFd;
+    // The following are only accessed by the writer thread.
+    off64_t mPosition;
+    Batch *mCurrent;
+    size_t mNumBatches;
+
+    std::atomic<bool> mError;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    // The front batch is being written by threadFunc().
+    std::deque<Batch *> mPendingBatches;
+    std::vector<Batch *> mFreeBatches;
+    bool mQuit;
+
+    // needs to be initialized after the variables above.
+    std::thread mThread;
+
+    Batch *acquireBatch() {
+        std::unique_lock<std::mutex> l(mLock);
+        if (mFreeBatches.empty() && mNumBatches < kMaxNumBatches) {
+            void *data = NULL;
+            if (posix_memalign(&data, kWriteBatchAlignment, kWriteBatchSize) != 0) {
+                l.unlock();
+                ALOGE("failed to allocate write batch");
+                postError();
+                return NULL;
+            }
+            ++mNumBatches;
+            return new Batch{(uint8_t *)data, 0, 0, 0};
+        }
+        mCondition.wait(l, [this] { return !mFreeBatches.empty(); });
+        Batch *batch = mFreeBatches.back();
+        mFreeBatches.pop_back();
+        return batch;
+    }
+
+    void submit() {
+        std::lock_guard<std::mutex> l(mLock);
+        mPendingBatches.push_back(mCurrent);
+        mCurrent = NULL;
+        mCondition.notify_all();
+    }
+
+    void writeBatch(const Batch *batch) {
+        if (mError) {
+            return;
+        }
+        size_t written = 0;
+        ssize_t res = 0;
+        auto beforeTP = std::chrono::high_resolution_clock::now();
+        while (written < batch->mSize) {
+            res = TEMP_FAILURE_RETRY(pwrite64(mFd, batch->mData + written,
+                    batch->mSize - written, batch->mOffset + written));
+            if (res <= 0) {
+                break;
+            }
+            written += res;
+        }
+        auto afterTP = std::chrono::high_resolution_clock::now();
+        auto writeDuration =
+                std::chrono::duration_cast<std::chrono::microseconds>(afterTP - beforeTP).count();
+        // mWriteDurationPQ is not accessed by the writer until this object is drained.
+        mOwner->mWriteDurationPQ.emplace(writeDuration);
+        if (mOwner->mWriteDurationPQ.size() > mOwner->kWriteDurationsCount) {
+            mOwner->mWriteDurationPQ.pop();
+        }
+
+        if (written == batch->mSize) {
+            return;
+        }
+        ALOGE("AsyncFileWriter bytesWritten:%zu, count:%zu, offset:%" PRId64 ", error:%s(%d)",
+              written, batch->mSize, (int64_t)batch->mOffset, std::strerror(errno), errno);
+        postError();
+    }
+
+    void postError() {
+        mError = true;
+        // Can't guarantee that file is usable or write would succeed anymore, hence signal to stop.
+        sp<AMessage> msg = new AMessage(kWhatIOError, mOwner->mReflector);
+        msg->setInt32("err", ERROR_IO);
+        WARN_UNLESS(msg->post() == OK, "AsyncFileWriter:error posting ERROR_IO");
+    }
+
+    void threadFunc() {
+        prctl(PR_SET_NAME, (unsigned long)"MPEG4WriterIO", 0, 0, 0);
+
+        std::unique_lock<std::mutex> l(mLock);
+        while (true) {
+            mCondition.wait(l, [this] { return mQuit || !mPendingBatches.empty(); });
+            if (mPendingBatches.empty()) {
+                break;
+            }
+            Batch *batch = mPendingBatches.front();
+            l.unlock();
+            writeBatch(batch);
+            l.lock();
+            mPendingBatches.pop_front();
+            mFreeBatches.push_back(batch);
+            mCondition.notify_all();
+        }
+    }
+
+    AsyncFileWriter(const AsyncFileWriter &);
+    AsyncFileWriter &operator=(const AsyncFileWriter &);
+};
+
 MPEG4Writer::MPEG4Writer(int fd) {
     initInternal(dup(fd), true /*isFirstSession*/);
 }
@@ -630,6 +839,8 @@ void MPEG4Writer::initInternal(int fd, bool isFirstSession) {
     if (off < 0) {
         ALOGE("cannot seek mFd: %s (%d) %lld", strerror(errno), errno, (long long)mFd);
         release();
+    } else {
+        mAsyncWriter.reset(new AsyncFileWriter(this, mFd));
     }
 
     if (fallocate64(mFd, FALLOC_FL_KEEP_SIZE, 0, 1) == 0) {
@@ -1137,7 +1348,12 @@ status_t MPEG4Writer::start(MetaData *param) {
      * 2) If kWhatIOError wasn't delivered or getting processed,
      * kWhatNoIOErrorSoFar should get posted successfully.  Wait for
      * response from MP4WtrCtrlHlpLooper.
+     * With asynchronous writes, the atoms are written out first so that their
+     * errors are known.
      */
+    if (mAsyncWriter != nullptr && mAsyncWriter->drain() != OK) {
+        return ERROR_IO;
+    }
     sp<AMessage> msg = new AMessage(kWhatNoIOErrorSoFar, mReflector);
     sp<AMessage> response;
     err = msg->postAndAwaitResponse(&response);
@@ -1260,6 +1476,13 @@ void MPEG4Writer::printWriteDurations() {
 status_t MPEG4Writer::release() {
     ALOGD("release()");
     status_t err = OK;
+    if (mAsyncWriter != nullptr) {
+        // The last batches may only fail here, after the moov box has been written.
+        if (mAsyncWriter->drain() != OK) {
+            err = ERROR_IO;
+        }
+        mAsyncWriter.reset();
+    }
     if (!truncatePreAllocation()) {
         if (err == OK) { err = ERROR_IO; }
     }
@@ -1846,6 +2069,14 @@ void MPEG4Writer::writeOrPostError(int fd, const void* buf, size_t count) {
     if (mWriteSeekErr == true)
         return;
 
+    if (mAsyncWriter != nullptr && fd == mFd) {
+        // Failures are posted by the writer thread.
+        if (!mAsyncWriter->write(buf, count)) {
+            mWriteSeekErr = true;
+        }
+        return;
+    }
+
     auto beforeTP = std::chrono::high_resolution_clock::now();
     ssize_t bytesWritten = ::write(fd, buf, count);
     auto afterTP = std::chrono::high_resolution_clock::now();
@@ -1875,7 +2106,13 @@ void MPEG4Writer::writeOrPostError(int fd, const void* buf, size_t count) {
 void MPEG4Writer::seekOrPostError(int fd, off64_t offset, int whence) {
     if (mWriteSeekErr == true)
         return;
-    off64_t resOffset = lseek64(fd, offset, whence);
+    off64_t resOffset;
+    if (mAsyncWriter != nullptr && fd == mFd && whence == SEEK_SET && offset >= 0) {
+        // Writes are positioned explicitly, only the write position changes.
+        resOffset = mAsyncWriter->seek(offset);
+    } else {
+        resOffset = lseek64(fd, offset, whence);
+    }
     /* Allow to seek during stop() execution even when there was an error
      * (mWriteSeekErr == true) in the previous call to write() or lseek64().
      */
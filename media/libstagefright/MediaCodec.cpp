@@ -205,6 +205,28 @@ static const char *kCodecRecentLatencyAvg = "android.media.mediacodec.recent.avg
 static const char *kCodecRecentLatencyCount = "android.media.mediacodec.recent.n";
 static const char *kCodecRecentLatencyHist = "android.media.mediacodec.recent.hist";    /* in us */
 
+// latency between the stages of the latest frames, with .p50, .p90 and .p99 fields in us
+static const struct {
+    FrameLatencyTracer::Stage from;
+    FrameLatencyTracer::Stage to;
+    const char *key;
+} kCodecStageLatencies[] = {
+    { FrameLatencyTracer::QUEUED, FrameLatencyTracer::COMPONENT_QUEUED,
+      "android.media.mediacodec.stage.input" },
+    { FrameLatencyTracer::COMPONENT_QUEUED, FrameLatencyTracer::WORK_DONE,
+      "android.media.mediacodec.stage.component" },
+    { FrameLatencyTracer::WORK_DONE, FrameLatencyTracer::OUTPUT_AVAILABLE,
+      "android.media.mediacodec.stage.output" },
+    { FrameLatencyTracer::OUTPUT_AVAILABLE, FrameLatencyTracer::RELEASED,
+      "android.media.mediacodec.stage.client" },
+    { FrameLatencyTracer::RELEASED, FrameLatencyTracer::RENDERED,
+      "android.media.mediacodec.stage.render" },
+    { FrameLatencyTracer::QUEUED, FrameLatencyTracer::OUTPUT_AVAILABLE,
+      "android.media.mediacodec.stage.codec" },
+};
+// the stages of the latest frames logged with the stage percentiles when the codec goes away
+static constexpr size_t kCodecStageDumpFrames = 8;
+
 /* -1: shaper disabled
    >=0: number of fields changed */
 static const char *kCodecShapingEnhanced = "android.media.mediacodec.shaped";
@@ -322,6 +344,20 @@ static bool areRenderMetricsEnabled() {
     return v == "true";
 }
 
+// the frame latency is traced unless turned off: recording a stage costs well under a
+// microsecond per frame, and the ring of the tracer about 16KB per codec.
+static std::shared_ptr<FrameLatencyTracer> createFrameLatencyTracer() {
+    if (!property_get_bool("debug.stagefright.frame-latency", true)) {
+        return nullptr;
+    }
+    return std::make_shared<FrameLatencyTracer>();
+}
+
+// the stages of the latest frames are logged when the codec goes away only when debugging.
+static bool isFrameLatencyLogEnabled() {
+    return property_get_bool("debug.stagefright.frame-latency.log", false);
+}
+
 static const int kMaxRetry = 2;
 static const int kMaxReclaimWaitTimeInUs = 500000;  // 0.5s
 static const int kNumBuffersAlign = 16;
@@ -1262,6 +1298,7 @@ MediaCodec::MediaCodec(
       mIsLowLatencyModeOn(false),
       mIndexOfFirstFrameWhenLowLatencyOn(-1),
       mInputBufferCounter(0),
+      mFrameLatencyTracer(createFrameLatencyTracer()),
       mGetCodecBase(getCodecBase),
       mGetCodecInfo(getCodecInfo) {
     mCodecId = GenerateCodecId();
@@ -1310,6 +1347,11 @@ MediaCodec::~MediaCodec() {
 
     flushMediametrics();
 
+    if (mFrameLatencyTracer && isFrameLatencyLogEnabled()) {
+        ALOGI("[%s] %s", mComponentName.c_str(),
+                mFrameLatencyTracer->dump(kCodecStageDumpFrames).c_str());
+    }
+
     // clean any saved metrics info we stored as part of configure()
     if (mConfigureMsg != nullptr) {
         mediametrics_handle_t metricsHandle;
@@ -1452,6 +1494,18 @@ void MediaCodec::updateMediametrics() {
     if (mLatencyUnknown > 0) {
         mediametrics_setInt64(mMetricsHandle, kCodecLatencyUnknown, mLatencyUnknown);
     }
+    if (mFrameLatencyTracer) {
+        for (const auto &stageLatency : kCodecStageLatencies) {
+            FrameLatencyTracer::Percentiles p =
+                    mFrameLatencyTracer->getPercentiles(stageLatency.from, stageLatency.to);
+            if (p.count != 0) {
+                std::string key = stageLatency.key;
+                mediametrics_setInt64(mMetricsHandle, (key + ".p50").c_str(), p.p50Us);
+                mediametrics_setInt64(mMetricsHandle, (key + ".p90").c_str(), p.p90Us);
+                mediametrics_setInt64(mMetricsHandle, (key + ".p99").c_str(), p.p99Us);
+            }
+        }
+    }
     int64_t playbackDurationSec = mPlaybackDurationAccumulator.getDurationInSeconds();
     if (playbackDurationSec > 0) {
         mediametrics_setInt64(mMetricsHandle, kCodecPlaybackDurationSec, playbackDurationSec);
@@ -1869,6 +1923,10 @@ void MediaCodec::processRenderedFrames(const sp<AMessage> &msg) {
                 ALOGE("processRenderedFrames: no media time found");
                 continue;
             }
+            if (mFrameLatencyTracer) {
+                mFrameLatencyTracer->record(
+                        FrameLatencyTracer::RENDERED, mediaTimeUs, renderTimeNs);
+            }
             // Tunneled frames use INT64_MAX to indicate end-of-stream, so don't report it as a
             // rendered frame.
             if (!mTunneled || mediaTimeUs != INT64_MAX) {
@@ -1925,6 +1983,13 @@ void MediaCodec::statsBufferReceived(int64_t presentationUs, const sp<MediaCodec
 
     CHECK_NE(mState, UNINITIALIZED);
 
+    int32_t bufferFlags = 0;
+    (void) buffer->meta()->findInt32("flags", &bufferFlags);
+    if (mFrameLatencyTracer
+            && (bufferFlags & BUFFER_FLAG_CODECCONFIG) == 0 && buffer->size() != 0) {
+        mFrameLatencyTracer->record(FrameLatencyTracer::OUTPUT_AVAILABLE, presentationUs);
+    }
+
     if (mDomain == DOMAIN_VIDEO && (mFlags & kFlagIsEncoder)) {
         int32_t flags = 0;
         (void) buffer->meta()->findInt32("flags", &flags);
@@ -2211,6 +2276,7 @@ status_t MediaCodec::init(const AString &name, bool nameIsType) {
     mBufferChannel->setCallback(
             std::unique_ptr<CodecBase::BufferCallback>(
                     new BufferCallback(new AMessage(kWhatCodecNotify, this))));
+    mBufferChannel->setFrameLatencyTracer(mFrameLatencyTracer);
     sp<AMessage> msg = new AMessage(kWhatInit, this);
     msg->setObject("codecInfo", mCodecInfo);
     // name may be different from mCodecInfo->getCodecName() if we stripped
@@ -3625,6 +3691,10 @@ status_t MediaCodec::getMetrics(mediametrics_handle_t &reply) {
     return OK;
 }
 
+std::shared_ptr<const FrameLatencyTracer> MediaCodec::getFrameLatencyTracer() const {
+    return mFrameLatencyTracer;
+}
+
 // runs on the looper thread (for mutex purposes)
 void MediaCodec::onGetMetrics(const sp<AMessage>& msg) {
 
@@ -6451,6 +6521,11 @@ status_t MediaCodec::onQueueInputBuffer(const sp<AMessage> &msg) {
     int32_t usedMaxInputSize = mApiUsageMetrics.inputBufferSize.usedMax;
     mApiUsageMetrics.inputBufferSize.usedMax = size > usedMaxInputSize ? size : usedMaxInputSize;
 
+    // recorded before queueing, as the buffer channel records the next stages as it queues.
+    if (mFrameLatencyTracer && (flags & BUFFER_FLAG_CODECCONFIG) == 0 && size != 0) {
+        mFrameLatencyTracer->record(FrameLatencyTracer::QUEUED, timeUs);
+    }
+
     if (hasCryptoOrDescrambler() && !c2Buffer && !memory) {
         AString *errorDetailMsg;
         CHECK(msg->findPointer("errorDetailMsg", (void **)&errorDetailMsg));
@@ -6597,6 +6672,15 @@ status_t MediaCodec::onReleaseOutputBuffer(const sp<AMessage> &msg) {
         info->mData.clear();
     }
 
+    int32_t bufferFlags = 0;
+    int64_t bufferTimeUs = 0;
+    (void) buffer->meta()->findInt32("flags", &bufferFlags);
+    if (mFrameLatencyTracer
+            && (bufferFlags & BUFFER_FLAG_CODECCONFIG) == 0 && buffer->size() != 0
+            && buffer->meta()->findInt64("timeUs", &bufferTimeUs)) {
+        mFrameLatencyTracer->record(FrameLatencyTracer::RELEASED, bufferTimeUs);
+    }
+
     if (render && buffer->size() != 0) {
         int64_t mediaTimeUs = INT64_MIN;
         buffer->meta()->findInt64("timeUs", &mediaTimeUs);
@@ -22,6 +22,7 @@
 #include <media/stagefright/foundation/ADebug.h>
 #include <media/stagefright/foundation/ALooper.h>
 #include <media/stagefright/foundation/ColorUtils.h>
+#include <media/stagefright/foundation/WorkerPool.h>
 #include <media/stagefright/ColorConverter.h>
 #include <media/stagefright/MediaCodecConstants.h>
 #include <media/stagefright/MediaErrors.h>
@@ -30,21 +31,29 @@
 #include "libyuv/convert_argb.h"
 #include "libyuv/planar_functions.h"
 #include "libyuv/video_common.h"
+#include <algorithm>
 #include <functional>
+#include <vector>
 #include <sys/time.h>
 
 #define PERF_PROFILING 0
 
 #if defined(__aarch64__) || defined(__ARM_NEON__)
 #define USE_NEON_Y410 1
+#define USE_NEON_16BIT_RGB 1
 #else
 #define USE_NEON_Y410 0
+#define USE_NEON_16BIT_RGB 0
 #endif
 
-#if USE_NEON_Y410
+#if USE_NEON_Y410 || USE_NEON_16BIT_RGB
 #include <arm_neon.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace android {
 typedef const struct libyuv::YuvConstants LibyuvConstants;
 
@@ -456,6 +465,11 @@ constexpr int CLIP_RANGE_MAX_8BIT = 552;
 constexpr int CLIP_RANGE_MIN_10BIT = -1175;
 constexpr int CLIP_RANGE_MAX_10BIT = 2218;
 
+// Frames below this size are converted on the calling thread, as starting
+// the workers would cost more than it saves.
+constexpr size_t kMinPixelsPerThreadedConversion = 1280 * 720;
+constexpr size_t kMinRowsPerBand = 64;
+
 }
 
 ColorConverter::ColorConverter(
@@ -464,7 +478,8 @@ ColorConverter::ColorConverter(
       mDstFormat(to),
       mSrcColorSpace({0, 0, 0}),
       mClip(NULL),
-      mClip10Bit(NULL) {
+      mClip10Bit(NULL),
+      mMaxThreads(1) {
 }
 
 ColorConverter::~ColorConverter() {
@@ -557,6 +572,10 @@ void ColorConverter::setSrcColorSpace(
     mSrcColorSpace.mTransfer = transfer;
 }
 
+void ColorConverter::setMaxThreads(size_t maxThreads) {
+    mMaxThreads = maxThreads;
+}
+
 /*
  * If stride is non-zero, client's stride will be used. For planar
  * or semi-planar YUV formats, stride must be even numbers.
@@ -667,32 +686,12 @@ status_t ColorConverter::convert(
 #if PERF_PROFILING
     int64_t startTimeUs = ALooper::GetNowUs();
 #endif
-    status_t err;
     switch ((int32_t)mSrcFormat) {
-        case COLOR_FormatYUV420Flexible:
-            err = convertYUVMediaImage(src, dst);
-            break;
-
         case OMX_COLOR_FormatYUV420Planar:
             if (!mSrcImage) {
                 mSrcImage = Image(CreateYUV420PlanarMediaImage2(
                         srcWidth, srcHeight, srcStride, srcHeight, 8 /*bitDepth*/));
             }
-            err = convertYUVMediaImage(src, dst);
-
-            break;
-
-        case OMX_COLOR_FormatYUV420Planar16:
-            err = convertYUV420Planar16(src, dst);
-            break;
-
-        case COLOR_FormatYUVP010:
-            err = convertYUVP010(src, dst);
-
-            break;
-
-        case OMX_COLOR_FormatCbYCrY:
-            err = convertCbYCrY(src, dst);
             break;
 
         case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
@@ -700,8 +699,6 @@ status_t ColorConverter::convert(
                 mSrcImage = Image(CreateYUV420SemiPlanarMediaImage2(
                     srcWidth, srcHeight, srcStride, srcHeight, 8 /*bitDepth*/, false));
             }
-            err = convertYUVMediaImage(src, dst);
-
             break;
 
         case OMX_COLOR_FormatYUV420SemiPlanar:
@@ -710,25 +707,106 @@ status_t ColorConverter::convert(
                 mSrcImage = Image(CreateYUV420SemiPlanarMediaImage2(
                     srcWidth, srcHeight, srcStride, srcHeight, 8 /*bitDepth*/));
             }
-            err = convertYUVMediaImage(src, dst);
-
             break;
 
         default:
-
-            CHECK(!"Should not be here. Unknown color conversion.");
             break;
     }
 
+    status_t err;
+    const size_t numBands = getNumBands(src);
+    if (numBands <= 1) {
+        err = convertBand(src, dst);
+    } else {
+        // The clip tables are created lazily; do it before the bands share them.
+        initClip();
+        initClip10Bit();
+
+        // Bands start on even rows so that every band begins on the same
+        // chroma row it would have reached when converting the whole frame.
+        const size_t rowsPerBand = ((src.cropHeight() + numBands - 1) / numBands + 1) & ~1;
+        auto makeBand = [rowsPerBand](const BitmapParams &frame, size_t band) {
+            BitmapParams params = frame;
+            params.mCropTop += band * rowsPerBand;
+            params.mCropBottom = std::min(params.mCropTop + rowsPerBand - 1, frame.mCropBottom);
+            return params;
+        };
+
+        // rounding the bands up to even rows may leave the last ones empty.
+        const size_t usedBands =
+                std::min(numBands, (src.cropHeight() + rowsPerBand - 1) / rowsPerBand);
+        std::vector<status_t> bandErr(usedBands, OK);
+        WorkerPool::Run(usedBands, [&](size_t band) {
+            bandErr[band] = convertBand(makeBand(src, band), makeBand(dst, band));
+        });
+        err = OK;
+        for (status_t e : bandErr) {
+            if (e != OK) {
+                err = e;
+                break;
+            }
+        }
+    }
+
 #if PERF_PROFILING
     int64_t endTimeUs = ALooper::GetNowUs();
-    ALOGD("%s image took %lld us", asString_ColorFormat(mSrcFormat,"Unknown"),
-            (long long) (endTimeUs - startTimeUs));
+    ALOGD("%s image took %lld us (%zu bands)", asString_ColorFormat(mSrcFormat,"Unknown"),
+            (long long) (endTimeUs - startTimeUs), numBands);
 #endif
 
     return err;
 }
 
+size_t ColorConverter::getNumBands(const BitmapParams &src) const {
+    if (mMaxThreads == 1
+            || src.cropWidth() * src.cropHeight() < kMinPixelsPerThreadedConversion) {
+        return 1;
+    }
+    if (mSrcImage) {
+        // Band starts are only aligned for chroma subsampled by at most 2.
+        const MediaImage2 &img = mSrcImage->getMediaImage2();
+        if (img.mNumPlanes != 3
+                || img.mPlane[MediaImage2::PlaneIndex::U].mVertSubsampling > 2
+                || img.mPlane[MediaImage2::PlaneIndex::V].mVertSubsampling > 2) {
+            return 1;
+        }
+    }
+    const size_t maxThreads = (mMaxThreads == 0) ? WorkerPool::GetConcurrency() : mMaxThreads;
+    return std::max<size_t>(
+            std::min(maxThreads, src.cropHeight() / kMinRowsPerBand), 1);
+}
+
+status_t ColorConverter::convertBand(const BitmapParams &src, const BitmapParams &dst) {
+    status_t err;
+    switch ((int32_t)mSrcFormat) {
+        case COLOR_FormatYUV420Flexible:
+        case OMX_COLOR_FormatYUV420Planar:
+        case OMX_QCOM_COLOR_FormatYVU420SemiPlanar:
+        case OMX_COLOR_FormatYUV420SemiPlanar:
+        case OMX_TI_COLOR_FormatYUV420PackedSemiPlanar:
+            err = convertYUVMediaImage(src, dst);
+            break;
+
+        case OMX_COLOR_FormatYUV420Planar16:
+            err = convertYUV420Planar16(src, dst);
+            break;
+
+        case COLOR_FormatYUVP010:
+            err = convertYUVP010(src, dst);
+            break;
+
+        case OMX_COLOR_FormatCbYCrY:
+            err = convertCbYCrY(src, dst);
+            break;
+
+        default:
+
+            CHECK(!"Should not be here. Unknown color conversion.");
+            break;
+    }
+    return err;
+}
+
 const struct ColorConverter::Coeffs *ColorConverter::getMatrix() const {
     const bool isFullRange = mSrcColorSpace.mRange == ColorUtils::kColorRangeFull;
     const bool is10Bit = (mSrcFormat == COLOR_FormatYUVP010
@@ -1373,6 +1451,166 @@ status_t ColorConverter::convertYUVMediaImage(
     return OK;
 }
 
+namespace {
+
+/*
+ * Row kernels for the 16-bit YUV sources. These clamp with min/max instead of
+ * the clip tables so that they vectorize: for the values the matrices can
+ * produce, clamping (x >> 8) gives the same result as looking up x / 256.
+ */
+
+inline int32_t clampShr8(int32_t x, int32_t max) {
+    return std::min(std::max(x >> 8, 0), max);
+}
+
+// Converts a pair of pixels sharing the chroma sample (u, v), both offset to
+// be centered at 0. The luma values are already offset by _c16.
+template <int32_t MAX, typename WriteFn>
+inline void convertPixelPair(const ColorConverter::Coeffs &m, int32_t y1, int32_t y2,
+        int32_t u, int32_t v, bool uncropped, WriteFn write) {
+    const int32_t u_b = u * m._b_u;
+    const int32_t uv_g = -(u * m._g_u) - v * m._g_v;
+    const int32_t v_r = v * m._r_v;
+
+    const int32_t tmp1 = y1 * m._y + 128;
+    write(0, clampShr8(tmp1 + v_r, MAX), clampShr8(tmp1 + uv_g, MAX), clampShr8(tmp1 + u_b, MAX));
+    if (uncropped) {
+        const int32_t tmp2 = y2 * m._y + 128;
+        write(1, clampShr8(tmp2 + v_r, MAX), clampShr8(tmp2 + uv_g, MAX),
+                clampShr8(tmp2 + u_b, MAX));
+    }
+}
+
+#if USE_NEON_16BIT_RGB
+// NEON version of convertPixelPair() for 8 pixels: y holds the offset luma of
+// pixels 0-3 and 4-7, u and v the 4 chroma samples of the pixel pairs.
+template <int32_t MAX>
+inline void convertPixels8Neon(const ColorConverter::Coeffs &m, const int32x4_t y[2],
+        int32x4_t u, int32x4_t v, uint32x4_t r[2], uint32x4_t g[2], uint32x4_t b[2]) {
+    const int32x4_t zero = vdupq_n_s32(0);
+    const int32x4_t max = vdupq_n_s32(MAX);
+    const int32x4_t round = vdupq_n_s32(128);
+
+    const int32x4x2_t u_b = vzipq_s32(vmulq_n_s32(u, m._b_u), vmulq_n_s32(u, m._b_u));
+    const int32x4_t uv_g1 = vmlsq_n_s32(vmulq_n_s32(u, -m._g_u), v, m._g_v);
+    const int32x4x2_t uv_g = vzipq_s32(uv_g1, uv_g1);
+    const int32x4x2_t v_r = vzipq_s32(vmulq_n_s32(v, m._r_v), vmulq_n_s32(v, m._r_v));
+
+    for (int i = 0; i < 2; ++i) {
+        const int32x4_t tmp = vmlaq_n_s32(round, y[i], m._y);
+        r[i] = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(
+                vshrq_n_s32(vaddq_s32(tmp, v_r.val[i]), 8), zero), max));
+        g[i] = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(
+                vshrq_n_s32(vaddq_s32(tmp, uv_g.val[i]), 8), zero), max));
+        b[i] = vreinterpretq_u32_s32(vminq_s32(vmaxq_s32(
+                vshrq_n_s32(vaddq_s32(tmp, u_b.val[i]), 8), zero), max));
+    }
+}
+#endif // USE_NEON_16BIT_RGB
+
+// P010 (10 bits in the msbs, interleaved U/V) to RGBA_1010102.
+void convertRowP010ToRGBA1010102(const ColorConverter::Coeffs &m,
+        const uint16_t *src_y, const uint16_t *src_uv, uint32_t *dst, size_t width) {
+    const int32_t c64 = m._c16 * 4;
+    size_t x = 0;
+#if USE_NEON_16BIT_RGB
+    const int32x4_t vc64 = vdupq_n_s32(c64);
+    const int32x4_t v512 = vdupq_n_s32(512);
+    const uint32x4_t alpha = vdupq_n_u32(3u << 30);
+    for (; x + 8 <= width; x += 8) {
+        const uint16x8_t y16 = vshrq_n_u16(vld1q_u16(src_y + x), 6);
+        const uint16x4x2_t uv16 = vld2_u16(src_uv + x);
+        const int32x4_t y[2] = {
+                vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y16))), vc64),
+                vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y16))), vc64)};
+        const int32x4_t u = vsubq_s32(
+                vreinterpretq_s32_u32(vmovl_u16(vshr_n_u16(uv16.val[0], 6))), v512);
+        const int32x4_t v = vsubq_s32(
+                vreinterpretq_s32_u32(vmovl_u16(vshr_n_u16(uv16.val[1], 6))), v512);
+
+        uint32x4_t r[2], g[2], b[2];
+        convertPixels8Neon<1023>(m, y, u, v, r, g, b);
+        for (int i = 0; i < 2; ++i) {
+            vst1q_u32(dst + x + 4 * i, vorrq_u32(vorrq_u32(r[i], vshlq_n_u32(g[i], 10)),
+                    vorrq_u32(vshlq_n_u32(b[i], 20), alpha)));
+        }
+    }
+#endif
+    for (; x < width; x += 2) {
+        convertPixelPair<1023>(m,
+                (src_y[x] >> 6) - c64, (src_y[x + 1] >> 6) - c64,
+                int(src_uv[x] >> 6) - 512, int(src_uv[x + 1] >> 6) - 512,
+                x + 1 < width,
+                [dst, x](int i, uint32_t r, uint32_t g, uint32_t b) {
+                    dst[x + i] = r | (g << 10) | (b << 20) | (3u << 30);
+                });
+    }
+}
+
+// YUV420Planar16 to 8-bit RGB. As before, only the 8 msbs of a 10-bit sample are used.
+template <OMX_COLOR_FORMATTYPE DST_FORMAT>
+void convertRowYUV420Planar16ToRGB(const ColorConverter::Coeffs &m,
+        const uint16_t *src_y, const uint16_t *src_u, const uint16_t *src_v,
+        uint8_t *dst, size_t width) {
+    static_assert(DST_FORMAT == OMX_COLOR_Format16bitRGB565
+            || DST_FORMAT == OMX_COLOR_Format32BitRGBA8888
+            || DST_FORMAT == OMX_COLOR_Format32bitBGRA8888);
+    const int32_t c16 = m._c16;
+    size_t x = 0;
+#if USE_NEON_16BIT_RGB
+    const uint16x8_t mask8 = vdupq_n_u16(0xFF);
+    const int32x4_t vc16 = vdupq_n_s32(c16);
+    const int32x4_t v128 = vdupq_n_s32(128);
+    const uint32x4_t alpha = vdupq_n_u32(0xFFu << 24);
+    for (; x + 8 <= width; x += 8) {
+        const uint16x8_t y16 = vandq_u16(vshrq_n_u16(vld1q_u16(src_y + x), 2), mask8);
+        const int32x4_t y[2] = {
+                vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(y16))), vc16),
+                vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(y16))), vc16)};
+        const int32x4_t u = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(
+                vand_u16(vshr_n_u16(vld1_u16(src_u + x / 2), 2), vget_low_u16(mask8)))), v128);
+        const int32x4_t v = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(
+                vand_u16(vshr_n_u16(vld1_u16(src_v + x / 2), 2), vget_low_u16(mask8)))), v128);
+
+        uint32x4_t r[2], g[2], b[2];
+        convertPixels8Neon<255>(m, y, u, v, r, g, b);
+        if constexpr (DST_FORMAT == OMX_COLOR_Format16bitRGB565) {
+            uint16x4_t rgb[2];
+            for (int i = 0; i < 2; ++i) {
+                rgb[i] = vmovn_u32(vorrq_u32(vorrq_u32(
+                        vshlq_n_u32(vshrq_n_u32(r[i], 3), 11),
+                        vshlq_n_u32(vshrq_n_u32(g[i], 2), 5)), vshrq_n_u32(b[i], 3)));
+            }
+            vst1q_u16((uint16_t *)dst + x, vcombine_u16(rgb[0], rgb[1]));
+        } else {
+            for (int i = 0; i < 2; ++i) {
+                const uint32x4_t lo = DST_FORMAT == OMX_COLOR_Format32BitRGBA8888 ? r[i] : b[i];
+                const uint32x4_t hi = DST_FORMAT == OMX_COLOR_Format32BitRGBA8888 ? b[i] : r[i];
+                vst1q_u32((uint32_t *)dst + x + 4 * i, vorrq_u32(
+                        vorrq_u32(lo, vshlq_n_u32(g[i], 8)), vorrq_u32(vshlq_n_u32(hi, 16), alpha)));
+            }
+        }
+    }
+#endif
+    for (; x < width; x += 2) {
+        convertPixelPair<255>(m,
+                (uint8_t)(src_y[x] >> 2) - c16, (uint8_t)(src_y[x + 1] >> 2) - c16,
+                (uint8_t)(src_u[x / 2] >> 2) - 128, (uint8_t)(src_v[x / 2] >> 2) - 128,
+                x + 1 < width,
+                [dst, x](int i, uint32_t r, uint32_t g, uint32_t b) {
+                    if constexpr (DST_FORMAT == OMX_COLOR_Format16bitRGB565) {
+                        ((uint16_t *)dst)[x + i] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+                    } else if constexpr (DST_FORMAT == OMX_COLOR_Format32BitRGBA8888) {
+                        ((uint32_t *)dst)[x + i] = r | (g << 8) | (b << 16) | (0xFFu << 24);
+                    } else {
+                        ((uint32_t *)dst)[x + i] = b | (g << 8) | (r << 16) | (0xFFu << 24);
+                    }
+                });
+    }
+}
+
+}  // namespace
+
 status_t ColorConverter::convertYUV420Planar16(
         const BitmapParams &src, const BitmapParams &dst) {
     if (mDstFormat == OMX_COLOR_FormatYUV444Y410) {
@@ -1384,17 +1622,21 @@ status_t ColorConverter::convertYUV420Planar16(
         return ERROR_UNSUPPORTED;
     }
 
-    signed _b_u = matrix->_b_u;
-    signed _neg_g_u = -matrix->_g_u;
-    signed _neg_g_v = -matrix->_g_v;
-    signed _r_v = matrix->_r_v;
-    signed _y = matrix->_y;
-    signed _c16 = matrix->_c16;
-
-    uint8_t *kAdjustedClip = initClip();
-
-    auto readFromSrc = getReadFromChromaHorizSubsampled2Image8b(std::nullopt, mSrcFormat);
-    auto writeToDst = getWriteToDst(mDstFormat, (void *)kAdjustedClip);
+    void (*convertRow)(const Coeffs &, const uint16_t *, const uint16_t *, const uint16_t *,
+            uint8_t *, size_t);
+    switch (mDstFormat) {
+    case OMX_COLOR_Format16bitRGB565:
+        convertRow = convertRowYUV420Planar16ToRGB<OMX_COLOR_Format16bitRGB565>;
+        break;
+    case OMX_COLOR_Format32BitRGBA8888:
+        convertRow = convertRowYUV420Planar16ToRGB<OMX_COLOR_Format32BitRGBA8888>;
+        break;
+    case OMX_COLOR_Format32bitBGRA8888:
+        convertRow = convertRowYUV420Planar16ToRGB<OMX_COLOR_Format32bitBGRA8888>;
+        break;
+    default:
+        return ERROR_UNSUPPORTED;
+    }
 
     uint8_t *dst_ptr = (uint8_t *)dst.mBits
             + dst.mCropTop * dst.mStride + dst.mCropLeft * dst.mBpp;
@@ -1408,28 +1650,8 @@ status_t ColorConverter::convertYUV420Planar16(
     uint8_t *src_v = src_u + (src.mStride / 2) * (src.mHeight / 2);
 
     for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1, y2, u, v;
-            readFromSrc(src_y, src_u, src_v, x, &y1, &y2, &u, &v);
-
-            signed u_b = u * _b_u;
-            signed u_g = u * _neg_g_u;
-            signed v_g = v * _neg_g_v;
-            signed v_r = v * _r_v;
-
-            signed tmp1 = (y1 - _c16) * _y + 128;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = (y2 - _c16) * _y + 128;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            bool uncropped = x + 1 < src.cropWidth();
-            writeToDst(dst_ptr + x * dst.mBpp, uncropped, r1, g1, b1, r2, g2, b2);
-        }
+        convertRow(*matrix, (const uint16_t *)src_y, (const uint16_t *)src_u,
+                (const uint16_t *)src_v, dst_ptr, src.cropWidth());
 
         src_y += src.mStride;
 
@@ -1459,18 +1681,6 @@ status_t ColorConverter::convertYUVP010ToRGBA1010102(
         return ERROR_UNSUPPORTED;
     }
 
-    signed _b_u = matrix->_b_u;
-    signed _neg_g_u = -matrix->_g_u;
-    signed _neg_g_v = -matrix->_g_v;
-    signed _r_v = matrix->_r_v;
-    signed _y = matrix->_y;
-    signed _c64 = matrix->_c16 * 4;
-
-    uint16_t *kAdjustedClip10bit = initClip10Bit();
-
-//    auto readFromSrc = getReadFromSrc(mSrcFormat);
-    auto writeToDst = getWriteToDst(mDstFormat, (void *)kAdjustedClip10bit);
-
     uint8_t *dst_ptr = (uint8_t *)dst.mBits
             + dst.mCropTop * dst.mStride + dst.mCropLeft * dst.mBpp;
 
@@ -1482,32 +1692,8 @@ status_t ColorConverter::convertYUVP010ToRGBA1010102(
             + (src.mCropTop / 2) * src.mStride + src.mCropLeft * src.mBpp);
 
     for (size_t y = 0; y < src.cropHeight(); ++y) {
-        for (size_t x = 0; x < src.cropWidth(); x += 2) {
-            signed y1, y2, u, v;
-            y1 = (src_y[x] >> 6) - _c64;
-            y2 = (src_y[x + 1] >> 6) - _c64;
-            u = int(src_uv[x] >> 6) - 512;
-            v = int(src_uv[x + 1] >> 6) - 512;
-
-            signed u_b = u * _b_u;
-            signed u_g = u * _neg_g_u;
-            signed v_g = v * _neg_g_v;
-            signed v_r = v * _r_v;
-
-            signed tmp1 = y1 * _y + 128;
-            signed b1 = (tmp1 + u_b) / 256;
-            signed g1 = (tmp1 + v_g + u_g) / 256;
-            signed r1 = (tmp1 + v_r) / 256;
-
-            signed tmp2 = y2 * _y + 128;
-            signed b2 = (tmp2 + u_b) / 256;
-            signed g2 = (tmp2 + v_g + u_g) / 256;
-            signed r2 = (tmp2 + v_r) / 256;
-
-            bool uncropped = x + 1 < src.cropWidth();
-
-            writeToDst(dst_ptr + x * dst.mBpp, uncropped, r1, g1, b1, r2, g2, b2);
-        }
+        convertRowP010ToRGBA1010102(*matrix, src_y, src_uv, (uint32_t *)dst_ptr,
+                src.cropWidth());
 
         src_y += src.mStride / 2;
 
@@ -1550,6 +1736,38 @@ status_t ColorConverter::convertYUV420Planar16ToY410(
 
         uint32_t u01, v01, y01, y23, y45, y67, uv0, uv1;
         size_t x = 0;
+#if defined(__SSE2__)
+        // 8 pixels of both lines at a time. Like the loop below, this masks
+        // the even samples only.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i mask = _mm_setr_epi32(0x3FF, 0xFFFF, 0x3FF, 0xFFFF);
+        for (; x + 7 < src.cropWidth(); x += 8) {
+            const __m128i u = _mm_and_si128(
+                    _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)ptr_u), zero), mask);
+            const __m128i v = _mm_and_si128(
+                    _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)ptr_v), zero), mask);
+            const __m128i uv = _mm_or_si128(u, _mm_slli_epi32(v, 20));
+            const __m128i uv0011 = _mm_unpacklo_epi32(uv, uv);
+            const __m128i uv2233 = _mm_unpackhi_epi32(uv, uv);
+            ptr_u += 4;
+            ptr_v += 4;
+
+            const __m128i ytop = _mm_loadu_si128((const __m128i *)ptr_ytop);
+            const __m128i ybot = _mm_loadu_si128((const __m128i *)ptr_ybot);
+            ptr_ytop += 8;
+            ptr_ybot += 8;
+            _mm_storeu_si128((__m128i *)dst_top, _mm_or_si128(uv0011, _mm_slli_epi32(
+                    _mm_and_si128(_mm_unpacklo_epi16(ytop, zero), mask), 10)));
+            _mm_storeu_si128((__m128i *)(dst_top + 4), _mm_or_si128(uv2233, _mm_slli_epi32(
+                    _mm_and_si128(_mm_unpackhi_epi16(ytop, zero), mask), 10)));
+            _mm_storeu_si128((__m128i *)dst_bot, _mm_or_si128(uv0011, _mm_slli_epi32(
+                    _mm_and_si128(_mm_unpacklo_epi16(ybot, zero), mask), 10)));
+            _mm_storeu_si128((__m128i *)(dst_bot + 4), _mm_or_si128(uv2233, _mm_slli_epi32(
+                    _mm_and_si128(_mm_unpackhi_epi16(ybot, zero), mask), 10)));
+            dst_top += 8;
+            dst_bot += 8;
+        }
+#endif
         // x % 4 is always 0 so x + 3 will never overflow.
         for (; x + 3 < src.cropWidth(); x += 4) {
             u01 = *((uint32_t*)ptr_u); ptr_u += 2;
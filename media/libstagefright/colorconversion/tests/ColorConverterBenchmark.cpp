@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures ColorConverter throughput in megapixels per second for the formats
+// FrameDecoder uses, at 1080p, 4K and 8K, on 1, 2 and 4 threads.
+//
+// $ atest ColorConverterBenchmark
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/stagefright/ColorConverter.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/foundation/ColorUtils.h>
+
+namespace android {
+namespace {
+
+// Bytes per pixel of the luma plane; the 4:2:0 sources are 1.5 times that.
+size_t srcBytesPerPixel(int32_t format) {
+    switch (format) {
+        case OMX_COLOR_FormatYUV420Planar16:
+        case COLOR_FormatYUVP010:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+size_t dstBytesPerPixel(int32_t format) {
+    return format == OMX_COLOR_Format16bitRGB565 ? 2 : 4;
+}
+
+template <int32_t SRC_FORMAT, int32_t DST_FORMAT>
+void BM_ColorConvert(benchmark::State &state) {
+    const size_t width = state.range(0);
+    const size_t height = state.range(1);
+    const size_t threads = state.range(2);
+
+    ColorConverter converter((OMX_COLOR_FORMATTYPE)SRC_FORMAT, (OMX_COLOR_FORMATTYPE)DST_FORMAT);
+    const bool is10Bit = SRC_FORMAT == OMX_COLOR_FormatYUV420Planar16
+            || SRC_FORMAT == COLOR_FormatYUVP010;
+    converter.setSrcColorSpace(
+            is10Bit ? ColorUtils::kColorStandardBT2020 : ColorUtils::kColorStandardBT709,
+            ColorUtils::kColorRangeLimited, ColorUtils::kColorTransferSMPTE_170M);
+    converter.setMaxThreads(threads);
+    if (!converter.isValid()) {
+        state.SkipWithError("unsupported conversion");
+        return;
+    }
+
+    const size_t srcStride = width * srcBytesPerPixel(SRC_FORMAT);
+    std::vector<uint16_t> src((srcStride * height * 3 / 2 + 1) / 2);
+    std::mt19937 rng(42);
+    for (uint16_t &sample : src) {
+        // 10-bit samples are msb aligned in P010 and lsb aligned in YUV420Planar16.
+        sample = is10Bit ? (rng() & 0x3FF) << (SRC_FORMAT == COLOR_FormatYUVP010 ? 6 : 0)
+                : rng();
+    }
+    const size_t dstStride = width * dstBytesPerPixel(DST_FORMAT);
+    std::vector<uint8_t> dst(dstStride * height);
+
+    for (auto _ : state) {
+        status_t err = converter.convert(
+                src.data(), width, height, srcStride, 0, 0, width - 1, height - 1,
+                dst.data(), width, height, dstStride, 0, 0, width - 1, height - 1);
+        if (err != OK) {
+            state.SkipWithError("convert failed");
+            return;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.counters["MP/s"] = benchmark::Counter(
+            state.iterations() * width * height / 1e6, benchmark::Counter::kIsRate);
+}
+
+void ColorConvertArgs(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"width", "height", "threads"});
+    static const int64_t kSizes[][2] = {{1920, 1080}, {3840, 2160}, {7680, 4320}};
+    for (const auto &size : kSizes) {
+        for (int64_t threads : {1, 2, 4}) {
+            b->Args({size[0], size[1], threads});
+        }
+    }
+    b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_ColorConvert, COLOR_FormatYUVP010, COLOR_Format32bitABGR2101010)
+        ->Apply(ColorConvertArgs);
+BENCHMARK_TEMPLATE(BM_ColorConvert, OMX_COLOR_FormatYUV420Planar16, OMX_COLOR_FormatYUV444Y410)
+        ->Apply(ColorConvertArgs);
+BENCHMARK_TEMPLATE(BM_ColorConvert, OMX_COLOR_FormatYUV420Planar16,
+        OMX_COLOR_Format32BitRGBA8888)->Apply(ColorConvertArgs);
+BENCHMARK_TEMPLATE(BM_ColorConvert, OMX_COLOR_FormatYUV420Planar, OMX_COLOR_Format32BitRGBA8888)
+        ->Apply(ColorConvertArgs);
+BENCHMARK_TEMPLATE(BM_ColorConvert, OMX_COLOR_FormatYUV420SemiPlanar,
+        OMX_COLOR_Format16bitRGB565)->Apply(ColorConvertArgs);
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
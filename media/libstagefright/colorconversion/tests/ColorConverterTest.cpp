@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "ColorConverterTest"
+#include <utils/Log.h>
+
+#include <stdint.h>
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/stagefright/ColorConverter.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/foundation/ColorUtils.h>
+
+namespace android {
+
+// Frames large enough to be converted in bands, with odd heights so that the
+// last band ends on a chroma row shared with a missing luma row.
+static constexpr size_t kWidth = 1280;
+static constexpr size_t kHeights[] = {721, 1079, 1083};
+
+static bool is10Bit(int32_t format) {
+    return format == OMX_COLOR_FormatYUV420Planar16 || format == COLOR_FormatYUVP010;
+}
+
+static size_t bytesPerPixel(int32_t format) {
+    switch (format) {
+        case OMX_COLOR_FormatYUV420Planar16:
+        case COLOR_FormatYUVP010:
+        case OMX_COLOR_FormatCbYCrY:
+        case OMX_COLOR_Format16bitRGB565:
+            return 2;
+        case OMX_COLOR_Format32bitBGRA8888:
+        case OMX_COLOR_Format32BitRGBA8888:
+        case COLOR_Format32bitABGR2101010:
+        case OMX_COLOR_FormatYUV444Y410:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+// An 8-bit planar 4:2:0 layout, for the flexible source format.
+static MediaImage2 planarMediaImage(size_t width, size_t height) {
+    MediaImage2 img = {};
+    img.mType = MediaImage2::MEDIA_IMAGE_TYPE_YUV;
+    img.mNumPlanes = 3;
+    img.mWidth = width;
+    img.mHeight = height;
+    img.mBitDepth = 8;
+    img.mBitDepthAllocated = 8;
+    const size_t lumaSize = width * height;
+    const size_t chromaSize = (width / 2) * ((height + 1) / 2);
+    img.mPlane[MediaImage2::Y] = {0, 1, (int32_t)width, 1, 1};
+    img.mPlane[MediaImage2::U] = {(uint32_t)lumaSize, 1, (int32_t)width / 2, 2, 2};
+    img.mPlane[MediaImage2::V] = {(uint32_t)(lumaSize + chromaSize), 1, (int32_t)width / 2, 2, 2};
+    return img;
+}
+
+class ColorConverterTest
+    : public ::testing::TestWithParam<std::tuple<int32_t, int32_t>> {
+protected:
+    // Converts |src| on up to |maxThreads| threads.
+    std::vector<uint8_t> convert(
+            const std::vector<uint16_t> &src, size_t height, size_t maxThreads) {
+        const int32_t srcFormat = std::get<0>(GetParam());
+        const int32_t dstFormat = std::get<1>(GetParam());
+        ColorConverter converter(
+                (OMX_COLOR_FORMATTYPE)srcFormat, (OMX_COLOR_FORMATTYPE)dstFormat);
+        if (srcFormat == COLOR_FormatYUV420Flexible) {
+            converter.setSrcMediaImage2(planarMediaImage(kWidth, height));
+        }
+        converter.setSrcColorSpace(
+                is10Bit(srcFormat) ? ColorUtils::kColorStandardBT2020
+                        : ColorUtils::kColorStandardBT709,
+                ColorUtils::kColorRangeLimited, ColorUtils::kColorTransferSMPTE_170M);
+        converter.setMaxThreads(maxThreads);
+        EXPECT_TRUE(converter.isValid());
+
+        const size_t dstStride = kWidth * bytesPerPixel(dstFormat);
+        std::vector<uint8_t> dst(dstStride * height);
+        EXPECT_EQ(converter.convert(
+                src.data(), kWidth, height, kWidth * bytesPerPixel(srcFormat),
+                0, 0, kWidth - 1, height - 1,
+                dst.data(), kWidth, height, dstStride,
+                0, 0, kWidth - 1, height - 1), OK);
+        return dst;
+    }
+
+    std::vector<uint16_t> makeSource(size_t height) {
+        const int32_t srcFormat = std::get<0>(GetParam());
+        // large enough for any of the layouts, including rounded up chroma rows.
+        std::vector<uint16_t> src(kWidth * bytesPerPixel(srcFormat) * (height + 1));
+        std::mt19937 rng(height);
+        for (uint16_t &sample : src) {
+            // 10-bit samples are msb aligned in P010 and lsb aligned in YUV420Planar16.
+            sample = !is10Bit(srcFormat) ? rng()
+                    : (rng() & 0x3FF) << (srcFormat == COLOR_FormatYUVP010 ? 6 : 0);
+        }
+        return src;
+    }
+};
+
+TEST_P(ColorConverterTest, bandedOutputMatchesSingleThreaded) {
+    for (size_t height : kHeights) {
+        SCOPED_TRACE(height);
+        const std::vector<uint16_t> src = makeSource(height);
+        const std::vector<uint8_t> expected = convert(src, height, 1);
+        for (size_t maxThreads : {2, 3, 4}) {
+            SCOPED_TRACE(maxThreads);
+            EXPECT_TRUE(convert(src, height, maxThreads) == expected);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        ColorConverter, ColorConverterTest,
+        ::testing::Values(
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar, OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar, OMX_COLOR_Format32BitRGBA8888),
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar, OMX_COLOR_Format32bitBGRA8888),
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar16, OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar16, OMX_COLOR_Format32BitRGBA8888),
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar16, OMX_COLOR_Format32bitBGRA8888),
+                std::make_tuple(OMX_COLOR_FormatYUV420Planar16, OMX_COLOR_FormatYUV444Y410),
+                std::make_tuple(OMX_COLOR_FormatCbYCrY, OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(OMX_COLOR_FormatYUV420SemiPlanar, OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(OMX_COLOR_FormatYUV420SemiPlanar, OMX_COLOR_Format32BitRGBA8888),
+                std::make_tuple(OMX_COLOR_FormatYUV420SemiPlanar, OMX_COLOR_Format32bitBGRA8888),
+                std::make_tuple(OMX_QCOM_COLOR_FormatYVU420SemiPlanar,
+                        OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(OMX_QCOM_COLOR_FormatYVU420SemiPlanar,
+                        OMX_COLOR_Format32BitRGBA8888),
+                std::make_tuple(OMX_QCOM_COLOR_FormatYVU420SemiPlanar,
+                        OMX_COLOR_Format32bitBGRA8888),
+                std::make_tuple(OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+                        OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+                        OMX_COLOR_Format32BitRGBA8888),
+                std::make_tuple(OMX_TI_COLOR_FormatYUV420PackedSemiPlanar,
+                        OMX_COLOR_Format32bitBGRA8888),
+                std::make_tuple(COLOR_FormatYUVP010, COLOR_Format32bitABGR2101010),
+                std::make_tuple(COLOR_FormatYUV420Flexible, OMX_COLOR_Format16bitRGB565),
+                std::make_tuple(COLOR_FormatYUV420Flexible, OMX_COLOR_Format32BitRGBA8888),
+                std::make_tuple(COLOR_FormatYUV420Flexible, OMX_COLOR_Format32bitBGRA8888)));
+
+}  // namespace android
@@ -66,9 +66,10 @@ struct HTTPDownloader : public RefBase {
             sp<ABuffer> *out,
             String8 *actualUrl = NULL);
 
-    // fetch a playlist file
+    // fetch a playlist file, reusing what it has in common with |previous|
     sp<M3UParser> fetchPlaylist(
-            const char *url, uint8_t *curPlaylistHash, bool *unchanged);
+            const char *url, uint8_t *curPlaylistHash, bool *unchanged,
+            const sp<M3UParser> &previous);
 
 private:
     sp<HTTPBase> mHTTPDataSource;
@@ -251,6 +251,12 @@ bool M3UParser::MediaGroup::getActiveURI(AString *uri, const char *baseURL) cons
 
 M3UParser::M3UParser(
         const char *baseURI, const void *data, size_t size)
+    : M3UParser(baseURI, data, size, nullptr /* previous */) {
+}
+
+M3UParser::M3UParser(
+        const char *baseURI, const void *data, size_t size,
+        const sp<M3UParser> &previous)
     : mInitCheck(NO_INIT),
       mBaseURI(baseURI),
       mIsExtM3U(false),
@@ -260,10 +266,11 @@ M3UParser::M3UParser(
       mFirstSeqNumber(-1),
       mLastSeqNumber(-1),
       mTargetDurationUs(-1LL),
+      mSkipBoundaryUs(-1LL),
       mDiscontinuitySeq(0),
       mDiscontinuityCount(0),
       mSelectedIndex(-1) {
-    mInitCheck = parse(data, size);
+    mInitCheck = parse(data, size, previous);
 }
 
 M3UParser::~M3UParser() {
@@ -306,6 +313,10 @@ void M3UParser::getSeqNumberRange(int32_t *firstSeq, int32_t *lastSeq) const {
     *lastSeq = mLastSeqNumber;
 }
 
+int64_t M3UParser::getSkipBoundaryUs() const {
+    return mSkipBoundaryUs;
+}
+
 sp<AMessage> M3UParser::meta() {
     return mMeta;
 }
@@ -566,15 +577,41 @@ AString M3UParser::MediaGroup::Media::makeURL(const char *baseURL) const {
     return out;
 }
 
-status_t M3UParser::parse(const void *_data, size_t size) {
+status_t M3UParser::parse(
+        const void *_data, size_t size, const sp<M3UParser> &previous) {
     int32_t lineNo = 0;
 
     sp<AMessage> itemMeta;
 
+    // Only the segments of a live media playlist are reused on reload.
+    const bool hasPrevious = previous != NULL && previous->mText != NULL;
+    if (hasPrevious) {
+        // room for the few segments a reload usually adds.
+        mItems.setCapacity(previous->mItems.size() + 16);
+    }
+
+    // Where the text of the current segment starts, and the parser state there.
+    size_t itemOffset = 0;
+    int32_t itemDiscontinuityCount = 0;
+    uint64_t itemRangeOffset = 0;
+    bool itemReusable = false;
+
     const char *data = (const char *)_data;
     size_t offset = 0;
     uint64_t segmentRangeOffset = 0;
     while (offset < size) {
+        if (offset == itemOffset) {
+            if (hasPrevious && mIsExtM3U && !mIsVariantPlaylist
+                    && reuseItem(previous, data, size, offset, &segmentRangeOffset)) {
+                offset += mItems.top().mTextSize;
+                itemOffset = offset;
+                continue;
+            }
+            itemDiscontinuityCount = mDiscontinuityCount;
+            itemRangeOffset = segmentRangeOffset;
+            itemReusable = lineNo > 0;
+        }
+
         size_t offsetLF = offset;
         while (offsetLF < size && data[offsetLF] != '\n') {
             ++offsetLF;
@@ -606,11 +643,13 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                     return ERROR_MALFORMED;
                 }
                 err = parseMetaData(line, &mMeta, "target-duration");
+                itemReusable = false;
             } else if (line.startsWith("#EXT-X-MEDIA-SEQUENCE")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
                 }
                 err = parseMetaData(line, &mMeta, "media-sequence");
+                itemReusable = false;
             } else if (line.startsWith("#EXT-X-KEY")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
@@ -618,8 +657,10 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 err = parseCipherInfo(line, &itemMeta);
             } else if (line.startsWith("#EXT-X-ENDLIST")) {
                 mIsComplete = true;
+                itemReusable = false;
             } else if (line.startsWith("#EXT-X-PLAYLIST-TYPE:EVENT")) {
                 mIsEvent = true;
+                itemReusable = false;
             } else if (line.startsWith("#EXTINF")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
@@ -637,6 +678,7 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 } else {
                     ALOGI("Failed to parseDiscontinuitySequence %d", err);
                 }
+                itemReusable = false;
             } else if (line.startsWith("#EXT-X-DISCONTINUITY")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
@@ -652,6 +694,7 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 }
                 mIsVariantPlaylist = true;
                 err = parseStreamInf(line, &itemMeta);
+                itemReusable = false;
             } else if (line.startsWith("#EXT-X-BYTERANGE")) {
                 if (mIsVariantPlaylist) {
                     return ERROR_MALFORMED;
@@ -672,6 +715,16 @@ status_t M3UParser::parse(const void *_data, size_t size) {
                 }
             } else if (line.startsWith("#EXT-X-MEDIA")) {
                 err = parseMedia(line);
+                itemReusable = false;
+            } else if (line.startsWith("#EXT-X-SERVER-CONTROL")) {
+                err = parseSkipBoundary(line, &mSkipBoundaryUs);
+                itemReusable = false;
+            } else if (line.startsWith("#EXT-X-SKIP")) {
+                if (mIsVariantPlaylist) {
+                    return ERROR_MALFORMED;
+                }
+                err = addSkippedItems(line, previous, &segmentRangeOffset);
+                itemReusable = false;
             }
 
             if (err != OK) {
@@ -700,7 +753,17 @@ status_t M3UParser::parse(const void *_data, size_t size) {
 
             item->mMeta = itemMeta;
 
+            if (itemReusable && mIsExtM3U && !mIsVariantPlaylist && offsetLF < size) {
+                item->mTextOffset = itemOffset;
+                item->mTextSize = offsetLF + 1 - itemOffset;
+            }
+            item->mDiscontinuitySeq = mDiscontinuitySeq + mDiscontinuityCount;
+            item->mDiscontinuities = mDiscontinuityCount - itemDiscontinuityCount;
+            item->mRangeOffsetBefore = itemRangeOffset;
+            item->mRangeOffsetAfter = segmentRangeOffset;
+
             itemMeta.clear();
+            itemOffset = offsetLF + 1;
         }
 
         offset = offsetLF + 1;
@@ -732,7 +795,8 @@ status_t M3UParser::parse(const void *_data, size_t size) {
         mLastSeqNumber = mFirstSeqNumber + mItems.size() - 1;
     }
 
-    for (size_t i = 0; i < mItems.size(); ++i) {
+    // only the items of a variant playlist refer to media groups.
+    for (size_t i = 0; mIsVariantPlaylist && i < mItems.size(); ++i) {
         sp<AMessage> meta = mItems.itemAt(i).mMeta;
         const char *keys[] = {"audio", "video", "subtitles"};
         for (size_t j = 0; j < sizeof(keys) / sizeof(const char *); ++j) {
@@ -748,6 +812,10 @@ status_t M3UParser::parse(const void *_data, size_t size) {
         }
     }
 
+    if (!mIsVariantPlaylist && !mIsComplete) {
+        mText = ABuffer::CreateAsCopy(data, size);
+    }
+
     return OK;
 }
 
@@ -822,6 +890,125 @@ static ssize_t FindNextUnquoted(
     return -1;
 }
 
+// Finds the value of the attribute |key| of the tag |line|.
+static bool FindAttribute(const AString &line, const char *key, AString *value) {
+    ssize_t colonPos = line.find(":");
+
+    if (colonPos < 0) {
+        return false;
+    }
+
+    size_t offset = colonPos + 1;
+
+    while (offset < line.size()) {
+        ssize_t end = FindNextUnquoted(line, ',', offset);
+        if (end < 0) {
+            end = line.size();
+        }
+
+        AString attr(line, offset, end - offset);
+        attr.trim();
+
+        offset = end + 1;
+
+        ssize_t equalPos = attr.find("=");
+        if (equalPos < 0) {
+            continue;
+        }
+
+        AString name(attr, 0, equalPos);
+        name.trim();
+
+        if (!strcasecmp(key, name.c_str())) {
+            value->setTo(attr, equalPos + 1, attr.size() - equalPos - 1);
+            value->trim();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Appends the item |previous| has for the segment at |offset| if the segment is
+// repeated unchanged, and parsing it again would give the same item.
+bool M3UParser::reuseItem(
+        const sp<M3UParser> &previous, const char *data, size_t size,
+        size_t offset, uint64_t *segmentRangeOffset) {
+    int32_t firstSeqNumber = 0;
+    if (mMeta != NULL) {
+        mMeta->findInt32("media-sequence", &firstSeqNumber);
+    }
+    int64_t index = (int64_t)firstSeqNumber + (int64_t)mItems.size()
+            - previous->mFirstSeqNumber;
+    if (index < 0 || index >= (int64_t)previous->mItems.size()) {
+        return false;
+    }
+
+    const Item &item = previous->mItems.itemAt(index);
+    if (item.mTextSize == 0
+            || item.mTextSize > size - offset
+            || item.mRangeOffsetBefore != *segmentRangeOffset
+            || item.mDiscontinuitySeq
+                    != mDiscontinuitySeq + mDiscontinuityCount + item.mDiscontinuities
+            || memcmp(data + offset,
+                    previous->mText->data() + item.mTextOffset, item.mTextSize)) {
+        return false;
+    }
+
+    mItems.push(item);
+    mItems.editTop().mTextOffset = offset;
+    mDiscontinuityCount += item.mDiscontinuities;
+    *segmentRangeOffset = item.mRangeOffsetAfter;
+    return true;
+}
+
+// Appends the items of |previous| for the segments an EXT-X-SKIP tag stands for.
+status_t M3UParser::addSkippedItems(
+        const AString &line, const sp<M3UParser> &previous,
+        uint64_t *segmentRangeOffset) {
+    AString value;
+    int32_t skipped;
+    if (!FindAttribute(line, "SKIPPED-SEGMENTS", &value)
+            || ParseInt32(value.c_str(), &skipped) != OK
+            || skipped < 0
+            || !mItems.empty()) {
+        return ERROR_MALFORMED;
+    }
+
+    if (previous == NULL || previous->mText == NULL) {
+        ALOGE("delta update with no playlist to apply it to");
+        return ERROR_MALFORMED;
+    }
+
+    int32_t firstSeqNumber = 0;
+    if (mMeta != NULL) {
+        mMeta->findInt32("media-sequence", &firstSeqNumber);
+    }
+    int64_t index = (int64_t)firstSeqNumber - previous->mFirstSeqNumber;
+    if (index < 0 || index + skipped > (int64_t)previous->mItems.size()) {
+        ALOGW("delta update skips segments from %d, have %d-%d",
+                firstSeqNumber, previous->mFirstSeqNumber, previous->mLastSeqNumber);
+        return ERROR_MALFORMED;
+    }
+    if (skipped == 0) {
+        return OK;
+    }
+
+    for (int32_t i = 0; i < skipped; ++i) {
+        mItems.push(previous->mItems.itemAt(index + i));
+        // their text is not part of this playlist.
+        mItems.editTop().mTextSize = 0;
+    }
+
+    const Item &last = mItems.top();
+    if (last.mDiscontinuitySeq < mDiscontinuitySeq) {
+        return ERROR_MALFORMED;
+    }
+    mDiscontinuityCount = last.mDiscontinuitySeq - mDiscontinuitySeq;
+    *segmentRangeOffset = last.mRangeOffsetAfter;
+    return OK;
+}
+
 status_t M3UParser::parseStreamInf(
         const AString &line, sp<AMessage> *meta) const {
     ssize_t colonPos = line.find(":");
@@ -1311,6 +1498,27 @@ status_t M3UParser::parseDiscontinuitySequence(const AString &line, size_t *seq)
     return OK;
 }
 
+// static
+status_t M3UParser::parseSkipBoundary(const AString &line, int64_t *skipBoundaryUs) {
+    AString value;
+    if (!FindAttribute(line, "CAN-SKIP-UNTIL", &value)) {
+        return OK;
+    }
+
+    double x;
+    status_t err = ParseDouble(value.c_str(), &x);
+    if (err != OK) {
+        return err;
+    }
+
+    if (x <= 0) {
+        return ERROR_MALFORMED;
+    }
+
+    *skipBoundaryUs = x * 1E6;
+    return OK;
+}
+
 // static
 status_t M3UParser::ParseInt32(const char *s, int32_t *x) {
     char *end;
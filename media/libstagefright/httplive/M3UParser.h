@@ -19,6 +19,7 @@
 #define M3U_PARSER_H_
 
 #include <media/stagefright/foundation/ABase.h>
+#include <media/stagefright/foundation/ABuffer.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AString.h>
 #include <media/mediaplayer.h>
@@ -29,6 +30,12 @@ namespace android {
 struct M3UParser : public RefBase {
     M3UParser(const char *baseURI, const void *data, size_t size);
 
+    // Parses a reload of the live media playlist |previous| was parsed from.
+    // Segments repeated unchanged from |previous| are not parsed again, and the
+    // segments an EXT-X-SKIP tag stands for are taken from it.
+    M3UParser(const char *baseURI, const void *data, size_t size,
+            const sp<M3UParser> &previous);
+
     status_t initCheck() const;
 
     bool isExtM3U() const;
@@ -40,6 +47,10 @@ struct M3UParser : public RefBase {
     int32_t getFirstSeqNumber() const;
     void getSeqNumberRange(int32_t *firstSeq, int32_t *lastSeq) const;
 
+    // Returns the skip boundary (CAN-SKIP-UNTIL) of the playlist, or -1 if the
+    // server does not support delta updates.
+    int64_t getSkipBoundaryUs() const;
+
     sp<AMessage> meta();
 
     size_t size();
@@ -67,6 +78,17 @@ private:
         AString mURI;
         sp<AMessage> mMeta;
         AString makeURL(const char *baseURL) const;
+
+        // Where the tags and URI of the segment are in mText (0 bytes if a
+        // reload repeating them cannot reuse the item), its discontinuity
+        // sequence, the discontinuities in its tags and the byte range offset
+        // before and after them.
+        size_t mTextOffset = 0;
+        size_t mTextSize = 0;
+        size_t mDiscontinuitySeq = 0;
+        int32_t mDiscontinuities = 0;
+        uint64_t mRangeOffsetBefore = 0;
+        uint64_t mRangeOffsetAfter = 0;
     };
 
     status_t mInitCheck;
@@ -79,6 +101,7 @@ private:
     int32_t mFirstSeqNumber;
     int32_t mLastSeqNumber;
     int64_t mTargetDurationUs;
+    int64_t mSkipBoundaryUs;
     size_t mDiscontinuitySeq;
     int32_t mDiscontinuityCount;
 
@@ -89,7 +112,16 @@ private:
     // Media groups keyed by group ID.
     KeyedVector<AString, sp<MediaGroup> > mMediaGroups;
 
-    status_t parse(const void *data, size_t size);
+    // Text of a live media playlist, kept to compare the next reload with.
+    sp<ABuffer> mText;
+
+    status_t parse(const void *data, size_t size, const sp<M3UParser> &previous);
+
+    bool reuseItem(const sp<M3UParser> &previous, const char *data, size_t size,
+            size_t offset, uint64_t *segmentRangeOffset);
+
+    status_t addSkippedItems(const AString &line, const sp<M3UParser> &previous,
+            uint64_t *segmentRangeOffset);
 
     static status_t parseMetaData(
             const AString &line, sp<AMessage> *meta, const char *key);
@@ -111,6 +143,8 @@ private:
 
     static status_t parseDiscontinuitySequence(const AString &line, size_t *seq);
 
+    static status_t parseSkipBoundary(const AString &line, int64_t *skipBoundaryUs);
+
     static status_t ParseInt32(const char *s, int32_t *x);
     static status_t ParseDouble(const char *s, double *x);
 
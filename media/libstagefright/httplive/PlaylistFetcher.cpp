@@ -665,7 +665,8 @@ void PlaylistFetcher::onMessageReceived(const sp<AMessage> &msg) {
         {
             bool unchanged;
             sp<M3UParser> playlist = mHTTPDownloader->fetchPlaylist(
-                    mURI.c_str(), NULL /* curPlaylistHash */, &unchanged);
+                    mURI.c_str(), NULL /* curPlaylistHash */, &unchanged,
+                    nullptr /* previous */);
 
             sp<AMessage> notify = mNotify->dup();
             notify->setInt32("what", kWhatPlaylistFetched);
@@ -940,9 +941,28 @@ void PlaylistFetcher::onMonitorQueue() {
 
 status_t PlaylistFetcher::refreshPlaylist() {
     if (delayUsToRefreshPlaylist() <= 0) {
+        // Ask for a delta update (EXT-X-SKIP) if the server supports them, and
+        // our playlist is recent enough to have the segments it would skip.
+        AString url = mURI;
+        bool deltaUpdate = false;
+        if (mPlaylist != NULL && mPlaylist->getSkipBoundaryUs() > 0
+                && ALooper::GetNowUs() - mLastPlaylistFetchTimeUs
+                        < mPlaylist->getSkipBoundaryUs() / 2) {
+            url.append(url.find("?") < 0 ? "?" : "&");
+            url.append("_HLS_skip=YES");
+            deltaUpdate = true;
+        }
+
         bool unchanged;
         sp<M3UParser> playlist = mHTTPDownloader->fetchPlaylist(
-                mURI.c_str(), mPlaylistHash, &unchanged);
+                url.c_str(), mPlaylistHash, &unchanged, mPlaylist);
+
+        if (playlist == NULL && !unchanged && deltaUpdate) {
+            // the delta update could not be applied to our playlist.
+            ALOGW("delta update failed, reloading the whole playlist");
+            playlist = mHTTPDownloader->fetchPlaylist(
+                    mURI.c_str(), mPlaylistHash, &unchanged, mPlaylist);
+        }
 
         if (playlist == NULL) {
             if (unchanged) {
@@ -1753,15 +1773,10 @@ status_t PlaylistFetcher::extractAndQueueAccessUnitsFromTs(const sp<ABuffer> &bu
         mSampleAesKeyItemChanged = false;
     }
 
-    size_t offset = 0;
-    while (offset + 188 <= buffer->size()) {
-        status_t err = mTSParser->feedTSPacket(buffer->data() + offset, 188);
-
-        if (err != OK) {
-            return err;
-        }
-
-        offset += 188;
+    size_t offset = buffer->size() - buffer->size() % 188;
+    status_t err = mTSParser->feedTSPackets(buffer->data(), offset);
+    if (err != OK) {
+        return err;
     }
     // setRange to indicate consumed bytes.
     buffer->setRange(buffer->offset() + offset, buffer->size() - offset);
@@ -1824,7 +1839,7 @@ status_t PlaylistFetcher::extractAndQueueAccessUnitsFromTs(const sp<ABuffer> &bu
         }
     }
 
-    status_t err = OK;
+    err = OK;
     mLastIDRFound = false;
     bool hasAvcOrHevcSource = false;
     for (size_t i = mPacketSources.size(); i > 0;) {
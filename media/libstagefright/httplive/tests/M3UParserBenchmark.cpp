@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays the reloads of a synthetic live media playlist with a sliding window of
+// segments, as PlaylistFetcher does: each reload drops the oldest segment and adds
+// a new one.
+//
+// BM_ReloadFull parses every reload from scratch, BM_ReloadIncremental reuses the
+// segments the previous reload already had, and BM_ReloadDelta parses delta updates
+// (EXT-X-SKIP) that only list the segments within the skip boundary.
+//
+// $ atest M3UParserBenchmark
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <M3UParser.h>
+#include <benchmark/benchmark.h>
+
+using namespace android;
+
+namespace {
+
+constexpr char kBaseURI[] = "https://example.com/live/index.m3u8";
+constexpr int32_t kTargetDurationSecs = 2;
+constexpr int32_t kSkipBoundarySecs = 6 * kTargetDurationSecs;
+constexpr int32_t kDiscontinuityInterval = 500;  // segments
+constexpr int32_t kKeyInterval = 100;  // segments
+constexpr size_t kReloads = 32;
+
+std::string makePlaylist(int32_t firstSeq, int32_t window, bool delta) {
+    std::string text;
+    text.reserve(window * 96);
+    text += "#EXTM3U\n#EXT-X-VERSION:9\n";
+    text += "#EXT-X-TARGETDURATION:" + std::to_string(kTargetDurationSecs) + "\n";
+    text += "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=" + std::to_string(kSkipBoundarySecs) + "\n";
+    text += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(firstSeq) + "\n";
+    text += "#EXT-X-DISCONTINUITY-SEQUENCE:"
+            + std::to_string((firstSeq + kDiscontinuityInterval - 1) / kDiscontinuityInterval)
+            + "\n";
+    int32_t seq = firstSeq;
+    if (delta) {
+        const int32_t skipped = window - kSkipBoundarySecs / kTargetDurationSecs;
+        text += "#EXT-X-SKIP:SKIPPED-SEGMENTS=" + std::to_string(skipped) + "\n";
+        seq += skipped;
+    }
+    for (; seq < firstSeq + window; ++seq) {
+        if (seq % kDiscontinuityInterval == 0) {
+            text += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (seq % kKeyInterval == 0) {
+            text += "#EXT-X-KEY:METHOD=AES-128,URI=\"key" + std::to_string(seq / kKeyInterval)
+                    + ".bin\"\n";
+        }
+        const int32_t secs = seq * kTargetDurationSecs;
+        char time[64];
+        snprintf(time, sizeof(time), "#EXT-X-PROGRAM-DATE-TIME:2024-01-01T%02d:%02d:%02d.000Z\n",
+                (secs / 3600) % 24, (secs / 60) % 60, secs % 60);
+        text += time;
+        text += "#EXTINF:2.000,\n";
+        text += "segment" + std::to_string(seq) + ".ts\n";
+    }
+    return text;
+}
+
+sp<M3UParser> parse(const std::string& text, const sp<M3UParser>& previous) {
+    return new M3UParser(kBaseURI, text.data(), text.size(), previous);
+}
+
+enum Mode { FULL, INCREMENTAL, DELTA };
+
+// Argument: the number of segments of the playlist.
+void replayReloads(benchmark::State& state, Mode mode) {
+    const int32_t window = state.range(0);
+    const sp<M3UParser> initial = parse(makePlaylist(1, window, false /* delta */), nullptr);
+    std::vector<std::string> reloads;
+    size_t bytes = 0;
+    for (size_t i = 1; i <= kReloads; ++i) {
+        reloads.push_back(makePlaylist(1 + i, window, mode == DELTA));
+        bytes += reloads.back().size();
+    }
+
+    for (auto _ : state) {
+        sp<M3UParser> playlist = initial;
+        for (const std::string& text : reloads) {
+            playlist = parse(text, mode == FULL ? nullptr : playlist);
+            if (playlist->initCheck() != OK || playlist->size() != (size_t)window) {
+                state.SkipWithError("failed to parse a reload");
+                return;
+            }
+        }
+        benchmark::DoNotOptimize(playlist);
+    }
+    state.SetItemsProcessed(state.iterations() * kReloads);
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+void BM_ReloadFull(benchmark::State& state) {
+    replayReloads(state, FULL);
+}
+
+void BM_ReloadIncremental(benchmark::State& state) {
+    replayReloads(state, INCREMENTAL);
+}
+
+void BM_ReloadDelta(benchmark::State& state) {
+    replayReloads(state, DELTA);
+}
+
+// from a few minutes to a few hours of 2 s segments.
+BENCHMARK(BM_ReloadFull)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReloadIncremental)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReloadDelta)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "M3UParserTest"
+#include <utils/Log.h>
+
+#include <string.h>
+
+#include <string>
+#include <tuple>
+
+#include <M3UParser.h>
+#include <gtest/gtest.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+
+static constexpr char kBaseURI[] = "https://example.com/live/index.m3u8";
+static constexpr int64_t kSkipBoundaryUs = 12000000;
+
+struct PlaylistParams {
+    int32_t firstSeq;
+    int32_t window;
+    // number of segments listed after EXT-X-SKIP, 0 for a full playlist.
+    int32_t listed = 0;
+    // segments carry EXT-X-BYTERANGE, continuing the previous range unless
+    // the segment starts a new one.
+    bool byteRange = false;
+    int32_t discontinuityInterval = 5;
+    bool endList = false;
+};
+
+static PlaylistParams livePlaylist(int32_t firstSeq, int32_t window, int32_t listed = 0) {
+    PlaylistParams params;
+    params.firstSeq = firstSeq;
+    params.window = window;
+    params.listed = listed;
+    return params;
+}
+
+// A live media playlist with a sliding window of segments, with the tags that
+// carry state from one segment to the next.
+static std::string makePlaylist(const PlaylistParams &params) {
+    std::string text = "#EXTM3U\n#EXT-X-VERSION:9\n#EXT-X-TARGETDURATION:2\n"
+            "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12.0\n";
+    text += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(params.firstSeq) + "\n";
+    text += "#EXT-X-DISCONTINUITY-SEQUENCE:" + std::to_string(
+            (params.firstSeq + params.discontinuityInterval - 1)
+                    / params.discontinuityInterval) + "\n";
+    int32_t seq = params.firstSeq;
+    if (params.listed > 0) {
+        const int32_t skipped = params.window - params.listed;
+        text += "#EXT-X-SKIP:SKIPPED-SEGMENTS=" + std::to_string(skipped) + "\n";
+        seq += skipped;
+    }
+    const int32_t firstListed = seq;
+    for (; seq < params.firstSeq + params.window; ++seq) {
+        if (seq % params.discontinuityInterval == 0) {
+            text += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (seq % 7 == 0) {
+            text += "#EXT-X-KEY:METHOD=AES-128,URI=\"key" + std::to_string(seq) + ".bin\"\n";
+        }
+        text += "#EXTINF:2.0" + std::to_string(seq % 3) + ",\n";
+        if (params.byteRange) {
+            text += "#EXT-X-BYTERANGE:1000";
+            if (seq % 5 == 0 || seq == firstListed) {
+                text += "@" + std::to_string(seq * 1000);
+            }
+            text += "\n";
+        }
+        text += "segment" + std::to_string(seq) + ".ts\n";
+    }
+    if (params.endList) {
+        text += "#EXT-X-ENDLIST\n";
+    }
+    return text;
+}
+
+static sp<M3UParser> parse(const std::string &text, const sp<M3UParser> &previous = nullptr) {
+    return new M3UParser(kBaseURI, text.data(), text.size(), previous);
+}
+
+// Checks that |actual| has the same segments as |expected|, which was parsed
+// from scratch.
+static void expectSameItems(const sp<M3UParser> &expected, const sp<M3UParser> &actual) {
+    ASSERT_EQ(expected->initCheck(), OK);
+    ASSERT_EQ(actual->initCheck(), OK);
+
+    int32_t expectedFirst, expectedLast, actualFirst, actualLast;
+    expected->getSeqNumberRange(&expectedFirst, &expectedLast);
+    actual->getSeqNumberRange(&actualFirst, &actualLast);
+    EXPECT_EQ(expectedFirst, actualFirst);
+    EXPECT_EQ(expectedLast, actualLast);
+    EXPECT_EQ(expected->getDiscontinuitySeq(), actual->getDiscontinuitySeq());
+    EXPECT_EQ(expected->isComplete(), actual->isComplete());
+
+    ASSERT_EQ(expected->size(), actual->size());
+    for (size_t i = 0; i < expected->size(); ++i) {
+        SCOPED_TRACE(i);
+        AString expectedURI, actualURI;
+        sp<AMessage> expectedMeta, actualMeta;
+        ASSERT_TRUE(expected->itemAt(i, &expectedURI, &expectedMeta));
+        ASSERT_TRUE(actual->itemAt(i, &actualURI, &actualMeta));
+        EXPECT_STREQ(expectedURI.c_str(), actualURI.c_str());
+        ASSERT_NE(expectedMeta, nullptr);
+        ASSERT_NE(actualMeta, nullptr);
+        EXPECT_EQ(expectedMeta->debugString(), actualMeta->debugString());
+
+        int64_t expectedOffset = -1, expectedLength = -1, actualOffset = -1, actualLength = -1;
+        expectedMeta->findInt64("range-offset", &expectedOffset);
+        expectedMeta->findInt64("range-length", &expectedLength);
+        actualMeta->findInt64("range-offset", &actualOffset);
+        actualMeta->findInt64("range-length", &actualLength);
+        EXPECT_EQ(expectedOffset, actualOffset);
+        EXPECT_EQ(expectedLength, actualLength);
+    }
+}
+
+class M3UParserReloadTest : public ::testing::TestWithParam<std::tuple<bool, int32_t>> {
+protected:
+    PlaylistParams params(int32_t firstSeq, int32_t window, int32_t listed = 0) const {
+        PlaylistParams p = livePlaylist(firstSeq, window, listed);
+        p.byteRange = std::get<0>(GetParam());
+        p.discontinuityInterval = std::get<1>(GetParam());
+        return p;
+    }
+};
+
+TEST_P(M3UParserReloadTest, incrementalReloadsMatchFullParse) {
+    sp<M3UParser> incremental = parse(makePlaylist(params(1, 40)));
+    for (int32_t seq = 2; seq < 120; ++seq) {
+        SCOPED_TRACE(seq);
+        // the window grows and shrinks between reloads.
+        const std::string text = makePlaylist(params(seq, 40 + seq % 4));
+        incremental = parse(text, incremental);
+        expectSameItems(parse(text), incremental);
+    }
+}
+
+TEST_P(M3UParserReloadTest, reloadAfterGapMatchesFullParse) {
+    const sp<M3UParser> previous = parse(makePlaylist(params(1, 20)));
+    // none of the segments of |previous| are left.
+    const std::string text = makePlaylist(params(30, 20));
+    expectSameItems(parse(text), parse(text, previous));
+}
+
+TEST_P(M3UParserReloadTest, deltaUpdatesMatchFullParse) {
+    sp<M3UParser> delta = parse(makePlaylist(params(1, 40)));
+    EXPECT_EQ(delta->getSkipBoundaryUs(), kSkipBoundaryUs);
+    for (int32_t seq = 2; seq < 120; ++seq) {
+        SCOPED_TRACE(seq);
+        const int32_t window = 40 + seq % 4;
+        delta = parse(makePlaylist(params(seq, window, 6 /* listed */)), delta);
+        expectSameItems(parse(makePlaylist(params(seq, window))), delta);
+    }
+}
+
+TEST_P(M3UParserReloadTest, misalignedDeltaUpdateFallsBackToFullReload) {
+    const sp<M3UParser> previous = parse(makePlaylist(params(1, 20)));
+    ASSERT_EQ(previous->initCheck(), OK);
+
+    // the delta skips segments |previous| does not have, as PlaylistFetcher
+    // would find after falling behind the live edge.
+    const sp<M3UParser> delta = parse(makePlaylist(params(100, 20, 6 /* listed */)), previous);
+    EXPECT_NE(delta->initCheck(), OK);
+    // SKIPPED-SEGMENTS reaches past the last segment of |previous|.
+    EXPECT_NE(parse(makePlaylist(params(10, 30, 6 /* listed */)), previous)->initCheck(), OK);
+
+    // it then reloads the whole playlist, still against |previous|.
+    const std::string text = makePlaylist(params(100, 20));
+    expectSameItems(parse(text), parse(text, previous));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        M3UParser, M3UParserReloadTest,
+        ::testing::Combine(
+                ::testing::Bool() /* byteRange */,
+                ::testing::Values(3, 50) /* discontinuityInterval */));
+
+TEST(M3UParserTest, deltaUpdateStartingBeforePreviousIsRejected) {
+    const sp<M3UParser> previous = parse(makePlaylist(livePlaylist(10, 20)));
+    const sp<M3UParser> delta = parse(makePlaylist(livePlaylist(5, 20, 6 /* listed */)),
+            previous);
+    EXPECT_NE(delta->initCheck(), OK);
+}
+
+TEST(M3UParserTest, deltaUpdateWithoutPreviousIsRejected) {
+    const sp<M3UParser> delta = parse(makePlaylist(livePlaylist(1, 20, 6 /* listed */)));
+    EXPECT_NE(delta->initCheck(), OK);
+}
+
+TEST(M3UParserTest, editedSegmentIsParsedAgain) {
+    const sp<M3UParser> previous = parse(makePlaylist(livePlaylist(1, 20)));
+    std::string text = makePlaylist(livePlaylist(2, 20));
+    const size_t pos = text.find("segment10.ts");
+    ASSERT_NE(pos, std::string::npos);
+    text.replace(pos, strlen("segment10.ts"), "segment10-edited.ts");
+    expectSameItems(parse(text), parse(text, previous));
+}
+
+TEST(M3UParserTest, lastSegmentWithoutNewlineIsParsedAgain) {
+    std::string previousText = makePlaylist(livePlaylist(1, 20));
+    previousText.pop_back();
+    const sp<M3UParser> previous = parse(previousText);
+
+    // the URI of the last segment continues in the reload.
+    std::string text = makePlaylist(livePlaylist(1, 20));
+    text.insert(text.size() - 1, "b");
+    expectSameItems(parse(text), parse(text, previous));
+}
+
+TEST(M3UParserTest, endListReloadMatchesFullParse) {
+    const sp<M3UParser> previous = parse(makePlaylist(livePlaylist(1, 20)));
+    PlaylistParams params = livePlaylist(2, 20);
+    params.endList = true;
+    const std::string text = makePlaylist(params);
+    const sp<M3UParser> reload = parse(text, previous);
+    expectSameItems(parse(text), reload);
+    EXPECT_TRUE(reload->isComplete());
+}
+
+}  // namespace android
@@ -23,6 +23,7 @@
 #include <media/stagefright/foundation/AString.h>
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/Mutexed.h>
+#include <media/stagefright/foundation/WorkerPool.h>
 #include <media/stagefright/MediaSource.h>
 #include <media/openmax/OMX_Video.h>
 #include <ui/GraphicTypes.h>
@@ -31,6 +32,7 @@
 namespace android {
 
 struct AMessage;
+struct ColorConverter;
 struct MediaCodec;
 class IMediaSource;
 class MediaCodecBuffer;
@@ -191,6 +193,14 @@ protected:
     virtual status_t extractInternal() override;
 
 private:
+    // The conversion of a decoded tile into mFrame.
+    struct Tile {
+        std::unique_ptr<ColorConverter> converter;
+        int32_t width, height, stride;
+        int32_t cropLeft, cropTop, cropRight, cropBottom;
+        int32_t dstLeft, dstTop, dstRight, dstBottom;
+    };
+
     VideoFrame *mFrame;
     int32_t mWidth;
     int32_t mHeight;
@@ -228,7 +238,26 @@ private:
     };
     Mutexed<OutputInfo> mOutInfo;
 
+    // The tile conversions of grid images on the WorkerPool, if it has workers.
+    std::unique_ptr<WorkerPool::Group> mTileWorkers;
+
     bool outputLoop();
+
+    // Sets up the conversion of the next tile, from |videoFrameBuffer| into mFrame.
+    status_t setUpTile(
+            const sp<AMessage> &outputFormat,
+            const sp<MediaCodecBuffer> &videoFrameBuffer,
+            Tile *tile,
+            bool *done);
+    void convertTile(const sp<MediaCodecBuffer> &videoFrameBuffer, const Tile &tile);
+
+    // Queues the conversion of the output buffer |index| to mTileWorkers, which release
+    // the buffer once converted.
+    status_t onTileReceived(
+            const sp<MediaCodecBuffer> &videoFrameBuffer,
+            size_t index,
+            const sp<AMessage> &outputFormat,
+            bool *done);
 };
 
 }  // namespace android
@@ -39,6 +39,7 @@ class C2Buffer;
 namespace android {
 class BufferChannelBase;
 struct BufferProducerWrapper;
+class FrameLatencyTracer;
 class MediaCodecBuffer;
 struct PersistentSurface;
 class RenderedFrameInfo;
@@ -365,6 +366,13 @@ public:
     virtual void setCrypto(const sp<ICrypto> &) {}
     virtual void setDescrambler(const sp<IDescrambler> &) {}
 
+    /**
+     * Set the tracer of the frames of the codec, for the buffer channel to record the
+     * FrameLatencyTracer::COMPONENT_QUEUED and FrameLatencyTracer::WORK_DONE stages, or null
+     * if the frame latency is not traced. Called before the codec is configured.
+     */
+    virtual void setFrameLatencyTracer(const std::shared_ptr<FrameLatencyTracer> &) {}
+
     /**
      * Queue an input buffer into the buffer channel.
      *
@@ -42,6 +42,12 @@ struct ColorConverter {
 
     void setSrcColorSpace(uint32_t standard, uint32_t range, uint32_t transfer);
 
+    // Large frames are converted in horizontal bands on up to |maxThreads|
+    // threads, the calling thread and the workers of the process-wide
+    // WorkerPool. 1 (the default) converts on the calling thread only; 0 picks
+    // the count of WorkerPool::GetConcurrency().
+    void setMaxThreads(size_t maxThreads);
+
     status_t convert(
             const void *srcBits,
             size_t srcWidth, size_t srcHeight, size_t srcStride,
@@ -166,6 +172,7 @@ private:
     ColorSpace mSrcColorSpace;
     uint8_t *mClip;
     uint16_t *mClip10Bit;
+    size_t mMaxThreads;
 
     uint8_t *initClip();
     uint16_t *initClip10Bit();
@@ -183,6 +190,12 @@ private:
             size_t *u_stride,
             size_t *v_stride) const;
 
+    // number of horizontal bands to split a conversion of |src| into
+    size_t getNumBands(const BitmapParams &src) const;
+
+    // converts the crop rect of |src|, which may be a single band of the frame
+    status_t convertBand(const BitmapParams &src, const BitmapParams &dst);
+
     status_t convertYUVMediaImage(
         const BitmapParams &src, const BitmapParams &dst);
 
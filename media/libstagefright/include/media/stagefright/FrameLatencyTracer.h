@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAME_LATENCY_TRACER_H_
+
+#define FRAME_LATENCY_TRACER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <utils/Timers.h>
+
+namespace android {
+
+// Records when each frame passes the stages of a codec, from the input buffer queued by the
+// client to the output buffer rendered on the display, to tell where frames spend their time.
+//
+// The frames are identified by their presentation timestamp, which the codec keeps from the
+// input to the output, and kept in a fixed size ring: queueing a frame overwrites the oldest
+// frame. Recording does not lock nor allocate, so that the stages can be recorded from the
+// threads of MediaCodec and of the buffer channel without slowing them down, and looks for the
+// frame among the latest kMaxLookBack frames queued only. Reading the frames while they are
+// recorded returns a consistent copy of each frame, except when the ring wraps around during
+// the read.
+//
+// While atrace is enabled, each frame is also traced as it is recorded: every stage from QUEUED
+// to OUTPUT_AVAILABLE opens an async slice of the frame, which the next stage that the frame
+// reaches closes, so that Perfetto shows the stages of the frames next to the codec threads.
+class FrameLatencyTracer {
+public:
+    enum Stage : uint32_t {
+        // the client queued the input buffer to MediaCodec
+        QUEUED,
+        // the buffer channel queued the input to the component
+        COMPONENT_QUEUED,
+        // the buffer channel got the output of the component
+        WORK_DONE,
+        // MediaCodec made the output buffer available to the client
+        OUTPUT_AVAILABLE,
+        // the client released the output buffer, rendering it or not
+        RELEASED,
+        // the output buffer was rendered on the display
+        RENDERED,
+        STAGE_COUNT,
+    };
+
+    static const char *asString(Stage stage);
+
+    // The stages of a frame, 0 for the stages that the frame did not reach.
+    struct Frame {
+        int64_t mediaTimeUs;
+        nsecs_t stageNs[STAGE_COUNT];
+    };
+
+    // The distribution of the time between two stages, over the frames that reached both.
+    struct Percentiles {
+        size_t count;
+        int64_t p50Us;
+        int64_t p90Us;
+        int64_t p99Us;
+        int64_t maxUs;
+    };
+
+    static constexpr size_t kDefaultCapacity = 256;
+    // the number of latest frames in which the stages other than QUEUED look for their frame.
+    static constexpr size_t kMaxLookBack = 64;
+
+    // |capacity| is rounded up to a power of 2.
+    explicit FrameLatencyTracer(size_t capacity = kDefaultCapacity);
+
+    // Records that the frame with |mediaTimeUs| reached |stage| at |timeNs|. QUEUED starts a new
+    // frame, the other stages are recorded for the latest frame with |mediaTimeUs| that did not
+    // reach them yet, and are ignored if there is no such frame among the latest kMaxLookBack
+    // frames.
+    void record(Stage stage, int64_t mediaTimeUs,
+                nsecs_t timeNs = systemTime(SYSTEM_TIME_MONOTONIC));
+
+    // Forgets all the frames.
+    void clear();
+
+    size_t capacity() const { return mSlots.size(); }
+
+    // The frames in the ring, from the oldest to the latest queued.
+    std::vector<Frame> getFrames() const;
+
+    Percentiles getPercentiles(Stage from, Stage to) const;
+
+    // A readable summary of the percentiles between the stages, and the latest frames.
+    std::string dump(size_t maxFrames = 16) const;
+
+private:
+    struct Slot {
+        // 0 while the slot is empty or written, otherwise the sequence of the frame plus one.
+        std::atomic<uint64_t> sequence;
+        std::atomic<int64_t> mediaTimeUs;
+        std::atomic<int64_t> stageNs[STAGE_COUNT];
+    };
+
+    bool readSlot(const Slot &slot, uint64_t *sequence, Frame *frame) const;
+    // Closes the trace slice of the frame in |slot| that a stage before |before| opened.
+    void endTraceSlice(const Slot &slot, uint32_t before) const;
+
+    std::vector<Slot> mSlots;
+    const uint64_t mMask;
+    std::atomic<uint64_t> mNext;
+    // the names of the trace slices that the stages open, unique to the tracer.
+    std::string mTraceNames[STAGE_COUNT];
+
+    FrameLatencyTracer(const FrameLatencyTracer &) = delete;
+    FrameLatencyTracer &operator=(const FrameLatencyTracer &) = delete;
+};
+
+}  // namespace android
+
+#endif  // FRAME_LATENCY_TRACER_H_
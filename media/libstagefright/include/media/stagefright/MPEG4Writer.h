@@ -24,6 +24,7 @@
 #include <utils/List.h>
 #include <utils/threads.h>
 #include <map>
+#include <memory>
 #include <media/stagefright/foundation/AHandlerReflector.h>
 #include <media/stagefright/foundation/ALooper.h>
 #include <mutex>
@@ -61,9 +62,11 @@ public:
     void writeFourcc(const char *fourcc);
     void write(const void *data, size_t size);
     inline size_t write(const void *ptr, size_t size, size_t nmemb);
-    // Write to file system by calling ::write() or post error message to looper on failure.
+    // Write to file system through the write-behind batches, or by calling ::write() if there
+    // are none, or post error message to looper on failure.
     void writeOrPostError(int fd, const void *buf, size_t count);
-    // Seek in the file by calling ::lseek64() or post error message to looper on failure.
+    // Move the write position, or seek in the file by calling ::lseek64() if there are no
+    // write-behind batches, or post error message to looper on failure.
     void seekOrPostError(int fd, off64_t offset, int whence);
     void endBox();
     uint32_t interleaveDuration() const { return mInterleaveDurationUs; }
@@ -83,6 +86,7 @@ protected:
 
 private:
     class Track;
+    class AsyncFileWriter;
     friend struct AHandlerReflector<MPEG4Writer>;
 
     enum {
@@ -94,6 +98,8 @@ private:
 
     int  mFd;
     int mNextFd;
+    // Write-behind for mFd, valid while mFd is open.
+    std::unique_ptr<AsyncFileWriter> mAsyncWriter;
     sp<MetaData> mStartMeta;
     status_t mInitCheck;
     bool mIsRealTimeRecording;
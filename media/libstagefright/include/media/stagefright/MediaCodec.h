@@ -30,6 +30,7 @@
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/CodecErrorLog.h>
+#include <media/stagefright/FrameLatencyTracer.h>
 #include <media/stagefright/FrameRenderTracker.h>
 #include <media/stagefright/MediaHistogram.h>
 #include <media/stagefright/PlaybackDurationAccumulator.h>
@@ -292,6 +293,11 @@ struct MediaCodec : public AHandler {
 
     status_t getMetrics(mediametrics_handle_t &reply);
 
+    // The stages that the latest frames went through, from the input queued to the output
+    // rendered, or null if the frame latency is not traced. The tracer can be read from any
+    // thread.
+    std::shared_ptr<const FrameLatencyTracer> getFrameLatencyTracer() const;
+
     status_t setParameters(const sp<AMessage> &params);
 
     status_t querySupportedVendorParameters(std::vector<std::string> *names);
@@ -763,6 +769,10 @@ private:
 
     MediaHistogram<int64_t> mLatencyHist;
 
+    // per frame timestamps of the stages between the client and the component, null if
+    // the debug.stagefright.frame-latency property is set to false
+    const std::shared_ptr<FrameLatencyTracer> mFrameLatencyTracer;
+
     // An unique ID for the codec - Used by the metrics.
     uint64_t mCodecId = 0;
     bool     mIsHardware = false;
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Decodes synthetic HEIF style grid images, made of 512x512 HEVC tiles, with
+// MediaImageDecoder and the software HEVC decoder, as a whole image and one row
+// of tiles at a time, the way HeifDecoderImpl asks for them.
+//
+// The tiles are encoded once with the software HEVC encoder. As they are all intra
+// coded, a few distinct tiles are repeated over the grid.
+//
+// $ atest FrameDecoderBenchmark
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "FrameDecoderBenchmark"
+#include <utils/Log.h>
+
+#include <vector>
+
+#include <FrameDecoder.h>
+#include <HevcUtils.h>
+#include <benchmark/benchmark.h>
+#include <media/IMediaSource.h>
+#include <media/MediaCodecBuffer.h>
+#include <media/hardware/VideoAPI.h>
+#include <media/stagefright/MediaBuffer.h>
+#include <media/stagefright/MediaCodec.h>
+#include <media/stagefright/MediaCodecConstants.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+#include <media/stagefright/foundation/avc_utils.h>
+#include <system/graphics.h>
+
+using namespace android;
+
+namespace {
+
+constexpr int32_t kTileSize = 512;
+constexpr size_t kDistinctTiles = 4;
+constexpr size_t kMaxOutputRetries = 500;  // of 10 ms each
+
+struct EncodedTiles {
+    std::vector<uint8_t> hvcc;
+    std::vector<std::vector<uint8_t>> accessUnits;
+};
+
+// Fills |buffer| with a YUV 4:2:0 8-bit picture: gradients and a pattern that changes
+// with |seed|, so the tiles are neither flat nor identical.
+void fillPicture(const sp<MediaCodecBuffer>& buffer, int seed) {
+    MediaImage2 image = {};
+    sp<ABuffer> imageData;
+    if (buffer->meta()->findBuffer("image-data", &imageData)
+            && imageData->size() >= sizeof(MediaImage2)) {
+        image = *reinterpret_cast<const MediaImage2*>(imageData->data());
+    } else {
+        // planar, no padding
+        image.mPlane[MediaImage2::Y] = {0, 1, kTileSize, 1, 1};
+        image.mPlane[MediaImage2::U] = {kTileSize * kTileSize, 1, kTileSize / 2, 2, 2};
+        image.mPlane[MediaImage2::V] = {kTileSize * kTileSize * 5 / 4, 1, kTileSize / 2, 2, 2};
+    }
+    buffer->setRange(0, buffer->capacity());
+    uint8_t* base = buffer->data();
+    for (int32_t y = 0; y < kTileSize; ++y) {
+        for (int32_t x = 0; x < kTileSize; ++x) {
+            const auto& plane = image.mPlane[MediaImage2::Y];
+            base[plane.mOffset + y * plane.mRowInc + x * plane.mColInc] =
+                    (x + y + seed * 37 + ((x ^ y) & 0x1f)) & 0xff;
+        }
+    }
+    for (int32_t y = 0; y < kTileSize / 2; ++y) {
+        for (int32_t x = 0; x < kTileSize / 2; ++x) {
+            const auto& u = image.mPlane[MediaImage2::U];
+            const auto& v = image.mPlane[MediaImage2::V];
+            base[u.mOffset + y * u.mRowInc + x * u.mColInc] = (x * 2 + seed * 50) & 0xff;
+            base[v.mOffset + y * v.mRowInc + x * v.mColInc] = (y * 2 + seed * 90) & 0xff;
+        }
+    }
+}
+
+bool encodeTiles(EncodedTiles* tiles) {
+    sp<ALooper> looper = new ALooper;
+    looper->setName("FrameDecoderBenchmark");
+    looper->start();
+    sp<MediaCodec> encoder = MediaCodec::CreateByComponentName(
+            looper, "c2.android.hevc.encoder");
+    if (encoder == nullptr) {
+        return false;
+    }
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", MEDIA_MIMETYPE_VIDEO_HEVC);
+    format->setInt32("width", kTileSize);
+    format->setInt32("height", kTileSize);
+    format->setInt32("color-format", COLOR_FormatYUV420Flexible);
+    format->setInt32("bitrate", 8000000);
+    format->setInt32("frame-rate", 30);
+    format->setInt32("i-frame-interval", 0);
+    if (encoder->configure(format, nullptr /* nativeWindow */, nullptr /* crypto */,
+                MediaCodec::CONFIGURE_FLAG_ENCODE) != OK
+            || encoder->start() != OK) {
+        encoder->release();
+        return false;
+    }
+
+    HevcParameterSets paramSets;
+    size_t queued = 0;
+    size_t retries = 0;
+    bool eos = false;
+    while (!eos && retries < kMaxOutputRetries) {
+        size_t index;
+        if (queued <= kDistinctTiles && encoder->dequeueInputBuffer(&index, 0) == OK) {
+            sp<MediaCodecBuffer> buffer;
+            encoder->getInputBuffer(index, &buffer);
+            if (queued < kDistinctTiles) {
+                fillPicture(buffer, queued);
+                encoder->queueInputBuffer(index, 0, buffer->size(), queued * 33333, 0);
+            } else {
+                encoder->queueInputBuffer(index, 0, 0, queued * 33333,
+                        MediaCodec::BUFFER_FLAG_EOS);
+            }
+            ++queued;
+        }
+        size_t offset, size;
+        int64_t timeUs;
+        uint32_t flags;
+        status_t err = encoder->dequeueOutputBuffer(
+                &index, &offset, &size, &timeUs, &flags, 10000 /* timeoutUs */);
+        if (err == -EAGAIN) {
+            ++retries;
+            continue;
+        } else if (err == INFO_FORMAT_CHANGED || err == INFO_OUTPUT_BUFFERS_CHANGED) {
+            continue;
+        } else if (err != OK) {
+            break;
+        }
+        sp<MediaCodecBuffer> buffer;
+        encoder->getOutputBuffer(index, &buffer);
+        const uint8_t* data = buffer->data();
+        if (flags & MediaCodec::BUFFER_FLAG_CODECCONFIG) {
+            const uint8_t* nal;
+            size_t nalSize;
+            while (getNextNALUnit(&data, &size, &nal, &nalSize, true /* startCodeFollows */)
+                    == OK) {
+                paramSets.addNalUnit(nal, nalSize);
+            }
+        } else if (size > 0) {
+            tiles->accessUnits.emplace_back(data, data + size);
+        }
+        eos = flags & MediaCodec::BUFFER_FLAG_EOS;
+        encoder->releaseOutputBuffer(index);
+    }
+    encoder->stop();
+    encoder->release();
+    looper->stop();
+
+    tiles->hvcc.resize(1024);
+    size_t hvccSize = tiles->hvcc.size();
+    if (tiles->accessUnits.size() != kDistinctTiles
+            || paramSets.makeHvcc(tiles->hvcc.data(), &hvccSize, 4 /* nalSizeLength */) != OK) {
+        return false;
+    }
+    tiles->hvcc.resize(hvccSize);
+    return true;
+}
+
+const EncodedTiles* getTiles() {
+    static EncodedTiles tiles;
+    static const bool ok = encodeTiles(&tiles);
+    return ok ? &tiles : nullptr;
+}
+
+// Serves the tiles of a grid image, in raster order.
+class TileSource : public IMediaSource {
+public:
+    TileSource(const EncodedTiles* tiles, size_t tileCount)
+        : mTiles(tiles), mTileCount(tileCount) {}
+
+    status_t start(MetaData*) override { return OK; }
+    status_t stop() override { return OK; }
+    sp<MetaData> getFormat() override { return nullptr; }
+    status_t read(MediaBufferBase** buffer, const MediaSource::ReadOptions*) override {
+        *buffer = nullptr;
+        if (mNextTile >= mTileCount) {
+            return ERROR_END_OF_STREAM;
+        }
+        const std::vector<uint8_t>& au =
+                mTiles->accessUnits[mNextTile % mTiles->accessUnits.size()];
+        MediaBuffer* mediaBuffer = new MediaBuffer(au.size());
+        memcpy(mediaBuffer->data(), au.data(), au.size());
+        mediaBuffer->meta_data().setInt64(kKeyTime, mNextTile);
+        mediaBuffer->meta_data().setInt32(kKeyIsSyncFrame, 1);
+        ++mNextTile;
+        *buffer = mediaBuffer;
+        return OK;
+    }
+    status_t readMultiple(Vector<MediaBufferBase*>*, uint32_t,
+            const MediaSource::ReadOptions*) override {
+        return ERROR_UNSUPPORTED;
+    }
+    bool supportReadMultiple() override { return false; }
+    bool supportNonblockingRead() override { return false; }
+    status_t pause() override { return ERROR_UNSUPPORTED; }
+
+protected:
+    IBinder* onAsBinder() override { return nullptr; }
+
+private:
+    const EncodedTiles* mTiles;
+    const size_t mTileCount;
+    size_t mNextTile = 0;
+};
+
+sp<MetaData> makeGridMeta(const EncodedTiles* tiles, int32_t cols, int32_t rows) {
+    sp<MetaData> meta = new MetaData;
+    meta->setCString(kKeyMIMEType, MEDIA_MIMETYPE_IMAGE_ANDROID_HEIC);
+    meta->setInt32(kKeyWidth, cols * kTileSize);
+    meta->setInt32(kKeyHeight, rows * kTileSize);
+    meta->setInt32(kKeyTileWidth, kTileSize);
+    meta->setInt32(kKeyTileHeight, kTileSize);
+    meta->setInt32(kKeyGridCols, cols);
+    meta->setInt32(kKeyGridRows, rows);
+    meta->setData(kKeyHVCC, kTypeHVCC, tiles->hvcc.data(), tiles->hvcc.size());
+    return meta;
+}
+
+// Arguments: grid columns, grid rows, whether to decode one row of tiles at a time.
+void BM_DecodeGrid(benchmark::State& state) {
+    const int32_t cols = state.range(0);
+    const int32_t rows = state.range(1);
+    const bool byRow = state.range(2);
+    const EncodedTiles* tiles = getTiles();
+    if (tiles == nullptr) {
+        state.SkipWithError("failed to encode the tiles");
+        return;
+    }
+    sp<MetaData> meta = makeGridMeta(tiles, cols, rows);
+
+    for (auto _ : state) {
+        sp<FrameDecoder> decoder = new MediaImageDecoder(
+                AString("c2.android.hevc.decoder"), meta, new TileSource(tiles, cols * rows));
+        if (decoder->init(0 /* frameTimeUs */, MediaSource::ReadOptions::SEEK_PREVIOUS_SYNC,
+                    HAL_PIXEL_FORMAT_RGBA_8888) != OK) {
+            state.SkipWithError("failed to start the decoder");
+            return;
+        }
+        if (byRow) {
+            for (int32_t row = 0; row < rows; ++row) {
+                FrameRect rect = {0, row * kTileSize, cols * kTileSize, (row + 1) * kTileSize};
+                if (decoder->extractFrame(&rect) == nullptr) {
+                    state.SkipWithError("failed to decode a row");
+                    return;
+                }
+            }
+        } else if (decoder->extractFrame() == nullptr) {
+            state.SkipWithError("failed to decode the image");
+            return;
+        }
+    }
+    state.counters["MP/s"] = benchmark::Counter(
+            state.iterations() * cols * rows * kTileSize * kTileSize / 1e6,
+            benchmark::Counter::kIsRate);
+}
+
+// 2 MP, 12 MP and 50 MP images.
+BENCHMARK(BM_DecodeGrid)
+        ->ArgNames({"cols", "rows", "byRow"})
+        ->Args({4, 2, 0})->Args({4, 2, 1})
+        ->Args({8, 6, 0})->Args({8, 6, 1})
+        ->Args({16, 12, 0})->Args({16, 12, 1})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "FrameLatencyTracer_test"
+#include <utils/Log.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/FrameLatencyTracer.h>
+
+namespace android {
+
+using Frame = FrameLatencyTracer::Frame;
+using Stage = FrameLatencyTracer::Stage;
+
+static constexpr nsecs_t kMs = 1000000;
+
+TEST(FrameLatencyTracerTest, recordsTheStagesOfEachFrame) {
+    FrameLatencyTracer tracer;
+    for (int64_t i = 0; i < 3; ++i) {
+        tracer.record(FrameLatencyTracer::QUEUED, i * 33333, (i * 10 + 1) * kMs);
+    }
+    for (int64_t i = 0; i < 3; ++i) {
+        for (uint32_t stage = FrameLatencyTracer::COMPONENT_QUEUED;
+                stage < FrameLatencyTracer::STAGE_COUNT; ++stage) {
+            tracer.record(Stage(stage), i * 33333, (i * 10 + stage + 1) * kMs);
+        }
+    }
+
+    std::vector<Frame> frames = tracer.getFrames();
+    ASSERT_EQ(frames.size(), 3u);
+    for (int64_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(frames[i].mediaTimeUs, i * 33333);
+        for (uint32_t stage = 0; stage < FrameLatencyTracer::STAGE_COUNT; ++stage) {
+            EXPECT_EQ(frames[i].stageNs[stage], (i * 10 + stage + 1) * kMs);
+        }
+    }
+}
+
+TEST(FrameLatencyTracerTest, matchesReorderedOutputsByTimestamp) {
+    FrameLatencyTracer tracer;
+    // I P B B, decoded out of presentation order.
+    for (int64_t timeUs : { 0, 99999, 33333, 66666 }) {
+        tracer.record(FrameLatencyTracer::QUEUED, timeUs, 1 * kMs);
+    }
+    for (int64_t timeUs : { 0, 33333, 66666, 99999 }) {
+        tracer.record(FrameLatencyTracer::OUTPUT_AVAILABLE, timeUs, (2 + timeUs / 33333) * kMs);
+    }
+
+    std::vector<Frame> frames = tracer.getFrames();
+    ASSERT_EQ(frames.size(), 4u);
+    EXPECT_EQ(frames[0].stageNs[FrameLatencyTracer::OUTPUT_AVAILABLE], 2 * kMs);
+    EXPECT_EQ(frames[1].stageNs[FrameLatencyTracer::OUTPUT_AVAILABLE], 5 * kMs);
+    EXPECT_EQ(frames[2].stageNs[FrameLatencyTracer::OUTPUT_AVAILABLE], 3 * kMs);
+    EXPECT_EQ(frames[3].stageNs[FrameLatencyTracer::OUTPUT_AVAILABLE], 4 * kMs);
+}
+
+TEST(FrameLatencyTracerTest, recordsEachStageOncePerFrame) {
+    FrameLatencyTracer tracer;
+    // codec config and the first frame often share the timestamp.
+    tracer.record(FrameLatencyTracer::QUEUED, 0, 1 * kMs);
+    tracer.record(FrameLatencyTracer::QUEUED, 0, 2 * kMs);
+    tracer.record(FrameLatencyTracer::WORK_DONE, 0, 3 * kMs);
+    tracer.record(FrameLatencyTracer::WORK_DONE, 0, 4 * kMs);
+    tracer.record(FrameLatencyTracer::WORK_DONE, 0, 5 * kMs);
+    tracer.record(FrameLatencyTracer::WORK_DONE, 12345, 6 * kMs);
+
+    std::vector<Frame> frames = tracer.getFrames();
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[1].stageNs[FrameLatencyTracer::WORK_DONE], 3 * kMs);
+    EXPECT_EQ(frames[0].stageNs[FrameLatencyTracer::WORK_DONE], 4 * kMs);
+}
+
+TEST(FrameLatencyTracerTest, keepsTheLatestFrames) {
+    FrameLatencyTracer tracer(3);
+    ASSERT_EQ(tracer.capacity(), 4u);
+    for (int64_t i = 0; i < 10; ++i) {
+        tracer.record(FrameLatencyTracer::QUEUED, i, (i + 1) * kMs);
+    }
+    // the overwritten frames are not found anymore.
+    tracer.record(FrameLatencyTracer::RELEASED, 2, 20 * kMs);
+    tracer.record(FrameLatencyTracer::RELEASED, 8, 21 * kMs);
+
+    std::vector<Frame> frames = tracer.getFrames();
+    ASSERT_EQ(frames.size(), 4u);
+    for (int64_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(frames[i].mediaTimeUs, 6 + i);
+        EXPECT_EQ(frames[i].stageNs[FrameLatencyTracer::RELEASED], i == 2 ? 21 * kMs : 0);
+    }
+
+    tracer.clear();
+    EXPECT_TRUE(tracer.getFrames().empty());
+}
+
+TEST(FrameLatencyTracerTest, looksForFramesAmongTheLatestOnly) {
+    FrameLatencyTracer tracer;
+    const int64_t count = FrameLatencyTracer::kMaxLookBack + 10;
+    for (int64_t i = 0; i < count; ++i) {
+        tracer.record(FrameLatencyTracer::QUEUED, i, (i + 1) * kMs);
+    }
+    tracer.record(FrameLatencyTracer::WORK_DONE, 9, 200 * kMs);
+    tracer.record(FrameLatencyTracer::WORK_DONE, 10, 201 * kMs);
+
+    std::vector<Frame> frames = tracer.getFrames();
+    ASSERT_EQ(frames.size(), (size_t)count);
+    EXPECT_EQ(frames[9].stageNs[FrameLatencyTracer::WORK_DONE], 0);
+    EXPECT_EQ(frames[10].stageNs[FrameLatencyTracer::WORK_DONE], 201 * kMs);
+}
+
+TEST(FrameLatencyTracerTest, computesPercentiles) {
+    FrameLatencyTracer tracer;
+    // frame i takes i + 1 ms to reach the component, in shuffled order.
+    for (int64_t i = 0; i < 100; ++i) {
+        int64_t latencyMs = (i * 37) % 100 + 1;
+        tracer.record(FrameLatencyTracer::QUEUED, i, (i + 1) * kMs);
+        tracer.record(FrameLatencyTracer::COMPONENT_QUEUED, i, (i + 1 + latencyMs) * kMs);
+    }
+
+    FrameLatencyTracer::Percentiles p = tracer.getPercentiles(
+            FrameLatencyTracer::QUEUED, FrameLatencyTracer::COMPONENT_QUEUED);
+    EXPECT_EQ(p.count, 100u);
+    EXPECT_EQ(p.p50Us, 50000);
+    EXPECT_EQ(p.p90Us, 90000);
+    EXPECT_EQ(p.p99Us, 99000);
+    EXPECT_EQ(p.maxUs, 100000);
+
+    // no frame reached the other stages.
+    p = tracer.getPercentiles(FrameLatencyTracer::WORK_DONE, FrameLatencyTracer::RENDERED);
+    EXPECT_EQ(p.count, 0u);
+
+    std::string dump = tracer.dump();
+    EXPECT_NE(dump.find("queued -> component-queued: n=100 p50=50000 p90=90000 p99=99000"
+                        " max=100000"), std::string::npos) << dump;
+}
+
+TEST(FrameLatencyTracerTest, readsConsistentFramesWhileRecording) {
+    FrameLatencyTracer tracer(16);
+    std::atomic_bool done(false);
+    std::thread queuer([&tracer, &done] {
+        for (int64_t i = 1; i <= 100000; ++i) {
+            tracer.record(FrameLatencyTracer::QUEUED, i, i * 10);
+            tracer.record(FrameLatencyTracer::WORK_DONE, i - 1, (i - 1) * 10 + 5);
+        }
+        done = true;
+    });
+    size_t reads = 0;
+    size_t inconsistentFrames = 0;
+    while (!done || reads == 0) {
+        for (const Frame &frame : tracer.getFrames()) {
+            nsecs_t workDoneNs = frame.stageNs[FrameLatencyTracer::WORK_DONE];
+            if (frame.stageNs[FrameLatencyTracer::QUEUED] != frame.mediaTimeUs * 10
+                    || (workDoneNs != 0 && workDoneNs != frame.mediaTimeUs * 10 + 5)) {
+                ++inconsistentFrames;
+            }
+        }
+        ++reads;
+    }
+    queuer.join();
+    EXPECT_EQ(inconsistentFrames, 0u);
+}
+
+} // namespace android
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Records synthetic H.264 and AAC streams through MPEG4Writer into a memfd
+// (tmpfs) file, so the numbers reflect the writer rather than the storage.
+// Reports the overall throughput and how long stop() takes.
+//
+// $ atest MPEG4WriterBenchmark
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/stagefright/MPEG4Writer.h>
+#include <media/stagefright/MediaAdapter.h>
+#include <media/stagefright/MediaDefs.h>
+#include <media/stagefright/MetaData.h>
+#include <media/stagefright/Utils.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace android {
+namespace {
+
+constexpr int64_t kDurationUs = 10000000ll;
+constexpr int32_t kAudioSampleRate = 48000;
+constexpr int64_t kAudioFrameDurationUs = 1024ll * 1000000 / kAudioSampleRate;
+constexpr size_t kAudioFrameSize = 768;
+
+// Baseline profile. The writer does not check the SPS against the track
+// dimensions, and the sample sizes follow the requested bitrate.
+const uint8_t kSPS[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe4};
+const uint8_t kPPS[] = {0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80};
+const uint8_t kAudioSpecificConfig[] = {0x11, 0x90};  // AAC LC, 48kHz, stereo
+
+sp<MediaAdapter> makeVideoTrack(int32_t width, int32_t height) {
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", MEDIA_MIMETYPE_VIDEO_AVC);
+    format->setInt32("width", width);
+    format->setInt32("height", height);
+    format->setBuffer("csd-0", ABuffer::CreateAsCopy(kSPS, sizeof(kSPS)));
+    format->setBuffer("csd-1", ABuffer::CreateAsCopy(kPPS, sizeof(kPPS)));
+    sp<MetaData> meta = new MetaData;
+    convertMessageToMetaData(format, meta);
+    return new MediaAdapter(meta);
+}
+
+sp<MediaAdapter> makeAudioTrack() {
+    sp<AMessage> format = new AMessage;
+    format->setString("mime", MEDIA_MIMETYPE_AUDIO_AAC);
+    format->setInt32("sample-rate", kAudioSampleRate);
+    format->setInt32("channel-count", 2);
+    format->setBuffer("csd-0",
+            ABuffer::CreateAsCopy(kAudioSpecificConfig, sizeof(kAudioSpecificConfig)));
+    sp<MetaData> meta = new MetaData;
+    convertMessageToMetaData(format, meta);
+    return new MediaAdapter(meta);
+}
+
+// Pushes the first frameSize (syncSize for sync samples) bytes of sample
+// until kDurationUs, then signals EOS. A syncInterval of 0 makes every sample
+// a sync sample. pushBuffer() blocks until the writer has consumed the sample.
+void feedTrack(const sp<MediaAdapter> &track, const std::vector<uint8_t> &sample,
+        size_t frameSize, size_t syncSize, int64_t frameDurationUs, int32_t syncInterval) {
+    int64_t frame = 0;
+    for (int64_t timeUs = 0; timeUs < kDurationUs; timeUs += frameDurationUs, ++frame) {
+        bool isSync = syncInterval == 0 || frame % syncInterval == 0;
+        MediaBuffer *buffer = new MediaBuffer(isSync ? syncSize : frameSize);
+        memcpy(buffer->data(), sample.data(), buffer->size());
+        if (isSync && syncInterval != 0) {
+            ((uint8_t *)buffer->data())[4] = 0x65;  // IDR slice
+        }
+        buffer->add_ref();  // Released in MediaAdapter::signalBufferReturned().
+        buffer->meta_data().setInt64(kKeyTime, timeUs);
+        buffer->meta_data().setInt64(kKeyDecodingTime, timeUs);
+        if (isSync) {
+            buffer->meta_data().setInt32(kKeyIsSyncFrame, true);
+        }
+        if (track->pushBuffer(buffer) != OK) {
+            break;
+        }
+    }
+    track->stop();
+}
+
+// Arguments: video width, height, frame rate, bitrate in Mbps.
+void BM_MPEG4WriterRecord(benchmark::State &state) {
+    const int32_t width = state.range(0);
+    const int32_t height = state.range(1);
+    const int32_t frameRate = state.range(2);
+    const int64_t bitrate = state.range(3) * 1000000;
+
+    // Slice data carries no zero bytes, so it never contains a start code.
+    // IDR frames, once per second, are four times the size of other frames.
+    const size_t frameSize = bitrate / 8 / frameRate;
+    const size_t syncFrameSize = frameSize * 4;
+    std::vector<uint8_t> videoFrame(syncFrameSize, 0xaa);
+    memcpy(videoFrame.data(), "\x00\x00\x00\x01\x41", 5);
+    std::vector<uint8_t> audioFrame(kAudioFrameSize, 0x5a);
+
+    int64_t bytes = 0;
+    double stopMs = 0;
+    for (auto _ : state) {
+        int fd = memfd_create("MPEG4WriterBenchmark", 0);
+        if (fd < 0) {
+            state.SkipWithError("memfd_create failed");
+            return;
+        }
+        sp<MPEG4Writer> writer = new MPEG4Writer(fd);  // Writes through a dup of fd.
+
+        sp<MediaAdapter> video = makeVideoTrack(width, height);
+        sp<MediaAdapter> audio = makeAudioTrack();
+        if (writer->addSource(video) != OK || writer->addSource(audio) != OK) {
+            state.SkipWithError("addSource failed");
+            close(fd);
+            return;
+        }
+        sp<MetaData> params = new MetaData;
+        params->setInt32(kKeyRealTimeRecording, false);
+        if (writer->start(params.get()) != OK) {
+            state.SkipWithError("start failed");
+            close(fd);
+            return;
+        }
+
+        std::thread videoThread(feedTrack, video, std::cref(videoFrame), frameSize,
+                syncFrameSize, 1000000ll / frameRate, frameRate /* syncInterval */);
+        std::thread audioThread(feedTrack, audio, std::cref(audioFrame), audioFrame.size(),
+                audioFrame.size(), kAudioFrameDurationUs, 0 /* syncInterval */);
+        videoThread.join();
+        audioThread.join();
+
+        auto stopStart = std::chrono::steady_clock::now();
+        if (writer->stop() != OK) {
+            state.SkipWithError("stop failed");
+            close(fd);
+            return;
+        }
+        stopMs += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - stopStart).count();
+        off64_t size = lseek64(fd, 0, SEEK_END);
+        close(fd);
+        bytes += size;
+    }
+    state.SetBytesProcessed(bytes);
+    state.counters["stop_ms"] = benchmark::Counter(stopMs, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_MPEG4WriterRecord)
+        ->ArgNames({"width", "height", "fps", "mbps"})
+        ->Args({1920, 1080, 30, 20})
+        ->Args({3840, 2160, 60, 100})
+        ->Args({7680, 4320, 30, 200})
+        ->Args({7680, 4320, 120, 400})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
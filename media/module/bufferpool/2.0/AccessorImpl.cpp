@@ -477,7 +477,7 @@ bool Accessor::Impl::BufferPool::handleReleaseBuffer(
                 iter->second->mTransactionCount == 0) {
             if (!iter->second->mInvalidated) {
                 mStats.onBufferUnused(iter->second->mAllocSize);
-                mFreeBuffers.insert(bufferId);
+                addFreeBuffer(bufferId, iter->second->mConfig);
             } else {
                 mStats.onBufferUnused(iter->second->mAllocSize);
                 mStats.onBufferEvicted(iter->second->mAllocSize);
@@ -566,7 +566,7 @@ bool Accessor::Impl::BufferPool::handleTransferResult(const BufferStatusMessage
                 && bufferIter->second->mTransactionCount == 0) {
                 if (!bufferIter->second->mInvalidated) {
                     mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                    mFreeBuffers.insert(message.bufferId);
+                    addFreeBuffer(message.bufferId, bufferIter->second->mConfig);
                 } else {
                     mStats.onBufferUnused(bufferIter->second->mAllocSize);
                     mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -586,7 +586,7 @@ bool Accessor::Impl::BufferPool::handleTransferResult(const BufferStatusMessage
 }
 
 void Accessor::Impl::BufferPool::processStatusMessages() {
-    std::vector<BufferStatusMessage> messages;
+    std::vector<BufferStatusMessage> &messages = mMessages;
     mObserver.getBufferStatusChanges(messages);
     mTimestampUs = getTimestampNow();
     for (BufferStatusMessage& message: messages) {
@@ -645,7 +645,7 @@ bool Accessor::Impl::BufferPool::handleClose(ConnectionId connectionId) {
                     // TODO: handle freebuffer insert fail
                     if (!bufferIter->second->mInvalidated) {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
+                        addFreeBuffer(bufferId, bufferIter->second->mConfig);
                     } else {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
                         mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -675,7 +675,7 @@ bool Accessor::Impl::BufferPool::handleClose(ConnectionId connectionId) {
                     // TODO: handle freebuffer insert fail
                     if (!bufferIter->second->mInvalidated) {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
-                        mFreeBuffers.insert(bufferId);
+                        addFreeBuffer(bufferId, bufferIter->second->mConfig);
                     } else {
                         mStats.onBufferUnused(bufferIter->second->mAllocSize);
                         mStats.onBufferEvicted(bufferIter->second->mAllocSize);
@@ -695,16 +695,23 @@ bool Accessor::Impl::BufferPool::getFreeBuffer(
         const std::shared_ptr<BufferPoolAllocator> &allocator,
         const std::vector<uint8_t> &params, BufferId *pId,
         const native_handle_t** handle) {
-    auto bufferIt = mFreeBuffers.begin();
-    for (;bufferIt != mFreeBuffers.end(); ++bufferIt) {
-        BufferId bufferId = *bufferIt;
-        if (allocator->compatible(params, mBuffers[bufferId]->mConfig)) {
-            break;
+    auto bufferIt = mFreeBuffers.end();
+    // Buffers allocated with the same parameters are checked first.
+    auto configIt = mFreeBuffersByConfig.find(params);
+    if (configIt != mFreeBuffersByConfig.end()
+            && allocator->compatible(params, configIt->first)) {
+        bufferIt = mFreeBuffers.find(*configIt->second.begin());
+    } else {
+        for (bufferIt = mFreeBuffers.begin(); bufferIt != mFreeBuffers.end(); ++bufferIt) {
+            BufferId bufferId = *bufferIt;
+            if (allocator->compatible(params, mBuffers[bufferId]->mConfig)) {
+                break;
+            }
         }
     }
     if (bufferIt != mFreeBuffers.end()) {
         BufferId id = *bufferIt;
-        mFreeBuffers.erase(bufferIt);
+        eraseFreeBuffer(bufferIt, mBuffers[id]->mConfig);
         mStats.onBufferRecycled(mBuffers[id]->mAllocSize);
         *handle = mBuffers[id]->handle();
         *pId = id;
@@ -766,8 +773,8 @@ void Accessor::Impl::BufferPool::cleanUp(bool clearCache) {
             if (it != mBuffers.end() &&
                     it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
                 mStats.onBufferEvicted(it->second->mAllocSize);
+                freeIt = eraseFreeBuffer(freeIt, it->second->mConfig);
                 mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
             } else {
                 ++freeIt;
                 ALOGW("bufferpool2 inconsistent!");
@@ -776,6 +783,24 @@ void Accessor::Impl::BufferPool::cleanUp(bool clearCache) {
     }
 }
 
+void Accessor::Impl::BufferPool::addFreeBuffer(
+        BufferId bufferId, const std::vector<uint8_t> &config) {
+    mFreeBuffers.insert(bufferId);
+    mFreeBuffersByConfig[config].insert(bufferId);
+}
+
+std::set<BufferId>::iterator Accessor::Impl::BufferPool::eraseFreeBuffer(
+        std::set<BufferId>::iterator freeIt, const std::vector<uint8_t> &config) {
+    auto configIt = mFreeBuffersByConfig.find(config);
+    if (configIt != mFreeBuffersByConfig.end()) {
+        configIt->second.erase(*freeIt);
+        if (configIt->second.empty()) {
+            mFreeBuffersByConfig.erase(configIt);
+        }
+    }
+    return mFreeBuffers.erase(freeIt);
+}
+
 void Accessor::Impl::BufferPool::invalidate(
         bool needsAck, BufferId from, BufferId to,
         const std::shared_ptr<Accessor::Impl> &impl) {
@@ -785,8 +810,8 @@ void Accessor::Impl::BufferPool::invalidate(
             if (it != mBuffers.end() &&
                 it->second->mOwnerCount == 0 && it->second->mTransactionCount == 0) {
                 mStats.onBufferEvicted(it->second->mAllocSize);
+                freeIt = eraseFreeBuffer(freeIt, it->second->mConfig);
                 mBuffers.erase(it);
-                freeIt = mFreeBuffers.erase(freeIt);
                 continue;
             } else {
                 ALOGW("bufferpool2 inconsistent!");
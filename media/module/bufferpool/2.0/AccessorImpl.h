@@ -122,7 +122,12 @@ private:
 
         std::map<BufferId, std::unique_ptr<InternalBuffer>> mBuffers;
         std::set<BufferId> mFreeBuffers;
+        // Free buffers by their allocation parameters, in order to find a
+        // buffer to recycle without checking every free buffer.
+        std::map<std::vector<uint8_t>, std::set<BufferId>> mFreeBuffersByConfig;
         std::set<ConnectionId> mConnectionIds;
+        // Buffer status messages being processed, kept to reuse the storage.
+        std::vector<BufferStatusMessage> mMessages;
 
         struct Invalidation {
             static std::atomic<std::uint32_t> sInvSeqId;
@@ -256,6 +261,16 @@ private:
         void invalidate(bool needsAck, BufferId from, BufferId to,
                         const std::shared_ptr<Accessor::Impl> &impl);
 
+        /** Adds a buffer which is not used anymore to the free buffers. */
+        void addFreeBuffer(BufferId bufferId, const std::vector<uint8_t> &config);
+
+        /**
+         * Removes a buffer from the free buffers, and returns the iterator
+         * following it in mFreeBuffers.
+         */
+        std::set<BufferId>::iterator eraseFreeBuffer(
+                std::set<BufferId>::iterator freeIt, const std::vector<uint8_t> &config);
+
         static void createInvalidator();
 
     public:
@@ -86,19 +86,23 @@ ResultStatus BufferStatusObserver::close(ConnectionId id) {
 
 void BufferStatusObserver::getBufferStatusChanges(std::vector<BufferStatusMessage> &messages) {
     for (auto it = mBufferStatusQueues.begin(); it != mBufferStatusQueues.end(); ++it) {
-        BufferStatusMessage message;
         size_t avail = it->second->availableToRead();
-        while (avail > 0) {
-            if (!it->second->read(&message, 1)) {
-                // Since avaliable # of reads are already confirmed,
-                // this should not happen.
-                // TODO: error handling (spurious client?)
-                ALOGW("FMQ message cannot be read from %lld", (long long)it->first);
-                return;
-            }
-            message.connectionId = it->first;
-            messages.push_back(message);
-            --avail;
+        if (avail == 0) {
+            continue;
+        }
+        // Reads all the pending messages of the connection at once.
+        size_t first = messages.size();
+        messages.resize(first + avail);
+        if (!it->second->read(&messages[first], avail)) {
+            // Since avaliable # of reads are already confirmed,
+            // this should not happen.
+            // TODO: error handling (spurious client?)
+            ALOGW("FMQ message cannot be read from %lld", (long long)it->first);
+            messages.resize(first);
+            return;
+        }
+        for (size_t i = first; i < messages.size(); ++i) {
+            messages[i].connectionId = it->first;
         }
     }
 }
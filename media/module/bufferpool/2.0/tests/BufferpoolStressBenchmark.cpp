@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Allocates and releases buffers from several threads at once, like busy codecs do:
+// BM_SharedPool makes all the threads use one buffer pool, and BM_SeparatePools gives
+// each thread its own buffer pool. Every thread keeps a few buffers in use, and the
+// allocations mostly recycle the buffers released before.
+//
+// $ atest BufferpoolStressBenchmark
+
+#define LOG_TAG "BufferpoolStressBenchmark"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <bufferpool/ClientManager.h>
+
+#include "allocator.h"
+
+using android::hardware::media::bufferpool::BufferPoolData;
+using android::hardware::media::bufferpool::V2_0::ResultStatus;
+using android::hardware::media::bufferpool::V2_0::implementation::ClientManager;
+using android::hardware::media::bufferpool::V2_0::implementation::ConnectionId;
+
+namespace {
+
+// Buffers in use by each thread, as the output buffers of a codec.
+constexpr size_t kBuffersInUse = 8;
+
+struct Pool {
+    Pool() : mManager(ClientManager::getInstance()) {
+        mValid = mManager != nullptr
+                && mManager->create(std::make_shared<TestBufferPoolAllocator>(),
+                                    &mConnectionId) == ResultStatus::OK;
+    }
+
+    ~Pool() {
+        if (mValid) {
+            mManager->close(mConnectionId);
+        }
+    }
+
+    const android::sp<ClientManager> mManager;
+    ConnectionId mConnectionId;
+    bool mValid;
+};
+
+// Cycles the buffers of a thread through |pool| until the benchmark is done.
+void runClient(benchmark::State& state, const Pool& pool) {
+    if (!pool.mValid) {
+        state.SkipWithError("cannot create the buffer pool");
+        return;
+    }
+    std::vector<uint8_t> params;
+    getTestAllocatorParams(&params);
+    std::array<std::shared_ptr<BufferPoolData>, kBuffersInUse> buffers;
+    size_t next = 0;
+    for (auto _ : state) {
+        // releases the oldest buffer before allocating the next one.
+        buffers[next].reset();
+        native_handle_t* handle = nullptr;
+        if (pool.mManager->allocate(pool.mConnectionId, params, &handle, &buffers[next])
+                != ResultStatus::OK) {
+            state.SkipWithError("failed to allocate a buffer");
+            break;
+        }
+        if (handle) {
+            native_handle_close(handle);
+            native_handle_delete(handle);
+        }
+        next = (next + 1) % kBuffersInUse;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_SharedPool(benchmark::State& state) {
+    static Pool sPool;
+    runClient(state, sPool);
+}
+
+void BM_SeparatePools(benchmark::State& state) {
+    Pool pool;
+    runClient(state, pool);
+}
+
+BENCHMARK(BM_SharedPool)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_SeparatePools)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+
+BENCHMARK_MAIN();
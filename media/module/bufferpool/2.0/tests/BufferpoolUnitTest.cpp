@@ -24,6 +24,8 @@
 #include <hidl/LegacySupport.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <algorithm>
+#include <set>
 #include <unordered_set>
 #include <vector>
 #include "allocator.h"
@@ -90,6 +92,18 @@ class BufferpoolTest {
     std::shared_ptr<BufferPoolAllocator> mAllocator;
 
     void setupBufferpoolManager();
+
+    // Allocates a buffer with |params|, without keeping its handle.
+    ResultStatus allocateBuffer(const std::vector<uint8_t>& params,
+                                std::shared_ptr<BufferPoolData>* buffer) {
+        native_handle_t* handle = nullptr;
+        ResultStatus status = mManager->allocate(mConnectionId, params, &handle, buffer);
+        if (handle) {
+            native_handle_close(handle);
+            native_handle_delete(handle);
+        }
+        return status;
+    }
 };
 
 void BufferpoolTest::setupBufferpoolManager() {
@@ -301,6 +315,136 @@ TEST_F(BufferpoolUnitTest, RecycleBuffer) {
     allocHandle.clear();
 }
 
+// Buffer recycle test with different allocation params.
+// Check whether the buffers are recycled for the params they were allocated with, lowest id first.
+TEST_F(BufferpoolUnitTest, RecycleBufferByParams) {
+    std::vector<uint8_t> vecParams[2];
+    getTestAllocatorParams(&vecParams[0]);
+    getIpcMutexParams(&vecParams[1]);
+
+    std::vector<std::shared_ptr<BufferPoolData>> buffers[2];
+    std::set<BufferId> freeIds[2];
+    BufferId maxId = 0;
+    for (int i = 0; i < kNumIterationCount; ++i) {
+        for (int p = 0; p < 2; ++p) {
+            std::shared_ptr<BufferPoolData> buffer;
+            ASSERT_EQ(allocateBuffer(vecParams[p], &buffer), ResultStatus::OK)
+                    << "allocate failed for " << i << " iteration";
+            freeIds[p].insert(buffer->mId);
+            maxId = std::max(maxId, buffer->mId);
+            buffers[p].push_back(std::move(buffer));
+        }
+    }
+    // free the buffers of both params, interleaved by id.
+    buffers[0].clear();
+    buffers[1].clear();
+
+    for (int i = 0; i < kNumIterationCount; ++i) {
+        for (int p = 1; p >= 0; --p) {
+            std::shared_ptr<BufferPoolData> buffer;
+            ASSERT_EQ(allocateBuffer(vecParams[p], &buffer), ResultStatus::OK)
+                    << "allocate failed for " << i << " iteration";
+            ASSERT_EQ(buffer->mId, *freeIds[p].begin()) << "buffer not recycled for params " << p;
+            freeIds[p].erase(freeIds[p].begin());
+            buffers[p].push_back(std::move(buffer));
+        }
+    }
+
+    // all the buffers are in use.
+    std::shared_ptr<BufferPoolData> buffer;
+    ASSERT_EQ(allocateBuffer(vecParams[0], &buffer), ResultStatus::OK);
+    ASSERT_GT(buffer->mId, maxId) << "buffer in use is recycled";
+}
+
+// Buffer recycle test after flush.
+// Check whether the buffers invalidated by flush are not recycled, and whether the buffers
+// allocated after it are.
+TEST_F(BufferpoolUnitTest, RecycleBufferByParamsAfterFlush) {
+    std::vector<uint8_t> vecParams[2];
+    getTestAllocatorParams(&vecParams[0]);
+    getIpcMutexParams(&vecParams[1]);
+
+    std::vector<std::shared_ptr<BufferPoolData>> buffers;
+    BufferId maxId = 0;
+    for (int i = 0; i < kNumIterationCount; ++i) {
+        for (int p = 0; p < 2; ++p) {
+            std::shared_ptr<BufferPoolData> buffer;
+            ASSERT_EQ(allocateBuffer(vecParams[p], &buffer), ResultStatus::OK)
+                    << "allocate failed for " << i << " iteration";
+            maxId = std::max(maxId, buffer->mId);
+            buffers.push_back(std::move(buffer));
+        }
+    }
+    std::shared_ptr<BufferPoolData> usedBuffer = buffers[kNumIterationCount];
+    buffers.clear();
+
+    // the free buffers are evicted, the buffer in use is when it is freed.
+    ResultStatus status = mManager->flush(mConnectionId);
+    ASSERT_EQ(status, ResultStatus::OK) << "failed to flush connection : " << mConnectionId;
+    usedBuffer.reset();
+
+    BufferId newIds[2];
+    for (int p = 0; p < 2; ++p) {
+        std::shared_ptr<BufferPoolData> buffer;
+        ASSERT_EQ(allocateBuffer(vecParams[p], &buffer), ResultStatus::OK);
+        ASSERT_GT(buffer->mId, maxId) << "invalidated buffer is recycled";
+        newIds[p] = buffer->mId;
+    }
+    for (int p = 0; p < 2; ++p) {
+        std::shared_ptr<BufferPoolData> buffer;
+        ASSERT_EQ(allocateBuffer(vecParams[p], &buffer), ResultStatus::OK);
+        ASSERT_EQ(buffer->mId, newIds[p]) << "buffer not recycled after flush";
+    }
+}
+
+// Buffer recycle test after eviction.
+// Check whether the buffers left after the pool evicts the unused buffers above its limit are
+// recycled.
+TEST_F(BufferpoolUnitTest, RecycleBufferByParamsAfterEviction) {
+    // more buffers than the pool keeps unused.
+    constexpr int kNumBuffers = 80;
+    std::vector<uint8_t> vecParams[2];
+    getTestAllocatorParams(&vecParams[0]);
+    getIpcMutexParams(&vecParams[1]);
+
+    std::vector<std::shared_ptr<BufferPoolData>> buffers;
+    std::set<BufferId> freeIds;
+    for (int i = 0; i < kNumBuffers; ++i) {
+        std::shared_ptr<BufferPoolData> buffer;
+        ASSERT_EQ(allocateBuffer(vecParams[0], &buffer), ResultStatus::OK)
+                << "allocate failed for " << i << " iteration";
+        freeIds.insert(buffer->mId);
+        buffers.push_back(std::move(buffer));
+    }
+    std::shared_ptr<BufferPoolData> otherBuffer;
+    ASSERT_EQ(allocateBuffer(vecParams[1], &otherBuffer), ResultStatus::OK);
+    const BufferId otherId = otherBuffer->mId;
+    buffers.clear();
+    otherBuffer.reset();
+
+    // the lowest buffers are evicted, the others are recycled in order.
+    std::vector<BufferId> recycledIds;
+    for (int i = 0; i < kNumBuffers; ++i) {
+        std::shared_ptr<BufferPoolData> buffer;
+        ASSERT_EQ(allocateBuffer(vecParams[0], &buffer), ResultStatus::OK)
+                << "allocate failed for " << i << " iteration";
+        if (freeIds.count(buffer->mId) == 0) {
+            ASSERT_GT(buffer->mId, otherId) << "buffer with other params is recycled";
+            break;
+        }
+        if (!recycledIds.empty()) {
+            ASSERT_GT(buffer->mId, recycledIds.back()) << "buffer recycled out of order";
+        }
+        recycledIds.push_back(buffer->mId);
+        buffers.push_back(std::move(buffer));
+    }
+    ASSERT_LT(recycledIds.size(), (size_t)kNumBuffers) << "no buffer was evicted";
+    ASSERT_EQ(recycledIds.back(), *freeIds.rbegin()) << "buffers left are not recycled";
+
+    ASSERT_EQ(allocateBuffer(vecParams[1], &otherBuffer), ResultStatus::OK);
+    ASSERT_EQ(otherBuffer->mId, otherId) << "buffer not recycled for its params";
+}
+
 // Validate cache evict and invalidate APIs.
 TEST_F(BufferpoolUnitTest, FlushTest) {
     std::vector<uint8_t> vecParams;
@@ -444,6 +588,64 @@ TEST_F(BufferpoolFunctionalityTest, TransferBuffer) {
             << "received error during buffer transfer\n";
 }
 
+// Buffer recycle test after the receiver closes.
+// Check whether the buffers freed after the receiver closes its connection, which evicts the
+// buffers sent to it, are recycled.
+TEST_F(BufferpoolFunctionalityTest, RecycleBufferAfterReceiverClose) {
+    // initialize the receiver
+    PipeMessage message;
+    message.data.command = PipeCommand::INIT;
+    sendMessage(mCommandPipeFds, message);
+    ASSERT_TRUE(receiveMessage(mResultPipeFds, &message)) << "receiveMessage failed\n";
+    ASSERT_EQ(message.data.command, PipeCommand::INIT_OK) << "receiver init failed";
+
+    android::sp<IClientManager> receiver = IClientManager::getService();
+    ASSERT_NE(receiver, nullptr) << "getService failed for receiver\n";
+
+    ConnectionId receiverId;
+    ResultStatus status = mManager->registerSender(receiver, mConnectionId, &receiverId);
+    ASSERT_EQ(status, ResultStatus::OK)
+            << "registerSender failed for connection id " << mConnectionId << "\n";
+
+    std::vector<uint8_t> vecParams;
+    getTestAllocatorParams(&vecParams);
+
+    // send buffers which the receiver does not receive before it closes.
+    std::set<BufferId> ids;
+    for (int i = 0; i < kNumIterationCount; ++i) {
+        std::shared_ptr<BufferPoolData> buffer;
+        status = allocateBuffer(vecParams, &buffer);
+        ASSERT_EQ(status, ResultStatus::OK) << "allocate failed for " << i << "iteration";
+        int64_t postUs;
+        TransactionId transactionId;
+        status = mManager->postSend(receiverId, buffer, &transactionId, &postUs);
+        ASSERT_EQ(status, ResultStatus::OK)
+                << "postSend failed for receiver " << receiverId << "\n";
+        ids.insert(buffer->mId);
+    }
+    message.data.command = PipeCommand::STOP;
+    message.data.connectionId = receiverId;
+    sendMessage(mCommandPipeFds, message);
+    ASSERT_TRUE(receiveMessage(mResultPipeFds, &message)) << "receiveMessage failed\n";
+    ASSERT_EQ(message.data.command, PipeCommand::STOP_OK)
+            << "received error during receiver close\n";
+
+    // the pool handles the close asynchronously and evicts the free buffers. A new buffer is
+    // allocated before and after that, the freed buffer is recycled otherwise.
+    size_t newBuffers = 0;
+    for (int i = 0; i < 50; ++i) {
+        std::shared_ptr<BufferPoolData> buffer;
+        status = allocateBuffer(vecParams, &buffer);
+        ASSERT_EQ(status, ResultStatus::OK) << "allocate failed for " << i << "iteration";
+        if (ids.insert(buffer->mId).second) {
+            ++newBuffers;
+        }
+        buffer.reset();
+        usleep(10000);
+    }
+    ASSERT_LE(newBuffers, 2u) << "buffers not recycled after receiver close";
+}
+
 /* Validate bufferpool for following corner cases:
  1. invalid connectionID
  2. invalid receiver
@@ -18,6 +18,7 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <algorithm>
 #include <limits>
 
 #include "SampleTable.h"
@@ -58,13 +59,18 @@ struct SampleTable::CompositionDeltaLookup {
     int32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
 private:
+    // Every kCheckpointInterval-th entry, we remember the index of its first
+    // sample so that random access does not rescan the table from the start.
+    static const size_t kCheckpointInterval = 256;
+
     Mutex mLock;
 
     const int32_t *mDeltaEntries;
     size_t mNumDeltaEntries;
+    std::vector<uint64_t> mCheckpointSampleIndex;
 
     size_t mCurrentDeltaEntry;
-    size_t mCurrentEntrySampleIndex;
+    uint64_t mCurrentEntrySampleIndex;
 
     DISALLOW_EVIL_CONSTRUCTORS(CompositionDeltaLookup);
 };
@@ -84,6 +90,15 @@ void SampleTable::CompositionDeltaLookup::setEntries(
     mNumDeltaEntries = numDeltaEntries;
     mCurrentDeltaEntry = 0;
     mCurrentEntrySampleIndex = 0;
+
+    mCheckpointSampleIndex.clear();
+    uint64_t sampleIndex = 0;
+    for (size_t i = 0; i < numDeltaEntries; ++i) {
+        if (i % kCheckpointInterval == 0) {
+            mCheckpointSampleIndex.push_back(sampleIndex);
+        }
+        sampleIndex += (uint32_t)deltaEntries[2 * i];
+    }
 }
 
 int32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
@@ -94,9 +109,15 @@ int32_t SampleTable::CompositionDeltaLookup::getCompositionTimeOffset(
         return 0;
     }
 
-    if (sampleIndex < mCurrentEntrySampleIndex) {
-        mCurrentDeltaEntry = 0;
-        mCurrentEntrySampleIndex = 0;
+    size_t nextCheckpoint = mCurrentDeltaEntry / kCheckpointInterval + 1;
+    if (sampleIndex < mCurrentEntrySampleIndex
+            || (nextCheckpoint < mCheckpointSampleIndex.size()
+                    && sampleIndex >= mCheckpointSampleIndex[nextCheckpoint])) {
+        size_t checkpoint = std::upper_bound(
+                mCheckpointSampleIndex.begin(), mCheckpointSampleIndex.end(),
+                (uint64_t)sampleIndex) - mCheckpointSampleIndex.begin() - 1;
+        mCurrentDeltaEntry = checkpoint * kCheckpointInterval;
+        mCurrentEntrySampleIndex = mCheckpointSampleIndex[checkpoint];
     }
 
     while (mCurrentDeltaEntry < mNumDeltaEntries) {
@@ -128,7 +149,8 @@ SampleTable::SampleTable(DataSourceHelper *source)
       mHasTimeToSample(false),
       mTimeToSampleCount(0),
       mTimeToSample(NULL),
-      mSampleTimeEntries(NULL),
+      mSampleIndexBuilt(false),
+      mNextSortedSegment(0),
       mCompositionTimeDeltaEntries(NULL),
       mNumCompositionTimeDeltaEntries(0),
       mCompositionDeltaLookup(new CompositionDeltaLookup),
@@ -157,9 +179,6 @@ SampleTable::~SampleTable() {
     delete[] mCompositionTimeDeltaEntries;
     mCompositionTimeDeltaEntries = NULL;
 
-    delete[] mSampleTimeEntries;
-    mSampleTimeEntries = NULL;
-
     delete mSampleIterator;
     mSampleIterator = NULL;
 }
@@ -595,16 +614,52 @@ status_t SampleTable::getMaxSampleSize(size_t *max_size) {
 
     *max_size = 0;
 
-    for (uint32_t i = 0; i < mNumSampleSizes; ++i) {
-        size_t sample_size;
-        status_t err = getSampleSize_l(i, &sample_size);
+    if (mNumSampleSizes == 0) {
+        return OK;
+    }
+
+    if (mDefaultSampleSize > 0) {
+        *max_size = mDefaultSampleSize;
+        return OK;
+    }
 
-        if (err != OK) {
-            return err;
+    // Scan the stsz/stz2 table in large reads rather than one readAt() per
+    // sample, which dominated open time for long recordings.
+    static const uint32_t kNumSampleSizesPerRead = 16384;
+    const uint32_t fieldSize = mSampleSizeFieldSize;
+    std::vector<uint8_t> buffer(kNumSampleSizesPerRead * fieldSize / 8);
+
+    for (uint32_t first = 0; first < mNumSampleSizes; first += kNumSampleSizesPerRead) {
+        uint32_t count = std::min(kNumSampleSizesPerRead, mNumSampleSizes - first);
+        size_t numBytes = ((uint64_t)count * fieldSize + 7) / 8;
+        if (mDataSource->readAt(
+                    mSampleSizeOffset + 12 + (uint64_t)first * fieldSize / 8,
+                    buffer.data(), numBytes) < (ssize_t)numBytes) {
+            return ERROR_IO;
         }
 
-        if (sample_size > *max_size) {
-            *max_size = sample_size;
+        for (uint32_t i = 0; i < count; ++i) {
+            size_t sample_size;
+            switch (fieldSize) {
+                case 32:
+                    sample_size = U32_AT(&buffer[4 * i]);
+                    break;
+                case 16:
+                    sample_size = U16_AT(&buffer[2 * i]);
+                    break;
+                case 8:
+                    sample_size = buffer[i];
+                    break;
+                default:
+                    CHECK_EQ(fieldSize, 4u);
+                    // |first| is always even, so nibble parity is preserved.
+                    sample_size = (i & 1) ? buffer[i / 2] & 0x0f : buffer[i / 2] >> 4;
+                    break;
+            }
+
+            if (sample_size > *max_size) {
+                *max_size = sample_size;
+            }
         }
     }
 
@@ -616,110 +671,239 @@ uint32_t abs_difference(uint64_t time1, uint64_t time2) {
 }
 
 // static
-int SampleTable::CompareIncreasingTime(const void *_a, const void *_b) {
-    const SampleTimeEntry *a = (const SampleTimeEntry *)_a;
-    const SampleTimeEntry *b = (const SampleTimeEntry *)_b;
+bool SampleTable::CompareIncreasingTime(
+        const SampleTimeEntry &a, const SampleTimeEntry &b) {
+    return a.mCompositionTime < b.mCompositionTime;
+}
 
-    if (a->mCompositionTime < b->mCompositionTime) {
-        return -1;
-    } else if (a->mCompositionTime > b->mCompositionTime) {
-        return 1;
+uint64_t SampleTable::nextCompositionTime(SampleTimeCursor *cursor) const {
+    while (cursor->mTimeToSampleIndex < mTimeToSampleCount
+            && cursor->mTimeToSampleOffset
+                    >= mTimeToSample[2 * cursor->mTimeToSampleIndex]) {
+        ++cursor->mTimeToSampleIndex;
+        cursor->mTimeToSampleOffset = 0;
     }
 
-    return 0;
+    if (cursor->mTimeToSampleIndex == mTimeToSampleCount) {
+        // Technically this should never be the case if the file is
+        // well-formed, but you know... there's (gasp) malformed content out
+        // there.
+        return 0;
+    }
+
+    int32_t compTimeDelta = 0;
+    if (mCompositionTimeDeltaEntries != NULL) {
+        while (cursor->mCompositionDeltaIndex < mNumCompositionTimeDeltaEntries
+                && cursor->mCompositionDeltaOffset >= (uint32_t)
+                        mCompositionTimeDeltaEntries[2 * cursor->mCompositionDeltaIndex]) {
+            ++cursor->mCompositionDeltaIndex;
+            cursor->mCompositionDeltaOffset = 0;
+        }
+        if (cursor->mCompositionDeltaIndex < mNumCompositionTimeDeltaEntries) {
+            compTimeDelta =
+                mCompositionTimeDeltaEntries[2 * cursor->mCompositionDeltaIndex + 1];
+        }
+        ++cursor->mCompositionDeltaOffset;
+    }
+
+    uint64_t sampleTime = cursor->mDecodeTime;
+    if ((compTimeDelta < 0 && sampleTime <
+            (compTimeDelta == INT32_MIN ?
+                    INT32_MAX : uint32_t(-compTimeDelta)))
+            || (compTimeDelta > 0 &&
+                    sampleTime > UINT64_MAX - compTimeDelta)) {
+        ALOGE("%llu + %d would overflow, clamping",
+                (unsigned long long) sampleTime, compTimeDelta);
+        if (compTimeDelta < 0) {
+            sampleTime = 0;
+        } else {
+            sampleTime = UINT64_MAX;
+        }
+        compTimeDelta = 0;
+    }
+
+    uint64_t compositionTime = compTimeDelta > 0 ? sampleTime + compTimeDelta :
+            sampleTime - uint64_t(-int64_t(compTimeDelta));
+
+    uint32_t delta = mTimeToSample[2 * cursor->mTimeToSampleIndex + 1];
+    if (sampleTime > UINT64_MAX - delta) {
+        ALOGE("%llu + %u would overflow, clamping",
+            (unsigned long long) sampleTime, delta);
+        sampleTime = UINT64_MAX;
+    } else {
+        sampleTime += delta;
+    }
+    cursor->mDecodeTime = sampleTime;
+    ++cursor->mTimeToSampleOffset;
+
+    return compositionTime;
 }
 
-void SampleTable::buildSampleEntriesTable() {
-    Mutex::Autolock autoLock(mLock);
+SampleTable::SampleTimeCursor SampleTable::getBlockCursor(uint32_t block) const {
+    SampleTimeCursor cursor;
+    cursor.mDecodeTime = mBlockDecodeTime[block];
+    cursor.mTimeToSampleIndex = mBlockTimeToSampleIndex[block];
+    cursor.mTimeToSampleOffset = mBlockTimeToSampleOffset[block];
+    cursor.mCompositionDeltaIndex = mBlockCompositionDeltaIndex[block];
+    cursor.mCompositionDeltaOffset = mBlockCompositionDeltaOffset[block];
+    return cursor;
+}
 
-    if (mSampleTimeEntries != NULL || mNumSampleSizes == 0) {
-        if (mNumSampleSizes == 0) {
-            ALOGE("b/23247055, mNumSampleSizes(%u)", mNumSampleSizes);
-        }
-        return;
+uint32_t SampleTable::getSegmentFirstSample(size_t segment) const {
+    return mSegmentFirstBlock[segment] * kSampleIndexBlockSize;
+}
+
+bool SampleTable::buildSampleEntriesTable_l() {
+    if (mSampleIndexBuilt) {
+        return true;
+    }
+
+    if (mNumSampleSizes == 0) {
+        ALOGE("b/23247055, mNumSampleSizes(%u)", mNumSampleSizes);
+        return false;
     }
 
-    mTotalSize += (uint64_t)mNumSampleSizes * sizeof(SampleTimeEntry);
+    const uint32_t numBlocks = (mNumSampleSizes - 1) / kSampleIndexBlockSize + 1;
+
+    // Worst case every block starts its own segment.
+    const uint64_t indexSize = (uint64_t)numBlocks * (
+            2 * sizeof(uint64_t) + 5 * sizeof(uint32_t));
+    mTotalSize += indexSize;
     if (mTotalSize > kMaxTotalSize) {
-        ALOGE("Sample entry table size would make sample table too large.\n"
-              "    Requested sample entry table size = %llu\n"
+        ALOGE("Sample index size would make sample table too large.\n"
+              "    Requested sample index size = %llu\n"
               "    Eventual sample table size >= %llu\n"
               "    Allowed sample table size = %llu\n",
-              (unsigned long long)mNumSampleSizes * sizeof(SampleTimeEntry),
+              (unsigned long long)indexSize,
               (unsigned long long)mTotalSize,
               (unsigned long long)kMaxTotalSize);
-        return;
-    }
-
-    mSampleTimeEntries = new (std::nothrow) SampleTimeEntry[mNumSampleSizes];
-
-    if (!mSampleTimeEntries) {
-        ALOGE("Cannot allocate sample entry table with %llu entries.",
-                (unsigned long long)mNumSampleSizes);
-        return;
-    }
-    memset(mSampleTimeEntries, 0, sizeof(SampleTimeEntry) * mNumSampleSizes);
-
-    uint32_t sampleIndex = 0;
-    uint64_t sampleTime = 0;
-
-    for (uint32_t i = 0; i < mTimeToSampleCount; ++i) {
-        uint32_t n = mTimeToSample[2 * i];
-        uint32_t delta = mTimeToSample[2 * i + 1];
-
-        for (uint32_t j = 0; j < n; ++j) {
-            if (sampleIndex < mNumSampleSizes) {
-                // Technically this should always be the case if the file
-                // is well-formed, but you know... there's (gasp) malformed
-                // content out there.
-
-                mSampleTimeEntries[sampleIndex].mSampleIndex = sampleIndex;
-
-                int32_t compTimeDelta =
-                    mCompositionDeltaLookup->getCompositionTimeOffset(
-                            sampleIndex);
-
-                if ((compTimeDelta < 0 && sampleTime <
-                        (compTimeDelta == INT32_MIN ?
-                                INT32_MAX : uint32_t(-compTimeDelta)))
-                        || (compTimeDelta > 0 &&
-                                sampleTime > UINT64_MAX - compTimeDelta)) {
-                    ALOGE("%llu + %d would overflow, clamping",
-                            (unsigned long long) sampleTime, compTimeDelta);
-                    if (compTimeDelta < 0) {
-                        sampleTime = 0;
-                    } else {
-                        sampleTime = UINT64_MAX;
-                    }
-                    compTimeDelta = 0;
-                }
-
-                mSampleTimeEntries[sampleIndex].mCompositionTime =
-                        compTimeDelta > 0 ? sampleTime + compTimeDelta:
-                                sampleTime - (-compTimeDelta);
-            }
+        return false;
+    }
+
+    mBlockDecodeTime.resize(numBlocks);
+    mBlockTimeToSampleIndex.resize(numBlocks);
+    mBlockTimeToSampleOffset.resize(numBlocks);
+    mBlockCompositionDeltaIndex.resize(numBlocks);
+    mBlockCompositionDeltaOffset.resize(numBlocks);
+
+    std::vector<uint64_t> blockMinTime(numBlocks);
+    std::vector<uint64_t> blockMaxTime(numBlocks);
+
+    SampleTimeCursor cursor = {};
+    for (uint32_t block = 0; block < numBlocks; ++block) {
+        mBlockDecodeTime[block] = cursor.mDecodeTime;
+        mBlockTimeToSampleIndex[block] = cursor.mTimeToSampleIndex;
+        mBlockTimeToSampleOffset[block] = cursor.mTimeToSampleOffset;
+        mBlockCompositionDeltaIndex[block] = cursor.mCompositionDeltaIndex;
+        mBlockCompositionDeltaOffset[block] = cursor.mCompositionDeltaOffset;
+
+        uint32_t numSamples = std::min(kSampleIndexBlockSize,
+                mNumSampleSizes - block * kSampleIndexBlockSize);
+        uint64_t minTime = UINT64_MAX;
+        uint64_t maxTime = 0;
+        for (uint32_t i = 0; i < numSamples; ++i) {
+            uint64_t time = nextCompositionTime(&cursor);
+            minTime = std::min(minTime, time);
+            maxTime = std::max(maxTime, time);
+        }
+        blockMinTime[block] = minTime;
+        blockMaxTime[block] = maxTime;
+    }
 
-            ++sampleIndex;
-            if (sampleTime > UINT64_MAX - delta) {
-                ALOGE("%llu + %u would overflow, clamping",
-                    (unsigned long long) sampleTime, delta);
-                sampleTime = UINT64_MAX;
-            } else {
-                sampleTime += delta;
-            }
+    // A new segment may start at a block only if no earlier sample is
+    // presented after any sample of this block or the following ones.
+    for (uint32_t block = numBlocks - 1; block > 0; --block) {
+        blockMinTime[block - 1] = std::min(blockMinTime[block - 1], blockMinTime[block]);
+    }
+
+    mSegmentFirstBlock.clear();
+    mSegmentMinTime.clear();
+    uint64_t maxTimeSoFar = 0;
+    for (uint32_t block = 0; block < numBlocks; ++block) {
+        if (block == 0 || maxTimeSoFar <= blockMinTime[block]) {
+            mSegmentFirstBlock.push_back(block);
+            mSegmentMinTime.push_back(blockMinTime[block]);
+        }
+        maxTimeSoFar = std::max(maxTimeSoFar, blockMaxTime[block]);
+    }
+    mSegmentFirstBlock.shrink_to_fit();
+    mSegmentMinTime.shrink_to_fit();
+
+    ALOGV("sample index: %u samples, %u blocks, %zu segments",
+            mNumSampleSizes, numBlocks, mSegmentFirstBlock.size());
+
+    mSampleIndexBuilt = true;
+    return true;
+}
+
+status_t SampleTable::getSortedEntry_l(
+        uint32_t sortedIndex, const SampleTimeEntry **entry) {
+    for (const SortedSegment &cached : mSortedSegments) {
+        if (sortedIndex >= cached.mFirstSample
+                && sortedIndex - cached.mFirstSample < cached.mNumEntries) {
+            *entry = &cached.mEntries[sortedIndex - cached.mFirstSample];
+            return OK;
         }
     }
 
-    qsort(mSampleTimeEntries, mNumSampleSizes, sizeof(SampleTimeEntry),
-          CompareIncreasingTime);
+    // Sorted positions and sample indices coincide at segment boundaries.
+    size_t segment = std::upper_bound(
+            mSegmentFirstBlock.begin(), mSegmentFirstBlock.end(),
+            sortedIndex / kSampleIndexBlockSize) - mSegmentFirstBlock.begin() - 1;
+    uint32_t firstSample = getSegmentFirstSample(segment);
+    uint32_t endSample = segment + 1 < mSegmentFirstBlock.size()
+            ? getSegmentFirstSample(segment + 1) : mNumSampleSizes;
+    uint32_t numEntries = endSample - firstSample;
+
+    SortedSegment &sorted = mSortedSegments[mNextSortedSegment];
+    mNextSortedSegment = (mNextSortedSegment + 1) % kNumCachedSegments;
+
+    // Release the evicted segment before accounting for the new one.
+    mTotalSize -= (uint64_t)sorted.mNumEntries * sizeof(SampleTimeEntry);
+    sorted.mEntries.reset();
+    sorted.mNumEntries = 0;
+
+    uint64_t allocSize = (uint64_t)numEntries * sizeof(SampleTimeEntry);
+    mTotalSize += allocSize;
+    if (mTotalSize > kMaxTotalSize) {
+        ALOGE("Sorted segment size would make sample table too large.\n"
+              "    Requested sorted segment size = %llu\n"
+              "    Eventual sample table size >= %llu\n"
+              "    Allowed sample table size = %llu\n",
+              (unsigned long long)allocSize,
+              (unsigned long long)mTotalSize,
+              (unsigned long long)kMaxTotalSize);
+        mTotalSize -= allocSize;
+        return ERROR_OUT_OF_RANGE;
+    }
+
+    sorted.mEntries.reset(new (std::nothrow) SampleTimeEntry[numEntries]);
+    if (!sorted.mEntries) {
+        ALOGE("Cannot allocate sorted segment of %u samples", numEntries);
+        mTotalSize -= allocSize;
+        return NO_MEMORY;
+    }
+    sorted.mFirstSample = firstSample;
+    sorted.mNumEntries = numEntries;
+
+    SampleTimeEntry *entries = sorted.mEntries.get();
+    SampleTimeCursor cursor = getBlockCursor(mSegmentFirstBlock[segment]);
+    for (uint32_t i = 0; i < numEntries; ++i) {
+        entries[i].mSampleIndex = firstSample + i;
+        entries[i].mCompositionTime = nextCompositionTime(&cursor);
+    }
+    std::stable_sort(entries, entries + numEntries, CompareIncreasingTime);
+
+    *entry = &entries[sortedIndex - firstSample];
+    return OK;
 }
 
 status_t SampleTable::findSampleAtTime(
         uint64_t req_time, uint64_t scale_num, uint64_t scale_den,
         uint32_t *sample_index, uint32_t flags) {
-    buildSampleEntriesTable();
+    Mutex::Autolock autoLock(mLock);
 
-    if (mSampleTimeEntries == NULL) {
+    if (!buildSampleEntriesTable_l()) {
         return ERROR_OUT_OF_RANGE;
     }
 
@@ -727,23 +911,45 @@ status_t SampleTable::findSampleAtTime(
         if (req_time >= mNumSampleSizes) {
             return ERROR_OUT_OF_RANGE;
         }
-        *sample_index = mSampleTimeEntries[req_time].mSampleIndex;
+        const SampleTimeEntry *entry;
+        status_t err = getSortedEntry_l(req_time, &entry);
+        if (err != OK) {
+            return err;
+        }
+        *sample_index = entry->mSampleIndex;
         return OK;
     }
 
-    uint32_t left = 0;
-    uint32_t right_plus_one = mNumSampleSizes;
+    // Segments do not overlap in time, so the insertion point of |req_time|
+    // lies within the last segment starting at or before it.
+    size_t segment = std::upper_bound(
+            mSegmentMinTime.begin(), mSegmentMinTime.end(), req_time,
+            [scale_num, scale_den](uint64_t time, uint64_t segmentMinTime) {
+                return time < scaleTime(segmentMinTime, scale_num, scale_den);
+            }) - mSegmentMinTime.begin();
+
+    uint32_t left = segment > 0 ? getSegmentFirstSample(segment - 1) : 0;
+    uint32_t right_plus_one = segment < mSegmentMinTime.size()
+            ? getSegmentFirstSample(segment) : mNumSampleSizes;
     while (left < right_plus_one) {
         uint32_t center = left + (right_plus_one - left) / 2;
-        uint64_t centerTime =
-            getSampleTime(center, scale_num, scale_den);
+        uint64_t centerTime;
+        status_t err = getSampleTime_l(center, scale_num, scale_den, &centerTime);
+        if (err != OK) {
+            return err;
+        }
 
         if (req_time < centerTime) {
             right_plus_one = center;
         } else if (req_time > centerTime) {
             left = center + 1;
         } else {
-            *sample_index = mSampleTimeEntries[center].mSampleIndex;
+            const SampleTimeEntry *entry;
+            err = getSortedEntry_l(center, &entry);
+            if (err != OK) {
+                return err;
+            }
+            *sample_index = entry->mSampleIndex;
             return OK;
         }
     }
@@ -782,17 +988,28 @@ status_t SampleTable::findSampleAtTime(
         {
             CHECK(flags == kFlagClosest);
             // pick closest based on timestamp. use abs_difference for safety
-            if (abs_difference(
-                    getSampleTime(closestIndex, scale_num, scale_den), req_time) >
-                abs_difference(
-                    req_time, getSampleTime(closestIndex - 1, scale_num, scale_den))) {
+            uint64_t closestTime, previousTime;
+            status_t err = getSampleTime_l(closestIndex, scale_num, scale_den, &closestTime);
+            if (err == OK) {
+                err = getSampleTime_l(closestIndex - 1, scale_num, scale_den, &previousTime);
+            }
+            if (err != OK) {
+                return err;
+            }
+            if (abs_difference(closestTime, req_time) >
+                abs_difference(req_time, previousTime)) {
                 --closestIndex;
             }
             break;
         }
     }
 
-    *sample_index = mSampleTimeEntries[closestIndex].mSampleIndex;
+    const SampleTimeEntry *entry;
+    status_t err = getSortedEntry_l(closestIndex, &entry);
+    if (err != OK) {
+        return err;
+    }
+    *sample_index = entry->mSampleIndex;
     return OK;
 }
 
@@ -982,9 +1199,14 @@ status_t SampleTable::getMetaDataForSample(
             // Every sample is a sync sample.
             *isSyncSample = true;
         } else {
-            size_t i = (mLastSyncSampleIndex < mNumSyncSamples)
-                    && (mSyncSamples[mLastSyncSampleIndex] <= sampleIndex)
-                ? mLastSyncSampleIndex : 0;
+            size_t i = mLastSyncSampleIndex;
+            if (i >= mNumSyncSamples || mSyncSamples[i] > sampleIndex
+                    || (i + 1 < mNumSyncSamples && mSyncSamples[i + 1] < sampleIndex)) {
+                // Not sequential access, e.g. after a seek: binary search
+                // rather than rescanning from the first sync sample.
+                i = std::lower_bound(mSyncSamples, mSyncSamples + mNumSyncSamples,
+                        sampleIndex) - mSyncSamples;
+            }
 
             while (i < mNumSyncSamples && mSyncSamples[i] < sampleIndex) {
                 ++i;
@@ -21,6 +21,9 @@
 #include <sys/types.h>
 #include <stdint.h>
 
+#include <memory>
+#include <vector>
+
 #include <media/MediaExtractorPluginHelper.h>
 #include <media/stagefright/MediaErrors.h>
 #include <utils/RefBase.h>
@@ -130,7 +133,44 @@ private:
         uint32_t mSampleIndex;
         uint64_t mCompositionTime;
     };
-    SampleTimeEntry *mSampleTimeEntries;
+
+    // Position within the stts/ctts tables, enough to regenerate the
+    // composition times of all following samples.
+    struct SampleTimeCursor {
+        uint64_t mDecodeTime;
+        uint32_t mTimeToSampleIndex;
+        uint32_t mTimeToSampleOffset;
+        uint32_t mCompositionDeltaIndex;
+        uint32_t mCompositionDeltaOffset;
+    };
+
+    // Presentation-order index, built lazily on the first seek. Instead of
+    // one SampleTimeEntry per sample, we keep a SampleTimeCursor for every
+    // block of kSampleIndexBlockSize samples. Consecutive blocks whose time
+    // ranges overlap (because of ctts reordering) are grouped into segments,
+    // of which we keep the first block and the min composition time. Segments
+    // never overlap in time, so the sorted position of a sample always lies
+    // within its own segment and only the segments touched by a seek need to
+    // be expanded. The expanded segments are counted in mTotalSize.
+    static constexpr uint32_t kSampleIndexBlockSize = 256;
+    static constexpr size_t kNumCachedSegments = 2;
+
+    bool mSampleIndexBuilt;
+    std::vector<uint64_t> mBlockDecodeTime;
+    std::vector<uint32_t> mBlockTimeToSampleIndex;
+    std::vector<uint32_t> mBlockTimeToSampleOffset;
+    std::vector<uint32_t> mBlockCompositionDeltaIndex;
+    std::vector<uint32_t> mBlockCompositionDeltaOffset;
+    std::vector<uint32_t> mSegmentFirstBlock;
+    std::vector<uint64_t> mSegmentMinTime;
+
+    struct SortedSegment {
+        uint32_t mFirstSample = 0;
+        uint32_t mNumEntries = 0;
+        std::unique_ptr<SampleTimeEntry[]> mEntries;
+    };
+    SortedSegment mSortedSegments[kNumCachedSegments];
+    size_t mNextSortedSegment;
 
     int32_t *mCompositionTimeDeltaEntries;
     size_t mNumCompositionTimeDeltaEntries;
@@ -156,19 +196,40 @@ private:
     friend struct SampleIterator;
 
     // normally we don't round
-    inline uint64_t getSampleTime(
-            size_t sample_index, uint64_t scale_num, uint64_t scale_den) const {
-        return (sample_index < (size_t)mNumSampleSizes && mSampleTimeEntries != NULL
-                && scale_den != 0)
-                ? (mSampleTimeEntries[sample_index].mCompositionTime * scale_num) / scale_den : 0;
+    static inline uint64_t scaleTime(
+            uint64_t time, uint64_t scale_num, uint64_t scale_den) {
+        return scale_den != 0 ? (time * scale_num) / scale_den : 0;
+    }
+
+    // |sorted_index| is a position in presentation order.
+    inline status_t getSampleTime_l(
+            size_t sorted_index, uint64_t scale_num, uint64_t scale_den,
+            uint64_t *time) {
+        if (sorted_index >= (size_t)mNumSampleSizes) {
+            *time = 0;
+            return OK;
+        }
+        const SampleTimeEntry *entry;
+        status_t err = getSortedEntry_l(sorted_index, &entry);
+        if (err != OK) {
+            return err;
+        }
+        *time = scaleTime(entry->mCompositionTime, scale_num, scale_den);
+        return OK;
     }
 
     status_t getSampleSize_l(uint32_t sample_index, size_t *sample_size);
     int32_t getCompositionTimeOffset(uint32_t sampleIndex);
 
-    static int CompareIncreasingTime(const void *, const void *);
+    static bool CompareIncreasingTime(
+            const SampleTimeEntry &a, const SampleTimeEntry &b);
+
+    uint64_t nextCompositionTime(SampleTimeCursor *cursor) const;
+    SampleTimeCursor getBlockCursor(uint32_t block) const;
+    uint32_t getSegmentFirstSample(size_t segment) const;
+    status_t getSortedEntry_l(uint32_t sortedIndex, const SampleTimeEntry **entry);
 
-    void buildSampleEntriesTable();
+    bool buildSampleEntriesTable_l();
 
     SampleTable(const SampleTable &);
     SampleTable &operator=(const SampleTable &);
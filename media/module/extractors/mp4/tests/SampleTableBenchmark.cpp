@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Opens and seeks synthetic sample tables of up to 10M samples, as found in
+// multi-hour recordings. The tables use an I P B B reordering pattern so the
+// ctts path is exercised.
+//
+// $ atest SampleTableBenchmark
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/MediaExtractorPluginHelper.h>
+#include <media/stagefright/foundation/ByteUtils.h>
+
+#include <SampleTable.h>
+
+namespace android {
+namespace {
+
+constexpr uint32_t kSampleDuration = 1000;     // in track timescale units
+constexpr uint32_t kSamplesPerChunk = 30;
+constexpr uint32_t kSyncSampleInterval = 32;
+
+// Serves the synthetic boxes from memory.
+class MemoryDataSource : public DataSourceHelper {
+  public:
+    explicit MemoryDataSource(std::vector<uint8_t> data)
+        : DataSourceHelper(static_cast<CDataSource *>(nullptr)), mData(std::move(data)) {}
+
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        if (offset < 0 || (size_t)offset >= mData.size()) {
+            return 0;
+        }
+        size = std::min(size, mData.size() - (size_t)offset);
+        memcpy(data, mData.data() + offset, size);
+        return size;
+    }
+
+    status_t getSize(off64_t *size) override {
+        *size = mData.size();
+        return OK;
+    }
+
+    uint32_t flags() override { return 0; }
+
+  private:
+    std::vector<uint8_t> mData;
+};
+
+struct SyntheticTrack {
+    std::unique_ptr<MemoryDataSource> mSource;
+    uint32_t mNumSamples;
+    off64_t mSttsOffset, mCttsOffset, mStszOffset, mStscOffset, mStcoOffset, mStssOffset;
+    size_t mSttsSize, mCttsSize, mStszSize, mStscSize, mStcoSize, mStssSize;
+};
+
+class BoxWriter {
+  public:
+    off64_t begin() {
+        mStart = mData.size();
+        put32(0);  // version and flags
+        return mStart;
+    }
+    size_t end() const { return mData.size() - mStart; }
+    void put32(uint32_t x) {
+        uint8_t b[4] = {uint8_t(x >> 24), uint8_t(x >> 16), uint8_t(x >> 8), uint8_t(x)};
+        mData.insert(mData.end(), b, b + 4);
+    }
+    std::vector<uint8_t> &data() { return mData; }
+
+  private:
+    std::vector<uint8_t> mData;
+    size_t mStart = 0;
+};
+
+SyntheticTrack makeTrack(uint32_t numSamples) {
+    SyntheticTrack track;
+    track.mNumSamples = numSamples;
+    BoxWriter w;
+
+    track.mSttsOffset = w.begin();
+    w.put32(1);
+    w.put32(numSamples);
+    w.put32(kSampleDuration);
+    track.mSttsSize = w.end();
+
+    // Decode order I P B B, presentation order I B B P.
+    static const uint32_t kPattern[] = {1, 3, 0, 0};
+    track.mCttsOffset = w.begin();
+    std::vector<std::pair<uint32_t, uint32_t>> runs;
+    for (uint32_t i = 0; i < numSamples; ++i) {
+        uint32_t offset = kPattern[i % 4] * kSampleDuration;
+        if (!runs.empty() && runs.back().second == offset) {
+            ++runs.back().first;
+        } else {
+            runs.emplace_back(1, offset);
+        }
+    }
+    w.put32(runs.size());
+    for (const auto &run : runs) {
+        w.put32(run.first);
+        w.put32(run.second);
+    }
+    track.mCttsSize = w.end();
+
+    std::mt19937 rng(numSamples);
+    track.mStszOffset = w.begin();
+    w.put32(0);  // no default size
+    w.put32(numSamples);
+    for (uint32_t i = 0; i < numSamples; ++i) {
+        w.put32(i % kSyncSampleInterval == 0 ? 60000 + rng() % 4096 : 4000 + rng() % 4096);
+    }
+    track.mStszSize = w.end();
+
+    track.mStscOffset = w.begin();
+    w.put32(1);
+    w.put32(1);  // first chunk
+    w.put32(kSamplesPerChunk);
+    w.put32(1);  // sample description index
+    track.mStscSize = w.end();
+
+    uint32_t numChunks = (numSamples + kSamplesPerChunk - 1) / kSamplesPerChunk;
+    track.mStcoOffset = w.begin();
+    w.put32(numChunks);
+    for (uint32_t i = 0; i < numChunks; ++i) {
+        w.put32(i * kSamplesPerChunk * 8192);
+    }
+    track.mStcoSize = w.end();
+
+    track.mStssOffset = w.begin();
+    w.put32((numSamples + kSyncSampleInterval - 1) / kSyncSampleInterval);
+    for (uint32_t i = 0; i < numSamples; i += kSyncSampleInterval) {
+        w.put32(i + 1);
+    }
+    track.mStssSize = w.end();
+
+    track.mSource = std::make_unique<MemoryDataSource>(std::move(w.data()));
+    return track;
+}
+
+// Mirrors what MPEG4Extractor does while parsing a 'stbl' box.
+sp<SampleTable> openTrack(const SyntheticTrack &track) {
+    sp<SampleTable> table = new SampleTable(track.mSource.get());
+    if (table->setTimeToSampleParams(track.mSttsOffset, track.mSttsSize) != OK ||
+        table->setCompositionTimeToSampleParams(track.mCttsOffset, track.mCttsSize) != OK ||
+        table->setSampleSizeParams(FOURCC("stsz"), track.mStszOffset, track.mStszSize) != OK ||
+        table->setSampleToChunkParams(track.mStscOffset, track.mStscSize) != OK ||
+        table->setChunkOffsetParams(FOURCC("stco"), track.mStcoOffset, track.mStcoSize) != OK ||
+        table->setSyncSampleParams(track.mStssOffset, track.mStssSize) != OK) {
+        return nullptr;
+    }
+    size_t maxSampleSize;
+    if (table->getMaxSampleSize(&maxSampleSize) != OK) {
+        return nullptr;
+    }
+    return table;
+}
+
+const SyntheticTrack &getTrack(uint32_t numSamples) {
+    static std::map<uint32_t, SyntheticTrack> tracks;
+    auto it = tracks.find(numSamples);
+    if (it == tracks.end()) {
+        it = tracks.emplace(numSamples, makeTrack(numSamples)).first;
+    }
+    return it->second;
+}
+
+void BM_SampleTableOpen(benchmark::State &state) {
+    const SyntheticTrack &track = getTrack(state.range(0));
+    for (auto _ : state) {
+        sp<SampleTable> table = openTrack(track);
+        if (table == nullptr) {
+            state.SkipWithError("failed to open sample table");
+            return;
+        }
+        // The first seek builds the presentation-order index.
+        uint32_t sampleIndex;
+        if (table->findSampleAtTime(0, 1, 1, &sampleIndex, SampleTable::kFlagClosest) != OK) {
+            state.SkipWithError("findSampleAtTime failed");
+            return;
+        }
+        benchmark::DoNotOptimize(sampleIndex);
+    }
+    state.counters["samples"] = track.mNumSamples;
+}
+
+void BM_SampleTableSeek(benchmark::State &state) {
+    const SyntheticTrack &track = getTrack(state.range(0));
+    sp<SampleTable> table = openTrack(track);
+    if (table == nullptr) {
+        state.SkipWithError("failed to open sample table");
+        return;
+    }
+    // Exclude building the presentation-order index from the seek timing.
+    uint32_t firstSample;
+    table->findSampleAtTime(0, 1, 1, &firstSample, SampleTable::kFlagClosest);
+
+    const uint64_t duration = (uint64_t)track.mNumSamples * kSampleDuration;
+    std::mt19937_64 rng(42);
+    static const uint32_t kFlags[] = {
+            SampleTable::kFlagBefore, SampleTable::kFlagAfter, SampleTable::kFlagClosest};
+    size_t n = 0;
+    for (auto _ : state) {
+        uint64_t seekTime = rng() % duration;
+        uint32_t sampleIndex, syncSampleIndex;
+        uint32_t flags = kFlags[n++ % 3];
+        if (table->findSampleAtTime(seekTime, 1, 1, &sampleIndex, flags) != OK ||
+            table->findSyncSampleNear(sampleIndex, &syncSampleIndex, SampleTable::kFlagBefore)
+                    != OK) {
+            state.SkipWithError("seek failed");
+            return;
+        }
+
+        off64_t offset;
+        size_t size;
+        uint64_t time;
+        bool isSync;
+        if (table->getMetaDataForSample(syncSampleIndex, &offset, &size, &time, &isSync) != OK
+                || !isSync) {
+            state.SkipWithError("getMetaDataForSample failed");
+            return;
+        }
+        benchmark::DoNotOptimize(offset);
+    }
+}
+
+BENCHMARK(BM_SampleTableOpen)->Arg(100000)->Arg(1000000)->Arg(10000000)
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SampleTableSeek)->Arg(100000)->Arg(1000000)->Arg(10000000);
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
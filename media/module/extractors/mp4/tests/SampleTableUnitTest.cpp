@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks the seeks of SampleTable, which sorts the samples in presentation order one segment
+// at a time, against a reference that sorts all the samples of synthetic tracks.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <media/MediaExtractorPluginHelper.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/foundation/ByteUtils.h>
+
+#include <SampleTable.h>
+
+namespace android {
+namespace {
+
+constexpr uint32_t kTimescale = 90000;
+constexpr uint32_t kSampleDuration = 3000;  // 30 fps
+constexpr uint32_t kSamplesPerChunk = 30;
+
+// Serves the synthetic boxes from memory.
+class MemoryDataSource : public DataSourceHelper {
+  public:
+    explicit MemoryDataSource(std::vector<uint8_t> data)
+        : DataSourceHelper(static_cast<CDataSource *>(nullptr)), mData(std::move(data)) {}
+
+    ssize_t readAt(off64_t offset, void *data, size_t size) override {
+        if (offset < 0 || (size_t)offset >= mData.size()) {
+            return 0;
+        }
+        size = std::min(size, mData.size() - (size_t)offset);
+        memcpy(data, mData.data() + offset, size);
+        return size;
+    }
+
+    status_t getSize(off64_t *size) override {
+        *size = mData.size();
+        return OK;
+    }
+
+    uint32_t flags() override { return 0; }
+
+  private:
+    std::vector<uint8_t> mData;
+};
+
+// The sample tables of a track, as runs of (sample count, value).
+struct TrackTables {
+    uint32_t mNumSamples = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> mTimeToSample;
+    // no ctts box if empty.
+    std::vector<std::pair<uint32_t, int32_t>> mCompositionOffsets;
+};
+
+// Appends to |tables| the ctts runs of |numSamples| samples repeating |pattern|, in units of
+// kSampleDuration.
+void addCompositionPattern(
+        TrackTables *tables, uint32_t numSamples, const std::vector<int32_t> &pattern) {
+    for (uint32_t i = 0; i < numSamples; ++i) {
+        const int32_t offset = pattern[i % pattern.size()] * (int32_t)kSampleDuration;
+        if (!tables->mCompositionOffsets.empty()
+                && tables->mCompositionOffsets.back().second == offset) {
+            ++tables->mCompositionOffsets.back().first;
+        } else {
+            tables->mCompositionOffsets.emplace_back(1, offset);
+        }
+    }
+}
+
+class BoxWriter {
+  public:
+    off64_t begin(uint8_t version = 0) {
+        mStart = mData.size();
+        put32((uint32_t)version << 24);  // version and flags
+        return mStart;
+    }
+    size_t end() const { return mData.size() - mStart; }
+    void put32(uint32_t x) {
+        uint8_t b[4] = {uint8_t(x >> 24), uint8_t(x >> 16), uint8_t(x >> 8), uint8_t(x)};
+        mData.insert(mData.end(), b, b + 4);
+    }
+    std::vector<uint8_t> &data() { return mData; }
+
+  private:
+    std::vector<uint8_t> mData;
+    size_t mStart = 0;
+};
+
+// A sample in presentation order.
+struct SortedSample {
+    uint64_t mTime;
+    uint32_t mIndex;
+};
+
+class SampleTableTest : public ::testing::Test {
+  protected:
+    // Opens |tables| the way MPEG4Extractor parses a 'stbl' box.
+    void open(const TrackTables &tables) {
+        BoxWriter w;
+
+        const off64_t sttsOffset = w.begin();
+        w.put32(tables.mTimeToSample.size());
+        for (const auto &run : tables.mTimeToSample) {
+            w.put32(run.first);
+            w.put32(run.second);
+        }
+        const size_t sttsSize = w.end();
+
+        off64_t cttsOffset = 0;
+        size_t cttsSize = 0;
+        if (!tables.mCompositionOffsets.empty()) {
+            const bool isSigned = std::any_of(
+                    tables.mCompositionOffsets.begin(), tables.mCompositionOffsets.end(),
+                    [](const auto &run) { return run.second < 0; });
+            cttsOffset = w.begin(isSigned ? 1 : 0);
+            w.put32(tables.mCompositionOffsets.size());
+            for (const auto &run : tables.mCompositionOffsets) {
+                w.put32(run.first);
+                w.put32((uint32_t)run.second);
+            }
+            cttsSize = w.end();
+        }
+
+        const off64_t stszOffset = w.begin();
+        w.put32(0);  // no default size
+        w.put32(tables.mNumSamples);
+        for (uint32_t i = 0; i < tables.mNumSamples; ++i) {
+            w.put32(1000 + i % 100);
+        }
+        const size_t stszSize = w.end();
+
+        const off64_t stscOffset = w.begin();
+        w.put32(1);
+        w.put32(1);  // first chunk
+        w.put32(kSamplesPerChunk);
+        w.put32(1);  // sample description index
+        const size_t stscSize = w.end();
+
+        const uint32_t numChunks = (tables.mNumSamples + kSamplesPerChunk - 1) / kSamplesPerChunk;
+        const off64_t stcoOffset = w.begin();
+        w.put32(numChunks);
+        for (uint32_t i = 0; i < numChunks; ++i) {
+            w.put32(i * kSamplesPerChunk * 1100);
+        }
+        const size_t stcoSize = w.end();
+
+        mSource = std::make_unique<MemoryDataSource>(std::move(w.data()));
+        mTable = new SampleTable(mSource.get());
+        ASSERT_EQ(mTable->setTimeToSampleParams(sttsOffset, sttsSize), OK);
+        if (cttsSize != 0) {
+            ASSERT_EQ(mTable->setCompositionTimeToSampleParams(cttsOffset, cttsSize), OK);
+        }
+        ASSERT_EQ(mTable->setSampleSizeParams(FOURCC("stsz"), stszOffset, stszSize), OK);
+        ASSERT_EQ(mTable->setSampleToChunkParams(stscOffset, stscSize), OK);
+        ASSERT_EQ(mTable->setChunkOffsetParams(FOURCC("stco"), stcoOffset, stcoSize), OK);
+        ASSERT_EQ(mTable->countSamples(), tables.mNumSamples);
+
+        sortSamples(tables);
+    }
+
+    // Sorts all the samples in presentation order. The samples beyond the stts runs are
+    // presented at 0.
+    void sortSamples(const TrackTables &tables) {
+        mSorted.clear();
+        uint64_t decodeTime = 0;
+        size_t sttsRun = 0, sttsCount = 0, cttsRun = 0, cttsCount = 0;
+        for (uint32_t i = 0; i < tables.mNumSamples; ++i) {
+            while (sttsRun < tables.mTimeToSample.size()
+                    && sttsCount == tables.mTimeToSample[sttsRun].first) {
+                ++sttsRun;
+                sttsCount = 0;
+            }
+            while (cttsRun < tables.mCompositionOffsets.size()
+                    && cttsCount == tables.mCompositionOffsets[cttsRun].first) {
+                ++cttsRun;
+                cttsCount = 0;
+            }
+            if (sttsRun == tables.mTimeToSample.size()) {
+                mSorted.push_back({0, i});
+                continue;
+            }
+            int64_t offset = 0;
+            if (cttsRun < tables.mCompositionOffsets.size()) {
+                offset = tables.mCompositionOffsets[cttsRun].second;
+                ++cttsCount;
+            }
+            ASSERT_GE((int64_t)decodeTime + offset, 0) << "sample " << i << " is before 0";
+            mSorted.push_back({decodeTime + offset, i});
+            decodeTime += tables.mTimeToSample[sttsRun].second;
+            ++sttsCount;
+        }
+        std::stable_sort(mSorted.begin(), mSorted.end(),
+                [](const SortedSample &a, const SortedSample &b) { return a.mTime < b.mTime; });
+    }
+
+    static uint64_t toUs(uint64_t time) {
+        return time * 1000000 / kTimescale;
+    }
+
+    // The samples that findSampleAtTime() may return for |timeUs| and |flags|, empty if the
+    // time is out of range.
+    std::vector<uint32_t> findReference(uint64_t timeUs, uint32_t flags) const {
+        if (flags == SampleTable::kFlagFrameIndex) {
+            if (timeUs >= mSorted.size()) {
+                return {};
+            }
+            return {mSorted[timeUs].mIndex};
+        }
+
+        // any of the samples presented at |timeUs|.
+        std::vector<uint32_t> exact;
+        for (const SortedSample &sample : mSorted) {
+            if (toUs(sample.mTime) == timeUs) {
+                exact.push_back(sample.mIndex);
+            }
+        }
+        if (!exact.empty()) {
+            return exact;
+        }
+
+        // the first sample presented after |timeUs|.
+        size_t after = 0;
+        while (after < mSorted.size() && toUs(mSorted[after].mTime) < timeUs) {
+            ++after;
+        }
+        size_t sorted;
+        if (after == mSorted.size()) {
+            if (flags == SampleTable::kFlagAfter) {
+                return {};
+            }
+            sorted = after - 1;
+        } else if (after == 0) {
+            sorted = 0;
+        } else if (flags == SampleTable::kFlagBefore) {
+            sorted = after - 1;
+        } else if (flags == SampleTable::kFlagAfter) {
+            sorted = after;
+        } else {
+            // the later sample wins a tie.
+            const uint64_t afterUs = toUs(mSorted[after].mTime);
+            const uint64_t beforeUs = toUs(mSorted[after - 1].mTime);
+            sorted = (afterUs - timeUs > timeUs - beforeUs) ? after - 1 : after;
+        }
+        return {mSorted[sorted].mIndex};
+    }
+
+    // Seeks to the times of the samples, around and between them, and beyond the last one,
+    // with each flag, in an order that goes back and forth over the track.
+    void checkSeeks() {
+        std::vector<std::pair<uint64_t, uint32_t>> seeks;
+        for (uint32_t flags : {SampleTable::kFlagBefore, SampleTable::kFlagAfter,
+                               SampleTable::kFlagClosest}) {
+            seeks.emplace_back(0, flags);
+            for (size_t i = 0; i < mSorted.size(); ++i) {
+                const uint64_t timeUs = toUs(mSorted[i].mTime);
+                seeks.emplace_back(timeUs, flags);
+                seeks.emplace_back(timeUs + 1, flags);
+                if (timeUs > 0) {
+                    seeks.emplace_back(timeUs - 1, flags);
+                }
+                if (i + 1 < mSorted.size()) {
+                    seeks.emplace_back((timeUs + toUs(mSorted[i + 1].mTime)) / 2, flags);
+                }
+            }
+            seeks.emplace_back(toUs(mSorted.back().mTime) + 1000000, flags);
+        }
+        for (uint64_t frame = 0; frame <= mSorted.size(); ++frame) {
+            seeks.emplace_back(frame, SampleTable::kFlagFrameIndex);
+        }
+        std::shuffle(seeks.begin(), seeks.end(), std::mt19937(mSorted.size()));
+
+        for (const auto &[timeUs, flags] : seeks) {
+            const std::vector<uint32_t> expected = findReference(timeUs, flags);
+            uint32_t sampleIndex;
+            const status_t err = mTable->findSampleAtTime(
+                    timeUs, 1000000, kTimescale, &sampleIndex, flags);
+            if (expected.empty()) {
+                EXPECT_EQ(err, ERROR_OUT_OF_RANGE) << "time " << timeUs << " flags " << flags;
+                continue;
+            }
+            ASSERT_EQ(err, OK) << "time " << timeUs << " flags " << flags;
+            EXPECT_NE(std::find(expected.begin(), expected.end(), sampleIndex), expected.end())
+                    << "time " << timeUs << " flags " << flags << " found " << sampleIndex
+                    << " expected " << expected.front();
+        }
+    }
+
+    std::unique_ptr<MemoryDataSource> mSource;
+    sp<SampleTable> mTable;
+    std::vector<SortedSample> mSorted;
+};
+
+TEST_F(SampleTableTest, NoCompositionOffsets) {
+    TrackTables tables;
+    tables.mNumSamples = 1000;
+    // a variable frame rate.
+    tables.mTimeToSample = {{300, kSampleDuration}, {400, kSampleDuration / 2},
+                            {300, kSampleDuration * 3}};
+    ASSERT_NO_FATAL_FAILURE(open(tables));
+    checkSeeks();
+}
+
+TEST_F(SampleTableTest, NegativeCompositionOffsets) {
+    TrackTables tables;
+    tables.mNumSamples = 2000;
+    tables.mTimeToSample = {{2000, kSampleDuration}};
+    // decode order I P B B, presentation order I B B P, with signed offsets.
+    addCompositionPattern(&tables, tables.mNumSamples, {0, 2, -1, -1});
+    ASSERT_NO_FATAL_FAILURE(open(tables));
+    checkSeeks();
+}
+
+TEST_F(SampleTableTest, ReorderingAcrossBlocks) {
+    TrackTables tables;
+    tables.mNumSamples = 2000;
+    tables.mTimeToSample = {{2000, kSampleDuration}};
+    // groups of 5 samples, which straddle the blocks of the sample index.
+    addCompositionPattern(&tables, tables.mNumSamples, {1, 4, 0, 0, 0});
+    ASSERT_NO_FATAL_FAILURE(open(tables));
+    checkSeeks();
+}
+
+TEST_F(SampleTableTest, OneReorderingSegment) {
+    TrackTables tables;
+    tables.mNumSamples = 1500;
+    tables.mTimeToSample = {{1500, kSampleDuration}};
+    // the samples are presented in the reverse of the decode order, so no block can start a
+    // segment of its own.
+    for (uint32_t i = 0; i < tables.mNumSamples; ++i) {
+        tables.mCompositionOffsets.emplace_back(
+                1, ((int32_t)tables.mNumSamples - 1 - 2 * (int32_t)i) * (int32_t)kSampleDuration);
+    }
+    ASSERT_NO_FATAL_FAILURE(open(tables));
+    checkSeeks();
+}
+
+TEST_F(SampleTableTest, SamplesBeyondTimeToSample) {
+    TrackTables tables;
+    tables.mNumSamples = 1200;
+    // the last 200 samples have no duration, and are presented at 0.
+    tables.mTimeToSample = {{1000, kSampleDuration}};
+    addCompositionPattern(&tables, 1000, {1, 3, 0, 0});
+    ASSERT_NO_FATAL_FAILURE(open(tables));
+    checkSeeks();
+}
+
+TEST_F(SampleTableTest, ExactAndBetweenSampleTimes) {
+    TrackTables tables;
+    tables.mNumSamples = 4;
+    tables.mTimeToSample = {{4, kSampleDuration}};
+    addCompositionPattern(&tables, tables.mNumSamples, {1, 3, 0, 0});
+    ASSERT_NO_FATAL_FAILURE(open(tables));
+
+    // presented at 1, 2, 3 and 4 frames: samples 0, 2, 3 and 1.
+    auto frameUs = [](uint64_t frames) { return toUs(frames * kSampleDuration); };
+    struct {
+        uint64_t timeUs;
+        uint32_t flags;
+        uint32_t sampleIndex;
+    } kSeeks[] = {
+        {frameUs(2), SampleTable::kFlagBefore, 2},
+        {frameUs(2), SampleTable::kFlagAfter, 2},
+        {frameUs(2), SampleTable::kFlagClosest, 2},
+        {frameUs(2) + 1, SampleTable::kFlagBefore, 2},
+        {frameUs(2) + 1, SampleTable::kFlagAfter, 3},
+        {frameUs(2) + 1, SampleTable::kFlagClosest, 2},
+        {frameUs(3) - 1, SampleTable::kFlagClosest, 3},
+        {0, SampleTable::kFlagBefore, 0},
+        {frameUs(10), SampleTable::kFlagBefore, 1},
+        {frameUs(10), SampleTable::kFlagClosest, 1},
+        {1, SampleTable::kFlagFrameIndex, 2},
+        {3, SampleTable::kFlagFrameIndex, 1},
+    };
+    for (const auto &seek : kSeeks) {
+        uint32_t sampleIndex;
+        ASSERT_EQ(mTable->findSampleAtTime(
+                seek.timeUs, 1000000, kTimescale, &sampleIndex, seek.flags), OK);
+        EXPECT_EQ(sampleIndex, seek.sampleIndex) << "time " << seek.timeUs
+                                                 << " flags " << seek.flags;
+    }
+    uint32_t sampleIndex;
+    EXPECT_EQ(mTable->findSampleAtTime(
+            frameUs(10), 1000000, kTimescale, &sampleIndex, SampleTable::kFlagAfter),
+            ERROR_OUT_OF_RANGE);
+    EXPECT_EQ(mTable->findSampleAtTime(
+            4, 1000000, kTimescale, &sampleIndex, SampleTable::kFlagFrameIndex),
+            ERROR_OUT_OF_RANGE);
+
+    checkSeeks();
+}
+
+}  // namespace
+}  // namespace android
@@ -14,51 +14,96 @@
  * limitations under the License.
  */
 
+//#define LOG_NDEBUG 0
+#define LOG_TAG "AAtomizer"
+#include <utils/Log.h>
+
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "AAtomizer.h"
 
 namespace android {
 
+struct AAtomizer::Atom {
+    Atom *mNext;
+    uint32_t mHash;
+    size_t mLength;
+    char mName[];
+};
+
 // static
 AAtomizer AAtomizer::gAtomizer;
 
 // static
 const char *AAtomizer::Atomize(const char *name) {
-    return gAtomizer.atomize(name);
+    return gAtomizer.atomize(name, strlen(name), false /* bounded */);
 }
 
-AAtomizer::AAtomizer() {
-    for (size_t i = 0; i < 128; ++i) {
-        mAtoms.push(List<AString>());
+// static
+const char *AAtomizer::TryAtomize(const char *name, size_t length) {
+    return gAtomizer.atomize(name, length, true /* bounded */);
+}
+
+AAtomizer::AAtomizer()
+    : mNumAtoms(0),
+      mAtomBytes(0) {
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+        mBuckets[i].store(NULL, std::memory_order_relaxed);
     }
 }
 
-const char *AAtomizer::atomize(const char *name) {
+const char *AAtomizer::atomize(const char *name, size_t length, bool bounded) {
+    const uint32_t hash = Hash(name, length);
+    std::atomic<Atom *> &bucket = mBuckets[hash % kNumBuckets];
+
+    for (Atom *atom = bucket.load(std::memory_order_acquire);
+            atom != NULL; atom = atom->mNext) {
+        if (atom->mHash == hash && atom->mLength == length
+                && !memcmp(atom->mName, name, length)) {
+            return atom->mName;
+        }
+    }
+
     Mutex::Autolock autoLock(mLock);
 
-    const size_t n = mAtoms.size();
-    size_t index = AAtomizer::Hash(name) % n;
-    List<AString> &entry = mAtoms.editItemAt(index);
-    List<AString>::iterator it = entry.begin();
-    while (it != entry.end()) {
-        if ((*it) == name) {
-            return (*it).c_str();
+    // Another thread may have added the same name in the meantime.
+    Atom *head = bucket.load(std::memory_order_relaxed);
+    for (Atom *atom = head; atom != NULL; atom = atom->mNext) {
+        if (atom->mHash == hash && atom->mLength == length
+                && !memcmp(atom->mName, name, length)) {
+            return atom->mName;
         }
-        ++it;
     }
 
-    entry.push_back(AString(name));
+    if (bounded && (mNumAtoms >= kMaxNumAtoms || mAtomBytes + length > kMaxAtomBytes)) {
+        return NULL;
+    }
+
+    Atom *atom = (Atom *)malloc(sizeof(Atom) + length + 1);
+    if (atom == NULL) {
+        ALOGE("Unable to allocate atom of %zu bytes", length);
+        return NULL;
+    }
+    atom->mNext = head;
+    atom->mHash = hash;
+    atom->mLength = length;
+    memcpy(atom->mName, name, length);
+    atom->mName[length] = '\0';
+    ++mNumAtoms;
+    mAtomBytes += length;
+
+    bucket.store(atom, std::memory_order_release);
 
-    return (*--entry.end()).c_str();
+    return atom->mName;
 }
 
 // static
-uint32_t AAtomizer::Hash(const char *s) {
+uint32_t AAtomizer::Hash(const char *s, size_t length) {
     uint32_t sum = 0;
-    while (*s != '\0') {
-        sum = (sum * 31) + *s;
-        ++s;
+    for (size_t i = 0; i < length; ++i) {
+        sum = (sum * 31) + s[i];
     }
 
     return sum;
@@ -19,6 +19,9 @@
 //#define DUMP_STATS
 
 #include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "AMessage.h"
 
@@ -52,6 +55,53 @@ status_t AReplyToken::setReply(const sp<AMessage> &reply) {
     return OK;
 }
 
+struct AMessage::StringValue : public LightRefBase<StringValue> {
+    StringValue(const char *s, size_t size) : mValue(s, size) { }
+
+    const AString mValue;
+};
+
+AMessage::ItemVector::ItemVector()
+    : mItems(mInlineItems),
+      mSize(0),
+      mCapacity(kNumInlineItems) {
+}
+
+AMessage::ItemVector::~ItemVector() {
+    if (mItems != mInlineItems) {
+        delete[] mItems;
+    }
+}
+
+AMessage::Item *AMessage::ItemVector::append() {
+    if (mSize == mCapacity) {
+        reserve(mCapacity * 2);
+    }
+    mItems[mSize] = Item();
+    return &mItems[mSize++];
+}
+
+void AMessage::ItemVector::resize(size_t size) {
+    reserve(size);
+    for (size_t i = mSize; i < size; ++i) {
+        mItems[i] = Item();
+    }
+    mSize = size;
+}
+
+void AMessage::ItemVector::reserve(size_t capacity) {
+    if (capacity <= mCapacity) {
+        return;
+    }
+    Item *items = new Item[capacity];
+    std::copy(mItems, mItems + mSize, items);
+    if (mItems != mInlineItems) {
+        delete[] mItems;
+    }
+    mItems = items;
+    mCapacity = capacity;
+}
+
 AMessage::AMessage(void)
     : mWhat(0),
       mTarget(0) {
@@ -89,8 +139,7 @@ void AMessage::setTarget(const sp<const AHandler> &handler) {
 void AMessage::clear() {
     // Item needs to be handled delicately
     for (Item &item : mItems) {
-        delete[] item.mName;
-        item.mName = NULL;
+        item.freeName();
         freeItemValue(&item);
     }
     mItems.clear();
@@ -100,7 +149,7 @@ void AMessage::freeItemValue(Item *item) {
     switch (item->mType) {
         case kTypeString:
         {
-            delete item->u.stringValue;
+            item->u.stringValue->decStrong(this);
             break;
         }
 
@@ -156,6 +205,11 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
 #endif
     size_t i = 0;
     for (; i < mItems.size(); i++) {
+        // Callers passing back a name obtained from this message, or the
+        // atom for it, match without touching the characters.
+        if (mItems[i].mName == name) {
+            break;
+        }
         if (len != mItems[i].mNameLength) {
             continue;
         }
@@ -179,17 +233,33 @@ inline size_t AMessage::findItemIndex(const char *name, size_t len) const {
     return i;
 }
 
+AMessage::Item::Item()
+    : mName(nullptr),
+      mNameLength(0),
+      mNameIsAtom(false),
+      mType(kTypeInt32) {
+    memset(&u, 0, sizeof(u));
+}
+
 // assumes item's name was uninitialized or NULL
 void AMessage::Item::setName(const char *name, size_t len) {
     mNameLength = len;
-    mName = new char[len + 1];
-    memcpy((void*)mName, name, len + 1);
+    mName = AAtomizer::TryAtomize(name, len);
+    mNameIsAtom = mName != nullptr;
+    if (!mNameIsAtom) {
+        // The atom table is full or out of memory, keep a private copy.
+        char *copy = new char[len + 1];
+        memcpy(copy, name, len + 1);
+        mName = copy;
+    }
 }
 
-AMessage::Item::Item(const char *name, size_t len)
-    : mType(kTypeInt32) {
-    // mName and mNameLength are initialized by setName
-    setName(name, len);
+void AMessage::Item::freeName() {
+    if (!mNameIsAtom) {
+        delete[] mName;
+    }
+    mName = nullptr;
+    mNameIsAtom = false;
 }
 
 AMessage::Item *AMessage::allocateItem(const char *name) {
@@ -202,10 +272,9 @@ AMessage::Item *AMessage::allocateItem(const char *name) {
         freeItemValue(item);
     } else {
         CHECK(mItems.size() < kMaxNumItems);
-        i = mItems.size();
         // place a 'blank' item at the end - this is of type kTypeInt32
-        mItems.emplace_back(name, len);
-        item = &mItems[i];
+        item = mItems.append();
+        item->setName(name, len);
     }
 
     return item;
@@ -305,7 +374,8 @@ void AMessage::setString(
     Item *item = allocateItem(name);
     if (item) {
         item->mType = kTypeString;
-        item->u.stringValue = new AString(s, len < 0 ? strlen(s) : len);
+        item->u.stringValue = new StringValue(s, len < 0 ? strlen(s) : len);
+        item->u.stringValue->incStrong(this);
     }
 }
 
@@ -360,7 +430,7 @@ void AMessage::setRect(
 bool AMessage::findString(const char *name, AString *value) const {
     const Item *item = findItem(name, kTypeString);
     if (item) {
-        *value = *item->u.stringValue;
+        *value = item->u.stringValue->mValue;
         return true;
     }
     return false;
@@ -490,7 +560,7 @@ bool AMessage::senderAwaitsResponse(sp<AReplyToken> *replyToken) {
 
 sp<AMessage> AMessage::dup() const {
     sp<AMessage> msg = new AMessage(mWhat, mHandler.promote());
-    msg->mItems = mItems;
+    msg->mItems.resize(mItems.size());
 
 #ifdef DUMP_STATS
     {
@@ -505,14 +575,20 @@ sp<AMessage> AMessage::dup() const {
         const Item *from = &mItems[i];
         Item *to = &msg->mItems[i];
 
-        to->setName(from->mName, from->mNameLength);
+        if (from->mNameIsAtom) {
+            to->mName = from->mName;
+            to->mNameLength = from->mNameLength;
+            to->mNameIsAtom = true;
+        } else {
+            to->setName(from->mName, from->mNameLength);
+        }
         to->mType = from->mType;
 
         switch (from->mType) {
             case kTypeString:
             {
-                to->u.stringValue =
-                    new AString(*from->u.stringValue);
+                to->u.stringValue = from->u.stringValue;
+                to->u.stringValue->incStrong(msg.get());
                 break;
             }
 
@@ -520,12 +596,18 @@ sp<AMessage> AMessage::dup() const {
             case kTypeBuffer:
             {
                 to->u.refValue = from->u.refValue;
-                to->u.refValue->incStrong(msg.get());
+                if (to->u.refValue != NULL) {
+                    to->u.refValue->incStrong(msg.get());
+                }
                 break;
             }
 
             case kTypeMessage:
             {
+                if (from->u.refValue == NULL) {
+                    to->u.refValue = NULL;
+                    break;
+                }
                 sp<AMessage> copy =
                     static_cast<AMessage *>(from->u.refValue)->dup();
 
@@ -616,7 +698,7 @@ AString AMessage::debugString(int32_t indent) const {
                 tmp = AStringPrintf(
                         "string %s = \"%s\"",
                         item.mName,
-                        item.u.stringValue->c_str());
+                        item.u.stringValue->mValue.c_str());
                 break;
             case kTypeObject:
                 tmp = AStringPrintf(
@@ -738,7 +820,8 @@ sp<AMessage> AMessage::FromParcel(const Parcel &parcel, size_t maxNestingLevel)
                     continue;
                     // The loop will terminate subsequently.
                 } else {
-                    item->u.stringValue = new AString(stringValue);
+                    item->u.stringValue = new StringValue(stringValue, strlen(stringValue));
+                    item->u.stringValue->incStrong(msg.get());
                 }
                 break;
             }
@@ -818,7 +901,7 @@ void AMessage::writeToParcel(Parcel *parcel) const {
 
             case kTypeString:
             {
-                parcel->writeCString(item.u.stringValue->c_str());
+                parcel->writeCString(item.u.stringValue->mValue.c_str());
                 break;
             }
 
@@ -885,8 +968,9 @@ sp<AMessage> AMessage::changesFrom(const sp<const AMessage> &other, bool deep) c
                 break;
 
             case kTypeString:
-                if (oitem == NULL || *item.u.stringValue != *oitem->u.stringValue) {
-                    diff->setString(item.mName, *item.u.stringValue);
+                if (oitem == NULL
+                        || item.u.stringValue->mValue != oitem->u.stringValue->mValue) {
+                    diff->setString(item.mName, item.u.stringValue->mValue);
                 }
                 break;
 
@@ -989,7 +1073,7 @@ AMessage::ItemData AMessage::getEntryAt(size_t index) const {
             case kTypeDouble:   it.set(mItems[index].u.doubleValue); break;
             case kTypePointer:  it.set(mItems[index].u.ptrValue); break;
             case kTypeRect:     it.set(mItems[index].u.rectValue); break;
-            case kTypeString:   it.set(*mItems[index].u.stringValue); break;
+            case kTypeString:   it.set(mItems[index].u.stringValue->mValue); break;
             case kTypeObject: {
                 sp<RefBase> obj = mItems[index].u.refValue;
                 it.set(obj);
@@ -1026,8 +1110,7 @@ status_t AMessage::setEntryNameAt(size_t index, const char *name) {
     if (findItemIndex(name, len) < mItems.size()) {
         return ALREADY_EXISTS;
     }
-    delete[] mItems[index].mName;
-    mItems[index].mName = nullptr;
+    mItems[index].freeName();
     mItems[index].setName(name, len);
     return OK;
 }
@@ -1063,7 +1146,8 @@ status_t AMessage::setEntryAt(size_t index, const ItemData &item) {
     } else if (item.find(&dst->u.rectValue)) {
         dst->mType = kTypeRect;
     } else if (item.find(&stringValue)) {
-        dst->u.stringValue = new AString(stringValue);
+        dst->u.stringValue = new StringValue(stringValue.c_str(), stringValue.size());
+        dst->u.stringValue->incStrong(this);
         dst->mType = kTypeString;
     } else if (item.find(&refValue)) {
         if (refValue != NULL) { refValue->incStrong(this); }
@@ -1091,16 +1175,13 @@ status_t AMessage::removeEntryAt(size_t index) {
         return BAD_INDEX;
     }
     // delete entry data and objects
-    delete[] mItems[index].mName;
-    mItems[index].mName = nullptr;
+    mItems[index].freeName();
     freeItemValue(&mItems[index]);
 
-    // swap entry with last entry and clear last entry's data
+    // move the last entry into its place, items own nothing themselves
     size_t lastIndex = mItems.size() - 1;
     if (index < lastIndex) {
         mItems[index] = mItems[lastIndex];
-        mItems[lastIndex].mName = nullptr;
-        mItems[lastIndex].mType = kTypeInt32;
     }
     mItems.pop_back();
     return OK;
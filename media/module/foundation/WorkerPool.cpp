@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "WorkerPool"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <utils/Log.h>
+
+#include "WorkerPool.h"
+
+namespace android {
+
+struct WorkerPool::Pool {
+    // The pool of the process, which starts its workers on first use.
+    static Pool &Get() {
+        // never destroyed, so that the workers can outlive the static destructors.
+        static Pool *sPool = new Pool;
+        return *sPool;
+    }
+
+    void queue(Group *group, std::function<void()> &&task) {
+        std::call_once(mStarted, [this] { start(); });
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mTasks.push_back({group, std::move(task)});
+            ++group->mPending;
+        }
+        mWorkCond.notify_one();
+    }
+
+    void wait(Group *group) {
+        std::unique_lock<std::mutex> lock(mLock);
+        while (group->mPending != 0) {
+            auto it = std::find_if(mTasks.begin(), mTasks.end(),
+                    [group](const Task &task) { return task.group == group; });
+            if (it == mTasks.end()) {
+                // the remaining tasks are running on the workers.
+                group->mDoneCond.wait(lock);
+                continue;
+            }
+            std::function<void()> fn = std::move(it->fn);
+            mTasks.erase(it);
+            run(lock, group, fn);
+        }
+    }
+
+private:
+    struct Task {
+        Group *group;
+        std::function<void()> fn;
+    };
+
+    Pool() = default;
+
+    void start() {
+        const size_t numWorkers = GetConcurrency() - 1;
+        for (size_t i = 0; i < numWorkers; ++i) {
+            std::thread([this] { loop(); }).detach();
+        }
+        ALOGV("started %zu workers", numWorkers);
+    }
+
+    void loop() {
+        pthread_setname_np(pthread_self(), "MediaWorker");
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mWorkCond.wait(lock, [this] { return !mTasks.empty(); });
+            Task task = std::move(mTasks.front());
+            mTasks.pop_front();
+            run(lock, task.group, task.fn);
+        }
+    }
+
+    // Runs |fn| of |group| with |lock| released.
+    static void run(std::unique_lock<std::mutex> &lock, Group *group,
+                    const std::function<void()> &fn) {
+        lock.unlock();
+        fn();
+        lock.lock();
+        if (--group->mPending == 0) {
+            group->mDoneCond.notify_all();
+        }
+    }
+
+    std::once_flag mStarted;
+    std::mutex mLock;
+    std::condition_variable mWorkCond;
+    std::deque<Task> mTasks;
+
+    DISALLOW_EVIL_CONSTRUCTORS(Pool);
+};
+
+// static
+size_t WorkerPool::GetConcurrency() {
+    static const size_t sConcurrency =
+            std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxConcurrency);
+    return sConcurrency;
+}
+
+// static
+void WorkerPool::Run(size_t count, const std::function<void(size_t)> &fn) {
+    if (count == 0) {
+        return;
+    }
+    Group group;
+    for (size_t i = 1; i < count; ++i) {
+        group.queue([&fn, i] { fn(i); });
+    }
+    fn(0);
+    group.wait();
+}
+
+WorkerPool::Group::Group()
+    : mPending(0) {
+}
+
+WorkerPool::Group::~Group() {
+    wait();
+}
+
+void WorkerPool::Group::queue(std::function<void()> &&task) {
+    Pool::Get().queue(this, std::move(task));
+}
+
+void WorkerPool::Group::wait() {
+    Pool::Get().wait(this);
+}
+
+}  // namespace android
@@ -28,6 +28,12 @@
 #include <media/stagefright/MetaData.h>
 #include <utils/misc.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace android {
 
 unsigned parseUE(ABitReader *br) {
@@ -288,6 +294,45 @@ void FindAVCDimensions(
     }
 }
 
+size_t FindStartCode(const uint8_t *data, size_t size) {
+    size_t offset = 0;
+#if defined(__SSE2__) || defined(__aarch64__)
+    // Compare 16 candidate positions at a time, the last block also loading the 2 bytes that
+    // follow it.
+    for (; offset + 18 <= size; offset += 16) {
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i b0 = _mm_loadu_si128((const __m128i *)(data + offset));
+        const __m128i b1 = _mm_loadu_si128((const __m128i *)(data + offset + 1));
+        const __m128i b2 = _mm_loadu_si128((const __m128i *)(data + offset + 2));
+        const __m128i match = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero)),
+                _mm_cmpeq_epi8(b2, _mm_set1_epi8(1)));
+        const int mask = _mm_movemask_epi8(match);
+        if (mask != 0) {
+            return offset + __builtin_ctz(mask);
+        }
+#else
+        const uint8x16_t b0 = vld1q_u8(data + offset);
+        const uint8x16_t b1 = vld1q_u8(data + offset + 1);
+        const uint8x16_t b2 = vld1q_u8(data + offset + 2);
+        const uint8x16_t match = vandq_u8(
+                vandq_u8(vceqzq_u8(b0), vceqzq_u8(b1)), vceqq_u8(b2, vdupq_n_u8(1)));
+        if (vmaxvq_u8(match) != 0) {
+            break;  // the scalar loop locates the start code within this block
+        }
+#endif
+    }
+#endif
+    for (; offset + 2 < size; ++offset) {
+        if (data[offset + 2] == 0x01 && data[offset] == 0x00
+                && data[offset + 1] == 0x00) {
+            return offset;
+        }
+    }
+    return size;
+}
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
@@ -302,17 +347,10 @@ status_t getNextNALUnit(
         return -EAGAIN;
     }
 
-    size_t offset = 0;
-
     // A valid startcode consists of at least two 0x00 bytes followed by 0x01.
-    for (; offset + 2 < size; ++offset) {
-        if (data[offset + 2] == 0x01 && data[offset] == 0x00
-                && data[offset + 1] == 0x00) {
-            break;
-        }
-    }
-    if (offset + 2 >= size) {
-        *_data = &data[offset];
+    size_t offset = FindStartCode(data, size);
+    if (offset == size) {
+        *_data = &data[size - 2];
         *_size = 2;
         return -EAGAIN;
     }
@@ -320,26 +358,12 @@ status_t getNextNALUnit(
 
     size_t startOffset = offset;
 
-    for (;;) {
-        while (offset < size && data[offset] != 0x01) {
-            ++offset;
-        }
-
-        if (offset == size) {
-            if (startCodeFollows) {
-                offset = size + 2;
-                break;
-            }
-
-            return -EAGAIN;
-        }
-
-        if (data[offset - 1] == 0x00 && data[offset - 2] == 0x00) {
-            break;
-        }
-
-        ++offset;
+    // The NAL unit ends at the next startcode, |offset| is left on its 0x01.
+    offset += FindStartCode(&data[offset], size - offset);
+    if (offset == size && !startCodeFollows) {
+        return -EAGAIN;
     }
+    offset += 2;
 
     size_t endOffset = offset - 2;
     while (endOffset > startOffset + 1 && data[endOffset - 1] == 0x00) {
@@ -20,28 +20,48 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
 #include <media/stagefright/foundation/ABase.h>
-#include <media/stagefright/foundation/AString.h>
-#include <utils/List.h>
-#include <utils/Vector.h>
 #include <utils/threads.h>
 
 namespace android {
 
+// Interns strings, so that equal strings can be compared by address.
+// Atoms are never freed.
 struct AAtomizer {
     static const char *Atomize(const char *name);
 
+    // Same as Atomize(), but returns NULL instead of adding a new atom once
+    // the table has grown to kMaxNumAtoms atoms or kMaxAtomBytes bytes, so
+    // names from untrusted sources can't grow it without bound. Both return
+    // NULL if the new atom cannot be allocated.
+    // |name| must be NUL terminated at |length|.
+    static const char *TryAtomize(const char *name, size_t length);
+
 private:
+    struct Atom;
+
+    enum {
+        kNumBuckets = 512,
+        kMaxNumAtoms = 4096,
+        kMaxAtomBytes = 256 * 1024,
+    };
+
     static AAtomizer gAtomizer;
 
+    // Lookups don't take mLock, new atoms are only ever pushed to the front
+    // of their bucket.
     Mutex mLock;
-    Vector<List<AString> > mAtoms;
+    std::atomic<Atom *> mBuckets[kNumBuckets];
+    size_t mNumAtoms;
+    size_t mAtomBytes;
 
     AAtomizer();
 
-    const char *atomize(const char *name);
+    const char *atomize(const char *name, size_t length, bool bounded);
 
-    static uint32_t Hash(const char *s);
+    static uint32_t Hash(const char *s, size_t length);
 
     DISALLOW_EVIL_CONSTRUCTORS(AAtomizer);
 };
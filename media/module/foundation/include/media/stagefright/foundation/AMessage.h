@@ -295,6 +295,9 @@ private:
     wp<AHandler> mHandler;
     wp<ALooper> mLooper;
 
+    // Immutable, so that dup() can share it.
+    struct StringValue;
+
     struct Item {
         union {
             int32_t int32Value;
@@ -304,21 +307,59 @@ private:
             double doubleValue;
             void *ptrValue;
             RefBase *refValue;
-            AString *stringValue;
+            StringValue *stringValue;
             Rect rectValue;
         } u;
+        // Interned through AAtomizer when possible, so that lookups with the
+        // same key mostly end at a pointer comparison.
         const char *mName;
         size_t      mNameLength;
+        bool        mNameIsAtom;
         Type mType;
         void setName(const char *name, size_t len);
-        Item() : mName(nullptr), mNameLength(0), mType(kTypeInt32) { }
-        Item(const char *name, size_t length);
+        void freeName();
+        Item();
     };
 
     enum {
-        kMaxNumItems = 256
+        kMaxNumItems = 256,
+        kNumInlineItems = 8,
+    };
+
+    // Keeps the first kNumInlineItems items inside the message, so that a
+    // typical message takes a single allocation. Items are plain data, their
+    // names and values are managed by AMessage.
+    class ItemVector {
+    public:
+        ItemVector();
+        ~ItemVector();
+
+        size_t size() const { return mSize; }
+        Item &operator[](size_t i) { return mItems[i]; }
+        const Item &operator[](size_t i) const { return mItems[i]; }
+        Item *begin() { return mItems; }
+        Item *end() { return mItems + mSize; }
+        const Item *begin() const { return mItems; }
+        const Item *end() const { return mItems + mSize; }
+
+        // Adds a blank item at the end and returns it.
+        Item *append();
+        void pop_back() { --mSize; }
+        // Drops items from the end or appends blank items.
+        void resize(size_t size);
+        void clear() { mSize = 0; }
+
+    private:
+        Item *mItems;
+        size_t mSize;
+        size_t mCapacity;
+        Item mInlineItems[kNumInlineItems];
+
+        void reserve(size_t capacity);
+
+        DISALLOW_EVIL_CONSTRUCTORS(ItemVector);
     };
-    std::vector<Item> mItems;
+    ItemVector mItems;
 
     /**
      * Allocates an item with the given key |name|. If the key already exists, the corresponding
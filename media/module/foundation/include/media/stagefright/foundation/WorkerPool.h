@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WORKER_POOL_H_
+
+#define WORKER_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <stddef.h>
+
+#include <media/stagefright/foundation/ABase.h>
+
+namespace android {
+
+// A pool of worker threads shared by the whole process, to spread the CPU bound work of a single
+// caller, such as the conversion of a large frame, over a few cores. The threads are created the
+// first time that work is queued and live as long as the process.
+//
+// The caller always takes part in the work: waiting for its tasks runs those that no worker has
+// picked up yet, so that tasks can queue and wait for tasks of their own without deadlocking
+// the pool.
+struct WorkerPool {
+    // The most cores that the work of a single caller is spread over, the caller included.
+    static constexpr size_t kMaxConcurrency = 4;
+
+    // The number of cores that the work of a single caller is spread over on this device, the
+    // caller included: work is best split into this many parts.
+    static size_t GetConcurrency();
+
+    // Runs |fn(0)| to |fn(count - 1)| on the workers and the calling thread, and returns once
+    // they all ran.
+    static void Run(size_t count, const std::function<void(size_t)> &fn);
+
+    // Tasks that a caller queues to the pool and waits for together. A group must not be used
+    // from more than one thread at a time.
+    struct Group {
+        Group();
+
+        // Waits for the queued tasks.
+        ~Group();
+
+        void queue(std::function<void()> &&task);
+
+        // Waits for the queued tasks to run, running those that no worker picked up yet.
+        void wait();
+
+    private:
+        friend struct WorkerPool;
+
+        // the tasks queued and not run yet, guarded by the lock of the pool.
+        size_t mPending;
+        std::condition_variable mDoneCond;
+
+        DISALLOW_EVIL_CONSTRUCTORS(Group);
+    };
+
+private:
+    struct Pool;
+};
+
+}  // namespace android
+
+#endif  // WORKER_POOL_H_
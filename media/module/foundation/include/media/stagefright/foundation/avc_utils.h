@@ -75,6 +75,10 @@ inline void skipSE(ABitReader *br) {
     (void)parseSEWithFallback(br, 0);
 }
 
+// Returns the offset of the first 0x00 0x00 0x01 start code in |data|, or |size| if there is
+// none. Scans 16 bytes at a time where SIMD is available.
+size_t FindStartCode(const uint8_t *data, size_t size);
+
 status_t getNextNALUnit(
         const uint8_t **_data, size_t *_size,
         const uint8_t **nalStart, size_t *nalSize,
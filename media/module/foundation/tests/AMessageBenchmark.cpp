@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Posts messages shaped like the buffer notifications of MediaCodec through
+// an ALooper and looks their items up in the handler, counting the heap
+// allocations made per message.
+//
+// $ atest AMessageBenchmark
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+
+#include <benchmark/benchmark.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/AHandler.h>
+#include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AMessage.h>
+
+namespace {
+
+std::atomic<size_t> gNumAllocations{0};
+
+}  // namespace
+
+void *operator new(size_t size) {
+    gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+namespace android {
+namespace {
+
+constexpr size_t kMessagesPerBatch = 64;
+
+// Names as used by MediaCodec and ACodec.
+const char *const kExtraNames[] = {
+    "buffer-id", "offset", "size", "flags", "csd", "eos", "err", "generation",
+    "index", "portIndex", "rangeOffset", "rangeLength", "skip", "frameIndex",
+};
+
+struct RoundTripHandler : public AHandler {
+    void expect(size_t count) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mPending = count;
+    }
+
+    void waitForAll() {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCondition.wait(lock, [this] { return mPending == 0; });
+    }
+
+protected:
+    void onMessageReceived(const sp<AMessage> &msg) override {
+        int64_t timeUs;
+        int32_t value;
+        sp<ABuffer> buffer;
+        sp<RefBase> obj;
+        bool ok = msg->findInt64("timeUs", &timeUs)
+                && msg->findBuffer("buffer", &buffer)
+                && msg->findObject("replyID", &obj);
+        for (size_t i = 0; i < mNumExtraItems; ++i) {
+            ok = ok && msg->findInt32(kExtraNames[i], &value);
+        }
+        benchmark::DoNotOptimize(ok);
+
+        std::lock_guard<std::mutex> lock(mLock);
+        if (--mPending == 0) {
+            mCondition.notify_one();
+        }
+    }
+
+public:
+    size_t mNumExtraItems = 0;
+
+private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    size_t mPending = 0;
+};
+
+// Argument: number of int32 items besides timeUs, buffer and replyID.
+void BM_PostDeliverFind(benchmark::State &state) {
+    sp<ALooper> looper = new ALooper;
+    sp<RoundTripHandler> handler = new RoundTripHandler;
+    handler->mNumExtraItems = state.range(0);
+    looper->registerHandler(handler);
+    looper->start();
+
+    sp<ABuffer> buffer = new ABuffer(1024);
+    sp<RefBase> token = new ABuffer(0);
+
+    size_t numAllocations = 0;
+    for (auto _ : state) {
+        handler->expect(kMessagesPerBatch);
+        size_t before = gNumAllocations.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kMessagesPerBatch; ++i) {
+            sp<AMessage> msg = new AMessage('rndt', handler);
+            msg->setInt64("timeUs", i * 33333);
+            msg->setBuffer("buffer", buffer);
+            msg->setObject("replyID", token);
+            for (size_t j = 0; j < handler->mNumExtraItems; ++j) {
+                msg->setInt32(kExtraNames[j], j);
+            }
+            msg->post();
+        }
+        handler->waitForAll();
+        numAllocations += gNumAllocations.load(std::memory_order_relaxed) - before;
+    }
+
+    looper->stop();
+    looper->unregisterHandler(handler->id());
+
+    state.SetItemsProcessed(state.iterations() * kMessagesPerBatch);
+    state.counters["allocs_per_msg"] =
+            (double)numAllocations / (state.iterations() * kMessagesPerBatch);
+}
+
+// Argument: number of int32 items besides a string and a buffer.
+void BM_Dup(benchmark::State &state) {
+    sp<AMessage> msg = new AMessage;
+    msg->setString("mime", "video/avc");
+    msg->setBuffer("csd-0", new ABuffer(32));
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        msg->setInt32(kExtraNames[i], i);
+    }
+
+    size_t before = gNumAllocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        sp<AMessage> copy = msg->dup();
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.counters["allocs_per_dup"] = benchmark::Counter(
+            gNumAllocations.load(std::memory_order_relaxed) - before,
+            benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_PostDeliverFind)->Arg(0)->Arg(5)->Arg(14)->UseRealTime();
+BENCHMARK(BM_Dup)->Arg(0)->Arg(5)->Arg(14);
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -24,6 +24,7 @@
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/AHandler.h>
 #include <media/stagefright/foundation/ALooper.h>
+#include <media/stagefright/foundation/AString.h>
 
 using namespace android;
 
@@ -169,6 +170,57 @@ TEST(AMessage_tests, settersAndGetters) {
   EXPECT_NE(OK, m1->removeEntryByName("notpresent"));
 }
 
+TEST(AMessage_tests, dupIsIndependentOfOriginal) {
+  sp<AMessage> m1 = new AMessage();
+  sp<AMessage> nested = new AMessage();
+  nested->setString("inner", "nested");
+
+  // more items than are kept inline
+  for (int i = 0; i < 40; ++i) {
+    AString name = AStringPrintf("key-%d", i);
+    if (i % 2) {
+      m1->setInt32(name.c_str(), i);
+    } else {
+      m1->setString(name.c_str(), AStringPrintf("value-%d", i));
+    }
+  }
+  m1->setMessage("nested", nested);
+  m1->setObject("null", nullptr);
+
+  sp<AMessage> m2 = m1->dup();
+  EXPECT_EQ(m1->countEntries(), m2->countEntries());
+
+  m1->setString("key-0", "changed");
+  m1->setInt32("key-1", -1);
+  nested->setString("inner", "changed");
+  EXPECT_EQ(OK, m1->removeEntryByName("key-2"));
+
+  AString s;
+  int32_t i32;
+  EXPECT_TRUE(m2->findString("key-0", &s));
+  EXPECT_STREQ("value-0", s.c_str());
+  EXPECT_TRUE(m2->findString("key-2", &s));
+  EXPECT_STREQ("value-2", s.c_str());
+  EXPECT_TRUE(m2->findInt32("key-1", &i32));
+  EXPECT_EQ(1, i32);
+  EXPECT_TRUE(m2->findInt32("key-39", &i32));
+  EXPECT_EQ(39, i32);
+
+  sp<AMessage> dupNested;
+  EXPECT_TRUE(m2->findMessage("nested", &dupNested));
+  EXPECT_TRUE(dupNested->findString("inner", &s));
+  EXPECT_STREQ("nested", s.c_str());
+
+  EXPECT_TRUE(m1->findString("key-0", &s));
+  EXPECT_STREQ("changed", s.c_str());
+  EXPECT_FALSE(m1->contains("key-2"));
+
+  // names returned by the message find their own entry
+  AMessage::Type type;
+  const char *name = m2->getEntryNameAt(5, &type);
+  EXPECT_EQ(5u, m2->findEntryByName(name));
+}
+
 TEST(AMessage_tests, deliversMultipleMessagesInOrderImmediately) {
   sp<NiceMock<MockHandler>> mockHandler = new NiceMock<MockHandler>;
   sp<LooperWithSettableClock> looper = new LooperWithSettableClock();
@@ -20,6 +20,8 @@
 
 #include <fstream>
 #include <memory>
+#include <random>
+#include <vector>
 
 #include "media/stagefright/foundation/ABitReader.h"
 #include "media/stagefright/foundation/avc_utils.h"
@@ -349,6 +351,29 @@ TEST_P(AVCFrameTest, FrameTest) {
     }
 }
 
+// Compares FindStartCode() with a byte by byte scan, on sparse data with start codes at
+// every offset of the SIMD blocks, including across block boundaries and at the very end.
+TEST(FindStartCodeTest, MatchesByteScan) {
+    std::mt19937 gen(42);
+    for (size_t size = 0; size < 80; ++size) {
+        for (int round = 0; round < 200; ++round) {
+            std::vector<uint8_t> data(size);
+            for (auto &byte : data) {
+                const unsigned r = gen() % 8;
+                byte = r < 4 ? 0x00 : r == 4 ? 0x01 : gen() & 0xff;
+            }
+            size_t expected = size;
+            for (size_t i = 0; i + 2 < size; ++i) {
+                if (data[i] == 0x00 && data[i + 1] == 0x00 && data[i + 2] == 0x01) {
+                    expected = i;
+                    break;
+                }
+            }
+            ASSERT_EQ(expected, FindStartCode(data.data(), size)) << "size " << size;
+        }
+    }
+}
+
 INSTANTIATE_TEST_SUITE_P(AVCUtilsTestAll, MpegAudioUnitTest,
                          ::testing::Values(make_tuple(0xFFFB9204, 418, 44100, 2, 128, 1152),
                                            make_tuple(0xFFFB7604, 289, 48000, 2, 96, 1152),
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "WorkerPool_test"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <media/stagefright/foundation/WorkerPool.h>
+
+namespace android {
+
+TEST(WorkerPoolTest, ConcurrencyIsBounded) {
+    EXPECT_GE(WorkerPool::GetConcurrency(), 1u);
+    EXPECT_LE(WorkerPool::GetConcurrency(), WorkerPool::kMaxConcurrency);
+}
+
+TEST(WorkerPoolTest, RunCallsEachIndexOnce) {
+    for (size_t count : {0, 1, 2, 7, 100}) {
+        std::vector<std::atomic<int>> calls(count);
+        WorkerPool::Run(count, [&calls](size_t i) { ++calls[i]; });
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(calls[i], 1) << "index " << i << " of " << count;
+        }
+    }
+}
+
+TEST(WorkerPoolTest, RunNestedDoesNotDeadlock) {
+    // every task waits for tasks of its own, more than there are workers.
+    std::atomic<size_t> calls(0);
+    WorkerPool::Run(WorkerPool::kMaxConcurrency * 2, [&calls](size_t) {
+        WorkerPool::Run(WorkerPool::kMaxConcurrency * 2, [&calls](size_t) { ++calls; });
+    });
+    EXPECT_EQ(calls, WorkerPool::kMaxConcurrency * WorkerPool::kMaxConcurrency * 4);
+}
+
+TEST(WorkerPoolTest, GroupsWaitForTheirOwnTasks) {
+    std::atomic<bool> release(false);
+    std::atomic<size_t> slowCalls(0);
+    std::atomic<size_t> fastCalls(0);
+    std::thread slowCaller([&] {
+        WorkerPool::Group group;
+        group.queue([&] {
+            while (!release) {
+                std::this_thread::yield();
+            }
+            ++slowCalls;
+        });
+    });
+
+    // a group waits for its tasks only, not for the ones of other groups.
+    {
+        WorkerPool::Group group;
+        for (size_t i = 0; i < 10; ++i) {
+            group.queue([&fastCalls] { ++fastCalls; });
+        }
+        group.wait();
+        EXPECT_EQ(fastCalls, 10u);
+    }
+    release = true;
+    slowCaller.join();
+    EXPECT_EQ(slowCalls, 1u);
+}
+
+}  // namespace android
@@ -109,6 +109,16 @@ struct ATSParser::Program : public RefBase {
         return mParser->mCasManager;
     }
 
+    bool inPacketBatch() const {
+        return mParser->mInPacketBatch;
+    }
+
+    // Map the PIDs of this program's streams in streamsByPID.
+    void addStreamsByPID(std::vector<Stream *> *streamsByPID);
+
+    // See Stream::pinPayloadSegments().
+    void pinPayloadSegments();
+
     uint64_t firstPTS() const {
         return mFirstPTS;
     }
@@ -180,6 +190,10 @@ struct ATSParser::Stream : public RefBase {
 
     void signalNewSampleAesKey(const sp<AMessage> &keyItem);
 
+    // Copy payload that still references the packets passed to
+    // ATSParser::feedTSPackets() into mBuffer.
+    status_t pinPayloadSegments();
+
 protected:
     virtual ~Stream();
 
@@ -189,6 +203,10 @@ private:
         unsigned transport_scrambling_mode;
         unsigned random_access_indicator;
     };
+    struct PayloadSegment {
+        const uint8_t *mData;
+        size_t mSize;
+    };
     Program *mProgram;
     unsigned mElementaryPID;
     unsigned mStreamType;
@@ -197,6 +215,10 @@ private:
     int32_t mExpectedContinuityCounter;
 
     sp<ABuffer> mBuffer;
+    // Payload referenced in place during ATSParser::feedTSPackets(), it
+    // logically follows the contents of mBuffer.
+    std::vector<PayloadSegment> mPayloadSegments;
+    size_t mPayloadSegmentsSize;
     sp<AnotherPacketSource> mSource;
     bool mPayloadStarted;
     bool mEOSReached;
@@ -344,6 +366,22 @@ bool ATSParser::Program::parsePID(
     return true;
 }
 
+void ATSParser::Program::addStreamsByPID(std::vector<Stream *> *streamsByPID) {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        (*streamsByPID)[mStreams.keyAt(i)] = mStreams.editValueAt(i).get();
+    }
+}
+
+void ATSParser::Program::pinPayloadSegments() {
+    for (size_t i = 0; i < mStreams.size(); ++i) {
+        status_t err = mStreams.editValueAt(i)->pinPayloadSegments();
+        if (err != OK) {
+            ALOGW("failed to pin payload of stream 0x%04x (%d)",
+                    mStreams.keyAt(i), err);
+        }
+    }
+}
+
 void ATSParser::Program::signalDiscontinuity(
         DiscontinuityType type, const sp<AMessage> &extra) {
     int64_t mediaTimeUs;
@@ -408,6 +446,9 @@ bool ATSParser::Program::switchPIDs(const Vector<StreamInfo> &infos) {
             }
 
             mStreams.clear();
+            // the cached PID lookups point into mStreams, drop them before
+            // any of the early returns below can leave them dangling.
+            mParser->invalidateStreamsByPID();
             for (i = 0; i < temp.size(); ++i) {
                 // The two checks below shouldn't happen,
                 // we already checked above the stream count matches
@@ -821,6 +862,7 @@ status_t ATSParser::Program::parseProgramMap(ABitReader *br) {
 
             isAddingScrambledStream |= info.mCADescriptor.mSystemID >= 0;
             mStreams.add(info.mPID, stream);
+            mParser->invalidateStreamsByPID();
         }
         else if (index >= 0 && mStreams.editValueAt(index)->isAudio()
                  && audioPresentationsChanged) {
@@ -939,6 +981,7 @@ ATSParser::Stream::Stream(
       mStreamTypeExt(info.mTypeExt),
       mPCR_PID(PCR_PID),
       mExpectedContinuityCounter(-1),
+      mPayloadSegmentsSize(0),
       mPayloadStarted(false),
       mEOSReached(false),
       mPrevPTS(0),
@@ -1147,6 +1190,8 @@ status_t ATSParser::Stream::parse(
         mPayloadStarted = false;
         mPesStartOffsets.clear();
         mBuffer->setRange(0, 0);
+        mPayloadSegments.clear();
+        mPayloadSegmentsSize = 0;
         mSubSamples.clear();
         mExpectedContinuityCounter = -1;
 
@@ -1200,6 +1245,15 @@ status_t ATSParser::Stream::parse(
         return BAD_VALUE;
     }
 
+    if (!mScrambled && mProgram->inPacketBatch()) {
+        // Defer the copy until the PES is complete, see flush().
+        if (payloadSizeBits > 0) {
+            mPayloadSegments.push_back({br->data(), payloadSizeBits / 8});
+            mPayloadSegmentsSize += payloadSizeBits / 8;
+        }
+        return OK;
+    }
+
     size_t neededSize = mBuffer->size() + payloadSizeBits / 8;
     if (!ensureBufferCapacity(neededSize)) {
         return NO_MEMORY;
@@ -1271,6 +1325,8 @@ void ATSParser::Stream::signalDiscontinuity(
     mPesStartOffsets.clear();
     mEOSReached = false;
     mBuffer->setRange(0, 0);
+    mPayloadSegments.clear();
+    mPayloadSegmentsSize = 0;
     mSubSamples.clear();
 
     bool clearFormat = false;
@@ -1804,14 +1860,52 @@ status_t ATSParser::Stream::flushScrambled(SyncEvent *event) {
 }
 
 
+status_t ATSParser::Stream::pinPayloadSegments() {
+    if (mPayloadSegments.empty()) {
+        return OK;
+    }
+
+    size_t size = mBuffer == NULL ? 0 : mBuffer->size();
+    status_t err = OK;
+    if (ensureBufferCapacity(size + mPayloadSegmentsSize)) {
+        for (const PayloadSegment &segment : mPayloadSegments) {
+            memcpy(mBuffer->data() + size, segment.mData, segment.mSize);
+            size += segment.mSize;
+        }
+        mBuffer->setRange(0, size);
+    } else {
+        err = NO_MEMORY;
+    }
+
+    mPayloadSegments.clear();
+    mPayloadSegmentsSize = 0;
+    return err;
+}
+
 status_t ATSParser::Stream::flush(SyncEvent *event) {
+    if (mPayloadSegments.size() == 1 && (mBuffer == NULL || mBuffer->size() == 0)) {
+        // The whole PES is within a single packet of the current batch,
+        // parse it in place.
+        ABitReader br(mPayloadSegments[0].mData, mPayloadSegments[0].mSize);
+        mPayloadSegments.clear();
+        mPayloadSegmentsSize = 0;
+        return parsePES(&br, event);
+    }
+
+    status_t err = pinPayloadSegments();
+    if (err != OK) {
+        if (mBuffer != NULL) {
+            mBuffer->setRange(0, 0);
+        }
+        return err;
+    }
+
     if (mBuffer == NULL || mBuffer->size() == 0) {
         return OK;
     }
 
     ALOGV("flushing stream 0x%04x size = %zu", mElementaryPID, mBuffer->size());
 
-    status_t err = OK;
     if (mScrambled) {
         err = flushScrambled(event);
         mSubSamples.clear();
@@ -1988,6 +2082,8 @@ ATSParser::ATSParser(uint32_t flags)
       mTimeOffsetUs(0LL),
       mLastRecoveredPTS(-1LL),
       mNumTSPacketsParsed(0),
+      mStreamsByPIDValid(false),
+      mInPacketBatch(false),
       mNumPCRs(0) {
     mPSISections.add(0 /* PID */, new PSISection);
     mCasManager = new CasManager();
@@ -2007,6 +2103,35 @@ status_t ATSParser::feedTSPacket(const void *data, size_t size,
     return parseTS(&br, event);
 }
 
+status_t ATSParser::feedTSPackets(const void *data, size_t size) {
+    if (size % kTSPacketSize != 0) {
+        ALOGE("Wrong TS packets size %zu", size);
+        return BAD_VALUE;
+    }
+
+    mInPacketBatch = true;
+
+    status_t err = OK;
+    const uint8_t *packet = (const uint8_t *)data;
+    for (size_t offset = 0; offset < size; offset += kTSPacketSize) {
+        ABitReader br(packet + offset, kTSPacketSize);
+        err = parseTS(&br, NULL /* event */);
+        if (err != OK) {
+            break;
+        }
+    }
+
+    mInPacketBatch = false;
+
+    // Partial PES packets must not reference the caller's data beyond this
+    // call.
+    for (size_t i = 0; i < mPrograms.size(); ++i) {
+        mPrograms.editItemAt(i)->pinPayloadSegments();
+    }
+
+    return err;
+}
+
 status_t ATSParser::setMediaCas(const sp<ICas> &cas) {
     status_t err = mCasManager->setMediaCas(cas);
     if (err != OK) {
@@ -2148,10 +2273,12 @@ void ATSParser::parseProgramAssociationTable(ABitReader *br) {
                 if (mSampleAesKeyItem != NULL) {
                     mPrograms.top()->signalNewSampleAesKey(mSampleAesKeyItem);
                 }
+                invalidateStreamsByPID();
             }
 
             if (mPSISections.indexOfKey(programMapPID) < 0) {
                 mPSISections.add(programMapPID, new PSISection);
+                invalidateStreamsByPID();
             }
         }
     }
@@ -2163,6 +2290,21 @@ void ATSParser::parseProgramAssociationTable(ABitReader *br) {
     MY_LOGV("  CRC = 0x%08x", br->getBits(32));
 }
 
+ATSParser::Stream *ATSParser::findStream(unsigned PID) {
+    if (!mStreamsByPIDValid) {
+        mStreamsByPID.assign(0x2000, NULL);
+        // Earlier programs take precedence, as in the lookup below.
+        for (size_t i = mPrograms.size(); i > 0; --i) {
+            mPrograms.editItemAt(i - 1)->addStreamsByPID(&mStreamsByPID);
+        }
+        for (size_t i = 0; i < mPSISections.size(); ++i) {
+            mStreamsByPID[mPSISections.keyAt(i)] = NULL;
+        }
+        mStreamsByPIDValid = true;
+    }
+    return mStreamsByPID[PID];
+}
+
 status_t ATSParser::parsePID(
         ABitReader *br, unsigned PID,
         unsigned continuity_counter,
@@ -2170,6 +2312,16 @@ status_t ATSParser::parsePID(
         unsigned transport_scrambling_control,
         unsigned random_access_indicator,
         SyncEvent *event) {
+    Stream *stream = findStream(PID);
+    if (stream != NULL) {
+        return stream->parse(
+                continuity_counter,
+                payload_unit_start_indicator,
+                transport_scrambling_control,
+                random_access_indicator,
+                br, event);
+    }
+
     ssize_t sectionIndex = mPSISections.indexOfKey(PID);
 
     if (sectionIndex >= 0) {
@@ -2232,6 +2384,7 @@ status_t ATSParser::parsePID(
 
             if (!handled) {
                 mPSISections.removeItem(PID);
+                invalidateStreamsByPID();
                 section.clear();
             }
         }
@@ -33,6 +33,7 @@
 #include <media/cas/DescramblerAPI.h>
 #include <media/hardware/CryptoAPI.h>
 
+#include <algorithm>
 #include <inttypes.h>
 #include <netinet/in.h>
 
@@ -47,7 +48,9 @@ ElementaryStreamQueue::ElementaryStreamQueue(Mode mode, uint32_t flags)
       mFlags(flags),
       mEOSReached(false),
       mCASystemId(0),
-      mAUIndex(0) {
+      mAUIndex(0),
+      mH264ScannedBytes(0) {
+    resetH264Scan();
 
     ALOGV("ElementaryStreamQueue(%p) mode %x  flags %x  isScrambled %d  isSampleEncrypted %d",
             this, mode, flags, isScrambled(), isSampleEncrypted());
@@ -73,6 +76,7 @@ void ElementaryStreamQueue::clear(bool clearFormat) {
     }
 
     mRangeInfos.clear();
+    resetH264Scan();
 
     if (mScrambledBuffer != NULL) {
         mScrambledBuffer->setRange(0, 0);
@@ -880,6 +884,8 @@ status_t ElementaryStreamQueue::appendData(
     if (!isScrambled() && (mBuffer == NULL || mBuffer->size() == 0)) {
         switch (mMode) {
             case H264:
+                resetH264Scan();
+                [[fallthrough]];
             case MPEG_VIDEO:
             {
 #if 0
@@ -1937,24 +1943,67 @@ int64_t ElementaryStreamQueue::fetchTimestamp(
     return timeUs;
 }
 
+void ElementaryStreamQueue::resetH264Scan() {
+    mH264Scan.mScanOffset = 0;
+    mH264Scan.mNALOffset = 0;
+    mH264Scan.mEndScanOffset = 0;
+    mH264Scan.mNALs.clear();
+    mH264Scan.mTotalSize = 0;
+    mH264Scan.mSeiCount = 0;
+    mH264Scan.mFoundSlice = false;
+    mH264Scan.mFoundIDR = false;
+}
+
+// Delimits the NAL units of mBuffer incrementally: the scan state is kept across calls, so
+// that bytes appended since the previous call are the only ones examined, rather than the
+// whole buffer. This matters for large access units carried in several PES packets.
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
+    H264ScanState &scan = mH264Scan;
     const uint8_t *data = mBuffer->data();
-
     size_t size = mBuffer->size();
-    Vector<NALPosition> nals;
 
-    size_t totalSize = 0;
-    size_t seiCount = 0;
+    if (scan.mScanOffset > size || scan.mEndScanOffset > size) {
+        ALOGW("dequeueAccessUnit_H264[%d] buffer shrunk to %zu, rescanning", mAUIndex, size);
+        resetH264Scan();
+    }
 
-    status_t err;
-    const uint8_t *nalStart;
-    size_t nalSize;
-    bool foundSlice = false;
-    bool foundIDR = false;
+    ALOGV("dequeueAccessUnit_H264[%d] %p/%zu from %zu", mAUIndex, data, size, scan.mScanOffset);
 
-    ALOGV("dequeueAccessUnit_H264[%d] %p/%zu", mAUIndex, data, size);
+    for (;;) {
+        if (scan.mNALOffset == 0) {
+            // Look for the startcode of the next NAL unit.
+            const size_t offset = scan.mScanOffset;
+            const size_t startCode = offset + FindStartCode(data + offset, size - offset);
+            if (startCode == size) {
+                mH264ScannedBytes += size - offset;
+                // a startcode may span the end of the data appended so far
+                scan.mScanOffset = std::max(offset, size < 2 ? 0 : size - 2);
+                return NULL;
+            }
+            mH264ScannedBytes += startCode + 3 - offset;
+            scan.mNALOffset = startCode + 3;
+            scan.mEndScanOffset = scan.mNALOffset;
+        }
+
+        // Look for its end, which is the startcode of the following NAL unit.
+        const size_t offset = scan.mEndScanOffset;
+        const size_t nextStartCode = offset + FindStartCode(data + offset, size - offset);
+        if (nextStartCode == size) {
+            mH264ScannedBytes += size - offset;
+            scan.mEndScanOffset = std::max(offset, size - 2);
+            return NULL;
+        }
+        mH264ScannedBytes += nextStartCode + 3 - offset;
+
+        size_t nalEnd = nextStartCode;
+        while (nalEnd > scan.mNALOffset + 1 && data[nalEnd - 1] == 0x00) {
+            --nalEnd;
+        }
+        const uint8_t *nalStart = data + scan.mNALOffset;
+        const size_t nalSize = nalEnd - scan.mNALOffset;
+        scan.mNALOffset = 0;
+        scan.mScanOffset = nextStartCode;
 
-    while ((err = getNextNALUnit(&data, &size, &nalStart, &nalSize)) == OK) {
         if (nalSize == 0) continue;
 
         unsigned nalType = nalStart[0] & 0x1f;
@@ -1962,9 +2011,9 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
 
         if (nalType == 1 || nalType == 5) {
             if (nalType == 5) {
-                foundIDR = true;
+                scan.mFoundIDR = true;
             }
-            if (foundSlice) {
+            if (scan.mFoundSlice) {
                 //TODO: Shouldn't this have been called with nalSize-1?
                 ABitReader br(nalStart + 1, nalSize);
                 unsigned first_mb_in_slice = parseUE(&br);
@@ -1976,27 +2025,28 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
                 }
             }
 
-            foundSlice = true;
-        } else if ((nalType == 9 || nalType == 7) && foundSlice) {
+            scan.mFoundSlice = true;
+        } else if ((nalType == 9 || nalType == 7) && scan.mFoundSlice) {
             // Access unit delimiter and SPS will be associated with the
             // next frame.
 
             flush = true;
         } else if (nalType == 6 && nalSize > 0) {
             // found non-zero sized SEI
-            ++seiCount;
+            ++scan.mSeiCount;
         }
 
         if (flush) {
             // The access unit will contain all nal units up to, but excluding
             // the current one, separated by 0x00 0x00 0x00 0x01 startcodes.
 
-            size_t auSize = 4 * nals.size() + totalSize;
+            const Vector<NALPosition> &nals = scan.mNALs;
+            size_t auSize = 4 * nals.size() + scan.mTotalSize;
             sp<ABuffer> accessUnit = new ABuffer(auSize);
             sp<ABuffer> sei;
 
-            if (seiCount > 0) {
-                sei = new ABuffer(seiCount * sizeof(NALPosition));
+            if (scan.mSeiCount > 0) {
+                sei = new ABuffer(scan.mSeiCount * sizeof(NALPosition));
                 accessUnit->meta()->setBuffer("sei", sei);
             }
 
@@ -2015,6 +2065,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
                 if (nalType == 6 && pos.nalSize > 0) {
                     if (seiIndex >= sei->size() / sizeof(NALPosition)) {
                         ALOGE("Wrong seiIndex");
+                        resetH264Scan();
                         return NULL;
                     }
                     NALPosition &seiPos = ((NALPosition *)sei->data())[seiIndex++];
@@ -2041,6 +2092,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
                         // don't log unless verbose, since this can get called a lot if
                         // the caller is trying to resynchronize
                         ALOGV("expected sample size < %u, got %zu", pos.nalSize, newSize);
+                        resetH264Scan();
                         return NULL;
                     }
                     memcpy(accessUnit->data() + dstOffset + 4,
@@ -2071,6 +2123,15 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
 
             const NALPosition &pos = nals.itemAt(nals.size() - 1);
             size_t nextScan = pos.nalOffset + pos.nalSize;
+            const size_t nalCount = nals.size();
+            const size_t totalSize = scan.mTotalSize;
+            const bool foundIDR = scan.mFoundIDR;
+
+            // The current NAL unit opens the next access unit, keep it delimited.
+            const size_t nalOffset = nalStart - mBuffer->data();
+            resetH264Scan();
+            scan.mNALOffset = nalOffset - nextScan;
+            scan.mEndScanOffset = nextStartCode - nextScan;
 
             memmove(mBuffer->data(),
                     mBuffer->data() + nextScan,
@@ -2107,7 +2168,7 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
 
             ALOGV("dequeueAccessUnitH264[%d]: AU %p(%zu) dstOffset:%zu, nals:%zu, totalSize:%zu ",
                     mAUIndex, accessUnit->data(), accessUnit->size(),
-                    dstOffset, nals.size(), totalSize);
+                    dstOffset, nalCount, totalSize);
             mAUIndex++;
 
             return accessUnit;
@@ -2117,16 +2178,10 @@ sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitH264() {
         pos.nalOffset = nalStart - mBuffer->data();
         pos.nalSize = nalSize;
 
-        nals.push(pos);
+        scan.mNALs.push(pos);
 
-        totalSize += nalSize;
+        scan.mTotalSize += nalSize;
     }
-    if (err != (status_t)-EAGAIN) {
-        ALOGE("Unexpeted err");
-        return NULL;
-    }
-
-    return NULL;
 }
 
 sp<ABuffer> ElementaryStreamQueue::dequeueAccessUnitMPEGAudio() {
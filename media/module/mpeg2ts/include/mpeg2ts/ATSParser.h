@@ -122,6 +122,13 @@ struct ATSParser : public RefBase {
     status_t feedTSPacket(
             const void *data, size_t size, SyncEvent *event = NULL);
 
+    // Feed a contiguous run of TS packets into the parser in a single pass,
+    // size must be a multiple of the TS packet size. Elementary stream
+    // payloads are referenced in place while the run is demuxed and are
+    // copied once per PES, so data only has to stay valid for the duration
+    // of the call. Stops at and returns the first error encountered.
+    status_t feedTSPackets(const void *data, size_t size);
+
     void signalDiscontinuity(
             DiscontinuityType type, const sp<AMessage> &extra);
 
@@ -225,6 +232,18 @@ private:
 
     sp<AMessage> mSampleAesKeyItem;
 
+    // Elementary stream for each PID, NULL for PSI and unknown PIDs which
+    // take the slow path in parsePID(). Rebuilt lazily whenever the program
+    // or stream maps change.
+    std::vector<Stream *> mStreamsByPID;
+    bool mStreamsByPIDValid;
+
+    // True while feedTSPackets() is demuxing a run of packets.
+    bool mInPacketBatch;
+
+    Stream *findStream(unsigned PID);
+    void invalidateStreamsByPID() { mStreamsByPIDValid = false; }
+
     void parseProgramAssociationTable(ABitReader *br);
     void parseProgramMap(ABitReader *br);
     // Parse PES packet where br is pointing to. If the PES contains a sync
@@ -21,10 +21,12 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AMessage.h>
 #include <media/stagefright/foundation/ABuffer.h>
+#include <media/stagefright/foundation/avc_utils.h>
 #include <media/stagefright/MetaData.h>
 #include <utils/Errors.h>
 #include <utils/List.h>
 #include <utils/RefBase.h>
+#include <utils/Vector.h>
 #include <vector>
 
 #include "SampleDecryptor.h"
@@ -84,6 +86,9 @@ struct ElementaryStreamQueue {
 
     void signalNewSampleAesKey(const sp<AMessage> &keyItem);
 
+    // Total number of bytes examined while delimiting H.264 NAL units, for benchmarks.
+    uint64_t getH264ScannedBytes() const { return mH264ScannedBytes; }
+
 protected:
     struct RangeInfo {
         int64_t mTimestampUs;
@@ -118,6 +123,23 @@ protected:
     sp<SampleDecryptor> mSampleDecryptor;
     int mAUIndex;
 
+    // State of the H.264 NAL unit scan of mBuffer, kept across dequeueAccessUnitH264() calls.
+    // Offsets are relative to the start of mBuffer.
+    struct H264ScanState {
+        size_t mScanOffset;         // where to look for the startcode of the next NAL unit
+        size_t mNALOffset;          // start of the NAL unit being delimited, 0 if none
+        size_t mEndScanOffset;      // where to resume looking for the end of that NAL unit
+        Vector<NALPosition> mNALs;  // NAL units of the pending access unit
+        size_t mTotalSize;
+        size_t mSeiCount;
+        bool mFoundSlice;
+        bool mFoundIDR;
+    };
+    H264ScanState mH264Scan;
+    uint64_t mH264ScannedBytes;
+
+    void resetH264Scan();
+
     bool isSampleEncrypted() const {
         return (mFlags & kFlag_SampleEncryptedData) != 0;
     }
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Demuxes a synthetic transport stream carrying one H.264 and one AAC
+// stream, either one packet at a time through feedTSPacket() or in runs of
+// packets through feedTSPackets(), and reports the throughput.
+//
+// Also feeds the H.264 elementary stream to an ElementaryStreamQueue in PES
+// sized pieces, as a muxer limiting the PES packet size would carry it, and
+// reports the bytes scanned for NAL unit startcodes per byte appended.
+//
+// $ atest ATSParserBenchmark
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/foundation/ABuffer.h>
+#include <mpeg2ts/ATSParser.h>
+#include <mpeg2ts/AnotherPacketSource.h>
+#include <mpeg2ts/ESQueue.h>
+
+namespace android {
+namespace {
+
+constexpr size_t kTSPacketSize = 188;
+constexpr unsigned kPMTPID = 0x100;
+constexpr unsigned kVideoPID = 0x101;
+constexpr unsigned kAudioPID = 0x102;
+constexpr int kFrameRate = 30;
+constexpr int kAudioFramesPerSecond = 43;  // 1024 samples at 44.1kHz
+constexpr int kDurationSeconds = 10;
+constexpr int kIdrInterval = 60;
+constexpr size_t kPacketsPerDrain = 4096;
+
+// Baseline profile, 320x240.
+const uint8_t kSPS[] = {0x67, 0x42, 0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe4};
+const uint8_t kPPS[] = {0x68, 0xce, 0x3c, 0x80};
+
+uint32_t crc32(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+class TSWriter {
+  public:
+    const std::vector<uint8_t> &data() const { return mData; }
+
+    void writePSI(unsigned pid, std::vector<uint8_t> section) {
+        uint32_t crc = crc32(section.data(), section.size());
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            section.push_back(crc >> shift);
+        }
+        section.insert(section.begin(), 0);  // pointer_field
+        writePayload(pid, section);
+    }
+
+    void writePES(unsigned pid, uint8_t streamId, uint64_t pts,
+            const std::vector<uint8_t> &es, bool bounded) {
+        std::vector<uint8_t> pes = {0x00, 0x00, 0x01, streamId, 0x00, 0x00, 0x80, 0x80, 0x05};
+        pes.push_back(0x21 | ((pts >> 29) & 0x0e));
+        pes.push_back(pts >> 22);
+        pes.push_back(0x01 | ((pts >> 14) & 0xfe));
+        pes.push_back(pts >> 7);
+        pes.push_back(0x01 | ((pts << 1) & 0xfe));
+        pes.insert(pes.end(), es.begin(), es.end());
+        if (bounded) {
+            size_t length = pes.size() - 6;
+            pes[4] = length >> 8;
+            pes[5] = length & 0xff;
+        }
+        writePayload(pid, pes);
+    }
+
+  private:
+    std::vector<uint8_t> mData;
+    std::map<unsigned, unsigned> mContinuityCounters;
+
+    void writePayload(unsigned pid, const std::vector<uint8_t> &payload) {
+        for (size_t offset = 0; offset < payload.size();) {
+            size_t size = std::min(payload.size() - offset, kTSPacketSize - 4);
+            unsigned &cc = mContinuityCounters[pid];
+            mData.push_back(0x47);
+            mData.push_back((offset == 0 ? 0x40 : 0x00) | (pid >> 8));
+            mData.push_back(pid & 0xff);
+            if (size == kTSPacketSize - 4) {
+                mData.push_back(0x10 | cc);
+            } else {
+                // Stuff the last packet through the adaptation field.
+                size_t stuffing = kTSPacketSize - 4 - size;
+                mData.push_back(0x30 | cc);
+                mData.push_back(stuffing - 1);
+                if (stuffing > 1) {
+                    mData.push_back(0x00);
+                    mData.insert(mData.end(), stuffing - 2, 0xff);
+                }
+            }
+            cc = (cc + 1) & 0x0f;
+            mData.insert(mData.end(), payload.begin() + offset, payload.begin() + offset + size);
+            offset += size;
+        }
+    }
+};
+
+void appendNAL(std::vector<uint8_t> *es, const uint8_t *nal, size_t size) {
+    static const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+    es->insert(es->end(), kStartCode, kStartCode + sizeof(kStartCode));
+    es->insert(es->end(), nal, nal + size);
+}
+
+// Returns the access units of the video stream, each starting with an access unit delimiter.
+std::vector<std::vector<uint8_t>> makeVideoAccessUnits(int videoBitrate) {
+    // Slice data has the top bit set for first_mb_in_slice == 0 and no zero
+    // bytes, so it never emulates a start code.
+    const size_t sliceSize = videoBitrate / 8 / kFrameRate;
+    std::vector<uint8_t> slice(sliceSize, 0xaa);
+
+    std::vector<std::vector<uint8_t>> accessUnits;
+    for (int frame = 0; frame < kDurationSeconds * kFrameRate; ++frame) {
+        std::vector<uint8_t> es;
+        static const uint8_t kAUD[] = {0x09, 0xf0};
+        appendNAL(&es, kAUD, sizeof(kAUD));
+        bool idr = frame % kIdrInterval == 0;
+        if (idr) {
+            appendNAL(&es, kSPS, sizeof(kSPS));
+            appendNAL(&es, kPPS, sizeof(kPPS));
+        }
+        slice[0] = idr ? 0x65 : 0x41;
+        appendNAL(&es, slice.data(), slice.size());
+        accessUnits.push_back(std::move(es));
+    }
+    return accessUnits;
+}
+
+// |maxPESPayload| 0 carries each video access unit in a single unbounded PES packet,
+// otherwise in bounded PES packets of at most that many bytes.
+std::vector<uint8_t> makeStream(int videoBitrate, size_t maxPESPayload) {
+    TSWriter writer;
+    const std::vector<uint8_t> pat = {
+            0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+            0x00, 0x01, 0xe0 | (kPMTPID >> 8), kPMTPID & 0xff};
+    const std::vector<uint8_t> pmt = {
+            0x02, 0xb0, 0x17, 0x00, 0x01, 0xc1, 0x00, 0x00,
+            0xe0 | (kVideoPID >> 8), kVideoPID & 0xff, 0xf0, 0x00,
+            ATSParser::STREAMTYPE_H264, 0xe0 | (kVideoPID >> 8), kVideoPID & 0xff, 0xf0, 0x00,
+            ATSParser::STREAMTYPE_MPEG2_AUDIO_ADTS,
+            0xe0 | (kAudioPID >> 8), kAudioPID & 0xff, 0xf0, 0x00};
+
+    const std::vector<std::vector<uint8_t>> accessUnits = makeVideoAccessUnits(videoBitrate);
+
+    const size_t aacFrameSize = 371;
+    std::vector<uint8_t> adts = {0xff, 0xf1, 0x50, 0x80,
+            uint8_t((aacFrameSize >> 3) & 0xff), uint8_t(((aacFrameSize & 7) << 5) | 0x1f), 0xfc};
+    adts.resize(aacFrameSize, 0x5a);
+
+    int audioFrames = 0;
+    for (int frame = 0; frame < kDurationSeconds * kFrameRate; ++frame) {
+        if (frame % (kFrameRate / 10) == 0) {
+            writer.writePSI(0, pat);
+            writer.writePSI(kPMTPID, pmt);
+        }
+
+        const uint64_t pts = 90000ll * frame / kFrameRate;
+        const std::vector<uint8_t> &es = accessUnits[frame];
+        if (maxPESPayload == 0) {
+            writer.writePES(kVideoPID, 0xe0, pts, es, false /* bounded */);
+        } else {
+            for (size_t offset = 0; offset < es.size(); offset += maxPESPayload) {
+                const size_t size = std::min(maxPESPayload, es.size() - offset);
+                writer.writePES(kVideoPID, 0xe0, pts,
+                        std::vector<uint8_t>(es.begin() + offset, es.begin() + offset + size),
+                        true /* bounded */);
+            }
+        }
+
+        for (; audioFrames * kFrameRate < (frame + 1) * kAudioFramesPerSecond; ++audioFrames) {
+            writer.writePES(kAudioPID, 0xc0, 90000ll * audioFrames / kAudioFramesPerSecond,
+                    adts, true /* bounded */);
+        }
+    }
+    return writer.data();
+}
+
+const std::vector<uint8_t> &getStream(int videoBitrate, size_t maxPESPayload) {
+    static std::map<std::pair<int, size_t>, std::vector<uint8_t>> streams;
+    const std::pair<int, size_t> key(videoBitrate, maxPESPayload);
+    auto it = streams.find(key);
+    if (it == streams.end()) {
+        it = streams.emplace(key, makeStream(videoBitrate, maxPESPayload)).first;
+    }
+    return it->second;
+}
+
+size_t drain(const sp<ATSParser> &parser) {
+    size_t count = 0;
+    for (ATSParser::SourceType type : {ATSParser::VIDEO, ATSParser::AUDIO}) {
+        sp<AnotherPacketSource> source = parser->getSource(type);
+        if (source == NULL) {
+            continue;
+        }
+        status_t finalResult;
+        sp<ABuffer> accessUnit;
+        while (source->hasBufferAvailable(&finalResult)
+                && source->dequeueAccessUnit(&accessUnit) == OK) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Arguments: video bitrate, packets per call (0 feeds one packet at a time
+// through feedTSPacket()), maximum video PES payload (0 for unbounded).
+void BM_ATSParser(benchmark::State &state) {
+    const std::vector<uint8_t> &stream = getStream(state.range(0), state.range(2));
+    const size_t numPackets = stream.size() / kTSPacketSize;
+    const size_t packetsPerCall = state.range(1);
+
+    size_t accessUnits = 0;
+    for (auto _ : state) {
+        sp<ATSParser> parser = new ATSParser;
+        accessUnits = 0;
+        for (size_t packet = 0; packet < numPackets;) {
+            size_t n = std::min(kPacketsPerDrain, numPackets - packet);
+            const uint8_t *data = stream.data() + packet * kTSPacketSize;
+            if (packetsPerCall == 0) {
+                for (size_t i = 0; i < n; ++i) {
+                    if (parser->feedTSPacket(data + i * kTSPacketSize, kTSPacketSize) != OK) {
+                        state.SkipWithError("feedTSPacket failed");
+                        return;
+                    }
+                }
+            } else {
+                for (size_t i = 0; i < n; i += packetsPerCall) {
+                    size_t count = std::min(packetsPerCall, n - i);
+                    if (parser->feedTSPackets(data + i * kTSPacketSize,
+                            count * kTSPacketSize) != OK) {
+                        state.SkipWithError("feedTSPackets failed");
+                        return;
+                    }
+                }
+            }
+            packet += n;
+            accessUnits += drain(parser);
+        }
+        parser->signalEOS(ERROR_END_OF_STREAM);
+        accessUnits += drain(parser);
+    }
+    state.SetBytesProcessed(state.iterations() * stream.size());
+    state.counters["access_units"] = accessUnits;
+}
+
+// Arguments: video bitrate, PES payload size.
+void BM_ESQueueH264(benchmark::State &state) {
+    const std::vector<std::vector<uint8_t>> accessUnits = makeVideoAccessUnits(state.range(0));
+    const size_t pesPayload = state.range(1);
+
+    size_t bytes = 0;
+    uint64_t scannedBytes = 0;
+    for (auto _ : state) {
+        ElementaryStreamQueue queue(ElementaryStreamQueue::H264);
+        bytes = 0;
+        int64_t timeUs = 0;
+        for (const std::vector<uint8_t> &es : accessUnits) {
+            for (size_t offset = 0; offset < es.size(); offset += pesPayload) {
+                const size_t size = std::min(pesPayload, es.size() - offset);
+                if (queue.appendData(es.data() + offset, size, timeUs) != OK) {
+                    state.SkipWithError("appendData failed");
+                    return;
+                }
+                bytes += size;
+                while (queue.dequeueAccessUnit() != NULL) {
+                }
+            }
+            timeUs += 1000000 / kFrameRate;
+        }
+        scannedBytes = queue.getH264ScannedBytes();
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["scanned_per_byte"] = (double)scannedBytes / bytes;
+}
+
+BENCHMARK(BM_ATSParser)
+        ->ArgNames({"bitrate", "packets", "pes"})
+        ->ArgsProduct({{2000000, 8000000, 20000000}, {0, 7, 64, 1024}, {0}})
+        ->Unit(benchmark::kMillisecond);
+// High bitrate video split in bounded PES packets.
+BENCHMARK(BM_ATSParser)
+        ->ArgNames({"bitrate", "packets", "pes"})
+        ->ArgsProduct({{20000000, 60000000}, {64}, {16384, 65000}})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ESQueueH264)
+        ->ArgNames({"bitrate", "pes"})
+        ->ArgsProduct({{8000000, 60000000}, {1504, 16384, 65000}})
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace android
+
+BENCHMARK_MAIN();
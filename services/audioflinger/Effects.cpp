@@ -2270,6 +2270,12 @@ void EffectChain::clearInputBuffer_l()
 
 // Must be called with EffectChain::mutex() locked
 void EffectChain::process_l() {
+    processAudio_l();
+    updateEffectsState_l();
+}
+
+// Must be called with EffectChain::mutex() locked
+void EffectChain::processAudio_l() {
     // never process effects when:
     // - on an OFFLOAD thread
     // - no more tracks are on the session and the effect tail has been rendered
@@ -2310,7 +2316,12 @@ void EffectChain::process_l() {
             mOutBuffer->commit();
         }
     }
+}
+
+// Must be called with EffectChain::mutex() locked
+void EffectChain::updateEffectsState_l() {
     bool doResetVolume = false;
+    const size_t size = mEffects.size();
     for (size_t i = 0; i < size; i++) {
         // reset volume when any effect just started or stopped.
         // resetVolume_l will check if the volume controller effect in the chain needs update and
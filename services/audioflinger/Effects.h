@@ -428,6 +428,8 @@ public:
                 const sp<IAfThreadCallback>& afThreadCallback);
 
     void process_l() final REQUIRES(audio_utils::EffectChain_Mutex);
+    void processAudio_l() final REQUIRES(audio_utils::EffectChain_Mutex);
+    void updateEffectsState_l() final REQUIRES(audio_utils::EffectChain_Mutex);
 
     audio_utils::mutex& mutex() const final RETURN_CAPABILITY(audio_utils::EffectChain_Mutex) {
         return mMutex;
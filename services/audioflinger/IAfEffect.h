@@ -234,6 +234,11 @@ public:
     static constexpr int kProcessTailDurationMs = 1000;
 
     virtual void process_l() REQUIRES(audio_utils::EffectChain_Mutex) = 0;
+    // process_l() in two steps, so that the audio of independent chains can be processed
+    // concurrently: processAudio_l() only touches the effects and buffers of this chain,
+    // updateEffectsState_l() must then be called from the thread of the chain.
+    virtual void processAudio_l() REQUIRES(audio_utils::EffectChain_Mutex) = 0;
+    virtual void updateEffectsState_l() REQUIRES(audio_utils::EffectChain_Mutex) = 0;
 
     virtual audio_utils::mutex& mutex() const RETURN_CAPABILITY(audio_utils::EffectChain_Mutex) = 0;
 
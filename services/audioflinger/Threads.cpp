@@ -230,6 +230,10 @@ static const int kPriorityFastCapture = 3;
 // Request real-time priority for PlaybackThread in ARC
 static const int kPriorityPlaybackThreadArc = 1;
 
+// Upper bound for af.effect.workers, the number of helper threads processing
+// session effect chains in parallel on each MixerThread.
+static const int32_t kMaxEffectWorkers = 4;
+
 // IAudioFlinger::createTrack() has an in/out parameter 'pFrameCount' for the total size of the
 // track buffer in shared memory.  Zero on input means to use a default value.  For fast tracks,
 // AudioFlinger derives the default from HAL buffer size and 'fast track multiplier'.
@@ -2365,6 +2369,10 @@ void PlaybackThread::dumpInternals_l(int fd, const Vector<String16>& args)
     if (mPipeSink.get() != nullptr) {
         dprintf(fd, "  PipeSink frames written: %lld\n", (long long)mPipeSink->framesWritten());
     }
+    if (mEffectWorkerPool != nullptr) {
+        // not guaranteed to be consistent, updated by the thread loop without lock
+        dprintf(fd, "  Effect workers: %s\n", mEffectWorkerPool->toString().c_str());
+    }
     if (output != nullptr) {
         dprintf(fd, "  Hal stream dump:\n");
         (void)output->stream->dump(fd, args);
@@ -3862,6 +3870,20 @@ status_t PlaybackThread::addEffectChain_l(const sp<IAfEffectChain>& chain)
                 buffer = halInBuffer ? halInBuffer->audioBuffer()->f32 : buffer;
                 ALOGV("addEffectChain_l() creating new input buffer %p session %d",
                         buffer, session);
+
+                if (mEffectWorkerPool != nullptr) {
+                    sp<EffectBufferHalInterface> halStagingBuffer;
+                    const status_t stagingStatus =
+                            mAfThreadCallback->getEffectsFactoryHal()->allocateBuffer(
+                            numSamples * sizeof(float),
+                            &halStagingBuffer);
+                    if (stagingStatus != OK) return stagingStatus;
+
+                    ALOGV("addEffectChain_l() creating staging buffer %p session %d",
+                            halStagingBuffer->audioBuffer()->f32, session);
+                    mStagedEffectChains[session] = {chain, halStagingBuffer, halOutBuffer};
+                    halOutBuffer = halStagingBuffer;
+                }
             }
         }
     }
@@ -3930,6 +3952,7 @@ size_t PlaybackThread::removeEffectChain_l(const sp<IAfEffectChain>& chain)
     for (size_t i = 0; i < mEffectChains.size(); i++) {
         if (chain == mEffectChains[i]) {
             mEffectChains.removeAt(i);
+            mStagedEffectChains.erase(session);
             // detach all active tracks from the chain
             for (const sp<IAfTrack>& track : mActiveTracks) {
                 if (session == track->sessionId()) {
@@ -3953,6 +3976,55 @@ size_t PlaybackThread::removeEffectChain_l(const sp<IAfEffectChain>& chain)
     return mEffectChains.size();
 }
 
+void PlaybackThread::getStagedEffectChains_l(const Vector<sp<IAfEffectChain>>& effectChains,
+        std::vector<StagedEffectChain>* stagedEffectChains) const
+{
+    stagedEffectChains->clear();
+    // Session chains come first in the chain list, see addEffectChain_l().
+    for (const auto& chain : effectChains) {
+        const auto it = mStagedEffectChains.find(chain->sessionId());
+        if (it == mStagedEffectChains.end() || it->second.mChain != chain) {
+            break;
+        }
+        stagedEffectChains->push_back(it->second);
+    }
+}
+
+void PlaybackThread::processStagedEffectChains(
+        const std::vector<StagedEffectChain>& stagedEffectChains)
+NO_THREAD_SAFETY_ANALYSIS  // the chains are locked by lockEffectChains_l()
+{
+    if (stagedEffectChains.empty()) {
+        return;
+    }
+    ATRACE_BEGIN("effects");
+    // Leave the other half of the period to mixing, the global chains and the write.
+    const int64_t budgetNs = (int64_t)mNormalFrameCount * NANOS_PER_SECOND / mSampleRate / 2;
+    mEffectWorkerPool->run(stagedEffectChains.size(),
+            [&stagedEffectChains](size_t i) NO_THREAD_SAFETY_ANALYSIS {
+                const StagedEffectChain& staged = stagedEffectChains[i];
+                // The last effect of the chain accumulates into the staging buffer.
+                memset(staged.mStaging->audioBuffer()->raw, 0, staged.mStaging->getSize());
+                staged.mChain->processAudio_l();
+            }, budgetNs);
+    // Effect state changes may call back into the thread, keep them on the thread loop.
+    for (const auto& staged : stagedEffectChains) {
+        staged.mChain->updateEffectsState_l();
+    }
+    ATRACE_END();
+}
+
+/* static */
+void PlaybackThread::mixStagedEffectChain(const StagedEffectChain& stagedEffectChain)
+{
+    const sp<EffectBufferHalInterface>& target = stagedEffectChain.mTarget;
+    const sp<EffectBufferHalInterface>& staging = stagedEffectChain.mStaging;
+    target->update();
+    accumulate_float(target->audioBuffer()->f32, staging->audioBuffer()->f32,
+            std::min(target->getSize(), staging->getSize()) / sizeof(float));
+    target->commit();
+}
+
 status_t PlaybackThread::attachAuxEffect(
         const sp<IAfTrack>& track, int EffectId)
 {
@@ -4084,6 +4156,7 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
         cpuStats.sample(myName);
 
         Vector<sp<IAfEffectChain>> effectChains;
+        std::vector<StagedEffectChain> stagedEffectChains;
         audio_session_t activeHapticSessionId = AUDIO_SESSION_NONE;
         bool isHapticSessionSpatialized = false;
         std::vector<sp<IAfTrack>> activeTracks;
@@ -4271,6 +4344,7 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
             // during mixing and effect process as the audio buffers could be deleted
             // or modified if an effect is created or deleted
             lockEffectChains_l(effectChains);
+            getStagedEffectChains_l(effectChains, &stagedEffectChains);
 
             // Determine which session to pick up haptic data.
             // This must be done under the same lock as prepareTracks_l().
@@ -4388,8 +4462,11 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
 
             // only process effects if we're going to write
             if (mSleepTimeUs == 0 && mType != OFFLOAD && mType != DIRECT) {
+                processStagedEffectChains(stagedEffectChains);
                 for (size_t i = 0; i < effectChains.size(); i ++) {
-                    effectChains[i]->process_l();
+                    if (i >= stagedEffectChains.size()) {
+                        effectChains[i]->process_l();
+                    }
                     // TODO: Write haptic data directly to sink buffer when mixing.
                     if (activeHapticSessionId != AUDIO_SESSION_NONE
                             && activeHapticSessionId == effectChains[i]->sessionId()) {
@@ -4411,6 +4488,9 @@ NO_THREAD_SAFETY_ANALYSIS  // manual locking of AudioFlinger
                                 (const uint8_t*)effectChains[i]->inBuffer() + audioBufferSize,
                                 AUDIO_FORMAT_PCM_FLOAT, mNormalFrameCount * mHapticChannelCount);
                     }
+                    if (i < stagedEffectChains.size()) {
+                        mixStagedEffectChain(stagedEffectChains[i]);
+                    }
                 }
             }
         }
@@ -5132,6 +5212,18 @@ MixerThread::MixerThread(const sp<IAfThreadCallback>& afThreadCallback, AudioStr
             mNormalFrameCount);
     mAudioMixer = new AudioMixer(mNormalFrameCount, mSampleRate);
 
+    if (type == MIXER) {
+        const int32_t effectWorkers = property_get_int32("af.effect.workers", 0 /* default */);
+        if (effectWorkers > 0) {
+            mEffectWorkerPool = std::make_unique<afutils::EffectWorkerPool>(
+                    std::min(effectWorkers, kMaxEffectWorkers),
+                    std::string("AudioFx") + std::to_string(id) + "_");
+            for (const pid_t tid : mEffectWorkerPool->workerTids()) {
+                sendPrioConfigEvent(getpid(), tid, kPriorityAudioApp, false /*forApp*/);
+            }
+        }
+    }
+
     if (type == DUPLICATING) {
         // The Duplicating thread uses the AudioMixer and delivers data to OutputTracks
         // (downstream MixerThreads) in DuplicatingThread::threadLoop_write().
@@ -5869,7 +5961,14 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
             }
             if (fastTrack->mHapticPlaybackEnabled != track->getHapticPlaybackEnabled()) {
                 fastTrack->mHapticPlaybackEnabled = track->getHapticPlaybackEnabled();
-                didModify = true;
+                fastTrack->mHapticScale = track->getHapticScale();
+                fastTrack->mHapticMaxAmplitude = track->getHapticMaxAmplitude();
+                // The change rides along with the next state push, but the fast mixer
+                // applies it from the update queue without waiting for one.
+                if (!mFastMixer->pushTrackUpdate(j, *fastTrack)) {
+                    fastTrack->mGeneration++;
+                    didModify = true;
+                }
             }
             continue;
         }
@@ -6260,7 +6359,10 @@ PlaybackThread::mixer_state MixerThread::prepareTracks_l(
         FastTrack *fastTrack = &state->mFastTracks[0];
         if (fastTrack->mHapticPlaybackEnabled != noFastHapticTrack) {
             fastTrack->mHapticPlaybackEnabled = noFastHapticTrack;
-            didModify = true;
+            if (!mFastMixer->pushTrackUpdate(0, *fastTrack)) {
+                fastTrack->mGeneration++;
+                didModify = true;
+            }
         }
     }
 
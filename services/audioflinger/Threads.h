@@ -25,6 +25,7 @@
 #include <android-base/macros.h>  // DISALLOW_COPY_AND_ASSIGN
 #include <android/os/IPowerManager.h>
 #include <afutils/AudioWatchdog.h>
+#include <afutils/EffectWorkerPool.h>
 #include <afutils/NBAIO_Tee.h>
 #include <audio_utils/Balance.h>
 #include <audio_utils/SimpleLog.h>
@@ -1297,6 +1298,30 @@ protected:
     // Size of mPostSpatializerBuffer in bytes
     size_t mPostSpatializerBufferSize GUARDED_BY(mutex());
 
+    // Parallel effect processing (MIXER threads, property af.effect.workers > 0).
+    //
+    // The session chains of such a thread write to a staging buffer of their own instead
+    // of accumulating into mEffectBuffer (or mSinkBuffer), so that they can be processed
+    // concurrently on mEffectWorkerPool. The thread loop then accumulates the staging
+    // buffers into their target in chain order, before processing the global chains.
+    struct StagedEffectChain {
+        sp<IAfEffectChain> mChain;
+        sp<EffectBufferHalInterface> mStaging;  // output buffer of the chain
+        sp<EffectBufferHalInterface> mTarget;   // where the chain output is mixed
+    };
+    // Keyed by session, changed with addEffectChain_l() and removeEffectChain_l().
+    std::map<audio_session_t, StagedEffectChain> mStagedEffectChains GUARDED_BY(mutex());
+    std::unique_ptr<afutils::EffectWorkerPool> mEffectWorkerPool;
+
+    // Returns the staged chains among the given chains, in the same order.
+    void getStagedEffectChains_l(const Vector<sp<IAfEffectChain>>& effectChains,
+            std::vector<StagedEffectChain>* stagedEffectChains) const REQUIRES(mutex());
+    // Processes the staged chains, which lead the chain list, on mEffectWorkerPool.
+    // Their output still has to be mixed with mixStagedEffectChain().
+    void processStagedEffectChains(const std::vector<StagedEffectChain>& stagedEffectChains)
+            REQUIRES(ThreadBase_ThreadLoop);
+    static void mixStagedEffectChain(const StagedEffectChain& stagedEffectChain);
+
     // suspend count, > 0 means suspended.  While suspended, the thread continues to pull from
     // tracks and mix, but doesn't write to HAL.  A2DP and SCO HAL implementations can't handle
     // concurrent use of both of them, so Audio Policy Service suspends one of the threads to
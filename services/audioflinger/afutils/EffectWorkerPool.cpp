@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "EffectWorkerPool"
+
+#include "EffectWorkerPool.h"
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <android-base/stringprintf.h>
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+namespace android::afutils {
+
+namespace {
+
+// Spins this many times on the join before sleeping on the futex;
+// effect jobs are short and the helpers usually finish within a few microseconds
+// of the calling thread.
+constexpr int kJoinSpins = 200;
+
+void futexWait(std::atomic<int32_t>* addr, int32_t value) {
+    (void) syscall(__NR_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAIT_PRIVATE, value,
+            nullptr);
+}
+
+void futexWake(std::atomic<int32_t>* addr, int count) {
+    (void) syscall(__NR_futex, reinterpret_cast<int32_t*>(addr), FUTEX_WAKE_PRIVATE, count);
+}
+
+}  // namespace
+
+EffectWorkerPool::EffectWorkerPool(size_t numWorkers, const std::string& name)
+    : mWorkerTids(numWorkers)
+{
+    static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t));
+    for (size_t i = 0; i < numWorkers; ++i) {
+        mWorkerTids[i] = -1;
+        mWorkers.emplace_back([this, i, threadName = name + std::to_string(i)] {
+            pthread_setname_np(pthread_self(), threadName.substr(0, 15).c_str());
+            mWorkerTids[i] = gettid();
+            threadLoop(i);
+        });
+    }
+}
+
+EffectWorkerPool::~EffectWorkerPool()
+{
+    mExit = true;
+    mWakeSeq.fetch_add(1);
+    futexWake(&mWakeSeq, INT32_MAX);
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+std::vector<pid_t> EffectWorkerPool::workerTids() const
+{
+    std::vector<pid_t> tids;
+    for (const auto& tid : mWorkerTids) {
+        // The helpers publish their tid first thing after starting.
+        pid_t value;
+        while ((value = tid.load()) == -1) {
+            std::this_thread::yield();
+        }
+        tids.push_back(value);
+    }
+    return tids;
+}
+
+void EffectWorkerPool::threadLoop(size_t index __unused)
+{
+    int32_t seenSeq = 0;
+    while (true) {
+        const int32_t seq = mWakeSeq.load();
+        if (seq == seenSeq) {
+            futexWait(&mWakeSeq, seq);
+            continue;
+        }
+        seenSeq = seq;
+        if (mExit) {
+            return;
+        }
+        // Register before looking at the work, so that the calling thread waits for any
+        // job this helper manages to claim.
+        mActive.fetch_add(1);
+        const uint32_t generation = mWork.load() >> 32;
+        const size_t ran = drain(generation);
+        if (ran != 0) {
+            mHelperJobs.fetch_add(ran, std::memory_order_relaxed);
+        }
+        if (mActive.fetch_sub(1) == 1) {
+            futexWake(&mActive, 1);
+        }
+    }
+}
+
+size_t EffectWorkerPool::drain(uint32_t generation)
+{
+    size_t ran = 0;
+    uint64_t work = mWork.load();
+    while ((work >> 32) == generation) {
+        const uint32_t count = (work >> 16) & kMaxJobs;
+        const uint32_t next = work & kMaxJobs;
+        if (next >= count) {
+            break;
+        }
+        if (mWork.compare_exchange_weak(work, work + 1)) {
+            // The period cannot end before this job is done, so mJob is still its job.
+            (*mJob.load())(next);
+            ++ran;
+            work = mWork.load();
+        }
+    }
+    return ran;
+}
+
+bool EffectWorkerPool::run(size_t count, const Job& job, int64_t budgetNs)
+{
+    const nsecs_t start = systemTime();
+    ++mStats.mPeriods;
+    if (mBackoff > 0) {
+        --mBackoff;
+    }
+    const bool parallel = mParallelEnabled && count > 1 && count <= kMaxJobs
+            && !mWorkers.empty() && mBackoff == 0
+            && mWorkNs * kParallelThresholdDivisor > budgetNs;
+
+    // The work of a period is measured in CPU time, so that it does not include the
+    // time a helper was preempted.
+    int64_t workNs = 0;
+    if (!parallel) {
+        const nsecs_t cpuStart = systemTime(SYSTEM_TIME_THREAD);
+        for (size_t i = 0; i < count; ++i) {
+            job(i);
+        }
+        workNs = systemTime(SYSTEM_TIME_THREAD) - cpuStart;
+    } else {
+        std::atomic<int64_t> jobNs{0};
+        const Job timedJob = [&job, &jobNs](size_t index) {
+            const nsecs_t jobStart = systemTime(SYSTEM_TIME_THREAD);
+            job(index);
+            jobNs.fetch_add(systemTime(SYSTEM_TIME_THREAD) - jobStart,
+                    std::memory_order_relaxed);
+        };
+        ++mGeneration;
+        mJob = &timedJob;
+        mHelperJobs.store(0, std::memory_order_relaxed);
+        mWork = static_cast<uint64_t>(mGeneration) << 32 | static_cast<uint64_t>(count) << 16;
+        mWakeSeq.fetch_add(1);
+        futexWake(&mWakeSeq, static_cast<int>(mWorkers.size()));
+
+        drain(mGeneration);
+        // All jobs are claimed; wait for the helpers still running one.
+        for (int spins = 0; ; ++spins) {
+            const int32_t active = mActive.load();
+            if (active == 0) {
+                break;
+            }
+            if (spins < kJoinSpins) {
+                std::this_thread::yield();
+            } else {
+                futexWait(&mActive, active);
+            }
+        }
+        workNs = jobNs.load(std::memory_order_relaxed);
+        const uint32_t helperJobs = mHelperJobs.load(std::memory_order_relaxed);
+        ++mStats.mParallelPeriods;
+        mStats.mHelperJobs += helperJobs;
+    }
+
+    const int64_t elapsedNs = systemTime() - start;
+    if (elapsedNs > mStats.mMaxElapsedNs) {
+        mStats.mMaxElapsedNs = elapsedNs;
+    }
+    if (elapsedNs > budgetNs) {
+        ++mStats.mMisses;
+        if (parallel && workNs <= budgetNs) {
+            // Serial execution would likely have made it: the helpers were not scheduled
+            // in time, or preempted.
+            ALOGV("%s: %lld ns over a %lld ns budget with %lld ns of work, running serially",
+                    __func__, (long long)elapsedNs, (long long)budgetNs, (long long)workNs);
+            mBackoff = kBackoffPeriods;
+            ++mStats.mBackoffs;
+        }
+    }
+    // Smooth over 8 periods, so that a single quiet period does not switch modes.
+    mWorkNs += (workNs - mWorkNs) / 8;
+    return parallel;
+}
+
+std::string EffectWorkerPool::toString() const
+{
+    return base::StringPrintf("%zu workers, %llu periods, %llu parallel, %llu helper jobs, "
+            "%llu misses, %llu backoffs, max %.3f ms",
+            mWorkers.size(), (unsigned long long)mStats.mPeriods,
+            (unsigned long long)mStats.mParallelPeriods, (unsigned long long)mStats.mHelperJobs,
+            (unsigned long long)mStats.mMisses, (unsigned long long)mStats.mBackoffs,
+            mStats.mMaxElapsedNs * 1e-6);
+}
+
+}  // namespace android::afutils
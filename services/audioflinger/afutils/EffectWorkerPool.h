@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace android::afutils {
+
+/**
+ * A small, fixed set of helper threads that an output thread uses to run the
+ * independent effect chains of one period concurrently.
+ *
+ * The calling thread takes part in the work: jobs are claimed one at a time by
+ * whichever thread is free first, so a helper that is slow to wake up never
+ * holds back a job, and with no helper awake the period degrades to serial
+ * execution on the calling thread.
+ *
+ * On top of that, run() decides per period whether to use the helpers at all:
+ * only when the total work of the previous periods is a sizable part of the
+ * period budget (below that, waking the helpers costs more than it saves), and
+ * not for a while after the helpers failed to keep a period within its budget
+ * that serial execution would have met.
+ *
+ * run() must be called from a single thread.
+ */
+class EffectWorkerPool {
+public:
+    using Job = std::function<void(size_t index)>;
+
+    struct Stats {
+        uint64_t mPeriods = 0;          // calls to run()
+        uint64_t mParallelPeriods = 0;  // periods that used the helpers
+        uint64_t mHelperJobs = 0;       // jobs run by the helpers
+        uint64_t mMisses = 0;           // periods over budget
+        uint64_t mBackoffs = 0;         // fallbacks to serial after a parallel miss
+        int64_t mMaxElapsedNs = 0;      // longest period
+    };
+
+    // numWorkers helper threads are started, named <name>N.
+    EffectWorkerPool(size_t numWorkers, const std::string& name);
+    ~EffectWorkerPool();
+
+    EffectWorkerPool(const EffectWorkerPool&) = delete;
+    EffectWorkerPool& operator=(const EffectWorkerPool&) = delete;
+
+    size_t numWorkers() const { return mWorkers.size(); }
+
+    // Kernel thread ids of the helpers, for requesting their scheduling priority.
+    std::vector<pid_t> workerTids() const;
+
+    // Runs job(i) for every i in [0, count) and returns when all of them are done.
+    // budgetNs is the time the jobs may take in this period.
+    // Returns true if the helpers were used.
+    bool run(size_t count, const Job& job, int64_t budgetNs);
+
+    // Forces serial execution, e.g. for comparison in a test harness.
+    void setParallelEnabled(bool enabled) { mParallelEnabled = enabled; }
+
+    const Stats& stats() const { return mStats; }
+    std::string toString() const;
+
+    // The helpers are used when the work of a period exceeds this share of its budget.
+    static constexpr int64_t kParallelThresholdDivisor = 4;
+    // Periods run serially after the helpers missed a budget serial execution would have met.
+    static constexpr uint32_t kBackoffPeriods = 64;
+
+private:
+    void threadLoop(size_t index);
+    // Claims and runs jobs of the given generation until none are left.
+    // Returns the number of jobs run.
+    size_t drain(uint32_t generation);
+
+    std::vector<std::thread> mWorkers;
+    std::vector<std::atomic<pid_t>> mWorkerTids;
+
+    // More jobs in a period are run serially.
+    static constexpr uint32_t kMaxJobs = 0xffff;
+
+    // Generation of the current period in bits 32-63, its job count in bits 16-31 and
+    // the index of the next unclaimed job in bits 0-15. Claiming a job is a compare and
+    // swap on the whole, which fails once the period is over.
+    std::atomic<uint64_t> mWork{0};
+    // Job of the current period, written before mWork is published.
+    std::atomic<const Job*> mJob{nullptr};
+
+    // Futex the helpers wait on, incremented for every parallel period and on exit.
+    std::atomic<int32_t> mWakeSeq{0};
+    // Helpers that may still claim or run a job of the current period.
+    // Futex the calling thread waits on.
+    std::atomic<int32_t> mActive{0};
+    std::atomic<uint32_t> mHelperJobs{0};
+    std::atomic<bool> mExit{false};
+
+    // Accessed by the calling thread only.
+    uint32_t mGeneration = 0;
+    int64_t mWorkNs = 0;            // smoothed total job time of a period
+    uint32_t mBackoff = 0;
+    bool mParallelEnabled = true;
+    Stats mStats;
+};
+
+}  // namespace android::afutils
@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Offline replay of the effect processing of a MixerThread.
+ *
+ * Each input WAV file is played on a session of its own, through a chain of
+ * effects loaded from effect libraries. The session chains are processed on an
+ * EffectWorkerPool as in PlaybackThread::processStagedEffectChains(), their output
+ * is mixed, then processed by the output stage chain. The CPU time and duration
+ * of each period are measured and reported against the period budget.
+ *
+ * For example, on a device, three sessions with the bundle equalizer and an output
+ * stage with dynamics processing:
+ *
+ *   LIB=/vendor/lib64/soundfx
+ *   EQ=$LIB/libbundlewrapper.so:ce772f20-847d-11df-bb17-0002a5d5c51b
+ *   DP=$LIB/libdynproc.so:e0e6539b-1781-7261-676f-6d7573696340
+ *   effect_chain_replay -w 2 -r -x $DP -o /data/local/tmp/out.wav \
+ *       -c a.wav=$EQ -c b.wav=$EQ -c c.wav=$EQ
+ */
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <audio_utils/primitives.h>
+#include <audio_utils/sndfile.h>
+#include <hardware/audio_effect.h>
+#include <media/AudioEffect.h>
+#include <utils/Timers.h>
+
+#include "../EffectWorkerPool.h"
+
+using namespace android;
+
+namespace {
+
+constexpr uint32_t kChannelCount = 2;
+
+void usage(const char* name) {
+    fprintf(stderr, "Usage: %s [-w workers] [-f frames] [-b budget] [-r] [-s] [-P]"
+                    " [-o <output-file>] [-x <effects>] (-c <input-file>=<effects>)+\n", name);
+    fprintf(stderr, "    -w    number of helper threads, default 2\n");
+    fprintf(stderr, "    -f    frames per period, default 480\n");
+    fprintf(stderr, "    -b    share of the period given to the session chains, default 0.5\n");
+    fprintf(stderr, "    -r    pace the periods in real time, as on an output thread\n");
+    fprintf(stderr, "    -s    process the session chains serially, for comparison\n");
+    fprintf(stderr, "    -P    print the statistics of every period in CSV format\n");
+    fprintf(stderr, "    -o    <output-file> WAV file, float\n");
+    fprintf(stderr, "    -x    effects of the output stage chain\n");
+    fprintf(stderr, "    -c    an input WAV file played on a session with the given effects\n");
+    fprintf(stderr, "    <effects> is a comma separated list of <library-path>:<effect-uuid>\n");
+}
+
+nsecs_t processCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return s2ns(ts.tv_sec) + ts.tv_nsec;
+}
+
+class Effect {
+public:
+    ~Effect() {
+        if (mHandle != nullptr) {
+            mLibrary->release_effect(mHandle);
+        }
+    }
+
+    // spec is <library-path>:<effect-uuid>
+    static std::unique_ptr<Effect> create(const std::string& spec, int32_t sessionId) {
+        const size_t colon = spec.rfind(':');
+        effect_uuid_t uuid;
+        if (colon == std::string::npos
+                || AudioEffect::stringToGuid(spec.c_str() + colon + 1, &uuid) != NO_ERROR) {
+            fprintf(stderr, "invalid effect %s\n", spec.c_str());
+            return nullptr;
+        }
+        const std::string path = spec.substr(0, colon);
+        void* lib = dlopen(path.c_str(), RTLD_NOW);
+        if (lib == nullptr) {
+            fprintf(stderr, "cannot load %s: %s\n", path.c_str(), dlerror());
+            return nullptr;
+        }
+        auto* library = reinterpret_cast<audio_effect_library_t*>(
+                dlsym(lib, AUDIO_EFFECT_LIBRARY_INFO_SYM_AS_STR));
+        if (library == nullptr) {
+            fprintf(stderr, "%s is not an effect library\n", path.c_str());
+            return nullptr;
+        }
+        auto effect = std::make_unique<Effect>();
+        effect->mLibrary = library;
+        if (int status = library->create_effect(&uuid, sessionId, 1 /* ioId */, &effect->mHandle);
+                status != 0) {
+            fprintf(stderr, "cannot create %s: %d\n", spec.c_str(), status);
+            effect->mHandle = nullptr;
+            return nullptr;
+        }
+        return effect;
+    }
+
+    // Configures the effect to process in place and enables it.
+    int start(uint32_t sampleRate, float* buffer, size_t frameCount) {
+        effect_config_t config{};
+        config.inputCfg.samplingRate = config.outputCfg.samplingRate = sampleRate;
+        config.inputCfg.channels = config.outputCfg.channels = AUDIO_CHANNEL_OUT_STEREO;
+        config.inputCfg.format = config.outputCfg.format = AUDIO_FORMAT_PCM_FLOAT;
+        config.inputCfg.accessMode = EFFECT_BUFFER_ACCESS_READ;
+        config.outputCfg.accessMode = EFFECT_BUFFER_ACCESS_WRITE;
+        config.inputCfg.buffer.frameCount = config.outputCfg.buffer.frameCount = frameCount;
+        config.inputCfg.buffer.f32 = config.outputCfg.buffer.f32 = buffer;
+        config.inputCfg.mask = config.outputCfg.mask = EFFECT_CONFIG_ALL;
+        int reply = 0;
+        uint32_t replySize = sizeof(reply);
+        int status = (*mHandle)->command(mHandle, EFFECT_CMD_SET_CONFIG, sizeof(config), &config,
+                &replySize, &reply);
+        if (status == 0 && reply == 0) {
+            status = (*mHandle)->command(mHandle, EFFECT_CMD_ENABLE, 0, nullptr,
+                    &replySize, &reply);
+        }
+        mBuffer.frameCount = frameCount;
+        mBuffer.f32 = buffer;
+        return status != 0 ? status : reply;
+    }
+
+    void process() {
+        (void)(*mHandle)->process(mHandle, &mBuffer, &mBuffer);
+    }
+
+private:
+    audio_effect_library_t* mLibrary = nullptr;
+    effect_handle_t mHandle = nullptr;
+    audio_buffer_t mBuffer{};
+};
+
+struct Chain {
+    std::vector<std::unique_ptr<Effect>> mEffects;
+    std::vector<float> mBuffer;
+    SNDFILE* mInput = nullptr;
+    uint32_t mInputChannels = 0;
+    std::vector<float> mReadBuffer;
+    bool mDone = false;
+
+    ~Chain() {
+        if (mInput != nullptr) {
+            sf_close(mInput);
+        }
+    }
+
+    bool createEffects(const std::string& specs, int32_t sessionId) {
+        size_t begin = 0;
+        while (begin < specs.size()) {
+            size_t end = specs.find(',', begin);
+            if (end == std::string::npos) {
+                end = specs.size();
+            }
+            auto effect = Effect::create(specs.substr(begin, end - begin), sessionId);
+            if (effect == nullptr) {
+                return false;
+            }
+            mEffects.push_back(std::move(effect));
+            begin = end + 1;
+        }
+        return true;
+    }
+
+    bool start(uint32_t sampleRate, size_t frameCount) {
+        mBuffer.assign(frameCount * kChannelCount, 0.f);
+        mReadBuffer.resize(frameCount * mInputChannels);
+        for (auto& effect : mEffects) {
+            if (int status = effect->start(sampleRate, mBuffer.data(), frameCount); status != 0) {
+                fprintf(stderr, "cannot start effect: %d\n", status);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Reads the next period of the input, as the mixer would write it to the chain
+    // input buffer, zero filled at the end of the file.
+    void read(size_t frameCount) {
+        std::fill(mBuffer.begin(), mBuffer.end(), 0.f);
+        if (mDone) {
+            return;
+        }
+        const sf_count_t frames = sf_readf_float(mInput, mReadBuffer.data(), frameCount);
+        for (sf_count_t i = 0; i < frames; ++i) {
+            for (uint32_t c = 0; c < kChannelCount; ++c) {
+                mBuffer[i * kChannelCount + c] =
+                        mReadBuffer[i * mInputChannels + std::min(c, mInputChannels - 1)];
+            }
+        }
+        mDone = frames < (sf_count_t)frameCount;
+    }
+
+    void process() {
+        for (auto& effect : mEffects) {
+            effect->process();
+        }
+    }
+};
+
+int64_t percentile(std::vector<int64_t> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+void printStats(const char* name, const std::vector<int64_t>& values) {
+    int64_t sum = 0;
+    for (int64_t value : values) {
+        sum += value;
+    }
+    printf("%-10s mean %8.1f  p50 %8.1f  p99 %8.1f  max %8.1f us\n", name,
+            values.empty() ? 0. : sum * 1e-3 / values.size(),
+            percentile(values, 0.5) * 1e-3, percentile(values, 0.99) * 1e-3,
+            percentile(values, 1.) * 1e-3);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* const progname = argv[0];
+    size_t workers = 2;
+    size_t frameCount = 480;
+    double budgetShare = 0.5;
+    bool realTime = false;
+    bool serial = false;
+    bool printPeriods = false;
+    const char* outputFile = nullptr;
+    std::string outputStage;
+    std::vector<std::string> sessions;
+    int ch;
+    while ((ch = getopt(argc, argv, "w:f:b:rsPo:x:c:")) != -1) {
+        switch (ch) {
+        case 'w':
+            workers = atoi(optarg);
+            break;
+        case 'f':
+            frameCount = atoi(optarg);
+            break;
+        case 'b':
+            budgetShare = atof(optarg);
+            break;
+        case 'r':
+            realTime = true;
+            break;
+        case 's':
+            serial = true;
+            break;
+        case 'P':
+            printPeriods = true;
+            break;
+        case 'o':
+            outputFile = optarg;
+            break;
+        case 'x':
+            outputStage = optarg;
+            break;
+        case 'c':
+            sessions.push_back(optarg);
+            break;
+        default:
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+    }
+    if (sessions.empty() || frameCount == 0 || budgetShare <= 0.) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t sampleRate = 0;
+    std::vector<std::unique_ptr<Chain>> chains;
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        const size_t equal = sessions[i].find('=');
+        if (equal == std::string::npos) {
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+        const std::string path = sessions[i].substr(0, equal);
+        auto chain = std::make_unique<Chain>();
+        SF_INFO info{};
+        chain->mInput = sf_open(path.c_str(), SFM_READ, &info);
+        if (chain->mInput == nullptr) {
+            perror(path.c_str());
+            return EXIT_FAILURE;
+        }
+        if (sampleRate != 0 && (uint32_t)info.samplerate != sampleRate) {
+            fprintf(stderr, "%s: sample rate %d differs from %u\n", path.c_str(),
+                    info.samplerate, sampleRate);
+            return EXIT_FAILURE;
+        }
+        sampleRate = info.samplerate;
+        chain->mInputChannels = info.channels;
+        // Sessions start at 1, AUDIO_SESSION_OUTPUT_MIX is 0.
+        if (!chain->createEffects(sessions[i].substr(equal + 1), i + 1)) {
+            return EXIT_FAILURE;
+        }
+        chains.push_back(std::move(chain));
+    }
+    for (auto& chain : chains) {
+        if (!chain->start(sampleRate, frameCount)) {
+            return EXIT_FAILURE;
+        }
+    }
+    Chain outputChain;
+    if (!outputStage.empty() && (!outputChain.createEffects(outputStage, AUDIO_SESSION_OUTPUT_STAGE)
+            || !outputChain.start(sampleRate, frameCount))) {
+        return EXIT_FAILURE;
+    }
+    if (outputStage.empty()) {
+        outputChain.mBuffer.assign(frameCount * kChannelCount, 0.f);
+    }
+
+    SNDFILE* output = nullptr;
+    if (outputFile != nullptr) {
+        SF_INFO info{};
+        info.samplerate = sampleRate;
+        info.channels = kChannelCount;
+        info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        output = sf_open(outputFile, SFM_WRITE, &info);
+        if (output == nullptr) {
+            perror(outputFile);
+            return EXIT_FAILURE;
+        }
+    }
+
+    afutils::EffectWorkerPool pool(workers, "replay");
+    pool.setParallelEnabled(!serial);
+    const int64_t periodNs = s2ns(frameCount) / sampleRate;
+    const int64_t budgetNs = periodNs * budgetShare;
+
+    std::vector<int64_t> elapsed;
+    std::vector<int64_t> cpu;
+    size_t periodMisses = 0;
+    if (printPeriods) {
+        printf("period,elapsed_us,cpu_us,parallel\n");
+    }
+    const nsecs_t startNs = systemTime();
+    for (size_t period = 0; ; ++period) {
+        bool done = true;
+        for (auto& chain : chains) {
+            chain->read(frameCount);
+            done = done && chain->mDone;
+        }
+        if (realTime) {
+            const nsecs_t wakeNs = startNs + period * periodNs;
+            const nsecs_t now = systemTime();
+            if (wakeNs > now) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(wakeNs - now));
+            }
+        }
+
+        const nsecs_t periodStartNs = systemTime();
+        const nsecs_t cpuStartNs = processCpuTimeNs();
+        const bool parallel = pool.run(chains.size(),
+                [&chains](size_t i) { chains[i]->process(); }, budgetNs);
+        float* mix = outputChain.mBuffer.data();
+        std::fill(outputChain.mBuffer.begin(), outputChain.mBuffer.end(), 0.f);
+        for (auto& chain : chains) {
+            accumulate_float(mix, chain->mBuffer.data(), chain->mBuffer.size());
+        }
+        outputChain.process();
+        const int64_t elapsedNs = systemTime() - periodStartNs;
+        const int64_t cpuNs = processCpuTimeNs() - cpuStartNs;
+
+        elapsed.push_back(elapsedNs);
+        cpu.push_back(cpuNs);
+        if (elapsedNs > periodNs) {
+            ++periodMisses;
+        }
+        if (printPeriods) {
+            printf("%zu,%.1f,%.1f,%d\n", period, elapsedNs * 1e-3, cpuNs * 1e-3, parallel);
+        }
+        if (output != nullptr) {
+            sf_writef_float(output, mix, frameCount);
+        }
+        if (done) {
+            break;
+        }
+    }
+    if (output != nullptr) {
+        sf_close(output);
+    }
+
+    printf("%zu sessions, %zu frames at %u Hz: period %.3f ms, session chain budget %.3f ms\n",
+            chains.size(), frameCount, sampleRate, periodNs * 1e-6, budgetNs * 1e-6);
+    printStats("elapsed", elapsed);
+    printStats("cpu", cpu);
+    printf("session chains over budget %" PRIu64 ", periods over period %zu of %zu\n",
+            pool.stats().mMisses, periodMisses, elapsed.size());
+    printf("%s\n", pool.toString().c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "effectworkerpool_tests"
+
+#include "../EffectWorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace android::afutils {
+namespace {
+
+constexpr int64_t kBudgetNs = 5'000'000;  // 5 ms
+
+void busyWait(std::chrono::microseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+// Runs enough heavy periods for the pool to switch to the helpers.
+void warmUp(EffectWorkerPool& pool, size_t count) {
+    for (int i = 0; i < 16; ++i) {
+        pool.run(count, [](size_t) { busyWait(std::chrono::microseconds(1000)); }, kBudgetNs);
+    }
+}
+
+TEST(effectworkerpool_tests, RunsEveryJobOnce) {
+    EffectWorkerPool pool(3, "test");
+    warmUp(pool, 4);
+    for (size_t count : {0, 1, 2, 4, 7, 64}) {
+        std::vector<std::atomic<int>> runs(count);
+        pool.run(count, [&runs](size_t i) {
+            busyWait(std::chrono::microseconds(300));
+            ++runs[i];
+        }, kBudgetNs);
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(1, runs[i].load()) << "job " << i << " of " << count;
+        }
+    }
+}
+
+TEST(effectworkerpool_tests, UsesHelpersForHeavyPeriods) {
+    EffectWorkerPool pool(3, "test");
+    std::mutex lock;
+    std::set<pid_t> tids;
+    const auto job = [&](size_t) {
+        busyWait(std::chrono::microseconds(1000));
+        std::lock_guard l(lock);
+        tids.insert(gettid());
+    };
+    // The first periods are serial, until the pool has seen how heavy they are.
+    EXPECT_FALSE(pool.run(4, job, kBudgetNs));
+    EXPECT_EQ(1u, tids.size());
+    bool parallel = false;
+    for (int i = 0; i < 32 && !parallel; ++i) {
+        parallel = pool.run(4, job, kBudgetNs);
+    }
+    EXPECT_TRUE(parallel);
+    EXPECT_GT(pool.stats().mHelperJobs, 0u);
+    EXPECT_GT(tids.size(), 1u);
+
+    const auto workerTids = pool.workerTids();
+    EXPECT_EQ(3u, workerTids.size());
+    for (const pid_t tid : tids) {
+        EXPECT_TRUE(tid == gettid()
+                || std::find(workerTids.begin(), workerTids.end(), tid) != workerTids.end());
+    }
+}
+
+TEST(effectworkerpool_tests, StaysSerialForLightPeriods) {
+    EffectWorkerPool pool(2, "test");
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_FALSE(pool.run(4, [](size_t) {}, kBudgetNs));
+    }
+    EXPECT_EQ(0u, pool.stats().mParallelPeriods);
+}
+
+TEST(effectworkerpool_tests, SerialWhenDisabled) {
+    EffectWorkerPool pool(2, "test");
+    pool.setParallelEnabled(false);
+    warmUp(pool, 4);
+    EXPECT_EQ(0u, pool.stats().mParallelPeriods);
+    EXPECT_EQ(16u, pool.stats().mPeriods);
+}
+
+TEST(effectworkerpool_tests, BacksOffAfterParallelMiss) {
+    EffectWorkerPool pool(2, "test");
+    warmUp(pool, 2);
+    ASSERT_GT(pool.stats().mParallelPeriods, 0u);
+
+    // A job that blocks (e.g. a helper preempted) makes the period miss a budget the
+    // work alone would have met.
+    const bool parallel = pool.run(2, [](size_t i) {
+        if (i == 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }, kBudgetNs);
+    ASSERT_TRUE(parallel);
+    EXPECT_EQ(1u, pool.stats().mMisses);
+    EXPECT_EQ(1u, pool.stats().mBackoffs);
+    for (uint32_t i = 1; i < EffectWorkerPool::kBackoffPeriods; ++i) {
+        EXPECT_FALSE(pool.run(2, [](size_t) { busyWait(std::chrono::microseconds(1500)); },
+                kBudgetNs)) << "period " << i;
+    }
+    EXPECT_TRUE(pool.run(2, [](size_t) { busyWait(std::chrono::microseconds(1500)); },
+            kBudgetNs));
+}
+
+}  // namespace
+}  // namespace android::afutils
@@ -85,6 +85,18 @@ FastMixerStateQueue* FastMixer::sq()
     return &mSQ;
 }
 
+bool FastMixer::pushTrackUpdate(int index, const FastTrack& fastTrack)
+{
+    FastTrackUpdate update;
+    update.mIndex = index;
+    update.mGeneration = fastTrack.mGeneration;
+    update.mHapticPlaybackEnabled = fastTrack.mHapticPlaybackEnabled;
+    update.mHapticScale = fastTrack.mHapticScale;
+    update.mHapticMaxAmplitude = fastTrack.mHapticMaxAmplitude;
+    update.mPushNs = systemTime(SYSTEM_TIME_MONOTONIC);
+    return mUpdates.push(update);
+}
+
 const FastThreadState *FastMixer::poll()
 {
     return mSQ.poll();
@@ -190,6 +202,42 @@ void FastMixer::updateMixerTrack(int index, Reason reason) {
     }
 }
 
+void FastMixer::applyTrackUpdates()
+{
+    const FastMixerState * const current = (const FastMixerState *) mCurrent;
+    FastMixerDumpState * const dumpState = (FastMixerDumpState *) mDumpState;
+    nsecs_t nowNs = 0;  // read once, only if there are updates
+
+    for (const FastTrackUpdate *update; (update = mUpdates.front()) != nullptr; mUpdates.pop()) {
+        const int index = update->mIndex;
+        ALOG_ASSERT(index >= 0 && index < (int) FastMixerState::kMaxFastTracks);
+        if (update->mGeneration - mGenerations[index] > 0) {
+            // pushed for a state we have not observed yet, keep it (and the following
+            // updates, to preserve their order) until we do.
+            break;
+        }
+        if (update->mGeneration != mGenerations[index]
+                || !(current->mTrackMask & (1 << index)) || mMixer == nullptr) {
+            // the track was reconfigured, or removed, from a more recent state
+            dumpState->mStaleTrackUpdates++;
+            continue;
+        }
+        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_ENABLED,
+                (void *)(uintptr_t)update->mHapticPlaybackEnabled);
+        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_SCALE,
+                (void *)(&(update->mHapticScale)));
+        mMixer->setParameter(index, AudioMixer::TRACK, AudioMixer::HAPTIC_MAX_AMPLITUDE,
+                (void *)(&(update->mHapticMaxAmplitude)));
+
+        if (nowNs == 0) {
+            nowNs = systemTime(SYSTEM_TIME_MONOTONIC);
+        }
+        dumpState->mTrackUpdates++;
+        dumpState->mTrackUpdateLatency[
+                FastMixerDumpState::trackUpdateLatencyBucket(nowNs - update->mPushNs)]++;
+    }
+}
+
 void FastMixer::onStateChange()
 {
     const FastMixerState * const current = (const FastMixerState *) mCurrent;
@@ -350,6 +398,9 @@ void FastMixer::onWork()
     const FastMixerState::Command command = mCommand;
     const size_t frameCount = current->mFrameCount;
 
+    // apply the track updates pushed since the previous cycle
+    applyTrackUpdates();
+
     if ((command & FastMixerState::MIX) && (mMixer != nullptr) && mIsWarm) {
         ALOG_ASSERT(mMixerBuffer != nullptr);
 
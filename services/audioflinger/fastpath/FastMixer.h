@@ -20,6 +20,7 @@
 #include <audio_utils/Balance.h>
 #include "FastThread.h"
 #include "StateQueue.h"
+#include "StateUpdateQueue.h"
 #include "FastMixerState.h"
 #include "FastMixerDumpState.h"
 #include <afutils/NBAIO_Tee.h>
@@ -29,6 +30,7 @@ namespace android {
 class AudioMixer;
 
 using FastMixerStateQueue = StateQueue<FastMixerState>;
+using FastTrackUpdateQueue = StateUpdateQueue<FastTrackUpdate, 64 /* kN */>;
 
 class FastMixer : public FastThread {
 
@@ -39,6 +41,13 @@ public:
 
             FastMixerStateQueue* sq();
 
+    // Queues the haptic fields of fastTrack, which the mixer thread has just changed in the
+    // state being mutated, to be applied at the start of the next cycle without a state push.
+    // Returns false if the update queue is full; the caller must then increment
+    // fastTrack.mGeneration and push the state instead.
+    // May be called from any thread.
+            bool pushTrackUpdate(int index, const FastTrack& fastTrack);
+
     virtual void setMasterMono(bool mono) { mMasterMono.store(mono); /* memory_order_seq_cst */ }
     virtual void setMasterBalance(float balance) { mMasterBalance.store(balance); }
     virtual float getMasterBalance() const { return mMasterBalance.load(); }
@@ -47,6 +56,7 @@ public:
     }
 private:
             FastMixerStateQueue mSQ;
+            FastTrackUpdateQueue mUpdates;
 
     // callouts
     const FastThreadState *poll() override;
@@ -64,6 +74,8 @@ private:
     };
     // called when a fast track of index has been removed, added, or modified
     void updateMixerTrack(int index, Reason reason);
+    // called at the start of each cycle to apply the queued FastTrackUpdates
+    void applyTrackUpdates();
 
     // FIXME these former local variables need comments
     static const FastMixerState sInitial;
@@ -43,6 +43,17 @@ static int compare_uint32_t(const void *pa, const void *pb)
     }
 }
 
+/* static */
+size_t FastMixerDumpState::trackUpdateLatencyBucket(int64_t latencyNs)
+{
+    const int64_t latencyUs = latencyNs / 1000;
+    if (latencyUs < 2) {
+        return 0;
+    }
+    const size_t bucket = 63 - __builtin_clzll((unsigned long long) latencyUs);
+    return bucket < kTrackUpdateLatencyBuckets ? bucket : kTrackUpdateLatencyBuckets - 1;
+}
+
 void FastMixerDumpState::dump(int fd) const
 {
     if (mCommand == FastMixerState::INITIAL) {
@@ -153,6 +164,23 @@ void FastMixerDumpState::dump(int fd) const
         delete[] tail;
     }
 #endif
+    dprintf(fd, "  Track updates: applied=%u stale=%u\n", mTrackUpdates, mStaleTrackUpdates);
+    if (mTrackUpdates > 0) {
+        dprintf(fd, "    push-to-apply latency histogram in us:");
+        for (size_t i = 0; i < kTrackUpdateLatencyBuckets; ++i) {
+            if (mTrackUpdateLatency[i] == 0) {
+                continue;
+            }
+            if (i == 0) {
+                dprintf(fd, " <2:%u", mTrackUpdateLatency[i]);
+            } else if (i == kTrackUpdateLatencyBuckets - 1) {
+                dprintf(fd, " >=%u:%u", 1u << i, mTrackUpdateLatency[i]);
+            } else {
+                dprintf(fd, " %u-%u:%u", 1u << i, 2u << i, mTrackUpdateLatency[i]);
+            }
+        }
+        dprintf(fd, "\n");
+    }
     // The active track mask and track states are updated non-atomically.
     // So if we relied on isActive to decide whether to display,
     // then we might display an obsolete track or omit an active track.
@@ -75,6 +75,14 @@ struct FastMixerDumpState : FastThreadDumpState {
     uint32_t mTrackMask = 0;      // mask of active tracks
     FastTrackDump   mTracks[FastMixerState::kMaxFastTracks];
 
+    // Push-to-apply latency of FastTrackUpdates: bucket i counts latencies in [2^i, 2^(i+1)) us,
+    // except the first bucket which also counts lower and the last bucket higher latencies.
+    static constexpr size_t kTrackUpdateLatencyBuckets = 16;
+    static size_t trackUpdateLatencyBucket(int64_t latencyNs);
+    uint32_t mTrackUpdates = 0;       // total number of track updates applied
+    uint32_t mStaleTrackUpdates = 0;  // total number of track updates superseded by a state push
+    uint32_t mTrackUpdateLatency[kTrackUpdateLatencyBuckets]{};
+
     // For timestamp statistics.
     TimestampVerifier<int64_t /* frame count */, int64_t /* time ns */> mTimestampVerifier;
 };
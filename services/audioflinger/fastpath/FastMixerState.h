@@ -61,6 +61,17 @@ struct FastTrack {
 // No virtuals.
 static_assert(!std::is_polymorphic_v<FastTrack>);
 
+// Represents a change of the fields of a fast track which doesn't require the mixer track to be
+// reconfigured. These are pushed to FastMixer::updates() rather than through the state queue.
+struct FastTrackUpdate {
+    int                     mIndex = -1;         // index in FastMixerState::mFastTracks
+    int                     mGeneration = 0;     // FastTrack::mGeneration the update applies to
+    bool                    mHapticPlaybackEnabled = false;
+    os::HapticScale         mHapticScale = os::HapticScale::mute();
+    float                   mHapticMaxAmplitude = NAN;
+    int64_t                 mPushNs = 0;         // CLOCK_MONOTONIC time of the push
+};
+
 // Represents a single state of the fast mixer
 struct FastMixerState : FastThreadState {
     FastMixerState();
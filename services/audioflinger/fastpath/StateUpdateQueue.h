@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace android {
+
+// StateUpdateQueue is a companion to StateQueue for small changes of the state.
+//
+// StateQueue publishes whole snapshots of the state, which a mutator must copy in full
+// for every push, and which only one mutator thread may push. That is the right tool
+// for changes of the topology (tracks added or removed, output sink reconfigured),
+// but it is heavy for a change of a single field of a single track.
+//
+// StateUpdateQueue carries such changes as individual updates, in a bounded ring:
+//  - any number of mutator threads may push() concurrently. A push never blocks and never
+//    waits for the observer; it claims a slot with a compare-and-swap which only retries
+//    while another mutator is claiming a slot at the same time, and it fails when the ring
+//    is full. The mutator is then expected to fall back to a StateQueue push.
+//  - a single observer thread (the fast thread) drains the ring at the start of its cycle
+//    with front() and pop(). These are wait-free: a slot claimed by a mutator but not yet
+//    published looks empty, and is picked up on the next cycle.
+// Updates are delivered in the order their slots were claimed.
+//
+// T must be trivially copyable, as it is copied from and to the ring without locks.
+
+template<typename T, size_t kN>
+class StateUpdateQueue final {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(kN >= 2 && (kN & (kN - 1)) == 0, "kN must be a power of 2");
+
+public:
+    StateUpdateQueue() {
+        for (size_t i = 0; i < kN; ++i) {
+            mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    StateUpdateQueue(const StateUpdateQueue&) = delete;
+    StateUpdateQueue& operator=(const StateUpdateQueue&) = delete;
+
+    // Mutator API, may be called from any thread.
+    // Returns false if the ring is full, in which case the update was not queued.
+    bool push(const T& update) {
+        size_t position = mPushPosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = mSlots[position & (kN - 1)];
+            const size_t sequence = slot.mSequence.load(std::memory_order_acquire);
+            const intptr_t distance = (intptr_t) sequence - (intptr_t) position;
+            if (distance == 0) {
+                // slot is free for this position: claim it, or reload if another mutator did
+                if (mPushPosition.compare_exchange_weak(position, position + 1,
+                        std::memory_order_relaxed)) {
+                    slot.mUpdate = update;
+                    slot.mSequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (distance < 0) {
+                // slot still holds the update pushed kN positions earlier
+                return false;
+            } else {
+                position = mPushPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Observer API, must only be called by the observer thread.
+    // Returns the oldest published update, or nullptr if there is none.
+    // The update remains valid until the next call to pop().
+    const T* front() const {
+        const Slot& slot = mSlots[mPopPosition & (kN - 1)];
+        if (slot.mSequence.load(std::memory_order_acquire) != mPopPosition + 1) {
+            return nullptr;
+        }
+        return &slot.mUpdate;
+    }
+
+    // Releases the update returned by front(), which must not be nullptr.
+    void pop() {
+        Slot& slot = mSlots[mPopPosition & (kN - 1)];
+        slot.mSequence.store(mPopPosition + kN, std::memory_order_release);
+        ++mPopPosition;
+    }
+
+    static constexpr size_t capacity() { return kN; }
+
+private:
+    struct Slot {
+        // position + 1 when holding the update pushed at position,
+        // position when free to be claimed for position
+        std::atomic<size_t> mSequence;
+        T mUpdate;
+    };
+
+    Slot mSlots[kN];
+    // separate the mutator and observer positions to avoid false sharing
+    alignas(64) std::atomic<size_t> mPushPosition{0};
+    alignas(64) size_t mPopPosition = 0;    // only accessed by observer
+};
+
+}   // namespace android
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../StateUpdateQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace {
+
+struct Update {
+    int mProducer;
+    int mSequence;
+    int64_t mPushNs;
+};
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Push-to-apply latencies, bucket i counts latencies in [2^i, 2^(i+1)) us.
+class LatencyHistogram {
+public:
+    void add(int64_t latencyNs) {
+        const int64_t latencyUs = latencyNs / 1000;
+        size_t bucket = latencyUs < 2 ? 0 : 63 - __builtin_clzll(latencyUs);
+        ++mBuckets[std::min(bucket, kBuckets - 1)];
+        ++mCount;
+    }
+
+    void print(const char *title) const {
+        printf("%s: %zu updates, push-to-apply latency in us\n", title, mCount);
+        for (size_t i = 0; i < kBuckets; ++i) {
+            if (mBuckets[i] == 0) {
+                continue;
+            }
+            printf("  %6s%-6u %8zu  %.2f%%\n", i == 0 ? "<" : "", i == 0 ? 2u : 1u << i,
+                    mBuckets[i], 100. * mBuckets[i] / mCount);
+        }
+    }
+
+private:
+    static constexpr size_t kBuckets = 16;
+    size_t mBuckets[kBuckets]{};
+    size_t mCount = 0;
+};
+
+TEST(stateupdatequeue_tests, EmptyQueue) {
+    StateUpdateQueue<Update, 4> queue;
+    EXPECT_EQ(nullptr, queue.front());
+}
+
+TEST(stateupdatequeue_tests, PushFailsWhenFull) {
+    StateUpdateQueue<Update, 4> queue;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(queue.push({0, i, 0})) << "round " << round;
+        }
+        EXPECT_FALSE(queue.push({0, 4, 0})) << "round " << round;
+        for (int i = 0; i < 4; ++i) {
+            const Update* update = queue.front();
+            ASSERT_NE(nullptr, update);
+            EXPECT_EQ(i, update->mSequence);
+            queue.pop();
+        }
+        EXPECT_EQ(nullptr, queue.front());
+    }
+}
+
+TEST(stateupdatequeue_tests, WrapsAround) {
+    StateUpdateQueue<Update, 8> queue;
+    int popped = 0;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(queue.push({0, i, 0}));
+        if (i % 7 == 6) {
+            for (int j = 0; j < 7; ++j) {
+                const Update* update = queue.front();
+                ASSERT_NE(nullptr, update);
+                EXPECT_EQ(popped++, update->mSequence);
+                queue.pop();
+            }
+        }
+    }
+    for (const Update* update; (update = queue.front()) != nullptr; queue.pop()) {
+        EXPECT_EQ(popped++, update->mSequence);
+    }
+    EXPECT_EQ(1000, popped);
+}
+
+// Several producers push concurrently while the observer drains the queue once per cycle,
+// as FastMixer does. Every update must be delivered exactly once, in per-producer order.
+void stress(int64_t cycleNs, const char *title) {
+    constexpr int kProducers = 4;
+    constexpr int kUpdatesPerProducer = 20000;
+    StateUpdateQueue<Update, 64> queue;
+    std::atomic<int> done{0};
+    std::atomic<int> fullPushes{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < kUpdatesPerProducer; ++i) {
+                while (!queue.push({p, i, nowNs()})) {
+                    // a mixer thread would fall back to a state push here
+                    ++fullPushes;
+                    std::this_thread::yield();
+                }
+                if (i % 64 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            ++done;
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    LatencyHistogram histogram;
+    int received = 0;
+    while (received < kProducers * kUpdatesPerProducer) {
+        const int64_t applyNs = nowNs();
+        for (const Update* update; (update = queue.front()) != nullptr; queue.pop()) {
+            ASSERT_GE(update->mProducer, 0);
+            ASSERT_LT(update->mProducer, kProducers);
+            ASSERT_EQ(next[update->mProducer], update->mSequence)
+                    << "producer " << update->mProducer;
+            ++next[update->mProducer];
+            histogram.add(std::max<int64_t>(0, applyNs - update->mPushNs));
+            ++received;
+        }
+        if (cycleNs > 0) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(cycleNs));
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_EQ(kProducers, done.load());
+    EXPECT_EQ(nullptr, queue.front());
+    for (int p = 0; p < kProducers; ++p) {
+        EXPECT_EQ(kUpdatesPerProducer, next[p]);
+    }
+    histogram.print(title);
+    printf("  pushes retried on a full queue: %d\n", fullPushes.load());
+}
+
+TEST(stateupdatequeue_tests, MultiProducerStressBusyObserver) {
+    stress(0 /* cycleNs */, "busy observer");
+}
+
+TEST(stateupdatequeue_tests, MultiProducerStressPeriodicObserver) {
+    // a 1 ms cycle, within the range of fast mixer periods
+    stress(1'000'000 /* cycleNs */, "1 ms observer cycle");
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <media/AudioCommonTypes.h>
+#include <system/audio.h>
+#include <utils/SortedVector.h>
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include "DeviceDescriptor.h"
+
+namespace android {
+
+/**
+ * Memoizes the output selection decisions of the audio policy manager:
+ * - the stream type and product strategy of audio attributes, which only depend on the
+ *   engine configuration,
+ * - the devices the engine selects for audio attributes,
+ * - the open outputs able to reach a set of devices,
+ * - the output selectOutput() picks among those outputs for a given client configuration.
+ *
+ * All but the first depend on the policy state and are counted against a generation,
+ * which invalidate() increments every time that state changes: connected devices,
+ * phone state, force use, device roles, opened or closed outputs, started or stopped
+ * clients... Invalidation is O(1); stale entries are dropped on the next lookup.
+ *
+ * Not thread safe: used under the audio policy service lock.
+ */
+class OutputSelectionCache {
+public:
+    struct SelectOutputKey {
+        std::vector<audio_io_handle_t> outputs;
+        audio_output_flags_t flags;
+        audio_format_t format;
+        audio_channel_mask_t channelMask;
+        uint32_t samplingRate;
+        bool hasOrphanHaptic;
+
+        bool operator<(const SelectOutputKey& other) const;
+    };
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mEnabled; }
+
+    // Drops every decision depending on the policy state.
+    void invalidate() { ++mGeneration; }
+    uint32_t generation() const { return mGeneration; }
+
+    // The engine may select devices depending on the time elapsed since a stream stopped
+    // (e.g. SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY): its decisions are not cached
+    // until that time.
+    void holdDeviceSelectionUntil(nsecs_t time);
+
+    bool getStreamAndStrategy(const audio_attributes_t& attr, audio_stream_type_t* stream,
+                              product_strategy_t* strategy);
+    void putStreamAndStrategy(const audio_attributes_t& attr, audio_stream_type_t stream,
+                              product_strategy_t strategy);
+
+    bool getDevices(const audio_attributes_t& attr, DeviceVector* devices);
+    void putDevices(const audio_attributes_t& attr, const DeviceVector& devices);
+
+    bool getOutputs(const DeviceVector& devices, SortedVector<audio_io_handle_t>* outputs);
+    void putOutputs(const DeviceVector& devices, const SortedVector<audio_io_handle_t>& outputs);
+
+    bool getSelectedOutput(const SelectOutputKey& key, audio_io_handle_t* output);
+    void putSelectedOutput(const SelectOutputKey& key, audio_io_handle_t output);
+
+    void dump(String8* dst, int spaces = 0) const;
+
+    // A map growing beyond this many entries is cleared.
+    static constexpr size_t kMaxEntries = 256;
+
+private:
+    struct AttributesKey {
+        explicit AttributesKey(const audio_attributes_t& attr) : attr(attr) {}
+        audio_attributes_t attr;
+
+        bool operator<(const AttributesKey& other) const;
+    };
+
+    struct AttributesEntry {
+        bool hasStream = false;
+        audio_stream_type_t stream = AUDIO_STREAM_DEFAULT;
+        product_strategy_t strategy = PRODUCT_STRATEGY_NONE;
+        uint32_t devicesGeneration = 0;  // 0 if devices were never cached
+        DeviceVector devices;
+    };
+
+    static std::vector<audio_port_handle_t> toIds(const DeviceVector& devices);
+    bool canCacheDevices() const;
+    // Drops the output maps if they were filled in an older generation.
+    void checkOutputsGeneration();
+    AttributesEntry& attributesEntry(const audio_attributes_t& attr);
+
+    bool mEnabled = true;
+    uint32_t mGeneration = 1;
+    uint32_t mOutputsGeneration = 1;
+    nsecs_t mDeviceSelectionHoldTime = 0;
+
+    std::map<AttributesKey, AttributesEntry> mAttributes;
+    std::map<std::vector<audio_port_handle_t>, SortedVector<audio_io_handle_t>> mOutputs;
+    std::map<SelectOutputKey, audio_io_handle_t> mSelectedOutputs;
+
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+};
+
+} // namespace android
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "APM::OutputSelectionCache"
+//#define LOG_NDEBUG 0
+
+#include <algorithm>
+#include <string.h>
+#include <tuple>
+
+#include <utils/Log.h>
+
+#include "OutputSelectionCache.h"
+
+namespace android {
+
+bool OutputSelectionCache::SelectOutputKey::operator<(const SelectOutputKey& other) const
+{
+    return std::tie(outputs, flags, format, channelMask, samplingRate, hasOrphanHaptic) <
+            std::tie(other.outputs, other.flags, other.format, other.channelMask,
+                     other.samplingRate, other.hasOrphanHaptic);
+}
+
+bool OutputSelectionCache::AttributesKey::operator<(const AttributesKey& other) const
+{
+    const auto& a = attr;
+    const auto& b = other.attr;
+    if (std::tie(a.usage, a.content_type, a.source, a.flags) !=
+            std::tie(b.usage, b.content_type, b.source, b.flags)) {
+        return std::tie(a.usage, a.content_type, a.source, a.flags) <
+                std::tie(b.usage, b.content_type, b.source, b.flags);
+    }
+    return strncmp(a.tags, b.tags, AUDIO_ATTRIBUTES_TAGS_MAX_SIZE) < 0;
+}
+
+void OutputSelectionCache::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+    mAttributes.clear();
+    mOutputs.clear();
+    mSelectedOutputs.clear();
+}
+
+void OutputSelectionCache::holdDeviceSelectionUntil(nsecs_t time)
+{
+    mDeviceSelectionHoldTime = std::max(mDeviceSelectionHoldTime, time);
+}
+
+std::vector<audio_port_handle_t> OutputSelectionCache::toIds(const DeviceVector& devices)
+{
+    std::vector<audio_port_handle_t> ids;
+    ids.reserve(devices.size());
+    for (const auto& device : devices) {
+        ids.push_back(device->getId());
+    }
+    return ids;
+}
+
+bool OutputSelectionCache::canCacheDevices() const
+{
+    return mDeviceSelectionHoldTime == 0 || systemTime() >= mDeviceSelectionHoldTime;
+}
+
+void OutputSelectionCache::checkOutputsGeneration()
+{
+    if (mOutputsGeneration != mGeneration) {
+        mOutputs.clear();
+        mSelectedOutputs.clear();
+        mOutputsGeneration = mGeneration;
+    }
+}
+
+OutputSelectionCache::AttributesEntry& OutputSelectionCache::attributesEntry(
+        const audio_attributes_t& attr)
+{
+    if (mAttributes.size() >= kMaxEntries) {
+        ALOGV("%s: dropping %zu entries", __func__, mAttributes.size());
+        mAttributes.clear();
+    }
+    return mAttributes[AttributesKey(attr)];
+}
+
+bool OutputSelectionCache::getStreamAndStrategy(const audio_attributes_t& attr,
+        audio_stream_type_t* stream, product_strategy_t* strategy)
+{
+    if (!mEnabled) {
+        return false;
+    }
+    auto it = mAttributes.find(AttributesKey(attr));
+    if (it == mAttributes.end() || !it->second.hasStream) {
+        ++mMisses;
+        return false;
+    }
+    ++mHits;
+    *stream = it->second.stream;
+    *strategy = it->second.strategy;
+    return true;
+}
+
+void OutputSelectionCache::putStreamAndStrategy(const audio_attributes_t& attr,
+        audio_stream_type_t stream, product_strategy_t strategy)
+{
+    if (!mEnabled) {
+        return;
+    }
+    AttributesEntry& entry = attributesEntry(attr);
+    entry.hasStream = true;
+    entry.stream = stream;
+    entry.strategy = strategy;
+}
+
+bool OutputSelectionCache::getDevices(const audio_attributes_t& attr, DeviceVector* devices)
+{
+    if (!mEnabled || !canCacheDevices()) {
+        return false;
+    }
+    auto it = mAttributes.find(AttributesKey(attr));
+    if (it == mAttributes.end() || it->second.devicesGeneration != mGeneration) {
+        ++mMisses;
+        return false;
+    }
+    ++mHits;
+    *devices = it->second.devices;
+    return true;
+}
+
+void OutputSelectionCache::putDevices(const audio_attributes_t& attr, const DeviceVector& devices)
+{
+    if (!mEnabled || !canCacheDevices()) {
+        return;
+    }
+    AttributesEntry& entry = attributesEntry(attr);
+    entry.devicesGeneration = mGeneration;
+    entry.devices = devices;
+}
+
+bool OutputSelectionCache::getOutputs(const DeviceVector& devices,
+        SortedVector<audio_io_handle_t>* outputs)
+{
+    if (!mEnabled) {
+        return false;
+    }
+    checkOutputsGeneration();
+    auto it = mOutputs.find(toIds(devices));
+    if (it == mOutputs.end()) {
+        ++mMisses;
+        return false;
+    }
+    ++mHits;
+    *outputs = it->second;
+    return true;
+}
+
+void OutputSelectionCache::putOutputs(const DeviceVector& devices,
+        const SortedVector<audio_io_handle_t>& outputs)
+{
+    if (!mEnabled) {
+        return;
+    }
+    checkOutputsGeneration();
+    if (mOutputs.size() >= kMaxEntries) {
+        mOutputs.clear();
+    }
+    mOutputs[toIds(devices)] = outputs;
+}
+
+bool OutputSelectionCache::getSelectedOutput(const SelectOutputKey& key,
+        audio_io_handle_t* output)
+{
+    if (!mEnabled) {
+        return false;
+    }
+    checkOutputsGeneration();
+    auto it = mSelectedOutputs.find(key);
+    if (it == mSelectedOutputs.end()) {
+        ++mMisses;
+        return false;
+    }
+    ++mHits;
+    *output = it->second;
+    return true;
+}
+
+void OutputSelectionCache::putSelectedOutput(const SelectOutputKey& key,
+        audio_io_handle_t output)
+{
+    if (!mEnabled) {
+        return;
+    }
+    checkOutputsGeneration();
+    if (mSelectedOutputs.size() >= kMaxEntries) {
+        mSelectedOutputs.clear();
+    }
+    mSelectedOutputs[key] = output;
+}
+
+void OutputSelectionCache::dump(String8* dst, int spaces) const
+{
+    dst->appendFormat("%*sOutput selection cache: %s, generation %u, %zu attributes, "
+            "%zu device sets, %zu selections, %llu hits, %llu misses\n", spaces, "",
+            mEnabled ? "enabled" : "disabled", mGeneration, mAttributes.size(),
+            mOutputs.size(), mSelectedOutputs.size(), (unsigned long long)mHits,
+            (unsigned long long)mMisses);
+}
+
+} // namespace android
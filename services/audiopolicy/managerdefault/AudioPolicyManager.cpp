@@ -249,6 +249,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
             if (mAvailableOutputDevices.add(device) < 0) {
                 return NO_MEMORY;
             }
+            mOutputSelectionCache.invalidate();
 
             // Before checking outputs, broadcast connect event to allow HAL to retrieve dynamic
             // parameters on newly connected devices (instead of opening the outputs...)
@@ -256,6 +257,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
 
             if (checkOutputsForDevice(device, state, outputs) != NO_ERROR) {
                 mAvailableOutputDevices.remove(device);
+                mOutputSelectionCache.invalidate();
 
                 broadcastDeviceConnectionState(device, media::DeviceConnectedState::DISCONNECTED);
 
@@ -289,6 +291,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
             mAvailableOutputDevices.remove(device);
 
             mOutputs.clearSessionRoutesForDevice(device);
+            mOutputSelectionCache.invalidate();
 
             checkOutputsForDevice(device, state, outputs);
 
@@ -297,6 +300,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
 
             // Reset active device codec
             device->setEncodedFormat(AUDIO_FORMAT_DEFAULT);
+            mOutputSelectionCache.invalidate();
 
             // remove device from mReportedFormatsMap cache
             mReportedFormatsMap.erase(device);
@@ -435,6 +439,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
             if (mAvailableInputDevices.add(device) < 0) {
                 return NO_MEMORY;
             }
+            mOutputSelectionCache.invalidate();
 
             // Before checking intputs, broadcast connect event to allow HAL to retrieve dynamic
             // parameters on newly connected devices (instead of opening the inputs...)
@@ -446,6 +451,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
                 setEngineDeviceConnectionState(device, AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE);
 
                 mAvailableInputDevices.remove(device);
+                mOutputSelectionCache.invalidate();
 
                 broadcastDeviceConnectionState(device, media::DeviceConnectedState::DISCONNECTED);
 
@@ -470,6 +476,7 @@ status_t AudioPolicyManager::setDeviceConnectionStateInt(const sp<DeviceDescript
                     device, media::DeviceConnectedState::PREPARE_TO_DISCONNECT);
 
             mAvailableInputDevices.remove(device);
+            mOutputSelectionCache.invalidate();
 
             checkInputsForDevice(device, state);
 
@@ -522,6 +529,7 @@ status_t AudioPolicyManager::deviceToAudioPort(audio_devices_t device, const cha
 
 void AudioPolicyManager::setEngineDeviceConnectionState(const sp<DeviceDescriptor> device,
                                       audio_policy_dev_state_t state) {
+    mOutputSelectionCache.invalidate();
 
     // the Engine does not have to know about remote submix devices used by dynamic audio policies
     if (audio_is_remote_submix_device(device->type()) && device->address() != "0") {
@@ -956,6 +964,7 @@ void AudioPolicyManager::setPhoneState(audio_mode_t state)
         ALOGW("setPhoneState() invalid or same state %d", state);
         return;
     }
+    mOutputSelectionCache.invalidate();
     /// Opens: can these line be executed after the switch of volume curves???
     if (isStateInCall(oldState)) {
         ALOGV("setPhoneState() in call state management: new state is %d", state);
@@ -1083,6 +1092,7 @@ void AudioPolicyManager::setForceUse(audio_policy_force_use_t usage,
         ALOGW("setForceUse() could not set force cfg %d for usage %d", config, usage);
         return;
     }
+    mOutputSelectionCache.invalidate();
     bool forceVolumeReeval = (usage == AUDIO_POLICY_FORCE_FOR_COMMUNICATION) ||
             (usage == AUDIO_POLICY_FORCE_FOR_DOCK) ||
             (usage == AUDIO_POLICY_FORCE_FOR_SYSTEM);
@@ -1327,7 +1337,8 @@ status_t AudioPolicyManager::getOutputForAttrInt(
     if (auto it = mAllowedCapturePolicies.find(uid); it != end(mAllowedCapturePolicies)) {
         resultAttr->flags = static_cast<audio_flags_mask_t>(resultAttr->flags | it->second);
     }
-    *stream = mEngine->getStreamTypeForAttributes(*resultAttr);
+    product_strategy_t strategy;
+    getStreamAndStrategyForAttributes(*resultAttr, stream, &strategy);
 
     ALOGV("%s() attributes=%s stream=%s session %d selectedDeviceId %d", __func__,
           toString(*resultAttr).c_str(), toString(*stream).c_str(), session, requestedPortId);
@@ -1418,7 +1429,7 @@ status_t AudioPolicyManager::getOutputForAttrInt(
     }
     // explicit routing managed by getDeviceForStrategy in APM is now handled by engine
     // in order to let the choice of the order to future vendor engine
-    outputDevices = mEngine->getOutputDevicesForAttributes(*resultAttr, requestedDevice, false);
+    outputDevices = getCachedOutputDevicesForAttributes(*resultAttr, requestedDevice);
 
     if ((resultAttr->flags & AUDIO_FLAG_HW_AV_SYNC) != 0) {
         *flags = (audio_output_flags_t)(*flags | AUDIO_OUTPUT_FLAG_HW_AV_SYNC);
@@ -1457,8 +1468,7 @@ status_t AudioPolicyManager::getOutputForAttrInt(
         sp<PreferredMixerAttributesInfo> info = nullptr;
         if (outputDevices.size() == 1) {
             info = getPreferredMixerAttributesInfo(
-                    outputDevices.itemAt(0)->getId(),
-                    mEngine->getProductStrategyForAttributes(*resultAttr),
+                    outputDevices.itemAt(0)->getId(), strategy,
                     true /*activeBitPerfectPreferred*/);
             // Only use preferred mixer if the uid matches or the preferred mixer is bit-perfect
             // and it is currently active.
@@ -2298,6 +2308,17 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
         }
     }
 
+    // The choice only depends on the session through its orphan haptic generator, if any
+    const bool hasOrphanHaptic =
+            mEffects.hasOrphanEffectsForSessionAndType(sessionId, FX_IID_HAPTICGENERATOR);
+    const OutputSelectionCache::SelectOutputKey cacheKey = {
+            std::vector<audio_io_handle_t>(outputs.begin(), outputs.end()),
+            flags, format, channelMask, samplingRate, hasOrphanHaptic};
+    audio_io_handle_t cachedOutput;
+    if (mOutputSelectionCache.getSelectedOutput(cacheKey, &cachedOutput)) {
+        return cachedOutput;
+    }
+
     // Flags disqualifying an output: the match must happen before calling selectOutput()
     static const audio_output_flags_t kExcludedFlags = (audio_output_flags_t)
         (AUDIO_OUTPUT_FLAG_HW_AV_SYNC | AUDIO_OUTPUT_FLAG_MMAP_NOIRQ | AUDIO_OUTPUT_FLAG_DIRECT);
@@ -2340,8 +2361,6 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
     // matching criteria values in priority order for best matching output so far
     std::vector<uint32_t> bestMatchCriteria(8, 0);
 
-    const bool hasOrphanHaptic =
-            mEffects.hasOrphanEffectsForSessionAndType(sessionId, FX_IID_HAPTICGENERATOR);
     const uint32_t channelCount = audio_channel_count_from_out_mask(channelMask);
     const uint32_t hapticChannelCount = audio_channel_count_from_out_mask(
         channelMask & AUDIO_CHANNEL_HAPTIC_ALL);
@@ -2438,6 +2457,7 @@ audio_io_handle_t AudioPolicyManager::selectOutput(const SortedVector<audio_io_h
         }
     }
 
+    mOutputSelectionCache.putSelectedOutput(cacheKey, bestOutput);
     return bestOutput;
 }
 
@@ -2631,6 +2651,7 @@ status_t AudioPolicyManager::startSource(const sp<SwAudioOutputDescriptor>& outp
     // NOTE that the usage count is the same for duplicated output and hardware output which is
     // necessary for a correct control of hardware output routing by startOutput() and stopOutput()
     outputDesc->setClientActive(client, true);
+    mOutputSelectionCache.invalidate();
 
     if (client->hasPreferredDevice(true)) {
         if (outputDesc->sameExclusivePreferredDevicesCount() > 0) {
@@ -2895,10 +2916,15 @@ status_t AudioPolicyManager::stopSource(const sp<SwAudioOutputDescriptor>& outpu
 
         // decrement usage count of this stream on the output
         outputDesc->setClientActive(client, false);
+        mOutputSelectionCache.invalidate();
 
         // store time at which the stream was stopped - see isStreamActive()
         if (outputDesc->getActivityCount(clientVolSrc) == 0 || forceDeviceUpdate) {
-            outputDesc->setStopTime(client, systemTime());
+            const nsecs_t stopTime = systemTime();
+            outputDesc->setStopTime(client, stopTime);
+            // The engine routes sonification differently shortly after music stopped
+            mOutputSelectionCache.holdDeviceSelectionUntil(
+                    stopTime + ms2ns(SONIFICATION_RESPECTFUL_AFTER_MUSIC_DELAY));
             DeviceVector newDevices = getNewOutputDevices(outputDesc, false /*fromCache*/);
 
             // If the routing does not change, if an output is routed on a device using HwGain
@@ -3052,6 +3078,7 @@ status_t AudioPolicyManager::getInputForAttr(const audio_attributes_t *attr,
         for (size_t i = 0; i < usbDevices.size(); i++) {
             mAvailableInputDevices.remove(usbDevices[i]);
         }
+        mOutputSelectionCache.invalidate();
     }
 
     // The supplied portId must be AUDIO_PORT_HANDLE_NONE
@@ -3229,6 +3256,7 @@ error:
         for (size_t i = 0; i < usbDevices.size(); i++) {
             mAvailableInputDevices.add(usbDevices[i]);
         }
+        mOutputSelectionCache.invalidate();
     }
     return status;
 }
@@ -3400,6 +3428,7 @@ status_t AudioPolicyManager::startInput(audio_port_handle_t portId)
     // increment activity count before calling getNewInputDevice() below as only active sessions
     // are considered for device selection
     inputDesc->setClientActive(client, true);
+    mOutputSelectionCache.invalidate();
 
     // indicate active capture to sound trigger service if starting capture from a mic on
     // primary HW module
@@ -3446,6 +3475,7 @@ status_t AudioPolicyManager::startInput(audio_port_handle_t portId)
     } else if (status != NO_ERROR) {
         // Restore client activity state.
         inputDesc->setClientActive(client, false);
+        mOutputSelectionCache.invalidate();
         inputDesc->stop();
     }
 
@@ -3472,6 +3502,7 @@ status_t AudioPolicyManager::stopInput(audio_port_handle_t portId)
     }
     auto old_source = inputDesc->source();
     inputDesc->setClientActive(client, false);
+    mOutputSelectionCache.invalidate();
 
     inputDesc->stop();
     if (inputDesc->isActive()) {
@@ -4422,6 +4453,7 @@ status_t AudioPolicyManager::setDevicesRoleForStrategy(product_strategy_t strate
                 dumpAudioDeviceTypeAddrVector(devices).c_str(), strategy, role);
         return status;
     }
+    mOutputSelectionCache.invalidate();
 
     checkForDeviceAndOutputChanges();
 
@@ -4514,6 +4546,7 @@ AudioPolicyManager::removeDevicesRoleForStrategy(product_strategy_t strategy,
                 dumpAudioDeviceTypeAddrVector(devices).c_str(), strategy, role);
         return status;
     }
+    mOutputSelectionCache.invalidate();
 
     checkForDeviceAndOutputChanges();
 
@@ -4543,6 +4576,7 @@ status_t AudioPolicyManager::clearDevicesRoleForStrategy(product_strategy_t stra
                 strategy, status);
         return status;
     }
+    mOutputSelectionCache.invalidate();
 
     checkForDeviceAndOutputChanges();
 
@@ -4716,6 +4750,7 @@ void AudioPolicyManager::dump(String8 *dst) const
     mAvailableInputDevices.dump(dst, String8("Available input"), 1);
     mHwModules.dump(dst);
     mOutputs.dump(dst);
+    mOutputSelectionCache.dump(dst);
     mInputs.dump(dst);
     mEffects.dump(dst, 1);
     mAudioPatches.dump(dst);
@@ -5453,6 +5488,7 @@ status_t AudioPolicyManager::createAudioPatchInternal(const struct audio_patch *
                                                       const sp<SourceClientDescriptor>& sourceDesc)
 {
     ALOGV("%s num sources %d num sinks %d", __func__, patch->num_sources, patch->num_sinks);
+    mOutputSelectionCache.invalidate();
     sp<AudioPatch> patchDesc;
     ssize_t index = mAudioPatches.indexOfKey(*handle);
 
@@ -5779,6 +5815,7 @@ status_t AudioPolicyManager::releaseAudioPatchInternal(audio_patch_handle_t hand
         ALOGE("%s: no patch found with handle=%d", __func__, handle);
         return BAD_VALUE;
     }
+    mOutputSelectionCache.invalidate();
     sp<AudioPatch> patchDesc = mAudioPatches.valueFor(handle);
     struct audio_patch *patch = &patchDesc->mPatch;
     patchDesc->setUid(mUidCached);
@@ -5983,6 +6020,7 @@ void AudioPolicyManager::checkStrategyRoute(product_strategy_t ps, audio_io_hand
 
 void AudioPolicyManager::clearSessionRoutes(uid_t uid)
 {
+    mOutputSelectionCache.invalidate();
     // remove output routes associated with this uid
     std::vector<product_strategy_t> affectedStrategies;
     for (size_t i = 0; i < mOutputs.size(); i++) {
@@ -6748,6 +6786,8 @@ status_t AudioPolicyManager::initialize() {
         return NO_INIT;
     }
     mEngine->setObserver(this);
+    mOutputSelectionCache.setEnabled(
+            property_get_bool("audio.policy.output_selection_cache", true /* default_value */));
     status_t status = mEngine->initCheck();
     if (status != NO_ERROR) {
         LOG_FATAL("Policy engine not initialized(err=%d)", status);
@@ -6998,6 +7038,7 @@ void AudioPolicyManager::addOutput(audio_io_handle_t output,
                                    const sp<SwAudioOutputDescriptor>& outputDesc)
 {
     mOutputs.add(output, outputDesc);
+    mOutputSelectionCache.invalidate();
     applyStreamVolumes(outputDesc, DeviceTypeSet(), 0 /* delayMs */, true /* force */);
     updateMono(output); // update mono status when adding to output list
     selectOutputForMusicEffects();
@@ -7011,6 +7052,7 @@ void AudioPolicyManager::removeOutput(audio_io_handle_t output)
         mPrimaryOutput = nullptr;
     }
     mOutputs.removeItem(output);
+    mOutputSelectionCache.invalidate();
     selectOutputForMusicEffects();
 }
 
@@ -7461,6 +7503,11 @@ SortedVector<audio_io_handle_t> AudioPolicyManager::getOutputsForDevices(
             const SwAudioOutputCollection& openOutputs)
 {
     SortedVector<audio_io_handle_t> outputs;
+    // Only the current outputs are cached, not mPreviousOutputs
+    const bool cacheable = &openOutputs == &mOutputs;
+    if (cacheable && mOutputSelectionCache.getOutputs(devices, &outputs)) {
+        return outputs;
+    }
 
     ALOGVV("%s() devices %s", __func__, devices.toString().c_str());
     for (size_t i = 0; i < openOutputs.size(); i++) {
@@ -7473,9 +7520,38 @@ SortedVector<audio_io_handle_t> AudioPolicyManager::getOutputsForDevices(
             outputs.add(openOutputs.keyAt(i));
         }
     }
+    if (cacheable) {
+        mOutputSelectionCache.putOutputs(devices, outputs);
+    }
     return outputs;
 }
 
+void AudioPolicyManager::getStreamAndStrategyForAttributes(const audio_attributes_t& attr,
+                                                           audio_stream_type_t* stream,
+                                                           product_strategy_t* strategy)
+{
+    if (!mOutputSelectionCache.getStreamAndStrategy(attr, stream, strategy)) {
+        *stream = mEngine->getStreamTypeForAttributes(attr);
+        *strategy = mEngine->getProductStrategyForAttributes(attr);
+        mOutputSelectionCache.putStreamAndStrategy(attr, *stream, *strategy);
+    }
+}
+
+DeviceVector AudioPolicyManager::getCachedOutputDevicesForAttributes(
+        const audio_attributes_t& attr, const sp<DeviceDescriptor>& preferredDevice)
+{
+    // explicit routing does not depend on the policy state
+    if (preferredDevice != nullptr) {
+        return mEngine->getOutputDevicesForAttributes(attr, preferredDevice, false /*fromCache*/);
+    }
+    DeviceVector devices;
+    if (!mOutputSelectionCache.getDevices(attr, &devices)) {
+        devices = mEngine->getOutputDevicesForAttributes(attr, nullptr, false /*fromCache*/);
+        mOutputSelectionCache.putDevices(attr, devices);
+    }
+    return devices;
+}
+
 void AudioPolicyManager::checkForDeviceAndOutputChanges(std::function<bool()> onOutputsChecked)
 {
     // checkA2dpSuspend must run before checkOutputForAllStrategies so that A2DP
@@ -7664,6 +7740,7 @@ void AudioPolicyManager::checkOutputForAttributes(const audio_attributes_t &attr
 
 void AudioPolicyManager::checkOutputForAllStrategies()
 {
+    mOutputSelectionCache.invalidate();
     for (const auto &strategy : mEngine->getOrderedProductStrategies()) {
         auto attributes = mEngine->getAllAttributesForProductStrategy(strategy).front();
         checkOutputForAttributes(attributes);
@@ -8127,6 +8204,8 @@ uint32_t AudioPolicyManager::setOutputDevices(const char *caller,
                                               bool skipMuteDelay)
 {
     // TODO(b/262404095): Consider if the output need to be reopened.
+    // The engine selects devices depending on the devices the active outputs are routed to.
+    mOutputSelectionCache.invalidate();
     std::string logPrefix = std::string("caller ") + caller + outputDesc->info();
     ALOGV("%s %s device %s delayMs %d", __func__, logPrefix.c_str(),
           devices.toString().c_str(), delayMs);
@@ -8230,6 +8309,7 @@ status_t AudioPolicyManager::resetOutputDevice(const sp<AudioOutputDescriptor>&
     if (patchHandle == nullptr && !outputDesc->isRouted()) {
         return INVALID_OPERATION;
     }
+    mOutputSelectionCache.invalidate();
     if (patchHandle) {
         index = mAudioPatches.indexOfKey(*patchHandle);
     } else {
@@ -8257,6 +8337,7 @@ status_t AudioPolicyManager::setInputDevice(audio_io_handle_t input,
 
     sp<AudioInputDescriptor> inputDesc = mInputs.valueFor(input);
     if ((device != nullptr) && ((device != inputDesc->getDevice()) || force)) {
+        mOutputSelectionCache.invalidate();
         inputDesc->setDevice(device);
 
         if (mAvailableInputDevices.contains(device)) {
@@ -8291,6 +8372,7 @@ status_t AudioPolicyManager::resetInputDevice(audio_io_handle_t input,
     if (index < 0) {
         return INVALID_OPERATION;
     }
+    mOutputSelectionCache.invalidate();
     sp< AudioPatch> patchDesc = mAudioPatches.valueAt(index);
     status_t status = mpClientInterface->releaseAudioPatch(patchDesc->getAfHandle(), 0);
     ALOGV("resetInputDevice() releaseAudioPatch returned %d", status);
@@ -9284,8 +9366,7 @@ status_t AudioPolicyManager::getDevicesForAttributes(
         // which selects setPreferredDevice if active.  This means forVolume call
         // will take an active setPreferredDevice, if such exists.
 
-        devices = mEngine->getOutputDevicesForAttributes(
-                attr, nullptr /* preferredDevice */, false /* fromCache */);
+        devices = getCachedOutputDevicesForAttributes(attr, nullptr /* preferredDevice */);
     }
 
     if (forVolume) {
@@ -9386,6 +9467,7 @@ void AudioPolicyManager::chkDpConnAndAllowedForVoice(audio_devices_t device,
             }
         }
         mEngine->setDpConnAndAllowedForVoice(connect & allowed);
+        mOutputSelectionCache.invalidate();
     }
 }
 
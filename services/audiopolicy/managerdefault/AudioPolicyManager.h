@@ -48,6 +48,7 @@
 #include <AudioOutputDescriptor.h>
 #include <AudioPolicyMix.h>
 #include <EffectDescriptor.h>
+#include <OutputSelectionCache.h>
 #include <PreferredMixerAttributesInfo.h>
 #include <SoundTriggerSession.h>
 #include "EngineLibrary.h"
@@ -795,6 +796,13 @@ protected:
         SortedVector<audio_io_handle_t> getOutputsForDevices(
                 const DeviceVector &devices, const SwAudioOutputCollection& openOutputs);
 
+        // Engine decisions for the attributes, memoized in mOutputSelectionCache.
+        void getStreamAndStrategyForAttributes(const audio_attributes_t& attr,
+                                               audio_stream_type_t* stream,
+                                               product_strategy_t* strategy);
+        DeviceVector getCachedOutputDevicesForAttributes(
+                const audio_attributes_t& attr, const sp<DeviceDescriptor>& preferredDevice);
+
         /**
          * @brief checkDeviceMuteStrategies mute/unmute strategies
          *      using an incompatible device combination.
@@ -993,6 +1001,9 @@ protected:
         // copy of mOutputs before setDeviceConnectionState() opens new outputs
         // reset to mOutputs when updateDevicesAndOutputs() is called.
         SwAudioOutputCollection mPreviousOutputs;
+        // output selection decisions for the current policy state: must be invalidated
+        // every time a condition that affects them changes (see OutputSelectionCache.h)
+        OutputSelectionCache mOutputSelectionCache;
         AudioInputCollection mInputs;     // list of input descriptors
 
         DeviceVector  mAvailableOutputDevices; // all available output devices
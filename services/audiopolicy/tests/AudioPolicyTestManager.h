@@ -46,6 +46,7 @@ class AudioPolicyTestManager : public AudioPolicyManager {
     using AudioPolicyManager::handleDeviceConfigChange;
     uint32_t getAudioPortGeneration() const { return mAudioPortGeneration; }
     HwModuleCollection getHwModules() const { return mHwModules; }
+    OutputSelectionCache& getOutputSelectionCache() { return mOutputSelectionCache; }
 };
 
 }  // namespace android
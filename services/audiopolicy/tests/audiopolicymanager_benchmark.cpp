@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the default engine configuration through storms of attribute queries, as issued by
+// apps creating their AudioTracks at start-up, with and without the output selection cache.
+//
+// $ atest audiopolicymanager_benchmark
+
+#include <memory>
+#include <vector>
+
+#include <android/content/AttributionSourceState.h>
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+
+#include "AudioPolicyManagerTestClient.h"
+#include "AudioPolicyTestManager.h"
+
+using namespace android;
+using android::content::AttributionSourceState;
+
+namespace {
+
+constexpr int kQueriesPerStorm = 4096;
+
+class Manager {
+public:
+    explicit Manager(bool cacheEnabled) {
+        mClient = std::make_unique<AudioPolicyManagerTestClient>();
+        auto config = AudioPolicyConfig::createWritableForTests();
+        config->setDefault();
+        mManager = std::make_unique<AudioPolicyTestManager>(config, mClient.get());
+        mInitStatus = mManager->initialize();
+        mManager->getOutputSelectionCache().setEnabled(cacheEnabled);
+        mAttributionSource.uid = 10042;
+        mAttributionSource.token = sp<BBinder>::make();
+    }
+
+    status_t initStatus() const { return mInitStatus; }
+    AudioPolicyTestManager* operator->() { return mManager.get(); }
+
+    // Creates and releases a track, as AudioTrack::set() followed by the destruction of a
+    // track that was never started.
+    status_t createTrack(const audio_attributes_t& attr) {
+        audio_io_handle_t output = AUDIO_IO_HANDLE_NONE;
+        audio_stream_type_t stream = AUDIO_STREAM_DEFAULT;
+        audio_config_t config = AUDIO_CONFIG_INITIALIZER;
+        config.sample_rate = 48000;
+        config.channel_mask = AUDIO_CHANNEL_OUT_STEREO;
+        config.format = AUDIO_FORMAT_PCM_16_BIT;
+        audio_output_flags_t flags = AUDIO_OUTPUT_FLAG_NONE;
+        audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+        audio_port_handle_t portId = AUDIO_PORT_HANDLE_NONE;
+        AudioPolicyInterface::output_type_t outputType;
+        bool isSpatialized;
+        bool isBitPerfect;
+        const status_t status = mManager->getOutputForAttr(&attr, &output,
+                AUDIO_SESSION_NONE, &stream, mAttributionSource, &config, &flags,
+                &selectedDeviceId, &portId, nullptr /*secondaryOutputs*/, &outputType,
+                &isSpatialized, &isBitPerfect);
+        if (status == NO_ERROR) {
+            mManager->releaseOutput(portId);
+        }
+        return status;
+    }
+
+private:
+    std::unique_ptr<AudioPolicyManagerTestClient> mClient;
+    std::unique_ptr<AudioPolicyTestManager> mManager;
+    AttributionSourceState mAttributionSource;
+    status_t mInitStatus = NO_INIT;
+};
+
+// The attributes of the tracks an app start-up storm creates.
+std::vector<audio_attributes_t> stormAttributes() {
+    const std::vector<std::pair<audio_usage_t, audio_content_type_t>> uses = {
+        {AUDIO_USAGE_MEDIA, AUDIO_CONTENT_TYPE_MUSIC},
+        {AUDIO_USAGE_MEDIA, AUDIO_CONTENT_TYPE_MOVIE},
+        {AUDIO_USAGE_GAME, AUDIO_CONTENT_TYPE_SONIFICATION},
+        {AUDIO_USAGE_GAME, AUDIO_CONTENT_TYPE_MUSIC},
+        {AUDIO_USAGE_ASSISTANCE_SONIFICATION, AUDIO_CONTENT_TYPE_SONIFICATION},
+        {AUDIO_USAGE_NOTIFICATION, AUDIO_CONTENT_TYPE_SONIFICATION},
+        {AUDIO_USAGE_NOTIFICATION_TELEPHONY_RINGTONE, AUDIO_CONTENT_TYPE_SONIFICATION},
+        {AUDIO_USAGE_ALARM, AUDIO_CONTENT_TYPE_SONIFICATION},
+        {AUDIO_USAGE_ASSISTANT, AUDIO_CONTENT_TYPE_SPEECH},
+        {AUDIO_USAGE_ASSISTANCE_NAVIGATION_GUIDANCE, AUDIO_CONTENT_TYPE_SPEECH},
+        {AUDIO_USAGE_ASSISTANCE_ACCESSIBILITY, AUDIO_CONTENT_TYPE_SPEECH},
+        {AUDIO_USAGE_UNKNOWN, AUDIO_CONTENT_TYPE_UNKNOWN},
+    };
+    std::vector<audio_attributes_t> attributes;
+    for (const auto& [usage, contentType] : uses) {
+        audio_attributes_t attr = AUDIO_ATTRIBUTES_INITIALIZER;
+        attr.usage = usage;
+        attr.content_type = contentType;
+        attributes.push_back(attr);
+    }
+    return attributes;
+}
+
+// Argument: output selection cache enabled.
+void BM_GetOutputForAttrStorm(benchmark::State& state) {
+    Manager manager(state.range(0) != 0);
+    if (manager.initStatus() != NO_ERROR) {
+        state.SkipWithError("initialize failed");
+        return;
+    }
+    const std::vector<audio_attributes_t> attributes = stormAttributes();
+    for (auto _ : state) {
+        for (int i = 0; i < kQueriesPerStorm; ++i) {
+            if (manager.createTrack(attributes[i % attributes.size()]) != NO_ERROR) {
+                state.SkipWithError("getOutputForAttr failed");
+                return;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kQueriesPerStorm);
+}
+
+// Argument: output selection cache enabled.
+void BM_GetDevicesForAttributesStorm(benchmark::State& state) {
+    Manager manager(state.range(0) != 0);
+    if (manager.initStatus() != NO_ERROR) {
+        state.SkipWithError("initialize failed");
+        return;
+    }
+    const std::vector<audio_attributes_t> attributes = stormAttributes();
+    for (auto _ : state) {
+        for (int i = 0; i < kQueriesPerStorm; ++i) {
+            AudioDeviceTypeAddrVector devices;
+            manager->getDevicesForAttributes(attributes[i % attributes.size()], &devices,
+                    false /*forVolume*/);
+            benchmark::DoNotOptimize(devices.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kQueriesPerStorm);
+}
+
+// Queries interleaved with forced use changes, each of which invalidates the cache.
+// Arguments: output selection cache enabled, queries between two changes.
+void BM_GetOutputForAttrWithForceUseChanges(benchmark::State& state) {
+    Manager manager(state.range(0) != 0);
+    if (manager.initStatus() != NO_ERROR) {
+        state.SkipWithError("initialize failed");
+        return;
+    }
+    const int queriesPerChange = state.range(1);
+    const std::vector<audio_attributes_t> attributes = stormAttributes();
+    bool forced = false;
+    for (auto _ : state) {
+        for (int i = 0; i < kQueriesPerStorm; ++i) {
+            if (i % queriesPerChange == 0) {
+                state.PauseTiming();
+                forced = !forced;
+                manager->setForceUse(AUDIO_POLICY_FORCE_FOR_MEDIA,
+                        forced ? AUDIO_POLICY_FORCE_NO_BT_A2DP : AUDIO_POLICY_FORCE_NONE);
+                state.ResumeTiming();
+            }
+            if (manager.createTrack(attributes[i % attributes.size()]) != NO_ERROR) {
+                state.SkipWithError("getOutputForAttr failed");
+                return;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kQueriesPerStorm);
+}
+
+BENCHMARK(BM_GetOutputForAttrStorm)->ArgName("cache")->Arg(0)->Arg(1);
+BENCHMARK(BM_GetDevicesForAttributesStorm)->ArgName("cache")->Arg(0)->Arg(1);
+BENCHMARK(BM_GetOutputForAttrWithForceUseChanges)
+        ->ArgNames({"cache", "queries_per_change"})
+        ->ArgsProduct({{0, 1}, {16, 256}});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -443,6 +443,22 @@ TEST_F(AudioPolicyManagerTest, CreateAudioPatchFromMix) {
     ASSERT_EQ(1, patchCount.deltaFromSnapshot());
 }
 
+TEST_F(AudioPolicyManagerTest, OutputSelectionCacheInvalidatedByPatches) {
+    audio_patch_handle_t handle = AUDIO_PATCH_HANDLE_NONE;
+    uid_t uid = 42;
+    ASSERT_FALSE(mManager->getAvailableInputDevices().isEmpty());
+    OutputSelectionCache& cache = mManager->getOutputSelectionCache();
+    PatchBuilder patchBuilder;
+    patchBuilder.addSource(mManager->getAvailableInputDevices()[0]).
+            addSink(mManager->getConfig().getDefaultOutputDevice());
+    uint32_t generation = cache.generation();
+    ASSERT_EQ(NO_ERROR, mManager->createAudioPatch(patchBuilder.patch(), &handle, uid));
+    EXPECT_NE(generation, cache.generation());
+    generation = cache.generation();
+    ASSERT_EQ(NO_ERROR, mManager->releaseAudioPatch(handle, uid));
+    EXPECT_NE(generation, cache.generation());
+}
+
 // TODO: Add patch creation tests that involve already existing patch
 
 enum
@@ -1021,6 +1037,43 @@ TEST_F(AudioPolicyManagerTestWithConfigurationFile, HandleDeviceConfigChange) {
     }
 }
 
+TEST_F(AudioPolicyManagerTestWithConfigurationFile, OutputSelectionFollowsPolicyChanges) {
+    const audio_attributes_t mediaAttr = {
+            .content_type = AUDIO_CONTENT_TYPE_MUSIC,
+            .usage = AUDIO_USAGE_MEDIA,
+    };
+    // Runs each query twice, so that the second one is answered by the output selection cache.
+    auto selectedDeviceType = [&]() {
+        audio_devices_t types[2] = {AUDIO_DEVICE_NONE, AUDIO_DEVICE_NONE};
+        for (auto& type : types) {
+            audio_port_handle_t selectedDeviceId = AUDIO_PORT_HANDLE_NONE;
+            audio_port_handle_t portId = AUDIO_PORT_HANDLE_NONE;
+            getOutputForAttr(&selectedDeviceId, AUDIO_FORMAT_PCM_16_BIT, AUDIO_CHANNEL_OUT_STEREO,
+                    k48000SamplingRate, AUDIO_OUTPUT_FLAG_NONE, nullptr /*output*/, &portId,
+                    mediaAttr);
+            auto device = mManager->getAvailableOutputDevices().getDeviceFromId(selectedDeviceId);
+            if (device != nullptr) type = device->type();
+            mManager->releaseOutput(portId);
+        }
+        EXPECT_EQ(types[0], types[1]);
+        return types[1];
+    };
+
+    EXPECT_EQ(AUDIO_DEVICE_OUT_SPEAKER, selectedDeviceType());
+    ASSERT_EQ(NO_ERROR, mManager->setDeviceConnectionState(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP,
+                                                           AUDIO_POLICY_DEVICE_STATE_AVAILABLE,
+                                                           "", "", AUDIO_FORMAT_LDAC));
+    EXPECT_EQ(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP, selectedDeviceType());
+    mManager->setForceUse(AUDIO_POLICY_FORCE_FOR_MEDIA, AUDIO_POLICY_FORCE_NO_BT_A2DP);
+    EXPECT_EQ(AUDIO_DEVICE_OUT_SPEAKER, selectedDeviceType());
+    mManager->setForceUse(AUDIO_POLICY_FORCE_FOR_MEDIA, AUDIO_POLICY_FORCE_NONE);
+    EXPECT_EQ(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP, selectedDeviceType());
+    ASSERT_EQ(NO_ERROR, mManager->setDeviceConnectionState(AUDIO_DEVICE_OUT_BLUETOOTH_A2DP,
+                                                           AUDIO_POLICY_DEVICE_STATE_UNAVAILABLE,
+                                                           "", "", AUDIO_FORMAT_LDAC));
+    EXPECT_EQ(AUDIO_DEVICE_OUT_SPEAKER, selectedDeviceType());
+}
+
 TEST_F(AudioPolicyManagerTestWithConfigurationFile, PreferredMixerAttributes) {
     mClient->addSupportedFormat(AUDIO_FORMAT_PCM_16_BIT);
     mClient->addSupportedChannelMask(AUDIO_CHANNEL_OUT_STEREO);
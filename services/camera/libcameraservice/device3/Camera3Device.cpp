@@ -106,6 +106,7 @@
 #include "utils/Utils.h"
 
 #include <algorithm>
+#include <map>
 #include <optional>
 #include <tuple>
 
@@ -262,7 +263,7 @@ status_t Camera3Device::initializeCommonLocked() {
 
     bool usePrecorrectArray = DistortionMapper::isDistortionSupported(mDeviceInfo);
     if (usePrecorrectArray) {
-        res = mDistortionMappers[mId].setupStaticInfo(mDeviceInfo);
+        res = setupDistortionMapper(mId, mDeviceInfo);
         if (res != OK) {
             SET_ERR_L("Unable to read necessary calibration fields for distortion correction");
             return res;
@@ -298,6 +299,28 @@ status_t Camera3Device::initializeCommonLocked() {
     return OK;
 }
 
+// Interpolation error, in pixels, allowed to the distortion lookup grid; 0 disables the grid.
+static constexpr float kDefaultDistortionGridMaxError = 0.1f;
+
+status_t Camera3Device::setupDistortionMapper(const std::string &cameraId,
+        const CameraMetadata &deviceInfo) {
+    DistortionMapper &mapper = mDistortionMappers[cameraId];
+    status_t res = mapper.setupStaticInfo(deviceInfo);
+    if (res != OK) {
+        return res;
+    }
+
+    char value[PROPERTY_VALUE_MAX];
+    property_get("camera.distortion.grid_max_error", value, "");
+    char *end = nullptr;
+    float maxError = strtof(value, &end);
+    if (end == value || *end != '\0' || !(maxError >= 0)) {
+        maxError = kDefaultDistortionGridMaxError;
+    }
+    mapper.setLookupGridMaxError(maxError);
+    return OK;
+}
+
 status_t Camera3Device::disconnect() {
     return disconnectImpl();
 }
@@ -3813,10 +3836,107 @@ status_t Camera3Device::removeFwkOnlyRegionKeys(CameraMetadata *request) {
     return OK;
 }
 
+void Camera3Device::RequestThread::prepareVideoStreamIfNeeded(
+        const sp<Camera3OutputStreamInterface>& outputStream) {
+    // Prepare video buffers for high speed recording on the first video request.
+    if (mPrepareVideoStream && outputStream->isVideoStream()) {
+        // Only try to prepare video stream on the first video request.
+        mPrepareVideoStream = false;
+
+        status_t res = outputStream->startPrepare(Camera3StreamInterface::ALLOCATE_PIPELINE_MAX,
+                false /*blockRequest*/);
+        while (res == NOT_ENOUGH_DATA) {
+            res = outputStream->prepareNextBuffer();
+        }
+        if (res != OK) {
+            ALOGW("%s: Preparing video buffers for high speed failed: %s (%d)",
+                __FUNCTION__, strerror(-res), res);
+            outputStream->cancelPrepare();
+        }
+    }
+}
+
+status_t Camera3Device::RequestThread::prefetchBatchOutputBuffers(
+        const sp<Camera3Device>& parent, nsecs_t waitDuration) {
+    ATRACE_CALL();
+
+    // The requests of a batch don't necessarily all target the same streams, so
+    // collect the buffers of each stream across the batch.
+    struct StreamBuffers {
+        sp<Camera3OutputStreamInterface> stream;
+        std::vector<Camera3StreamInterface::OutstandingBuffer> buffers;
+    };
+    std::map<int, StreamBuffers> streamBuffers;
+
+    for (auto& nextRequest : mNextRequests) {
+        sp<CaptureRequest> captureRequest = nextRequest.captureRequest;
+        Vector<camera_stream_buffer_t>* outputBuffers = &nextRequest.outputBuffers;
+        outputBuffers->insertAt(camera_stream_buffer_t(), 0,
+                captureRequest->mOutputStreams.size());
+
+        for (size_t j = 0; j < captureRequest->mOutputStreams.size(); j++) {
+            sp<Camera3OutputStreamInterface> outputStream =
+                    captureRequest->mOutputStreams.editItemAt(j);
+            int streamId = outputStream->getId();
+            // HAL will request buffer through requestStreamBuffer API
+            if (parent->isHalBufferManagedStream(streamId)) {
+                continue;
+            }
+            prepareVideoStreamIfNeeded(outputStream);
+
+            StreamBuffers& entry = streamBuffers[streamId];
+            entry.stream = outputStream;
+            entry.buffers.push_back({&outputBuffers->editItemAt(j),
+                    captureRequest->mOutputSurfaces[streamId]});
+        }
+    }
+
+    for (auto& [streamId, entry] : streamBuffers) {
+        status_t res = entry.stream->getBuffers(&entry.buffers, waitDuration);
+        if (res == BAD_VALUE) {
+            // More buffers than the stream can hand out at once; prepareHalRequests()
+            // gets them one by one as they are returned.
+            ALOGV("%s: Stream %d can't hand out %zu buffers at once", __FUNCTION__,
+                    streamId, entry.buffers.size());
+            continue;
+        }
+        if (res != OK) {
+            // Buffers acquired for the other streams are returned by
+            // cleanUpFailedRequests().
+            ALOGV("RequestThread: Can't get output buffers for stream %d, skipping request"
+                    " batch: %s (%d)", streamId, strerror(-res), res);
+            return TIMED_OUT;
+        }
+    }
+
+    return OK;
+}
+
 status_t Camera3Device::RequestThread::prepareHalRequests() {
     ATRACE_CALL();
 
+    sp<Camera3Device> parent = mParent.promote();
+    if (parent == NULL) {
+        // Should not happen, and nowhere to send errors to, so just log it
+        CLOGE("RequestThread: Parent is gone");
+        return INVALID_OPERATION;
+    }
+    nsecs_t waitDuration = kBaseGetBufferWait + parent->getExpectedInFlightDuration();
+
     bool batchedRequest = mNextRequests[0].captureRequest->mBatchSize > 1;
+    if (batchedRequest) {
+        status_t res = prefetchBatchOutputBuffers(parent, waitDuration);
+        if (res != OK) {
+            return res;
+        }
+    }
+
+    // Request settings are all the same within one batch, so the values derived from them
+    // are only computed for the first request.
+    ExpectedDurationInfo batchDurationInfo = {};
+    bool batchIsStillCapture = false;
+    bool batchIsZslCapture = false;
+
     for (size_t i = 0; i < mNextRequests.size(); i++) {
         auto& nextRequest = mNextRequests.editItemAt(i);
         sp<CaptureRequest> captureRequest = nextRequest.captureRequest;
@@ -4057,19 +4177,14 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
             halRequest->input_buffer = NULL;
         }
 
-        outputBuffers->insertAt(camera_stream_buffer_t(), 0,
-                captureRequest->mOutputStreams.size());
+        // Already sized if the buffers of the batch were prefetched.
+        if (outputBuffers->isEmpty()) {
+            outputBuffers->insertAt(camera_stream_buffer_t(), 0,
+                    captureRequest->mOutputStreams.size());
+        }
         halRequest->output_buffers = outputBuffers->array();
         std::set<std::set<std::string>> requestedPhysicalCameras;
 
-        sp<Camera3Device> parent = mParent.promote();
-        if (parent == NULL) {
-            // Should not happen, and nowhere to send errors to, so just log it
-            CLOGE("RequestThread: Parent is gone");
-            return INVALID_OPERATION;
-        }
-        nsecs_t waitDuration = kBaseGetBufferWait + parent->getExpectedInFlightDuration();
-
         SurfaceMap uniqueSurfaceIdMap;
         bool containsHalBufferManagedStream = false;
         for (size_t j = 0; j < captureRequest->mOutputStreams.size(); j++) {
@@ -4080,22 +4195,7 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
                 containsHalBufferManagedStream =
                         contains(mHalBufManagedStreamIds, streamId);
             }
-            // Prepare video buffers for high speed recording on the first video request.
-            if (mPrepareVideoStream && outputStream->isVideoStream()) {
-                // Only try to prepare video stream on the first video request.
-                mPrepareVideoStream = false;
-
-                res = outputStream->startPrepare(Camera3StreamInterface::ALLOCATE_PIPELINE_MAX,
-                        false /*blockRequest*/);
-                while (res == NOT_ENOUGH_DATA) {
-                    res = outputStream->prepareNextBuffer();
-                }
-                if (res != OK) {
-                    ALOGW("%s: Preparing video buffers for high speed failed: %s (%d)",
-                        __FUNCTION__, strerror(-res), res);
-                    outputStream->cancelPrepare();
-                }
-            }
+            prepareVideoStreamIfNeeded(outputStream);
 
             std::vector<size_t> uniqueSurfaceIds;
             res = outputStream->getUniqueSurfaceIds(
@@ -4127,7 +4227,8 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
                 // 'prepare' after this request reaches CameraHal and before the respective
                 // buffers are requested.
                 outputStream->markUnpreparable();
-            } else {
+            } else if (outputBuffers->itemAt(j).stream == nullptr) {
+                // Not prefetched with the rest of the batch.
                 res = outputStream->getBuffer(&outputBuffers->editItemAt(j),
                         waitDuration,
                         captureRequest->mOutputSurfaces[streamId]);
@@ -4143,20 +4244,17 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
             }
 
             {
-                sp<Camera3Device> parent = mParent.promote();
-                if (parent != nullptr) {
-                    const std::string& streamCameraId = outputStream->getPhysicalCameraId();
-                    // Consider the case where clients are sending a single logical camera request
-                    // to physical output/outputs
-                    bool singleRequest = captureRequest->mSettingsList.size() == 1;
-                    for (const auto& settings : captureRequest->mSettingsList) {
-                        if (((streamCameraId.empty() || singleRequest) &&
-                                parent->getId() == settings.cameraId) ||
-                                streamCameraId == settings.cameraId) {
-                            outputStream->fireBufferRequestForFrameNumber(
-                                    captureRequest->mResultExtras.frameNumber,
-                                    settings.metadata);
-                        }
+                const std::string& streamCameraId = outputStream->getPhysicalCameraId();
+                // Consider the case where clients are sending a single logical camera request
+                // to physical output/outputs
+                bool singleRequest = captureRequest->mSettingsList.size() == 1;
+                for (const auto& settings : captureRequest->mSettingsList) {
+                    if (((streamCameraId.empty() || singleRequest) &&
+                            parent->getId() == settings.cameraId) ||
+                            streamCameraId == settings.cameraId) {
+                        outputStream->fireBufferRequestForFrameNumber(
+                                captureRequest->mResultExtras.frameNumber,
+                                settings.metadata);
                     }
                 }
             }
@@ -4180,32 +4278,45 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
         if (batchedRequest && i != mNextRequests.size()-1) {
             hasCallback = false;
         }
-        bool isStillCapture = false;
-        bool isZslCapture = false;
-        const camera_metadata_t* settings = halRequest->settings;
-        bool shouldUnlockSettings = false;
-        if (settings == nullptr) {
-            shouldUnlockSettings = true;
-            settings = captureRequest->mSettingsList.begin()->metadata.getAndLock();
-        }
-        if (!mNextRequests[0].captureRequest->mSettingsList.begin()->metadata.isEmpty()) {
-            camera_metadata_ro_entry_t e = camera_metadata_ro_entry_t();
-            find_camera_metadata_ro_entry(settings, ANDROID_CONTROL_CAPTURE_INTENT, &e);
-            if ((e.count > 0) && (e.data.u8[0] == ANDROID_CONTROL_CAPTURE_INTENT_STILL_CAPTURE)) {
-                isStillCapture = true;
-                ATRACE_ASYNC_BEGIN("still capture", mNextRequests[i].halRequest.frame_number);
+        bool isStillCapture = batchIsStillCapture;
+        bool isZslCapture = batchIsZslCapture;
+        ExpectedDurationInfo expectedDurationInfo = batchDurationInfo;
+        if (!batchedRequest || i == 0) {
+            const camera_metadata_t* settings = halRequest->settings;
+            bool shouldUnlockSettings = false;
+            if (settings == nullptr) {
+                shouldUnlockSettings = true;
+                settings = captureRequest->mSettingsList.begin()->metadata.getAndLock();
             }
+            if (!mNextRequests[0].captureRequest->mSettingsList.begin()->metadata.isEmpty()) {
+                camera_metadata_ro_entry_t e = camera_metadata_ro_entry_t();
+                find_camera_metadata_ro_entry(settings, ANDROID_CONTROL_CAPTURE_INTENT, &e);
+                if ((e.count > 0) &&
+                        (e.data.u8[0] == ANDROID_CONTROL_CAPTURE_INTENT_STILL_CAPTURE)) {
+                    isStillCapture = true;
+                }
+
+                e = camera_metadata_ro_entry_t();
+                find_camera_metadata_ro_entry(settings, ANDROID_CONTROL_ENABLE_ZSL, &e);
+                if ((e.count > 0) && (e.data.u8[0] == ANDROID_CONTROL_ENABLE_ZSL_TRUE)) {
+                    isZslCapture = true;
+                }
+            }
+            expectedDurationInfo = calculateExpectedDurationRange(settings);
 
-            e = camera_metadata_ro_entry_t();
-            find_camera_metadata_ro_entry(settings, ANDROID_CONTROL_ENABLE_ZSL, &e);
-            if ((e.count > 0) && (e.data.u8[0] == ANDROID_CONTROL_ENABLE_ZSL_TRUE)) {
-                isZslCapture = true;
+            if (shouldUnlockSettings) {
+                captureRequest->mSettingsList.begin()->metadata.unlock(settings);
             }
+            batchIsStillCapture = isStillCapture;
+            batchIsZslCapture = isZslCapture;
+            batchDurationInfo = expectedDurationInfo;
+        }
+        if (isStillCapture) {
+            ATRACE_ASYNC_BEGIN("still capture", mNextRequests[i].halRequest.frame_number);
         }
         bool passSurfaceMap =
                 mUseHalBufManager ||
                         (flags::session_hal_buf_manager() && containsHalBufferManagedStream);
-        auto expectedDurationInfo = calculateExpectedDurationRange(settings);
         res = parent->registerInFlight(halRequest->frame_number,
                 totalNumBuffers, captureRequest->mResultExtras,
                 /*hasInput*/halRequest->input_buffer != NULL,
@@ -4224,10 +4335,6 @@ status_t Camera3Device::RequestThread::prepareHalRequests() {
                 captureRequest->mResultExtras.requestId, captureRequest->mResultExtras.frameNumber,
                 captureRequest->mResultExtras.burstId);
 
-        if (shouldUnlockSettings) {
-            captureRequest->mSettingsList.begin()->metadata.unlock(settings);
-        }
-
         if (res != OK) {
             SET_ERR("RequestThread: Unable to register new in-flight request:"
                     " %s (%d)", strerror(-res), res);
@@ -4472,7 +4579,12 @@ void Camera3Device::RequestThread::cleanUpFailedRequests(bool sendRequestError)
             captureRequest->mInputStream->returnInputBuffer(captureRequest->mInputBuffer);
         }
 
-        for (size_t i = 0; i < halRequest->num_output_buffers; i++) {
+        for (size_t i = 0; i < outputBuffers->size(); i++) {
+            // Past num_output_buffers, only buffers prefetched for a batch are
+            // outstanding.
+            if (i >= halRequest->num_output_buffers && (*outputBuffers)[i].stream == nullptr) {
+                continue;
+            }
             //Buffers that failed processing could still have
             //valid acquire fence.
             Camera3Stream *stream = Camera3Stream::cast((*outputBuffers)[i].stream);
@@ -905,6 +905,7 @@ class Camera3Device :
      * Thread for managing capture request submission to HAL device.
      */
     class RequestThread : public Thread {
+        friend class RequestThreadBatchTest;
 
       public:
 
@@ -1097,6 +1098,17 @@ class Camera3Device :
         // request batch.
         status_t prepareHalRequests();
 
+        // Get the output buffers of a high speed batch with one getBuffers() call per stream
+        // instead of one getBuffer() call per request and stream. Streams that can't hand out
+        // the whole batch at once are skipped and left to prepareHalRequests(). Return TIMED_OUT
+        // if getting output buffers timed out.
+        status_t prefetchBatchOutputBuffers(const sp<Camera3Device>& parent,
+                nsecs_t waitDuration);
+
+        // Prepare video buffers for high speed recording if outputStream is the first video
+        // stream seen since the configuration.
+        void prepareVideoStreamIfNeeded(const sp<Camera3OutputStreamInterface>& outputStream);
+
         // Return buffers, etc, for requests in mNextRequests that couldn't be fully constructed and
         // send request errors if sendRequestError is true. The buffers will be returned in the
         // ERROR state to mark them as not having valid data. mNextRequests will be cleared.
@@ -1378,6 +1390,11 @@ class Camera3Device :
     // logical camera and its physical subcameras.
     std::unordered_map<std::string, camera3::DistortionMapper> mDistortionMappers;
 
+    // Sets up the distortion mapper of camera |cameraId| from its static info, with the
+    // raw to corrected lookup grid bounded by the camera.distortion.grid_max_error property.
+    status_t setupDistortionMapper(const std::string &cameraId,
+            const CameraMetadata &deviceInfo);
+
     /**
      * Zoom ratio mapper support
      */
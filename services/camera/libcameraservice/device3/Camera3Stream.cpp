@@ -672,7 +672,26 @@ status_t Camera3Stream::getBuffer(camera_stream_buffer *buffer,
         }
     }
 
-    // Wait for new buffer returned back if we are running into the limit. There
+    res = waitForBufferSpaceLocked(1, waitBufferTimeout);
+    if (res != OK) {
+        return res;
+    }
+
+    res = getBufferLocked(buffer, surface_ids);
+    if (res == OK) {
+        fireBufferListenersLocked(*buffer, /*acquired*/true, /*output*/true);
+        if (buffer->buffer) {
+            Mutex::Autolock l(mOutstandingBuffersLock);
+            mOutstandingBuffers.push_back(*buffer->buffer);
+        }
+    }
+
+    return res;
+}
+
+status_t Camera3Stream::waitForBufferSpaceLocked(size_t numBuffers,
+        nsecs_t waitBufferTimeout) {
+    // Wait for new buffers returned back if we are running into the limit. There
     // are 2 limits:
     // 1. The number of HAL buffers is greater than max_buffers
     // 2. The number of HAL buffers + cached buffers is greater than max_buffers
@@ -680,8 +699,8 @@ status_t Camera3Stream::getBuffer(camera_stream_buffer *buffer,
     size_t numOutstandingBuffers = getHandoutOutputBufferCountLocked();
     size_t numCachedBuffers = getCachedOutputBufferCountLocked();
     size_t maxNumCachedBuffers = getMaxCachedOutputBuffersLocked();
-    while (numOutstandingBuffers == camera_stream::max_buffers ||
-            numOutstandingBuffers + numCachedBuffers ==
+    while (numOutstandingBuffers + numBuffers > camera_stream::max_buffers ||
+            numOutstandingBuffers + numCachedBuffers + numBuffers >
             camera_stream::max_buffers + maxNumCachedBuffers) {
         ALOGV("%s: Already dequeued max output buffers (%d(+%zu)), wait for next returned one.",
                         __FUNCTION__, camera_stream::max_buffers, maxNumCachedBuffers);
@@ -689,7 +708,7 @@ status_t Camera3Stream::getBuffer(camera_stream_buffer *buffer,
         if (waitBufferTimeout < kWaitForBufferDuration) {
             waitBufferTimeout = kWaitForBufferDuration;
         }
-        res = mOutputBufferReturnedSignal.waitRelative(mLock, waitBufferTimeout);
+        status_t res = mOutputBufferReturnedSignal.waitRelative(mLock, waitBufferTimeout);
         nsecs_t waitEnd = systemTime(SYSTEM_TIME_MONOTONIC);
         mBufferLimitLatency.add(waitStart, waitEnd);
         if (res != OK) {
@@ -713,17 +732,73 @@ status_t Camera3Stream::getBuffer(camera_stream_buffer *buffer,
         numOutstandingBuffers = updatedNumOutstandingBuffers;
         numCachedBuffers = updatedNumCachedBuffers;
     }
+    return OK;
+}
 
-    res = getBufferLocked(buffer, surface_ids);
-    if (res == OK) {
-        fireBufferListenersLocked(*buffer, /*acquired*/true, /*output*/true);
-        if (buffer->buffer) {
+status_t Camera3Stream::getBuffers(std::vector<OutstandingBuffer>* buffers,
+        nsecs_t waitBufferTimeout) {
+    ATRACE_HFR_CALL();
+    if (buffers == nullptr || buffers->empty()) {
+        return BAD_VALUE;
+    }
+
+    Mutex::Autolock l(mLock);
+    status_t res = OK;
+
+    // This function should be only called when the stream is configured already.
+    if (mState != STATE_CONFIGURED) {
+        ALOGE("%s: Stream %d: Can't get buffers if stream is not in CONFIGURED state %d",
+                __FUNCTION__, mId, mState);
+        if (mState == STATE_ABANDONED) {
+            return DEAD_OBJECT;
+        } else {
+            return INVALID_OPERATION;
+        }
+    }
+
+    // Waiting for room for more buffers than the stream can have outstanding
+    // would never finish; the caller falls back to getBuffer() in that case.
+    size_t numBuffers = buffers->size();
+    if (numBuffers > camera_stream::max_buffers) {
+        ALOGV("%s: Stream %d: %zu buffers requested, max_buffers is %d", __FUNCTION__, mId,
+                numBuffers, camera_stream::max_buffers);
+        return BAD_VALUE;
+    }
+
+    res = waitForBufferSpaceLocked(numBuffers, waitBufferTimeout);
+    if (res != OK) {
+        return res;
+    }
+
+    for (size_t i = 0; i < numBuffers; i++) {
+        OutstandingBuffer& b = (*buffers)[i];
+        res = getBufferLocked(b.outBuffer, b.surface_ids);
+        if (res != OK) {
+            ALOGE("%s: Stream %d: Can't get buffer %zu of %zu: %s (%d)", __FUNCTION__, mId,
+                    i, numBuffers, strerror(-res), res);
+            // Hand back what was acquired so far, so that the caller sees
+            // either all of the buffers or none.
+            for (size_t j = 0; j < i; j++) {
+                camera_stream_buffer* acquired = (*buffers)[j].outBuffer;
+                acquired->status = CAMERA_BUFFER_STATUS_ERROR;
+                returnBufferLocked(*acquired, /*timestamp*/0, /*readoutTimestamp*/0,
+                        /*transform*/-1, (*buffers)[j].surface_ids);
+                *acquired = camera_stream_buffer_t();
+            }
+            mOutputBufferReturnedSignal.signal();
+            return res;
+        }
+    }
+
+    for (auto& b : *buffers) {
+        fireBufferListenersLocked(*b.outBuffer, /*acquired*/true, /*output*/true);
+        if (b.outBuffer->buffer) {
             Mutex::Autolock l(mOutstandingBuffersLock);
-            mOutstandingBuffers.push_back(*buffer->buffer);
+            mOutstandingBuffers.push_back(*b.outBuffer->buffer);
         }
     }
 
-    return res;
+    return OK;
 }
 
 bool Camera3Stream::isOutstandingBuffer(const camera_stream_buffer &buffer) const{
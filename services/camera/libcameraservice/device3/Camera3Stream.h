@@ -342,6 +342,16 @@ class Camera3Stream :
             nsecs_t waitBufferTimeout,
             const std::vector<size_t>& surface_ids = std::vector<size_t>());
 
+    /**
+     * Fill in the camera_stream_buffers of all the outstanding buffers at
+     * once, waiting until the stream has room for all of them. Either all the
+     * buffers are acquired or none.
+     *
+     * This method may only be called once finishConfiguration has been called.
+     */
+    status_t         getBuffers(std::vector<OutstandingBuffer>* buffers,
+            nsecs_t waitBufferTimeout);
+
     /**
      * Return a buffer to the stream after use by the HAL.
      *
@@ -599,6 +609,10 @@ class Camera3Stream :
     // Remove the buffer from the list of outstanding buffers.
     void removeOutstandingBuffer(const camera_stream_buffer& buffer);
 
+    // Wait until numBuffers more output buffers can be handed out without
+    // going over max_buffers or the cached buffer limit.
+    status_t waitForBufferSpaceLocked(size_t numBuffers, nsecs_t waitBufferTimeout);
+
     // Tracking for PREPARING state
 
     // State of buffer preallocation. Only true if either prepareNextBuffer
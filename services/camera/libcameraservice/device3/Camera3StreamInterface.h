@@ -396,6 +396,19 @@ class Camera3StreamInterface : public virtual RefBase {
         std::vector<size_t> surface_ids;
     };
 
+    /**
+     * Fill in the camera_stream_buffers of all the outstanding buffers in one
+     * go, as for the requests of a high speed batch. Waits until the stream
+     * has room for all of them, and either all buffers are acquired or none.
+     *
+     * Returns BAD_VALUE if more buffers are requested than the stream can
+     * have outstanding at once.
+     *
+     * This method may only be called once finishConfiguration has been called.
+     */
+    virtual status_t getBuffers(std::vector<OutstandingBuffer>* buffers,
+            nsecs_t waitBufferTimeout) = 0;
+
     /**
      * Return a buffer to the stream after use by the HAL.
      *
@@ -28,6 +28,25 @@ namespace android {
 
 namespace camera3 {
 
+// Apply the distortion model to corrected (active array) coordinates, giving raw
+// (pre-correction active array) coordinates without rounding or clamping
+template<typename T>
+static inline void applyDistortionModel(const DistortionMapper::DistortionMapperInfo &info,
+        T x, T y, T *xr, T *yr) {
+    // Move to normalized space from active array space
+    T ywi = (y - (info.mCy - info.mArrayDiffY)) * info.mInvFy;
+    T xwi = (x - (info.mCx - info.mArrayDiffX) - info.mS * ywi) * info.mInvFx;
+    // Apply distortion model to calculate raw image coordinates
+    const std::array<float, 5> &kK = info.mK;
+    T rSq = xwi * xwi + ywi * ywi;
+    T Fr = 1.f + (kK[0] * rSq) + (kK[1] * rSq * rSq) + (kK[2] * rSq * rSq * rSq);
+    T xc = xwi * Fr + (kK[3] * 2 * xwi * ywi) + kK[4] * (rSq + 2 * xwi * xwi);
+    T yc = ywi * Fr + (kK[4] * 2 * xwi * ywi) + kK[3] * (rSq + 2 * ywi * ywi);
+    // Move back to image space
+    *xr = info.mFx * xc + info.mS * yc + info.mCx;
+    *yr = info.mFy * yc + info.mCy;
+}
+
 DistortionMapper::DistortionMapper() {
     initRemappedKeys();
 }
@@ -208,6 +227,15 @@ status_t DistortionMapper::correctCaptureResult(CameraMetadata *result) {
     return OK;
 }
 
+void DistortionMapper::setLookupGridMaxError(float maxError) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (maxError == mLookupGridMaxError) return;
+
+    mLookupGridMaxError = std::max(0.f, maxError);
+    mDistortionMapperInfo.mValidGrids = false;
+    mDistortionMapperInfoMaximumResolution.mValidGrids = false;
+}
+
 // Utility methods; not guarded by mutex
 
 status_t DistortionMapper::updateCalibration(const CameraMetadata &result, bool isStatic,
@@ -264,6 +292,7 @@ status_t DistortionMapper::updateCalibration(const CameraMetadata &result, bool
     mapperInfo->mValidMapping = true;
     // Need to recalculate grid
     mapperInfo->mValidGrids = false;
+    mapperInfo->mValidLookupGrid = false;
 
     return OK;
 }
@@ -279,6 +308,14 @@ status_t DistortionMapper::mapRawToCorrected(int32_t *coordPairs, int coordCount
         if (res != OK) return res;
     }
 
+    if (mapperInfo->mValidLookupGrid) {
+        return mapRawToCorrectedLookup(coordPairs, coordCount, mapperInfo, clamp);
+    }
+    return mapRawToCorrectedQuads(coordPairs, coordCount, mapperInfo, clamp);
+}
+
+status_t DistortionMapper::mapRawToCorrectedQuads(int32_t *coordPairs, int coordCount,
+        const DistortionMapperInfo *mapperInfo, bool clamp) const {
     for (int i = 0; i < coordCount * 2; i += 2) {
         const GridQuad *quad = findEnclosingQuad(coordPairs + i, mapperInfo->mDistortedGrid);
         if (quad == nullptr) {
@@ -385,21 +422,9 @@ status_t DistortionMapper::mapCorrectedToRawImpl(T *coordPairs, int coordCount,
 
     if (simple) return mapCorrectedToRawImplSimple(coordPairs, coordCount, mapperInfo, clamp);
 
-    float activeCx = mapperInfo->mCx - mapperInfo->mArrayDiffX;
-    float activeCy = mapperInfo->mCy - mapperInfo->mArrayDiffY;
     for (int i = 0; i < coordCount * 2; i += 2) {
-        // Move to normalized space from active array space
-        float ywi = (coordPairs[i + 1] - activeCy) * mapperInfo->mInvFy;
-        float xwi = (coordPairs[i] - activeCx - mapperInfo->mS * ywi) * mapperInfo->mInvFx;
-        // Apply distortion model to calculate raw image coordinates
-        const std::array<float, 5> &kK = mapperInfo->mK;
-        float rSq = xwi * xwi + ywi * ywi;
-        float Fr = 1.f + (kK[0] * rSq) + (kK[1] * rSq * rSq) + (kK[2] * rSq * rSq * rSq);
-        float xc = xwi * Fr + (kK[3] * 2 * xwi * ywi) + kK[4] * (rSq + 2 * xwi * xwi);
-        float yc = ywi * Fr + (kK[4] * 2 * xwi * ywi) + kK[3] * (rSq + 2 * ywi * ywi);
-        // Move back to image space
-        float xr = mapperInfo->mFx * xc + mapperInfo->mS * yc + mapperInfo->mCx;
-        float yr = mapperInfo->mFy * yc + mapperInfo->mCy;
+        float xr, yr;
+        applyDistortionModel<float>(*mapperInfo, coordPairs[i], coordPairs[i + 1], &xr, &yr);
         // Clamp to within pre-correction active array
         if (clamp) {
             xr = std::min(mapperInfo->mArrayWidth - 1, std::max(0.f, xr));
@@ -491,6 +516,213 @@ status_t DistortionMapper::buildGrids(DistortionMapperInfo *mapperInfo) {
     }
 
     mapperInfo->mValidGrids = true;
+
+    mapperInfo->mValidLookupGrid = false;
+    if (mLookupGridMaxError > 0) {
+        status_t res = buildLookupGrid(mapperInfo);
+        if (res != OK) {
+            ALOGW("%s: Unable to build distortion lookup grid, using quad grids: %s (%d)",
+                    __FUNCTION__, strerror(-res), res);
+        }
+    }
+    return OK;
+}
+
+status_t DistortionMapper::buildLookupGrid(DistortionMapperInfo *mapperInfo) {
+    LookupGrid &grid = mapperInfo->mLookupGrid;
+
+    // Only cover the pre-correction active array. The model may fold over in the margins of
+    // the quad grids, where it can't be inverted reliably.
+    float extentX = mapperInfo->mArrayWidth - 1;
+    float extentY = mapperInfo->mArrayHeight - 1;
+    grid.mOriginX = 0;
+    grid.mOriginY = 0;
+
+    std::vector<float> cellErrors;
+    for (float spacing = std::max(extentX, extentY) / 8; ; spacing /= 2) {
+        grid.mSpacing = spacing;
+        grid.mInvSpacing = 1 / spacing;
+        grid.mWidth = static_cast<int32_t>(std::ceil(extentX / spacing)) + 1;
+        grid.mHeight = static_cast<int32_t>(std::ceil(extentY / spacing)) + 1;
+        grid.mCorrectedX.resize(grid.mWidth * grid.mHeight);
+        grid.mCorrectedY.resize(grid.mWidth * grid.mHeight);
+
+        for (int32_t j = 0, index = 0; j < grid.mHeight; j++) {
+            for (int32_t i = 0; i < grid.mWidth; i++, index++) {
+                status_t res = invertDistortion(grid.mOriginX + i * spacing,
+                        grid.mOriginY + j * spacing, mapperInfo,
+                        &grid.mCorrectedX[index], &grid.mCorrectedY[index]);
+                if (res != OK) return res;
+            }
+        }
+
+        // Bilinear interpolation error peaks around the middle of each cell
+        int32_t cellsX = grid.mWidth - 1;
+        int32_t cellsY = grid.mHeight - 1;
+        cellErrors.resize(cellsX * cellsY);
+        size_t numOverBound = 0;
+        for (int32_t j = 0; j < cellsY; j++) {
+            for (int32_t i = 0; i < cellsX; i++) {
+                float x, y;
+                status_t res = invertDistortion(grid.mOriginX + (i + 0.5f) * spacing,
+                        grid.mOriginY + (j + 0.5f) * spacing, mapperInfo, &x, &y);
+                if (res != OK) return res;
+
+                int32_t index = j * grid.mWidth + i;
+                float interpX = (grid.mCorrectedX[index] + grid.mCorrectedX[index + 1] +
+                        grid.mCorrectedX[index + grid.mWidth] +
+                        grid.mCorrectedX[index + grid.mWidth + 1]) / 4;
+                float interpY = (grid.mCorrectedY[index] + grid.mCorrectedY[index + 1] +
+                        grid.mCorrectedY[index + grid.mWidth] +
+                        grid.mCorrectedY[index + grid.mWidth + 1]) / 4;
+                float error = std::sqrt(
+                        (interpX - x) * (interpX - x) + (interpY - y) * (interpY - y));
+                cellErrors[j * cellsX + i] = error;
+                if (error > mLookupGridMaxError) numOverBound++;
+            }
+        }
+
+        // Strongly distorted corners may need a much finer grid than the rest of the array;
+        // settle for solving the model exactly in a few of the cells.
+        if (numOverBound * kMaxExactCellFraction <= cellErrors.size()) break;
+        if (2 * grid.mWidth - 1 > kMaxLookupGridNodes ||
+                2 * grid.mHeight - 1 > kMaxLookupGridNodes) {
+            ALOGW("%s: %zu of %zu cells exceed the lookup grid error bound %f at the maximum "
+                    "grid size %dx%d", __FUNCTION__, numOverBound, cellErrors.size(),
+                    mLookupGridMaxError, grid.mWidth, grid.mHeight);
+            break;
+        }
+    }
+
+    grid.mExactCells.resize(cellErrors.size());
+    grid.mMaxError = 0;
+    size_t numExactCells = 0;
+    for (size_t i = 0; i < cellErrors.size(); i++) {
+        grid.mExactCells[i] = cellErrors[i] > mLookupGridMaxError;
+        if (grid.mExactCells[i]) {
+            numExactCells++;
+        } else {
+            grid.mMaxError = std::max(grid.mMaxError, cellErrors[i]);
+        }
+    }
+    ALOGV("%s: %dx%d nodes, spacing %f, max error %f, %zu exact cells", __FUNCTION__,
+            grid.mWidth, grid.mHeight, grid.mSpacing, grid.mMaxError, numExactCells);
+
+    mapperInfo->mValidLookupGrid = true;
+    return OK;
+}
+
+status_t DistortionMapper::invertDistortion(float xr, float yr,
+        const DistortionMapperInfo *mapperInfo, float *x, float *y) {
+    constexpr int kMaxIterations = 20;
+    // Step for the numerical derivatives, in pixels
+    constexpr double kStep = 1.;
+    // Convergence threshold, in pixels
+    constexpr double kTolerance = 1e-3;
+
+    // Without distortion, raw coordinates are only offset from the corrected ones
+    double xc = xr - mapperInfo->mArrayDiffX;
+    double yc = yr - mapperInfo->mArrayDiffY;
+    for (int iteration = 0; iteration < kMaxIterations; iteration++) {
+        double fx, fy, fxDx, fyDx, fxDy, fyDy;
+        applyDistortionModel(*mapperInfo, xc, yc, &fx, &fy);
+        applyDistortionModel(*mapperInfo, xc + kStep, yc, &fxDx, &fyDx);
+        applyDistortionModel(*mapperInfo, xc, yc + kStep, &fxDy, &fyDy);
+
+        // Jacobian of the distortion model
+        double j00 = (fxDx - fx) / kStep;
+        double j01 = (fxDy - fx) / kStep;
+        double j10 = (fyDx - fy) / kStep;
+        double j11 = (fyDy - fy) / kStep;
+        double det = j00 * j11 - j01 * j10;
+        if (std::fabs(det) < kFloatFuzz) {
+            ALOGV("%s: Singular distortion model at (%f, %f)", __FUNCTION__, xc, yc);
+            return INVALID_OPERATION;
+        }
+
+        double ex = fx - xr;
+        double ey = fy - yr;
+        double dx = (j11 * ex - j01 * ey) / det;
+        double dy = (j00 * ey - j10 * ex) / det;
+        xc -= dx;
+        yc -= dy;
+        if (std::fabs(dx) < kTolerance && std::fabs(dy) < kTolerance) {
+            *x = static_cast<float>(xc);
+            *y = static_cast<float>(yc);
+            return OK;
+        }
+    }
+    ALOGV("%s: No convergence for (%f, %f)", __FUNCTION__, xr, yr);
+    return INVALID_OPERATION;
+}
+
+status_t DistortionMapper::mapRawToCorrectedLookup(int32_t *coordPairs, int coordCount,
+        const DistortionMapperInfo *mapperInfo, bool clamp) const {
+    const LookupGrid &grid = mapperInfo->mLookupGrid;
+    const float *gridX = grid.mCorrectedX.data();
+    const float *gridY = grid.mCorrectedY.data();
+    const uint8_t *exactCells = grid.mExactCells.data();
+    const int32_t width = grid.mWidth;
+    const float maxCellX = grid.mWidth - 1;
+    const float maxCellY = grid.mHeight - 1;
+    const float maxX = clamp ? mapperInfo->mActiveWidth - 1 : INFINITY;
+    const float maxY = clamp ? mapperInfo->mActiveHeight - 1 : INFINITY;
+    const float minXY = clamp ? 0.f : -INFINITY;
+
+    // The loops over a batch have no branches or dependencies between coordinates so
+    // that they can be vectorized; only the grid loads are gathers.
+    for (int start = 0; start < coordCount; start += kLookupBatchSize) {
+        const int count = std::min(kLookupBatchSize, coordCount - start);
+        int32_t *pairs = coordPairs + 2 * start;
+
+        float u[kLookupBatchSize], v[kLookupBatchSize];
+        int32_t node[kLookupBatchSize];
+        bool outside[kLookupBatchSize], exact[kLookupBatchSize];
+        for (int i = 0; i < count; i++) {
+            // Position in units of cells; outside points get the nearest cell
+            float gx = (pairs[2 * i] - grid.mOriginX) * grid.mInvSpacing;
+            float gy = (pairs[2 * i + 1] - grid.mOriginY) * grid.mInvSpacing;
+            outside[i] = gx < 0 || gy < 0 || gx > maxCellX || gy > maxCellY;
+            float cx = std::min(std::max(std::floor(gx), 0.f), maxCellX - 1);
+            float cy = std::min(std::max(std::floor(gy), 0.f), maxCellY - 1);
+            u[i] = gx - cx;
+            v[i] = gy - cy;
+            node[i] = static_cast<int32_t>(cy) * width + static_cast<int32_t>(cx);
+            exact[i] = exactCells[node[i] - static_cast<int32_t>(cy)];
+        }
+
+        float corrX[kLookupBatchSize], corrY[kLookupBatchSize];
+        for (int i = 0; i < count; i++) {
+            const float *x = gridX + node[i];
+            const float *y = gridY + node[i];
+            float topX = x[0] + u[i] * (x[1] - x[0]);
+            float bottomX = x[width] + u[i] * (x[width + 1] - x[width]);
+            float topY = y[0] + u[i] * (y[1] - y[0]);
+            float bottomY = y[width] + u[i] * (y[width + 1] - y[width]);
+            corrX[i] = topX + v[i] * (bottomX - topX);
+            corrY[i] = topY + v[i] * (bottomY - topY);
+        }
+
+        // Few points land in cells the grid isn't accurate enough for, or outside the
+        // pre-correction active array, which is left to the quad grids
+        for (int i = 0; i < count; i++) {
+            if (outside[i]) {
+                status_t res = mapRawToCorrectedQuads(pairs + 2 * i, 1, mapperInfo, clamp);
+                if (res != OK) return res;
+                continue;
+            }
+            if (exact[i]) {
+                status_t res = invertDistortion(pairs[2 * i], pairs[2 * i + 1], mapperInfo,
+                        &corrX[i], &corrY[i]);
+                if (res != OK) return res;
+            }
+            float x = std::min(maxX, std::max(minXY, corrX[i]));
+            float y = std::min(maxY, std::max(minXY, corrY[i]));
+            pairs[2 * i] = static_cast<int32_t>(std::round(x));
+            pairs[2 * i + 1] = static_cast<int32_t>(std::round(y));
+        }
+    }
+
     return OK;
 }
 
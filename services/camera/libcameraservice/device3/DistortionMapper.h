@@ -37,6 +37,7 @@ class DistortionMapper : public CoordinateMapper {
     DistortionMapper();
 
     DistortionMapper(const DistortionMapper& other) :
+            mLookupGridMaxError(other.mLookupGridMaxError),
             mDistortionMapperInfo(other.mDistortionMapperInfo),
             mDistortionMapperInfoMaximumResolution(other.mDistortionMapperInfoMaximumResolution) {
             initRemappedKeys(); }
@@ -68,6 +69,13 @@ class DistortionMapper : public CoordinateMapper {
      */
     status_t correctCaptureResult(CameraMetadata *request);
 
+    /**
+     * Map raw to corrected coordinates through a precomputed lookup grid when not using the
+     * simple linear map. The grid is rebuilt on calibration changes, with a spacing that keeps
+     * the interpolation error within maxError pixels. A maxError of 0 disables the grid.
+     */
+    void setLookupGridMaxError(float maxError);
+
 
   public: // Visible for testing. Not guarded by mutex; do not use concurrently
 
@@ -135,9 +143,24 @@ class DistortionMapper : public CoordinateMapper {
         std::array<float, 8> coords;
     };
 
+    // Regular grid over the raw coordinate space, holding the corrected coordinates of each
+    // node for bilinear interpolation
+    struct LookupGrid {
+        float mOriginX, mOriginY;
+        float mSpacing, mInvSpacing;
+        // Number of nodes in each dimension
+        int32_t mWidth, mHeight;
+        // Largest interpolation error found at the centers of the interpolated cells, in pixels
+        float mMaxError;
+        std::vector<float> mCorrectedX, mCorrectedY;
+        // Per cell, whether it exceeds the error bound so the model is solved instead
+        std::vector<uint8_t> mExactCells;
+    };
+
     struct DistortionMapperInfo {
         bool mValidMapping = false;
         bool mValidGrids = false;
+        bool mValidLookupGrid = false;
 
         // intrisic parameters, in pixels
         float mFx, mFy, mCx, mCy, mS;
@@ -155,8 +178,15 @@ class DistortionMapper : public CoordinateMapper {
 
         std::vector<GridQuad> mCorrectedGrid;
         std::vector<GridQuad> mDistortedGrid;
+
+        LookupGrid mLookupGrid;
     };
 
+    // Invert the distortion model for a single point with Newton's method, without the
+    // approximation of the mapping grids
+    static status_t invertDistortion(float xr, float yr, const DistortionMapperInfo *mapperInfo,
+            float *x, float *y);
+
     // Find which grid quad encloses the point; returns null if none do
     static const GridQuad* findEnclosingQuad(
             const int32_t pt[2], const std::vector<GridQuad>& grid);
@@ -188,6 +218,16 @@ class DistortionMapper : public CoordinateMapper {
     constexpr static float kGridMargin = 0.05f;
     // Fuzziness for float inequality tests
     constexpr static float kFloatFuzz = 1e-4;
+    // Upper limit on the number of lookup grid nodes in each dimension
+    constexpr static int32_t kMaxLookupGridNodes = 129;
+    // The lookup grid is refined until fewer than 1 in kMaxExactCellFraction cells
+    // exceed its error bound
+    constexpr static size_t kMaxExactCellFraction = 20;
+    // Number of coordinates interpolated together from the lookup grid
+    constexpr static int kLookupBatchSize = 16;
+
+    // Largest error allowed for the lookup grid, in pixels; 0 to not use it
+    float mLookupGridMaxError = 0.f;
 
     bool mMaxResolution = false;
 
@@ -206,9 +246,21 @@ class DistortionMapper : public CoordinateMapper {
     status_t mapRawToCorrectedSimple(int32_t *coordPairs, int coordCount,
             const DistortionMapperInfo *mapperInfo, bool clamp) const;
 
+    // Mapping through the quad grids
+    status_t mapRawToCorrectedQuads(int32_t *coordPairs, int coordCount,
+            const DistortionMapperInfo *mapperInfo, bool clamp) const;
+
+    // Mapping through the lookup grid, in batches of kLookupBatchSize coordinates
+    status_t mapRawToCorrectedLookup(int32_t *coordPairs, int coordCount,
+            const DistortionMapperInfo *mapperInfo, bool clamp) const;
+
     // Utility to create reverse mapping grids
     status_t buildGrids(DistortionMapperInfo *mapperInfo);
 
+    // Build the lookup grid, halving its spacing until nearly all cells meet
+    // mLookupGridMaxError
+    status_t buildLookupGrid(DistortionMapperInfo *mapperInfo);
+
     DistortionMapperInfo mDistortionMapperInfo;
     DistortionMapperInfo mDistortionMapperInfoMaximumResolution;
 
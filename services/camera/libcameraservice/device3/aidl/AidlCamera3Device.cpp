@@ -234,8 +234,7 @@ status_t AidlCamera3Device::initialize(sp<CameraProviderManager> manager,
             bool usePrecorrectArray =
                     DistortionMapper::isDistortionSupported(mPhysicalDeviceInfoMap[physicalId]);
             if (usePrecorrectArray) {
-                res = mDistortionMappers[physicalId].setupStaticInfo(
-                        mPhysicalDeviceInfoMap[physicalId]);
+                res = setupDistortionMapper(physicalId, mPhysicalDeviceInfoMap[physicalId]);
                 if (res != OK) {
                     SET_ERR_L("Unable to read camera %s's calibration fields for distortion "
                             "correction", physicalId.c_str());
@@ -0,0 +1,554 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Camera3StreamBatchTest"
+
+#include <inttypes.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android/hardware/ICameraService.h>
+#include <cutils/native_handle.h>
+#include <gtest/gtest.h>
+#include <utils/Errors.h>
+#include <utils/Log.h>
+
+#include "../device3/Camera3Device.h"
+#include "../device3/Camera3FakeStream.h"
+#include "../utils/AttributionAndPermissionUtils.h"
+#include "../utils/CameraServiceProxyWrapper.h"
+
+using namespace android;
+using namespace android::camera3;
+
+namespace {
+
+constexpr nsecs_t kWaitTimeout = 1000000000LL;  // 1 s
+
+nsecs_t threadCpuTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// An output stream backed by a fixed pool of buffer handles, standing in for
+// the buffer queue of a real output stream.
+class MockHalStream : public Camera3FakeStream {
+  public:
+    MockHalStream(int id, uint32_t maxBuffers) : Camera3FakeStream(id) {
+        for (uint32_t i = 0; i < maxBuffers; i++) {
+            mHandles.push_back(native_handle_create(/*numFds*/0, /*numInts*/0));
+            mFree.push_back(i);
+        }
+        camera_stream* halStream = startConfiguration();
+        if (halStream != nullptr) {
+            halStream->max_buffers = maxBuffers;
+            mInitCheck = finishConfiguration();
+        }
+    }
+
+    ~MockHalStream() {
+        for (auto handle : mHandles) {
+            native_handle_delete(const_cast<native_handle_t*>(handle));
+        }
+    }
+
+    status_t initCheck() const { return mInitCheck; }
+
+    // Make getBufferLocked() fail once count more buffers have been handed out.
+    void failAfter(int count) {
+        Mutex::Autolock l(mLock);
+        mFailAfter = count;
+    }
+
+    size_t numFreeBuffers() {
+        Mutex::Autolock l(mLock);
+        return mFree.size();
+    }
+
+  protected:
+    status_t returnBufferCheckedLocked(const camera_stream_buffer &buffer,
+            nsecs_t, nsecs_t, bool, int32_t, const std::vector<size_t>&,
+            /*out*/sp<Fence>*) override {
+        mFree.push_back(buffer.buffer - mHandles.data());
+        return OK;
+    }
+
+  private:
+    status_t getBufferLocked(camera_stream_buffer *buffer,
+            const std::vector<size_t>&) override {
+        if (mFailAfter == 0 || mFree.empty()) {
+            return NO_MEMORY;
+        }
+        if (mFailAfter > 0) {
+            mFailAfter--;
+        }
+        size_t index = mFree.front();
+        mFree.pop_front();
+        handoutBufferLocked(*buffer, &mHandles[index], /*acquireFence*/-1,
+                /*releaseFence*/-1, CAMERA_BUFFER_STATUS_OK, /*output*/true);
+        return OK;
+    }
+
+    status_t returnBufferLocked(const camera_stream_buffer &buffer,
+            nsecs_t timestamp, nsecs_t readoutTimestamp, int32_t transform,
+            const std::vector<size_t>& surface_ids) override {
+        return returnAnyBufferLocked(buffer, timestamp, readoutTimestamp, /*output*/true,
+                transform, surface_ids);
+    }
+
+    status_t mInitCheck = NO_INIT;
+    std::vector<buffer_handle_t> mHandles;
+    std::deque<size_t> mFree;
+    int mFailAfter = -1;
+};
+
+// Returns the buffers it is handed after one frame duration, in order, like a
+// HAL running at a fixed frame rate.
+class MockHal {
+  public:
+    explicit MockHal(nsecs_t frameDuration) : mFrameDuration(frameDuration),
+            mThread([this] { threadLoop(); }) {}
+
+    ~MockHal() {
+        {
+            std::lock_guard<std::mutex> l(mLock);
+            mExit = true;
+        }
+        mCondition.notify_one();
+        mThread.join();
+    }
+
+    void processCaptureRequest(const std::vector<camera_stream_buffer>& buffers) {
+        std::lock_guard<std::mutex> l(mLock);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        mLastDue = std::max(mLastDue, now) + mFrameDuration;
+        mPending.push_back({mLastDue, buffers});
+        mCondition.notify_one();
+    }
+
+    void waitUntilIdle() {
+        std::unique_lock<std::mutex> l(mLock);
+        mCondition.wait(l, [this] { return mPending.empty() && !mBusy; });
+    }
+
+  private:
+    struct Frame {
+        nsecs_t due;
+        std::vector<camera_stream_buffer> buffers;
+    };
+
+    void threadLoop() {
+        std::unique_lock<std::mutex> l(mLock);
+        while (true) {
+            mCondition.wait(l, [this] { return mExit || !mPending.empty(); });
+            if (mPending.empty()) {
+                return;
+            }
+            Frame frame = std::move(mPending.front());
+            mPending.pop_front();
+            mBusy = true;
+            l.unlock();
+
+            std::this_thread::sleep_for(std::chrono::nanoseconds(
+                    frame.due - systemTime(SYSTEM_TIME_MONOTONIC)));
+            for (auto& b : frame.buffers) {
+                Camera3Stream::cast(b.stream)->returnBuffer(b, frame.due, frame.due,
+                        /*timestampIncreasing*/true, std::vector<size_t>(), mFrameNumber);
+            }
+            mFrameNumber++;
+
+            l.lock();
+            mBusy = false;
+            mCondition.notify_all();
+        }
+    }
+
+    const nsecs_t mFrameDuration;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<Frame> mPending;
+    nsecs_t mLastDue = 0;
+    uint64_t mFrameNumber = 0;
+    bool mBusy = false;
+    bool mExit = false;
+    std::thread mThread;
+};
+
+std::vector<Camera3StreamInterface::OutstandingBuffer> outstandingBuffers(
+        std::vector<camera_stream_buffer>* buffers) {
+    std::vector<Camera3StreamInterface::OutstandingBuffer> outstanding;
+    for (auto& b : *buffers) {
+        outstanding.push_back({&b, std::vector<size_t>()});
+    }
+    return outstanding;
+}
+
+void returnAll(const sp<MockHalStream>& stream, std::vector<camera_stream_buffer>* buffers) {
+    for (auto& b : *buffers) {
+        b.status = CAMERA_BUFFER_STATUS_ERROR;
+        EXPECT_EQ(stream->returnBuffer(b, /*timestamp*/0, /*readoutTimestamp*/0,
+                /*timestampIncreasing*/false), OK);
+    }
+}
+
+} // namespace
+
+TEST(Camera3StreamBatchTest, GetBuffersAcquiresAll) {
+    sp<MockHalStream> stream = new MockHalStream(0, /*maxBuffers*/8);
+    ASSERT_EQ(stream->initCheck(), OK);
+
+    std::vector<camera_stream_buffer> buffers(8);
+    auto outstanding = outstandingBuffers(&buffers);
+    ASSERT_EQ(stream->getBuffers(&outstanding, kWaitTimeout), OK);
+    EXPECT_EQ(stream->numFreeBuffers(), 0u);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        EXPECT_EQ(buffers[i].stream, stream->asHalStream());
+        ASSERT_NE(buffers[i].buffer, nullptr);
+        for (size_t j = 0; j < i; j++) {
+            EXPECT_NE(*buffers[i].buffer, *buffers[j].buffer);
+        }
+    }
+
+    returnAll(stream, &buffers);
+    EXPECT_EQ(stream->numFreeBuffers(), 8u);
+}
+
+TEST(Camera3StreamBatchTest, GetBuffersRejectsMoreThanMaxBuffers) {
+    sp<MockHalStream> stream = new MockHalStream(0, /*maxBuffers*/8);
+    ASSERT_EQ(stream->initCheck(), OK);
+
+    std::vector<camera_stream_buffer> buffers(9);
+    auto outstanding = outstandingBuffers(&buffers);
+    EXPECT_EQ(stream->getBuffers(&outstanding, kWaitTimeout), BAD_VALUE);
+    EXPECT_EQ(stream->numFreeBuffers(), 8u);
+
+    std::vector<Camera3StreamInterface::OutstandingBuffer> empty;
+    EXPECT_EQ(stream->getBuffers(&empty, kWaitTimeout), BAD_VALUE);
+}
+
+TEST(Camera3StreamBatchTest, GetBuffersIsAllOrNothing) {
+    sp<MockHalStream> stream = new MockHalStream(0, /*maxBuffers*/8);
+    ASSERT_EQ(stream->initCheck(), OK);
+
+    stream->failAfter(3);
+    std::vector<camera_stream_buffer> buffers(6);
+    auto outstanding = outstandingBuffers(&buffers);
+    EXPECT_NE(stream->getBuffers(&outstanding, kWaitTimeout), OK);
+    EXPECT_EQ(stream->numFreeBuffers(), 8u);
+    for (auto& b : buffers) {
+        EXPECT_EQ(b.stream, nullptr);
+        EXPECT_EQ(b.buffer, nullptr);
+    }
+
+    stream->failAfter(-1);
+    ASSERT_EQ(stream->getBuffers(&outstanding, kWaitTimeout), OK);
+    returnAll(stream, &buffers);
+}
+
+TEST(Camera3StreamBatchTest, GetBuffersWaitsForRoom) {
+    sp<MockHalStream> stream = new MockHalStream(0, /*maxBuffers*/8);
+    ASSERT_EQ(stream->initCheck(), OK);
+    MockHal hal(/*frameDuration*/10000000LL);  // 10 ms
+
+    std::vector<camera_stream_buffer> first(6);
+    auto outstanding = outstandingBuffers(&first);
+    ASSERT_EQ(stream->getBuffers(&outstanding, kWaitTimeout), OK);
+    for (auto& b : first) {
+        hal.processCaptureRequest({b});
+    }
+
+    // Only 2 buffers are free; the remaining 2 come back from the HAL.
+    std::vector<camera_stream_buffer> second(4);
+    outstanding = outstandingBuffers(&second);
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+    ASSERT_EQ(stream->getBuffers(&outstanding, kWaitTimeout), OK);
+    EXPECT_GE(systemTime(SYSTEM_TIME_MONOTONIC) - start, 10000000LL);
+
+    hal.waitUntilIdle();
+    returnAll(stream, &second);
+    EXPECT_EQ(stream->numFreeBuffers(), 8u);
+}
+
+// Preview and video streams of a 240 fps constrained high speed session, fed in
+// bursts of 8 requests. Compares the CPU time the request thread spends per
+// request getting buffers one by one against getting each stream's buffers for
+// the whole burst at once.
+TEST(Camera3StreamBatchTest, HighSpeedBurstCpuTime) {
+    constexpr size_t kBatchSize = 8;
+    constexpr size_t kNumBursts = 30;
+    constexpr nsecs_t kFrameDuration = 1000000000LL / 240;
+
+    auto runBursts = [&](bool batched) -> nsecs_t {
+        sp<MockHalStream> preview = new MockHalStream(0, /*maxBuffers*/2 * kBatchSize);
+        sp<MockHalStream> video = new MockHalStream(1, /*maxBuffers*/2 * kBatchSize);
+        EXPECT_EQ(preview->initCheck(), OK);
+        EXPECT_EQ(video->initCheck(), OK);
+        sp<MockHalStream> streams[] = {preview, video};
+        MockHal hal(kFrameDuration);
+
+        nsecs_t cpuTime = 0;
+        for (size_t burst = 0; burst < kNumBursts; burst++) {
+            // buffers[request][stream]
+            std::vector<std::vector<camera_stream_buffer>> buffers(kBatchSize,
+                    std::vector<camera_stream_buffer>(2));
+
+            nsecs_t start = threadCpuTimeNs();
+            if (batched) {
+                for (size_t s = 0; s < 2; s++) {
+                    std::vector<Camera3StreamInterface::OutstandingBuffer> outstanding;
+                    for (auto& request : buffers) {
+                        outstanding.push_back({&request[s], std::vector<size_t>()});
+                    }
+                    EXPECT_EQ(streams[s]->getBuffers(&outstanding, kWaitTimeout), OK);
+                }
+            } else {
+                for (auto& request : buffers) {
+                    for (size_t s = 0; s < 2; s++) {
+                        EXPECT_EQ(streams[s]->getBuffer(&request[s], kWaitTimeout), OK);
+                    }
+                }
+            }
+            cpuTime += threadCpuTimeNs() - start;
+            if (::testing::Test::HasFailure()) {
+                break;
+            }
+
+            for (auto& request : buffers) {
+                hal.processCaptureRequest(request);
+            }
+        }
+        hal.waitUntilIdle();
+        return cpuTime / (nsecs_t)(kNumBursts * kBatchSize);
+    };
+
+    nsecs_t perRequestNs = runBursts(/*batched*/false);
+    ASSERT_FALSE(HasFailure());
+    nsecs_t batchedNs = runBursts(/*batched*/true);
+    ASSERT_FALSE(HasFailure());
+
+    ALOGI("Buffer acquisition CPU time per request: %" PRId64 " ns one by one, %" PRId64
+            " ns batched", perRequestNs, batchedNs);
+    RecordProperty("per_request_cpu_ns", std::to_string(perRequestNs));
+    RecordProperty("batched_cpu_ns", std::to_string(batchedNs));
+}
+
+namespace android {
+
+// A Camera3Device without a HAL, only able to host a RequestThread.
+class BatchTestCamera3Device : public Camera3Device {
+  public:
+    using Camera3Device::CaptureRequest;
+    using Camera3Device::RequestThread;
+
+    explicit BatchTestCamera3Device(
+            std::shared_ptr<CameraServiceProxyWrapper>& cameraServiceProxyWrapper) :
+            Camera3Device(cameraServiceProxyWrapper,
+                    std::make_shared<AttributionAndPermissionUtils>(), "0",
+                    /*overrideForPerfClass*/false,
+                    hardware::ICameraService::ROTATION_OVERRIDE_NONE) {
+        mInterface = new FakeHalInterface();
+    }
+
+    sp<HalInterface> halInterface() const { return mInterface; }
+
+    status_t initialize(sp<CameraProviderManager>, const std::string&) override {
+        return INVALID_OPERATION;
+    }
+
+  private:
+    class FakeHalInterface : public HalInterface {
+      public:
+        FakeHalInterface() : HalInterface(/*useHalBufManager*/false,
+                /*supportOfflineProcessing*/false) {}
+        IPCTransport getTransportType() const override { return IPCTransport::AIDL; }
+        bool valid() override { return true; }
+        void clear() override {}
+        status_t constructDefaultRequestSettings(camera_request_template,
+                camera_metadata_t**) override { return INVALID_OPERATION; }
+        status_t configureStreams(const camera_metadata_t*, camera_stream_configuration_t*,
+                const std::vector<uint32_t>&, int64_t) override { return INVALID_OPERATION; }
+        status_t configureInjectedStreams(const camera_metadata_t*,
+                camera_stream_configuration_t*, const std::vector<uint32_t>&,
+                const CameraMetadata&) override { return INVALID_OPERATION; }
+        status_t processBatchCaptureRequests(std::vector<camera_capture_request_t*>&,
+                uint32_t*) override { return INVALID_OPERATION; }
+        status_t flush() override { return OK; }
+        status_t dump(int) override { return OK; }
+        status_t close() override { return OK; }
+        void signalPipelineDrain(const std::vector<int>&) override {}
+        bool isReconfigurationRequired(CameraMetadata&, CameraMetadata&) override {
+            return false;
+        }
+        status_t repeatingRequestEnd(uint32_t, const std::vector<int32_t>&) override {
+            return OK;
+        }
+    };
+
+    void applyMaxBatchSizeLocked(RequestList*,
+            const sp<camera3::Camera3OutputStreamInterface>&) override {}
+
+    status_t injectionCameraInitialize(const std::string&,
+            sp<CameraProviderManager>) override { return INVALID_OPERATION; }
+
+    sp<RequestThread> createNewRequestThread(wp<Camera3Device> parent,
+            sp<camera3::StatusTracker> statusTracker, sp<HalInterface> interface,
+            const Vector<int32_t>& sessionParamKeys, bool useHalBufManager,
+            bool supportCameraMute, int rotationOverride,
+            bool supportSettingsOverride) override {
+        return new RequestThread(parent, statusTracker, interface, sessionParamKeys,
+                useHalBufManager, supportCameraMute, rotationOverride, supportSettingsOverride);
+    }
+
+    sp<Camera3DeviceInjectionMethods> createCamera3DeviceInjectionMethods(
+            wp<Camera3Device>) override { return nullptr; }
+};
+
+// Drives the batch buffer acquisition of a RequestThread that is never started, as
+// prepareHalRequests() and its error path do for a high speed batch.
+class RequestThreadBatchTest : public ::testing::Test {
+  protected:
+    using RequestThread = BatchTestCamera3Device::RequestThread;
+    using CaptureRequest = BatchTestCamera3Device::CaptureRequest;
+
+    static constexpr int kBatchSize = 8;
+
+    void SetUp() override {
+        mProxyWrapper = std::make_shared<CameraServiceProxyWrapper>();
+        mDevice = new BatchTestCamera3Device(mProxyWrapper);
+        mStatusTracker = new camera3::StatusTracker(mDevice);
+        mRequestThread = new RequestThread(mDevice, mStatusTracker, mDevice->halInterface(),
+                Vector<int32_t>(), /*useHalBufManager*/false, /*supportCameraMute*/false,
+                hardware::ICameraService::ROTATION_OVERRIDE_NONE,
+                /*supportSettingsOverride*/false);
+    }
+
+    // Queues a batch of kBatchSize requests, each with an output buffer of every stream.
+    void addBatch(const std::vector<sp<MockHalStream>>& streams) {
+        for (int i = 0; i < kBatchSize; i++) {
+            sp<CaptureRequest> request = new CaptureRequest();
+            for (const auto& stream : streams) {
+                request->mOutputStreams.push(stream);
+                request->mOutputSurfaces[stream->getId()] = {0};
+            }
+            request->mBatchSize = kBatchSize;
+            request->mResultExtras.frameNumber = mFrameNumber++;
+
+            RequestThread::NextRequest nextRequest;
+            nextRequest.captureRequest = request;
+            nextRequest.halRequest = camera_capture_request_t();
+            nextRequest.submitted = false;
+            mRequestThread->mNextRequests.add(nextRequest);
+        }
+    }
+
+    status_t prefetchBatchOutputBuffers() {
+        return mRequestThread->prefetchBatchOutputBuffers(mDevice, kWaitTimeout);
+    }
+
+    void cleanUpFailedRequests() {
+        mRequestThread->cleanUpFailedRequests(/*sendRequestError*/false);
+    }
+
+    size_t numNextRequests() const { return mRequestThread->mNextRequests.size(); }
+
+    // The output buffer of stream |index| of request |request| in the batch.
+    const camera_stream_buffer_t& outputBuffer(size_t request, size_t index) const {
+        return mRequestThread->mNextRequests[request].outputBuffers[index];
+    }
+
+    std::shared_ptr<CameraServiceProxyWrapper> mProxyWrapper;
+    sp<BatchTestCamera3Device> mDevice;
+    sp<camera3::StatusTracker> mStatusTracker;
+    sp<RequestThread> mRequestThread;
+    int64_t mFrameNumber = 0;
+};
+
+TEST_F(RequestThreadBatchTest, PrefetchAcquiresEachStreamForTheBatch) {
+    sp<MockHalStream> preview = new MockHalStream(0, /*maxBuffers*/2 * kBatchSize);
+    sp<MockHalStream> video = new MockHalStream(1, /*maxBuffers*/2 * kBatchSize);
+    ASSERT_EQ(preview->initCheck(), OK);
+    ASSERT_EQ(video->initCheck(), OK);
+    addBatch({preview, video});
+
+    ASSERT_EQ(prefetchBatchOutputBuffers(), OK);
+    EXPECT_EQ(preview->numFreeBuffers(), (size_t)kBatchSize);
+    EXPECT_EQ(video->numFreeBuffers(), (size_t)kBatchSize);
+    for (size_t i = 0; i < kBatchSize; i++) {
+        EXPECT_EQ(outputBuffer(i, 0).stream, preview->asHalStream());
+        EXPECT_EQ(outputBuffer(i, 1).stream, video->asHalStream());
+        EXPECT_NE(outputBuffer(i, 0).buffer, nullptr);
+        EXPECT_NE(outputBuffer(i, 1).buffer, nullptr);
+    }
+
+    // None of the requests reached the HAL: every prefetched buffer goes back.
+    cleanUpFailedRequests();
+    EXPECT_EQ(numNextRequests(), 0u);
+    EXPECT_EQ(preview->numFreeBuffers(), 2u * kBatchSize);
+    EXPECT_EQ(video->numFreeBuffers(), 2u * kBatchSize);
+}
+
+TEST_F(RequestThreadBatchTest, PrefetchFailureReturnsOtherStreams) {
+    sp<MockHalStream> preview = new MockHalStream(0, /*maxBuffers*/2 * kBatchSize);
+    sp<MockHalStream> video = new MockHalStream(1, /*maxBuffers*/2 * kBatchSize);
+    ASSERT_EQ(preview->initCheck(), OK);
+    ASSERT_EQ(video->initCheck(), OK);
+    video->failAfter(3);
+    addBatch({preview, video});
+
+    // The preview buffers of the whole batch were acquired before video failed.
+    EXPECT_EQ(prefetchBatchOutputBuffers(), TIMED_OUT);
+    EXPECT_EQ(preview->numFreeBuffers(), (size_t)kBatchSize);
+    EXPECT_EQ(video->numFreeBuffers(), 2u * kBatchSize);
+
+    cleanUpFailedRequests();
+    EXPECT_EQ(numNextRequests(), 0u);
+    EXPECT_EQ(preview->numFreeBuffers(), 2u * kBatchSize);
+    EXPECT_EQ(video->numFreeBuffers(), 2u * kBatchSize);
+}
+
+TEST_F(RequestThreadBatchTest, PrefetchSkipsStreamsShortOfBuffers) {
+    sp<MockHalStream> preview = new MockHalStream(0, /*maxBuffers*/2 * kBatchSize);
+    sp<MockHalStream> video = new MockHalStream(1, /*maxBuffers*/kBatchSize / 2);
+    ASSERT_EQ(preview->initCheck(), OK);
+    ASSERT_EQ(video->initCheck(), OK);
+    addBatch({preview, video});
+
+    // Video can't hold the batch at once and is left to prepareHalRequests().
+    ASSERT_EQ(prefetchBatchOutputBuffers(), OK);
+    EXPECT_EQ(preview->numFreeBuffers(), (size_t)kBatchSize);
+    EXPECT_EQ(video->numFreeBuffers(), (size_t)kBatchSize / 2);
+    for (size_t i = 0; i < kBatchSize; i++) {
+        EXPECT_NE(outputBuffer(i, 0).buffer, nullptr);
+        EXPECT_EQ(outputBuffer(i, 1).stream, nullptr);
+        EXPECT_EQ(outputBuffer(i, 1).buffer, nullptr);
+    }
+
+    // Only the prefetched buffers are returned; the empty video slots are skipped.
+    cleanUpFailedRequests();
+    EXPECT_EQ(numNextRequests(), 0u);
+    EXPECT_EQ(preview->numFreeBuffers(), 2u * kBatchSize);
+    EXPECT_EQ(video->numFreeBuffers(), (size_t)kBatchSize / 2);
+}
+
+} // namespace android
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Maps batches of coordinates, as for the face landmarks and metering regions
+// of a capture result, between the raw and corrected coordinate systems.
+//
+// $ atest cameraservice_distortion_mapper_benchmark
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../device3/DistortionMapper.h"
+
+using namespace android;
+using namespace android::camera3;
+
+namespace {
+
+int32_t activeArray[] = {0, 8, 3278, 2450};
+int32_t preCorrectionActiveArray[] = {0, 0, 3280, 2464};
+
+float distortion[] = {0.06875723, -0.13922249, 0.02818312, -0.00032781, -0.00025431};
+float intrinsics[] = {1812.50000000, 1812.50000000, 1645.59533691, 1229.23229980, 0.00000000};
+
+void setupMapper(DistortionMapper *m, float lookupGridMaxError) {
+    CameraMetadata deviceInfo;
+    deviceInfo.update(ANDROID_SENSOR_INFO_PRE_CORRECTION_ACTIVE_ARRAY_SIZE,
+            preCorrectionActiveArray, 4);
+    deviceInfo.update(ANDROID_SENSOR_INFO_ACTIVE_ARRAY_SIZE, activeArray, 4);
+    deviceInfo.update(ANDROID_LENS_INTRINSIC_CALIBRATION, intrinsics, 5);
+    deviceInfo.update(ANDROID_LENS_DISTORTION, distortion, 5);
+    m->setupStaticInfo(deviceInfo);
+    m->setLookupGridMaxError(lookupGridMaxError);
+}
+
+std::vector<int32_t> randomCoords(size_t count, int32_t width, int32_t height) {
+    std::default_random_engine gen(1234);
+    std::uniform_int_distribution<int32_t> xDist(0, width - 1);
+    std::uniform_int_distribution<int32_t> yDist(0, height - 1);
+    std::vector<int32_t> coords(count * 2);
+    for (size_t i = 0; i < coords.size(); i += 2) {
+        coords[i] = xDist(gen);
+        coords[i + 1] = yDist(gen);
+    }
+    return coords;
+}
+
+// Arguments: number of coordinates, lookup grid error bound in 1/1000 pixels, 0 for the
+// quad grids.
+void BM_MapRawToCorrected(benchmark::State &state) {
+    DistortionMapper m;
+    setupMapper(&m, state.range(1) / 1000.f);
+    DistortionMapper::DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+
+    const std::vector<int32_t> coords = randomCoords(state.range(0),
+            preCorrectionActiveArray[2], preCorrectionActiveArray[3]);
+    std::vector<int32_t> mapped = coords;
+    // Build the grids outside of the timed loop
+    m.mapRawToCorrected(mapped.data(), 1, mapperInfo, /*clamp*/true, /*simple*/false);
+
+    for (auto _ : state) {
+        mapped = coords;
+        if (m.mapRawToCorrected(mapped.data(), mapped.size() / 2, mapperInfo, /*clamp*/true,
+                /*simple*/false) != OK) {
+            state.SkipWithError("mapRawToCorrected failed");
+            return;
+        }
+        benchmark::DoNotOptimize(mapped.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Arguments: number of coordinates.
+void BM_MapCorrectedToRaw(benchmark::State &state) {
+    DistortionMapper m;
+    setupMapper(&m, 0.f);
+    DistortionMapper::DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+
+    const std::vector<int32_t> coords = randomCoords(state.range(0),
+            activeArray[2], activeArray[3]);
+    std::vector<int32_t> mapped = coords;
+    for (auto _ : state) {
+        mapped = coords;
+        m.mapCorrectedToRaw(mapped.data(), mapped.size() / 2, mapperInfo, /*clamp*/true,
+                /*simple*/false);
+        benchmark::DoNotOptimize(mapped.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Cost of a calibration change. Argument: lookup grid error bound in 1/1000 pixels, 0 for
+// the quad grids only.
+void BM_RebuildGrids(benchmark::State &state) {
+    DistortionMapper m;
+    setupMapper(&m, state.range(0) / 1000.f);
+    DistortionMapper::DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+
+    for (auto _ : state) {
+        mapperInfo->mValidGrids = false;
+        int32_t coords[2] = {preCorrectionActiveArray[2] / 2, preCorrectionActiveArray[3] / 2};
+        m.mapRawToCorrected(coords, 1, mapperInfo, /*clamp*/true, /*simple*/false);
+        benchmark::DoNotOptimize(coords);
+    }
+    state.counters["nodes"] =
+            mapperInfo->mLookupGrid.mWidth * mapperInfo->mLookupGrid.mHeight;
+}
+
+BENCHMARK(BM_MapRawToCorrected)
+        ->ArgNames({"coords", "max_error_millipx"})
+        ->ArgsProduct({{16, 1024}, {0, 100, 250, 1000}});
+BENCHMARK(BM_MapCorrectedToRaw)->ArgName("coords")->Arg(16)->Arg(1024);
+BENCHMARK(BM_RebuildGrids)
+        ->ArgName("max_error_millipx")
+        ->Arg(0)->Arg(100)->Arg(250)->Arg(1000)
+        ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
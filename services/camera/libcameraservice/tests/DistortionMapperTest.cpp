@@ -348,6 +348,80 @@ TEST(DistortionMapperTest, LargeTransform) {
     RandomTransformTest(this, testActiveArray, m, /*clamp*/false, /*simple*/false);
 }
 
+// Test a realistic distortion function through the lookup grid, which the quad grids
+// aren't accurate enough for
+TEST(DistortionMapperTest, LookupGridSmallTransform) {
+    int32_t activeArray[] = {0, 8, 3278, 2450};
+    int32_t preCorrectionActiveArray[] = {0, 0, 3280, 2464};
+
+    float distortion[] = {0.06875723, -0.13922249, 0.02818312, -0.00032781, -0.00025431};
+    float intrinsics[] = {1812.50000000, 1812.50000000, 1645.59533691, 1229.23229980, 0.00000000};
+
+    DistortionMapper m;
+    setupTestMapper(&m, distortion, intrinsics, activeArray, preCorrectionActiveArray);
+    m.setLookupGridMaxError(0.1f);
+
+    RandomTransformTest(this, activeArray, m, /*clamp*/true, /*simple*/false);
+    ASSERT_TRUE(m.getMapperInfo()->mValidLookupGrid);
+    RecordProperty("LookupGridWidth", m.getMapperInfo()->mLookupGrid.mWidth);
+    RecordProperty("LookupGridHeight", m.getMapperInfo()->mLookupGrid.mHeight);
+}
+
+TEST(DistortionMapperTest, LookupGridLargeTransform) {
+    float bigDistortion[] = {0.1, -0.003, 0.004, 0.02, 0.01};
+
+    DistortionMapper m;
+    setupTestMapper(&m, bigDistortion, testICal,
+            /*activeArray*/testActiveArray,
+            /*preCorrectionActiveArray*/testPreCorrActiveArray);
+    m.setLookupGridMaxError(0.1f);
+
+    RandomTransformTest(this, testActiveArray, m, /*clamp*/false, /*simple*/false);
+    ASSERT_TRUE(m.getMapperInfo()->mValidLookupGrid);
+}
+
+// The lookup grid stays within its error bound of the exact inverse of the model
+TEST(DistortionMapperTest, LookupGridErrorBound) {
+    int32_t activeArray[] = {0, 8, 3278, 2450};
+    int32_t preCorrectionActiveArray[] = {0, 0, 3280, 2464};
+
+    float distortion[] = {0.06875723, -0.13922249, 0.02818312, -0.00032781, -0.00025431};
+    float intrinsics[] = {1812.50000000, 1812.50000000, 1645.59533691, 1229.23229980, 0.00000000};
+
+    for (float maxError : {1.f, 0.25f, 0.05f}) {
+        DistortionMapper m;
+        setupTestMapper(&m, distortion, intrinsics, activeArray, preCorrectionActiveArray);
+        m.setLookupGridMaxError(maxError);
+
+        std::default_random_engine gen(1234);
+        std::uniform_int_distribution<int> x_dist(0, preCorrectionActiveArray[2] - 1);
+        std::uniform_int_distribution<int> y_dist(0, preCorrectionActiveArray[3] - 1);
+        std::vector<int32_t> coords(2000);
+        for (size_t i = 0; i < coords.size(); i += 2) {
+            coords[i] = x_dist(gen);
+            coords[i + 1] = y_dist(gen);
+        }
+        auto rawCoords = coords;
+
+        DistortionMapperInfo *mapperInfo = m.getMapperInfo();
+        ASSERT_EQ(m.mapRawToCorrected(coords.data(), coords.size() / 2, mapperInfo,
+                /*clamp*/false, /*simple*/false), OK);
+        ASSERT_TRUE(mapperInfo->mValidLookupGrid);
+        EXPECT_LE(mapperInfo->mLookupGrid.mMaxError, maxError);
+
+        for (size_t i = 0; i < coords.size(); i += 2) {
+            float x, y;
+            ASSERT_EQ(DistortionMapper::invertDistortion(rawCoords[i], rawCoords[i + 1],
+                    mapperInfo, &x, &y), OK);
+            // Allow for rounding to integer coordinates
+            EXPECT_NEAR(coords[i], x, maxError + 0.5f);
+            EXPECT_NEAR(coords[i + 1], y, maxError + 0.5f);
+        }
+        RecordProperty(fmt::sprintf("LookupGridNodes[%f]", maxError),
+                mapperInfo->mLookupGrid.mWidth * mapperInfo->mLookupGrid.mHeight);
+    }
+}
+
 // Compare against values calculated by OpenCV
 // undistortPoints() method, which is the same as mapRawToCorrected
 // Ignore clamping
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "CachedMediaExtractor"
+#include <utils/Log.h>
+
+#include "CachedMediaExtractor.h"
+
+#include <binder/IPCThreadState.h>
+#include <media/IMediaSource.h>
+#include <media/stagefright/MediaExtractorFactory.h>
+#include <media/stagefright/MediaErrors.h>
+#include <media/stagefright/MetaData.h>
+
+namespace android {
+
+// the "extractor" metrics item, as logged by RemoteMediaExtractor.
+static const char *kKeyExtractor = "extractor";
+static const char *kExtractorFormat = "android.media.mediaextractor.fmt";
+static const char *kExtractorMime = "android.media.mediaextractor.mime";
+static const char *kExtractorTracks = "android.media.mediaextractor.ntrk";
+static const char *kExtractorEntryPoint = "android.media.mediaextractor.entry";
+static const char *kExtractorLogSessionId = "android.media.mediaextractor.logSessionId";
+
+static const char *entryPointString(IMediaExtractor::EntryPoint entryPoint) {
+    switch (entryPoint) {
+        case IMediaExtractor::EntryPoint::SDK:
+            return "sdk";
+        case IMediaExtractor::EntryPoint::NDK_WITH_JVM:
+            return "ndk-with-jvm";
+        case IMediaExtractor::EntryPoint::NDK_NO_JVM:
+            return "ndk-no-jvm";
+        case IMediaExtractor::EntryPoint::OTHER:
+            return "other";
+        default:
+            return nullptr;
+    }
+}
+
+CachedMediaExtractor::CachedMediaExtractor(
+        const ExtractorMetadataCache::Entry& entry,
+        const sp<DataSource>& source,
+        const std::optional<std::string>& mime)
+    : mEntry(entry),
+      mSource(source),
+      mMime(mime),
+      mMetricsItem(mediametrics::Item::create(kKeyExtractor)) {
+    // we're in the extractor service, we want to attribute to the app that invoked us.
+    mMetricsItem->setUid(IPCThreadState::self()->getCallingUid());
+    mMetricsItem->setCString(kExtractorFormat, mEntry.name.c_str());
+    mMetricsItem->setInt32(kExtractorTracks, int32_t(mEntry.trackMeta.size()));
+    const char *containerMime = nullptr;
+    if (mEntry.meta != nullptr && mEntry.meta->findCString(kKeyMIMEType, &containerMime)) {
+        mMetricsItem->setCString(kExtractorMime, containerMime);
+    }
+    mMetricsItem->setCString(kExtractorEntryPoint,
+            entryPointString(IMediaExtractor::EntryPoint::OTHER));
+}
+
+CachedMediaExtractor::~CachedMediaExtractor() {
+    // the real extractor closes the source, and logs its metrics, once done with it.
+    if (mExtractor == nullptr) {
+        mSource->close();
+        if (mMetricsItem->count() > 0) {
+            mMetricsItem->selfrecord();
+        }
+    }
+}
+
+sp<IMediaExtractor> CachedMediaExtractor::extractor() {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mExtractor == nullptr && !mCreateFailed) {
+        ALOGV("creating %s extractor", mEntry.name.c_str());
+        mExtractor = MediaExtractorFactory::CreateFromService(
+                mSource, mMime ? mMime->c_str() : nullptr);
+        if (mExtractor == nullptr) {
+            // the file changed under the same modification time and size.
+            ALOGW("failed to create %s extractor for a cached file", mEntry.name.c_str());
+            mCreateFailed = true;
+        } else {
+            if (mEntryPoint) {
+                mExtractor->setEntryPoint(*mEntryPoint);
+            }
+            if (mLogSessionId) {
+                mExtractor->setLogSessionId(*mLogSessionId);
+            }
+        }
+    }
+    return mExtractor;
+}
+
+size_t CachedMediaExtractor::countTracks() {
+    return mEntry.trackMeta.size();
+}
+
+sp<IMediaSource> CachedMediaExtractor::getTrack(size_t index) {
+    sp<IMediaExtractor> ex = extractor();
+    return ex != nullptr ? ex->getTrack(index) : nullptr;
+}
+
+sp<MetaData> CachedMediaExtractor::getTrackMetaData(size_t index, uint32_t flags) {
+    if (flags & kIncludeExtensiveMetaData) {
+        // only the metadata returned without the flag is cached.
+        sp<IMediaExtractor> ex = extractor();
+        return ex != nullptr ? ex->getTrackMetaData(index, flags) : nullptr;
+    }
+    if (index >= mEntry.trackMeta.size() || mEntry.trackMeta[index] == nullptr) {
+        return nullptr;
+    }
+    return new MetaData(*mEntry.trackMeta[index]);
+}
+
+sp<MetaData> CachedMediaExtractor::getMetaData() {
+    return mEntry.meta != nullptr ? new MetaData(*mEntry.meta) : nullptr;
+}
+
+status_t CachedMediaExtractor::getMetrics(Parcel *reply) {
+    if (reply == nullptr) {
+        return UNKNOWN_ERROR;
+    }
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mExtractor != nullptr) {
+        return mExtractor->getMetrics(reply);
+    }
+    mMetricsItem->writeToParcel(reply);
+    return OK;
+}
+
+uint32_t CachedMediaExtractor::flags() const {
+    return mEntry.flags;
+}
+
+status_t CachedMediaExtractor::setMediaCas(const HInterfaceToken &casToken) {
+    sp<IMediaExtractor> ex = extractor();
+    return ex != nullptr ? ex->setMediaCas(casToken) : ERROR_UNSUPPORTED;
+}
+
+String8 CachedMediaExtractor::name() {
+    return mEntry.name;
+}
+
+status_t CachedMediaExtractor::setEntryPoint(EntryPoint entryPoint) {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mExtractor != nullptr) {
+        return mExtractor->setEntryPoint(entryPoint);
+    }
+    const char *entryPointName = entryPointString(entryPoint);
+    if (entryPointName == nullptr) {
+        return BAD_VALUE;
+    }
+    mEntryPoint = entryPoint;
+    mMetricsItem->setCString(kExtractorEntryPoint, entryPointName);
+    return OK;
+}
+
+status_t CachedMediaExtractor::setLogSessionId(const String8& logSessionId) {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mExtractor != nullptr) {
+        return mExtractor->setLogSessionId(logSessionId);
+    }
+    mLogSessionId = logSessionId;
+    mMetricsItem->setCString(kExtractorLogSessionId, logSessionId.c_str());
+    return OK;
+}
+
+}  // namespace android
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_CACHED_MEDIA_EXTRACTOR_H
+#define ANDROID_CACHED_MEDIA_EXTRACTOR_H
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include <android/IMediaExtractor.h>
+#include <media/MediaMetricsItem.h>
+#include <media/stagefright/foundation/ABase.h>
+
+#include "ExtractorMetadataCache.h"
+
+namespace android {
+
+// IMediaExtractor answering the metadata queries from an ExtractorMetadataCache entry.
+// The container is only parsed, by a real extractor, once a track is read or metadata
+// the cache does not hold is asked for. Until then the "extractor" metrics item the real
+// extractor would have logged is made, and logged, from the entry.
+class CachedMediaExtractor : public BnMediaExtractor {
+public:
+    CachedMediaExtractor(
+            const ExtractorMetadataCache::Entry& entry,
+            const sp<DataSource>& source,
+            const std::optional<std::string>& mime);
+    virtual ~CachedMediaExtractor();
+
+    virtual size_t countTracks();
+    virtual sp<IMediaSource> getTrack(size_t index);
+    virtual sp<MetaData> getTrackMetaData(size_t index, uint32_t flags = 0);
+    virtual sp<MetaData> getMetaData();
+    virtual status_t getMetrics(Parcel *reply);
+    virtual uint32_t flags() const;
+    virtual status_t setMediaCas(const HInterfaceToken &casToken);
+    virtual String8 name();
+    virtual status_t setEntryPoint(EntryPoint entryPoint);
+    virtual status_t setLogSessionId(const String8& logSessionId);
+
+private:
+    // Returns the real extractor, creating it on first use.
+    sp<IMediaExtractor> extractor();
+
+    const ExtractorMetadataCache::Entry mEntry;
+    const sp<DataSource> mSource;
+    const std::optional<std::string> mMime;
+
+    std::mutex mLock;
+    sp<IMediaExtractor> mExtractor;  // guarded by mLock
+    bool mCreateFailed = false;      // guarded by mLock
+    std::optional<EntryPoint> mEntryPoint;  // guarded by mLock
+    std::optional<String8> mLogSessionId;   // guarded by mLock
+    // logged on destruction unless the real extractor, which logs its own, was created.
+    std::unique_ptr<mediametrics::Item> mMetricsItem;  // guarded by mLock
+
+    DISALLOW_EVIL_CONSTRUCTORS(CachedMediaExtractor);
+};
+
+}  // namespace android
+
+#endif  // ANDROID_CACHED_MEDIA_EXTRACTOR_H
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExtractorMetadataCache"
+#include <utils/Log.h>
+
+#include "ExtractorMetadataCache.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <binder/Parcel.h>
+#include <utils/String8.h>
+
+namespace android {
+
+static_assert(sizeof(ExtractorMetadataCache::Key) == 48, "Key must have no padding");
+
+bool ExtractorMetadataCache::Key::operator==(const Key& other) const {
+    return memcmp(this, &other, sizeof(Key)) == 0;
+}
+
+// MetaData is recorded as a presence flag followed, if present, by its items.
+static status_t writeMetaData(Parcel& parcel, const sp<MetaData>& meta) {
+    parcel.writeInt32(meta != nullptr);
+    return meta != nullptr ? meta->writeToParcel(parcel) : OK;
+}
+
+static status_t readMetaData(const Parcel& parcel, sp<MetaData>* meta) {
+    meta->clear();
+    if (parcel.readInt32() == 0) {
+        return OK;
+    }
+    *meta = new MetaData;
+    return (*meta)->updateFromParcel(parcel);
+}
+
+// static
+bool ExtractorMetadataCache::makeKey(int fd, int64_t offset, int64_t length, Key* key) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    memset(key, 0, sizeof(*key));
+    key->device = st.st_dev;
+    key->inode = st.st_ino;
+    key->mtimeNs = int64_t(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    key->fileSize = st.st_size;
+    key->offset = offset;
+    key->length = length;
+    return true;
+}
+
+ExtractorMetadataCache::ExtractorMetadataCache() {
+    const size_t size = sizeof(Header) + kSlotCount * sizeof(Slot) + kRecordAreaSize;
+    // Pages are only backed once written to, so an empty cache costs little.
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+            -1 /* fd */, 0 /* offset */);
+    if (base == MAP_FAILED) {
+        ALOGE("failed to map %zu bytes: %s", size, strerror(errno));
+        return;
+    }
+    mBase = static_cast<uint8_t*>(base);
+    mSize = size;
+    Header* h = header();
+    h->magic = kMagic;
+    h->version = kVersion;
+    h->slotCount = kSlotCount;
+    h->usedSlots = 0;
+    h->recordAreaSize = kRecordAreaSize;
+    h->recordAreaUsed = 0;
+}
+
+ExtractorMetadataCache::~ExtractorMetadataCache() {
+    if (mBase != nullptr) {
+        munmap(mBase, mSize);
+    }
+}
+
+void ExtractorMetadataCache::reset_l() {
+    // anonymous pages read back as zeros once discarded, which is an empty slot table.
+    madvise(slots(), mSize - sizeof(Header), MADV_DONTNEED);
+    header()->usedSlots = 0;
+    header()->recordAreaUsed = 0;
+    ++mResets;
+}
+
+// static
+uint32_t ExtractorMetadataCache::homeSlot(const Key& key) {
+    // FNV-1a over the key.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&key);
+    for (size_t i = 0; i < sizeof(Key); ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash & (kSlotCount - 1);
+}
+
+ExtractorMetadataCache::Slot* ExtractorMetadataCache::findSlot_l(const Key& key) const {
+    // The table is never more than half full (see insert()), so probing ends.
+    Slot* table = slots();
+    for (uint32_t i = homeSlot(key);; i = (i + 1) & (kSlotCount - 1)) {
+        Slot* slot = &table[i];
+        if (slot->recordSize == 0 || slot->key == key) {
+            return slot;
+        }
+    }
+}
+
+bool ExtractorMetadataCache::lookup(const Key& key, Entry* entry) {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mBase == nullptr) {
+        return false;
+    }
+    const Slot* slot = findSlot_l(key);
+    if (slot->recordSize == 0) {
+        ++mMisses;
+        return false;
+    }
+
+    Parcel parcel;
+    parcel.setData(records() + slot->recordOffset, slot->recordSize);
+    entry->name = parcel.readString8();
+    entry->flags = parcel.readUint32();
+    status_t err = readMetaData(parcel, &entry->meta);
+    const int32_t trackCount = parcel.readInt32();
+    entry->trackMeta.clear();
+    for (int32_t i = 0; err == OK && i < trackCount; ++i) {
+        sp<MetaData> meta;
+        err = readMetaData(parcel, &meta);
+        entry->trackMeta.push_back(meta);
+    }
+    if (err != OK || trackCount < 0 || parcel.dataAvail() != 0) {
+        ALOGW("dropping cache, malformed record of %u bytes", slot->recordSize);
+        reset_l();
+        ++mMisses;
+        return false;
+    }
+    ++mHits;
+    return true;
+}
+
+void ExtractorMetadataCache::insert(const Key& key, const Entry& entry) {
+    Parcel parcel;
+    // keep large items, like album art, inline rather than in ashmem.
+    parcel.setAllowFds(false);
+    parcel.writeString8(entry.name);
+    parcel.writeUint32(entry.flags);
+    status_t err = writeMetaData(parcel, entry.meta);
+    parcel.writeInt32(int32_t(entry.trackMeta.size()));
+    for (size_t i = 0; err == OK && i < entry.trackMeta.size(); ++i) {
+        err = writeMetaData(parcel, entry.trackMeta[i]);
+    }
+
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mBase == nullptr) {
+        return;
+    }
+    const size_t size = parcel.dataSize();
+    if (err != OK || parcel.hasFileDescriptors() || size == 0 || size > kMaxRecordSize) {
+        ALOGV("not caching %s, %zu bytes, error %d", entry.name.c_str(), size, err);
+        ++mRejects;
+        return;
+    }
+
+    Header* h = header();
+    // keep the records 8 byte aligned.
+    const size_t alignedSize = (size + 7) & ~size_t(7);
+    Slot* slot = findSlot_l(key);
+    const bool newSlot = slot->recordSize == 0;
+    if ((newSlot && h->usedSlots + 1 > kSlotCount / 2)
+            || h->recordAreaUsed + alignedSize > h->recordAreaSize) {
+        ALOGV("cache full with %u entries, %llu bytes, emptying",
+                h->usedSlots, (unsigned long long)h->recordAreaUsed);
+        reset_l();
+        slot = findSlot_l(key);
+    }
+    if (slot->recordSize == 0) {
+        ++h->usedSlots;
+    }
+    // a replaced record is left in place until the cache is emptied.
+    memcpy(records() + h->recordAreaUsed, parcel.data(), size);
+    slot->key = key;
+    slot->recordOffset = h->recordAreaUsed;
+    slot->recordSize = uint32_t(size);
+    h->recordAreaUsed += alignedSize;
+    ++mInserts;
+}
+
+std::string ExtractorMetadataCache::dump() const {
+    std::lock_guard<std::mutex> guard(mLock);
+    if (mBase == nullptr) {
+        return "Extractor metadata cache: not initialized\n";
+    }
+    const Header* h = header();
+    return std::string(String8::format(
+            "Extractor metadata cache: %u entries, %llu of %llu record bytes used\n"
+            "  hits %llu, misses %llu, inserts %llu, rejected %llu, emptied %llu\n",
+            h->usedSlots, (unsigned long long)h->recordAreaUsed,
+            (unsigned long long)h->recordAreaSize,
+            (unsigned long long)mHits, (unsigned long long)mMisses,
+            (unsigned long long)mInserts, (unsigned long long)mRejects,
+            (unsigned long long)mResets).c_str());
+}
+
+}  // namespace android
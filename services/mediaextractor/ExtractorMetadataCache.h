@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_EXTRACTOR_METADATA_CACHE_H
+#define ANDROID_EXTRACTOR_METADATA_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <media/stagefright/MetaData.h>
+#include <utils/String8.h>
+
+namespace android {
+
+// A cache of what an extractor parses from the container when a file is opened: the
+// extractor name and flags, the file metadata and the metadata of each track. A file opened
+// again, as media scans do, can then be described without parsing the container again.
+//
+// Entries are keyed by the identity and version of the file (device, inode, modification
+// time and size) and by the range of the file the data source covers, so that a file which
+// is modified or replaced misses.
+//
+// The cache is a single memory region with a flat, offset based layout:
+//   Header
+//   Slot[kSlotCount]    open addressing hash table of the keys
+//   records             Parcels holding the entries, appended one after the other
+// When the slots or the record area run out, the cache is emptied.
+class ExtractorMetadataCache {
+public:
+    struct Key {
+        uint64_t device;
+        uint64_t inode;
+        int64_t mtimeNs;
+        int64_t fileSize;
+        int64_t offset;
+        int64_t length;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct Entry {
+        String8 name;
+        uint32_t flags = 0;
+        // nullptr where the extractor returned no metadata
+        sp<MetaData> meta;
+        std::vector<sp<MetaData>> trackMeta;
+    };
+
+    // Returns in |key| the key of the range of |length| bytes at |offset| in the file |fd|
+    // is open on. Returns false if |fd| is not a regular file.
+    static bool makeKey(int fd, int64_t offset, int64_t length, Key* key);
+
+    ExtractorMetadataCache();
+    ~ExtractorMetadataCache();
+
+    bool initCheck() const { return mBase != nullptr; }
+
+    // Returns true and fills |entry| if |key| is in the cache.
+    bool lookup(const Key& key, Entry* entry);
+
+    // Adds or replaces the entry of |key|. Entries that do not fit, or carry file
+    // descriptors, are not cached.
+    void insert(const Key& key, const Entry& entry);
+
+    std::string dump() const;
+
+private:
+    friend class ExtractorMetadataCacheTest;
+
+    static constexpr uint32_t kMagic = 0x434d5845;  // 'EXMC'
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kSlotCount = 2048;         // power of 2
+    static constexpr size_t kRecordAreaSize = 16 << 20;
+    static constexpr size_t kMaxRecordSize = 256 << 10;  // room for album art
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t usedSlots;
+        uint64_t recordAreaSize;
+        uint64_t recordAreaUsed;
+    };
+
+    struct Slot {
+        Key key;
+        uint64_t recordOffset;  // from the start of the record area
+        uint32_t recordSize;    // 0 for an empty slot
+        uint32_t reserved;
+    };
+
+    Header* header() const { return reinterpret_cast<Header*>(mBase); }
+    Slot* slots() const { return reinterpret_cast<Slot*>(mBase + sizeof(Header)); }
+    uint8_t* records() const { return mBase + sizeof(Header) + kSlotCount * sizeof(Slot); }
+
+    // Returns the slot probing for |key| starts at.
+    static uint32_t homeSlot(const Key& key);
+    void reset_l();
+    Slot* findSlot_l(const Key& key) const;
+
+    mutable std::mutex mLock;
+    uint8_t* mBase = nullptr;
+    size_t mSize = 0;
+
+    uint64_t mHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mInserts = 0;
+    uint64_t mRejects = 0;
+    uint64_t mResets = 0;
+};
+
+}  // namespace android
+
+#endif  // ANDROID_EXTRACTOR_METADATA_CACHE_H
@@ -18,19 +18,38 @@
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
 
+#include <unistd.h>
+
 #include <utils/Vector.h>
 
+#include <binder/IBinder.h>
+#include <cutils/properties.h>
 #include <datasource/DataSourceFactory.h>
 #include <media/DataSource.h>
 #include <media/stagefright/InterfaceUtils.h>
 #include <media/stagefright/MediaExtractorFactory.h>
 #include <media/stagefright/RemoteDataSource.h>
+#include "CachedMediaExtractor.h"
 #include "MediaExtractorService.h"
 
 namespace android {
 
+// Identifies the ExtractorMetadataCache::Key attached to the binders of the data sources
+// made by makeIDataSource().
+static const int kMetadataCacheKeyId = 0;
+
+static void deleteMetadataCacheKey(const void* /* id */, void* obj, void* /* cookie */) {
+    delete static_cast<ExtractorMetadataCache::Key*>(obj);
+}
+
 MediaExtractorService::MediaExtractorService() {
     MediaExtractorFactory::LoadExtractors();
+    if (property_get_bool("media.extractor.metadata_cache", true /* default_value */)) {
+        mMetadataCache = std::make_unique<ExtractorMetadataCache>();
+        if (!mMetadataCache->initCheck()) {
+            mMetadataCache.reset();
+        }
+    }
 }
 
 MediaExtractorService::~MediaExtractorService() {
@@ -45,14 +64,37 @@ MediaExtractorService::~MediaExtractorService() {
 
     sp<DataSource> localSource = CreateDataSourceFromIDataSource(remoteSource);
 
+    // Only the data sources made by makeIDataSource() are known to be unmodified files.
+    const ExtractorMetadataCache::Key* cacheKey = nullptr;
+    if (mMetadataCache != nullptr && remoteSource != nullptr) {
+        cacheKey = static_cast<const ExtractorMetadataCache::Key*>(
+                IInterface::asBinder(remoteSource)->findObject(&kMetadataCacheKeyId));
+    }
+
     MediaBuffer::useSharedMemory();
-    sp<IMediaExtractor> extractor = MediaExtractorFactory::CreateFromService(
-            localSource,
-            mime ? mime->c_str() : nullptr);
+    sp<IMediaExtractor> extractor;
+    ExtractorMetadataCache::Entry entry;
+    if (cacheKey != nullptr && mMetadataCache->lookup(*cacheKey, &entry)) {
+        extractor = new CachedMediaExtractor(entry, localSource, mime);
+    } else {
+        extractor = MediaExtractorFactory::CreateFromService(
+                localSource,
+                mime ? mime->c_str() : nullptr);
+        if (extractor != nullptr && cacheKey != nullptr) {
+            entry.name = extractor->name();
+            entry.flags = extractor->flags();
+            entry.meta = extractor->getMetaData();
+            const size_t trackCount = extractor->countTracks();
+            for (size_t i = 0; i < trackCount; ++i) {
+                entry.trackMeta.push_back(extractor->getTrackMetaData(i));
+            }
+            mMetadataCache->insert(*cacheKey, entry);
+        }
+    }
 
     ALOGV("extractor service created %p (%s)",
             extractor.get(),
-            extractor == nullptr ? "" : extractor->name());
+            extractor == nullptr ? "" : extractor->name().c_str());
 
     if (extractor != nullptr) {
         registerMediaExtractor(extractor, localSource, mime ? mime->c_str() : nullptr);
@@ -66,8 +108,16 @@ MediaExtractorService::~MediaExtractorService() {
         int64_t offset,
         int64_t length,
         ::android::sp<::android::IDataSource>* _aidl_return) {
+    ExtractorMetadataCache::Key key;
+    const bool cacheable = mMetadataCache != nullptr
+            && ExtractorMetadataCache::makeKey(fd.get(), offset, length, &key);
     sp<DataSource> source = DataSourceFactory::getInstance()->CreateFromFd(fd.release(), offset, length);
     *_aidl_return = CreateIDataSourceFromDataSource(source);
+    if (cacheable && *_aidl_return != nullptr) {
+        IInterface::asBinder(*_aidl_return)->attachObject(&kMetadataCacheKeyId,
+                new ExtractorMetadataCache::Key(key), nullptr /* cleanupCookie */,
+                deleteMetadataCacheKey);
+    }
     return binder::Status::ok();
 }
 
@@ -78,6 +128,10 @@ MediaExtractorService::~MediaExtractorService() {
 }
 
 status_t MediaExtractorService::dump(int fd, const Vector<String16>& args) {
+    if (mMetadataCache != nullptr) {
+        const std::string cacheDump = mMetadataCache->dump();
+        write(fd, cacheDump.c_str(), cacheDump.size());
+    }
     return MediaExtractorFactory::dump(fd, args) || dumpExtractors(fd, args);
 }
 
@@ -17,10 +17,14 @@
 #ifndef ANDROID_MEDIA_EXTRACTOR_SERVICE_H
 #define ANDROID_MEDIA_EXTRACTOR_SERVICE_H
 
+#include <memory>
+
 #include <binder/BinderService.h>
 #include <android/BnMediaExtractorService.h>
 #include <android/IMediaExtractor.h>
 
+#include "ExtractorMetadataCache.h"
+
 namespace android {
 
 class MediaExtractorService : public BinderService<MediaExtractorService>, public BnMediaExtractorService
@@ -48,6 +52,9 @@ public:
 
 private:
     Mutex               mLock;
+
+    // nullptr if disabled by media.extractor.metadata_cache
+    std::unique_ptr<ExtractorMetadataCache> mMetadataCache;
 };
 
 }   // namespace android
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "ExtractorMetadataCacheTest"
+#include <utils/Log.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ExtractorMetadataCache.h"
+
+namespace android {
+
+class ExtractorMetadataCacheTest : public ::testing::Test {
+protected:
+    static constexpr uint32_t kSlotCount = ExtractorMetadataCache::kSlotCount;
+    static constexpr size_t kRecordAreaSize = ExtractorMetadataCache::kRecordAreaSize;
+    static constexpr size_t kMaxRecordSize = ExtractorMetadataCache::kMaxRecordSize;
+    static constexpr uint32_t kTypeRaw = 'raw ';
+
+    void SetUp() override {
+        ASSERT_TRUE(mCache.initCheck());
+    }
+
+    static ExtractorMetadataCache::Key makeKey(uint64_t inode) {
+        ExtractorMetadataCache::Key key = {};
+        key.device = 1;
+        key.inode = inode;
+        key.mtimeNs = 1000000000LL;
+        key.fileSize = 4096;
+        key.offset = 0;
+        key.length = 4096;
+        return key;
+    }
+
+    // An entry with two tracks and, if |artSize| is not 0, album art of that size.
+    static ExtractorMetadataCache::Entry makeEntry(const char* name, size_t artSize = 0) {
+        ExtractorMetadataCache::Entry entry;
+        entry.name = name;
+        entry.flags = 0x5;
+        entry.meta = new MetaData;
+        entry.meta->setCString(kKeyMIMEType, "video/mp4");
+        if (artSize > 0) {
+            std::vector<uint8_t> art(artSize, 0xa5);
+            entry.meta->setData(kKeyAlbumArt, kTypeRaw, art.data(), art.size());
+        }
+        sp<MetaData> video = new MetaData;
+        video->setCString(kKeyMIMEType, "video/avc");
+        video->setInt32(kKeyWidth, 1920);
+        entry.trackMeta.push_back(video);
+        entry.trackMeta.push_back(nullptr);
+        return entry;
+    }
+
+    bool lookupName(const ExtractorMetadataCache::Key& key, std::string* name) {
+        ExtractorMetadataCache::Entry entry;
+        if (!mCache.lookup(key, &entry)) {
+            return false;
+        }
+        *name = entry.name.c_str();
+        return true;
+    }
+
+    // Appends |extra| bytes to the record of |key|, as a corrupted record would have.
+    void growRecord(const ExtractorMetadataCache::Key& key, uint32_t extra) {
+        std::lock_guard<std::mutex> guard(mCache.mLock);
+        ExtractorMetadataCache::Slot* slot = mCache.findSlot_l(key);
+        ASSERT_NE(slot->recordSize, 0u);
+        slot->recordSize += extra;
+    }
+
+    // Returns the number of keys found past the slot probing starts at.
+    uint32_t probedKeys() {
+        std::lock_guard<std::mutex> guard(mCache.mLock);
+        uint32_t probed = 0;
+        const ExtractorMetadataCache::Slot* table = mCache.slots();
+        for (uint32_t i = 0; i < kSlotCount; ++i) {
+            if (table[i].recordSize != 0 && ExtractorMetadataCache::homeSlot(table[i].key) != i) {
+                ++probed;
+            }
+        }
+        return probed;
+    }
+
+    uint32_t usedSlots() {
+        std::lock_guard<std::mutex> guard(mCache.mLock);
+        return mCache.header()->usedSlots;
+    }
+
+    uint64_t resets() {
+        std::lock_guard<std::mutex> guard(mCache.mLock);
+        return mCache.mResets;
+    }
+
+    ExtractorMetadataCache mCache;
+};
+
+TEST_F(ExtractorMetadataCacheTest, LookupReturnsInsertedEntry) {
+    const ExtractorMetadataCache::Key key = makeKey(1);
+    ExtractorMetadataCache::Entry entry;
+    EXPECT_FALSE(mCache.lookup(key, &entry));
+
+    mCache.insert(key, makeEntry("MPEG4Extractor"));
+    ASSERT_TRUE(mCache.lookup(key, &entry));
+    EXPECT_STREQ(entry.name.c_str(), "MPEG4Extractor");
+    EXPECT_EQ(entry.flags, 0x5u);
+    const char* mime = nullptr;
+    ASSERT_NE(entry.meta, nullptr);
+    ASSERT_TRUE(entry.meta->findCString(kKeyMIMEType, &mime));
+    EXPECT_STREQ(mime, "video/mp4");
+    ASSERT_EQ(entry.trackMeta.size(), 2u);
+    ASSERT_NE(entry.trackMeta[0], nullptr);
+    int32_t width = 0;
+    EXPECT_TRUE(entry.trackMeta[0]->findInt32(kKeyWidth, &width));
+    EXPECT_EQ(width, 1920);
+    EXPECT_EQ(entry.trackMeta[1], nullptr);
+}
+
+TEST_F(ExtractorMetadataCacheTest, InsertReplacesEntry) {
+    const ExtractorMetadataCache::Key key = makeKey(1);
+    mCache.insert(key, makeEntry("first"));
+    mCache.insert(key, makeEntry("second"));
+    std::string name;
+    ASSERT_TRUE(lookupName(key, &name));
+    EXPECT_EQ(name, "second");
+    EXPECT_EQ(usedSlots(), 1u);
+}
+
+TEST_F(ExtractorMetadataCacheTest, KeyMismatchMisses) {
+    const ExtractorMetadataCache::Key key = makeKey(1);
+    mCache.insert(key, makeEntry("MPEG4Extractor"));
+
+    // a file modified, replaced or read from another range must miss.
+    std::vector<ExtractorMetadataCache::Key> others(6, key);
+    ++others[0].device;
+    ++others[1].inode;
+    ++others[2].mtimeNs;
+    ++others[3].fileSize;
+    ++others[4].offset;
+    --others[5].length;
+    std::string name;
+    for (const ExtractorMetadataCache::Key& other : others) {
+        EXPECT_FALSE(lookupName(other, &name));
+    }
+    ASSERT_TRUE(lookupName(key, &name));
+    EXPECT_EQ(name, "MPEG4Extractor");
+}
+
+TEST_F(ExtractorMetadataCacheTest, ProbingFindsEveryKey) {
+    // at half the slots, many keys collide and are probed past their first slot.
+    const uint32_t count = kSlotCount / 2;
+    for (uint32_t i = 0; i < count; ++i) {
+        mCache.insert(makeKey(i), makeEntry(std::to_string(i).c_str()));
+    }
+    EXPECT_EQ(usedSlots(), count);
+    EXPECT_GT(probedKeys(), 0u);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name;
+        ASSERT_TRUE(lookupName(makeKey(i), &name)) << "key " << i;
+        EXPECT_EQ(name, std::to_string(i));
+    }
+    EXPECT_EQ(resets(), 0u);
+}
+
+TEST_F(ExtractorMetadataCacheTest, EmptiedWhenSlotsRunOut) {
+    const uint32_t count = kSlotCount / 2;
+    for (uint32_t i = 0; i < count; ++i) {
+        mCache.insert(makeKey(i), makeEntry(std::to_string(i).c_str()));
+    }
+    ASSERT_EQ(resets(), 0u);
+
+    // replacing an entry takes no slot.
+    mCache.insert(makeKey(0), makeEntry("0"));
+    EXPECT_EQ(resets(), 0u);
+
+    mCache.insert(makeKey(count), makeEntry("last"));
+    EXPECT_EQ(resets(), 1u);
+    EXPECT_EQ(usedSlots(), 1u);
+    std::string name;
+    EXPECT_FALSE(lookupName(makeKey(0), &name));
+    ASSERT_TRUE(lookupName(makeKey(count), &name));
+    EXPECT_EQ(name, "last");
+}
+
+TEST_F(ExtractorMetadataCacheTest, EmptiedWhenRecordAreaRunsOut) {
+    const size_t artSize = kMaxRecordSize / 2;
+    const uint32_t fitting = kRecordAreaSize / (artSize + 1024);
+    for (uint32_t i = 0; i < fitting; ++i) {
+        mCache.insert(makeKey(i), makeEntry("art", artSize));
+    }
+    ASSERT_EQ(resets(), 0u);
+    ASSERT_EQ(usedSlots(), fitting);
+
+    uint32_t inserted = fitting;
+    while (resets() == 0 && inserted < 2 * fitting) {
+        mCache.insert(makeKey(inserted++), makeEntry("art", artSize));
+    }
+    EXPECT_EQ(resets(), 1u);
+    EXPECT_EQ(usedSlots(), 1u);
+    std::string name;
+    EXPECT_FALSE(lookupName(makeKey(0), &name));
+    EXPECT_TRUE(lookupName(makeKey(inserted - 1), &name));
+}
+
+TEST_F(ExtractorMetadataCacheTest, OversizedRecordNotCached) {
+    const ExtractorMetadataCache::Key key = makeKey(1);
+    mCache.insert(key, makeEntry("art", kMaxRecordSize));
+    std::string name;
+    EXPECT_FALSE(lookupName(key, &name));
+    EXPECT_EQ(usedSlots(), 0u);
+}
+
+TEST_F(ExtractorMetadataCacheTest, MalformedRecordEmptiesCache) {
+    const ExtractorMetadataCache::Key key = makeKey(1);
+    const ExtractorMetadataCache::Key other = makeKey(2);
+    mCache.insert(key, makeEntry("MPEG4Extractor"));
+    mCache.insert(other, makeEntry("MatroskaExtractor"));
+    growRecord(key, 8);
+
+    std::string name;
+    EXPECT_FALSE(lookupName(key, &name));
+    EXPECT_EQ(resets(), 1u);
+    EXPECT_FALSE(lookupName(other, &name));
+
+    // the cache is usable again.
+    mCache.insert(key, makeEntry("MPEG4Extractor"));
+    ASSERT_TRUE(lookupName(key, &name));
+    EXPECT_EQ(name, "MPEG4Extractor");
+}
+
+}  // namespace android
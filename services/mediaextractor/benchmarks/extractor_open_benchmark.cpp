@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Opens every MP4, MKV and HEIF file of a directory through the media.extractor service
+// and reads the file and track metadata, as a media scan does.
+//
+// BM_OpenCold changes the modification time of the files before each pass, so that the
+// extractor metadata cache misses and the containers are parsed; BM_OpenWarm opens them
+// again unchanged.
+//
+// $ adb push <media files> /data/local/tmp/media/
+// $ adb shell /data/nativetest64/extractor_open_benchmark/extractor_open_benchmark \
+//       [directory]
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <android-base/unique_fd.h>
+#include <android/IMediaExtractor.h>
+#include <android/IMediaExtractorService.h>
+#include <benchmark/benchmark.h>
+#include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+#include <media/stagefright/MetaData.h>
+
+using namespace android;
+
+static std::string gDirectory = "/data/local/tmp/media";
+
+static std::vector<std::string> listMediaFiles() {
+    std::vector<std::string> files;
+    DIR* dir = opendir(gDirectory.c_str());
+    if (dir == nullptr) {
+        return files;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        const char* ext = strrchr(entry->d_name, '.');
+        if (ext != nullptr && (!strcasecmp(ext, ".mp4") || !strcasecmp(ext, ".m4a")
+                || !strcasecmp(ext, ".mkv") || !strcasecmp(ext, ".webm")
+                || !strcasecmp(ext, ".heic") || !strcasecmp(ext, ".heif"))) {
+            files.push_back(gDirectory + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    return files;
+}
+
+static sp<IMediaExtractorService> getService() {
+    sp<IBinder> binder = defaultServiceManager()->getService(String16("media.extractor"));
+    return binder != nullptr ? interface_cast<IMediaExtractorService>(binder) : nullptr;
+}
+
+// Returns the number of tracks of |path|, or -1 on error.
+static int openAndReadMetaData(const sp<IMediaExtractorService>& service,
+        const std::string& path) {
+    base::unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        return -1;
+    }
+    sp<IDataSource> source;
+    service->makeIDataSource(std::move(fd), 0 /* offset */, st.st_size, &source);
+    if (source == nullptr) {
+        return -1;
+    }
+    sp<IMediaExtractor> extractor;
+    service->makeExtractor(source, std::nullopt /* mime */, &extractor);
+    if (extractor == nullptr) {
+        return -1;
+    }
+    sp<MetaData> meta = extractor->getMetaData();
+    const size_t trackCount = extractor->countTracks();
+    for (size_t i = 0; i < trackCount; ++i) {
+        sp<MetaData> trackMeta = extractor->getTrackMetaData(i);
+        benchmark::DoNotOptimize(trackMeta);
+    }
+    return trackCount;
+}
+
+// Moves the modification time of |path| forward by a microsecond.
+static bool touch(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    times[1].tv_nsec += 1000;
+    if (times[1].tv_nsec >= 1000000000) {
+        times[1].tv_nsec -= 1000000000;
+        ++times[1].tv_sec;
+    }
+    return utimensat(AT_FDCWD, path.c_str(), times, 0 /* flags */) == 0;
+}
+
+static void openDirectory(benchmark::State& state, bool cold) {
+    sp<IMediaExtractorService> service = getService();
+    if (service == nullptr) {
+        state.SkipWithError("media.extractor not running");
+        return;
+    }
+    const std::vector<std::string> files = listMediaFiles();
+    if (files.empty()) {
+        state.SkipWithError(("no media files in " + gDirectory).c_str());
+        return;
+    }
+
+    // the first pass fills the cache for the warm runs.
+    for (const auto& path : files) {
+        openAndReadMetaData(service, path);
+    }
+
+    int64_t tracks = 0;
+    for (auto _ : state) {
+        if (cold) {
+            state.PauseTiming();
+            for (const auto& path : files) {
+                if (!touch(path)) {
+                    state.SkipWithError(("cannot change the time of " + path).c_str());
+                    return;
+                }
+            }
+            state.ResumeTiming();
+        }
+        for (const auto& path : files) {
+            tracks += std::max(0, openAndReadMetaData(service, path));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * files.size());
+    state.counters["files"] = files.size();
+    state.counters["tracks"] = benchmark::Counter(tracks, benchmark::Counter::kAvgIterations);
+}
+
+static void BM_OpenCold(benchmark::State& state) {
+    openDirectory(state, true /* cold */);
+}
+
+static void BM_OpenWarm(benchmark::State& state) {
+    openDirectory(state, false /* cold */);
+}
+
+BENCHMARK(BM_OpenCold)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_OpenWarm)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (argc > 1) {
+        gDirectory = argv[1];
+    }
+    ProcessState::self()->startThreadPool();
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
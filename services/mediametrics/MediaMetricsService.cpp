@@ -60,6 +60,11 @@ static constexpr size_t kMaxRecords = 2000;
 // mutex, which also constrains how long a client might wait.
 static constexpr size_t kMaxExpiredAtOnce = 50;
 
+// items waiting for the ingest thread; beyond this, submitters process the
+// pending items themselves rather than growing the queue while the ingest
+// thread falls behind.
+static constexpr size_t kMaxPendingItems = kMaxRecords;
+
 // TODO: need to look at tuning kMaxRecords and friends for low-memory devices
 
 /* static */
@@ -108,7 +113,8 @@ MediaMetricsService::getSanitizedPackageNameAndVersionCode(uid_t uid) {
 MediaMetricsService::MediaMetricsService()
         : mMaxRecords(kMaxRecords),
           mMaxRecordAgeNs(kMaxRecordAgeNs),
-          mMaxRecordsExpiredAtOnce(kMaxExpiredAtOnce)
+          mMaxRecordsExpiredAtOnce(kMaxExpiredAtOnce),
+          mIngestThread([this] { ingestLoop(); })
 {
     ALOGD("%s", __func__);
 }
@@ -116,6 +122,17 @@ MediaMetricsService::MediaMetricsService()
 MediaMetricsService::~MediaMetricsService()
 {
     ALOGD("%s", __func__);
+    {
+        std::lock_guard _l(mIngestWakeLock);
+        mIngestQuit = true;
+        mIngestWakeCondition.notify_one();
+    }
+    mIngestThread.join();
+    {
+        // process the items submitted after the ingest thread last ran.
+        std::lock_guard _l(mIngestLock);
+        processPendingItems();
+    }
     // the class destructor clears anyhow, but we enforce clearing items first.
     mItemsDiscarded += (int64_t)mItems.size();
     mItems.clear();
@@ -216,13 +233,60 @@ status_t MediaMetricsService::submitInternal(mediametrics::Item *item, bool rele
         }
     }
 
-    (void)mAudioAnalytics.submit(sitem, isTrusted);
-
-    (void)dump2Statsd(sitem, mStatsdLog);  // failure should be logged in function.
-    saveItem(sitem);
+    enqueueItem(std::move(sitem), isTrusted);
     return NO_ERROR;
 }
 
+void MediaMetricsService::enqueueItem(
+        std::shared_ptr<const mediametrics::Item> item, bool isTrusted)
+{
+    if (mIngestPending.fetch_add(1, std::memory_order_relaxed) >= kMaxPendingItems) {
+        // The ingest thread fell behind: rather than dropping the item, the submitter
+        // processes the pending items itself, in order, before queueing its own.
+        ++mItemsIngestedInline;
+        std::lock_guard _l(mIngestLock);
+        processPendingItems();
+    }
+    if (mIngestQueue.push({std::move(item), isTrusted})) {
+        // The queue was empty, so the ingest thread may be waiting.
+        std::lock_guard _l(mIngestWakeLock);
+        mIngestWakeCondition.notify_one();
+    }
+}
+
+bool MediaMetricsService::hasPendingItems() const
+{
+    return !mIngestQueue.empty();
+}
+
+void MediaMetricsService::processPendingItems()
+{
+    std::vector<std::shared_ptr<const mediametrics::Item>> items;
+    const size_t count = mIngestQueue.consumeAll([&](PendingItem&& pending) {
+        (void)mAudioAnalytics.submit(pending.item, pending.isTrusted);
+        (void)dump2Statsd(pending.item, mStatsdLog);  // failure should be logged in function.
+        items.emplace_back(std::move(pending.item));
+    });
+    mIngestPending.fetch_sub(count, std::memory_order_relaxed);
+    if (!items.empty()) {
+        saveItems(items);
+    }
+}
+
+void MediaMetricsService::ingestLoop()
+{
+    while (true) {
+        {
+            std::unique_lock l(mIngestWakeLock);
+            mIngestWakeCondition.wait(l, [this] {
+                return mIngestQuit || hasPendingItems(); });
+            if (mIngestQuit) break;
+        }
+        std::lock_guard _l(mIngestLock);
+        processPendingItems();
+    }
+}
+
 status_t MediaMetricsService::dump(int fd, const Vector<String16>& args)
 {
     if (checkCallingPermission(String16("android.permission.DUMP")) == false) {
@@ -299,6 +363,11 @@ status_t MediaMetricsService::dump(int fd, const Vector<String16>& args)
             unreachable = true;
         }
     }
+    {
+        // Include everything submitted before the dump.
+        std::lock_guard _l(mIngestLock);
+        processPendingItems();
+    }
     std::stringstream result;
     {
         std::lock_guard _l(mLock);
@@ -390,6 +459,9 @@ std::string MediaMetricsService::dumpHeaders(int64_t sinceNs, const char* prefix
             "Records Discarded: %lld (by Count: %lld by Expiration: %lld)\n",
             (long long)mItemsDiscarded, (long long)mItemsDiscardedCount,
             (long long)mItemsDiscardedExpire);
+    result << StringPrintf(
+            "Submissions Processed Inline (ingest queue full): %lld\n",
+            (long long)getItemsIngestedInline());
     if (prefix != nullptr) {
         result << "Restricting to prefix " << prefix << "\n";
     }
@@ -486,17 +558,22 @@ void MediaMetricsService::processExpirations()
     } while (more);
 }
 
-void MediaMetricsService::saveItem(const std::shared_ptr<const mediametrics::Item>& item)
+void MediaMetricsService::saveItems(
+        const std::vector<std::shared_ptr<const mediametrics::Item>>& items)
 {
     std::lock_guard _l(mLock);
-    // we assume the items are roughly in time order.
-    mItems.emplace_back(item);
-    if (isPullable(item->getKey())) {
-        registerStatsdCallbacksIfNeeded();
-        mPullableItems[item->getKey()].emplace_back(item);
-    }
-    ++mItemsFinalized;
-    if (expirations(item)
+    bool more = false;
+    for (const auto& item : items) {
+        // we assume the items are roughly in time order.
+        mItems.emplace_back(item);
+        if (isPullable(item->getKey())) {
+            registerStatsdCallbacksIfNeeded();
+            mPullableItems[item->getKey()].emplace_back(item);
+        }
+        ++mItemsFinalized;
+        more = expirations(item);
+    }
+    if (more
             && (!mExpireFuture.valid()
                || mExpireFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
         mExpireFuture = std::async(std::launch::async, [this] { processExpirations(); });
@@ -589,6 +666,10 @@ AStatsManager_PullAtomCallbackReturn MediaMetricsService::pullItems(
     if (key.empty()) {
         return AStatsManager_PULL_SKIP;
     }
+    {
+        std::lock_guard _l(mIngestLock);
+        processPendingItems();
+    }
     std::lock_guard _l(mLock);
     bool dumped = false;
     for (auto &item : mPullableItems[key]) {
@@ -17,10 +17,13 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <future>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 // IMediaMetricsService must include Vector, String16, Errors
 #include <android-base/thread_annotations.h>
@@ -30,6 +33,7 @@
 #include <utils/String8.h>
 
 #include "AudioAnalytics.h"
+#include "MpscQueue.h"
 
 namespace android {
 
@@ -66,6 +70,14 @@ public:
 
     static constexpr const char * const kServiceName = "media.metrics";
 
+    /**
+     * Returns the number of submissions processed on the submitting thread because the
+     * ingest queue was full.
+     */
+    int64_t getItemsIngestedInline() const {
+        return mItemsIngestedInline.load(std::memory_order_relaxed);
+    }
+
     /**
      * Rounds time to the nearest second.
      */
@@ -95,7 +107,19 @@ private:
     // input validation after arrival from client
     static bool isContentValid(const mediametrics::Item *item, bool isTrusted);
     bool isRateLimited(mediametrics::Item *) const;
-    void saveItem(const std::shared_ptr<const mediametrics::Item>& item);
+    void saveItems(const std::vector<std::shared_ptr<const mediametrics::Item>>& items);
+
+    // Ingest stage. submitInternal() only validates an item and pushes it onto
+    // the ingest queue, the ingest thread then feeds the queued items in
+    // arrival order and in batches to AudioAnalytics, statsd and the item log.
+    struct PendingItem {
+        std::shared_ptr<const mediametrics::Item> item;
+        bool isTrusted;
+    };
+    void enqueueItem(std::shared_ptr<const mediametrics::Item> item, bool isTrusted);
+    bool hasPendingItems() const;
+    void processPendingItems() REQUIRES(mIngestLock);
+    void ingestLoop() NO_THREAD_SAFETY_ANALYSIS; // thread safety doesn't cover unique_lock
 
     bool expirations(const std::shared_ptr<const mediametrics::Item>& item) REQUIRES(mLock);
 
@@ -153,6 +177,22 @@ private:
     using ItemKey = std::string;
     using WeakItemQueue = std::deque<std::weak_ptr<const mediametrics::Item>>;
     std::unordered_map<ItemKey, WeakItemQueue> mPullableItems GUARDED_BY(mLock);
+
+    mediametrics::MpscQueue<PendingItem> mIngestQueue;
+    // Items in mIngestQueue; once the queue is full, submitters process them inline.
+    std::atomic<size_t> mIngestPending{};
+    std::atomic<int64_t> mItemsIngestedInline{}; // accessed outside of lock.
+
+    // Held while moving items out of mIngestQueue, by the ingest thread or
+    // by dump() and pullItems() to catch up with items already submitted.
+    std::mutex mIngestLock;
+
+    std::mutex mIngestWakeLock;
+    std::condition_variable mIngestWakeCondition;
+    bool mIngestQuit GUARDED_BY(mIngestWakeLock) = false;
+
+    // needs to be initialized after the variables above, done in constructor initializer list.
+    std::thread mIngestThread;
 };
 
 } // namespace android
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace android::mediametrics {
+
+/**
+ * Unbounded lock-free multiple producer, single consumer queue.
+ *
+ * Producers push onto an intrusive stack with a single compare-exchange.
+ * The consumer detaches the whole stack at once and reverses it, so elements
+ * are consumed in the order their pushes took effect, across all producers.
+ * Since nodes are only ever removed all together, there is no ABA problem.
+ * Callers that need a bound keep their own count of pushed elements.
+ */
+template <typename T>
+class MpscQueue {
+    struct Node {
+        explicit Node(T&& v) : value(std::move(v)) {}
+        T value;
+        Node* next = nullptr;
+    };
+
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        consumeAll([](T&&) {});
+    }
+
+    /**
+     * Adds value to the queue, may be called from any thread.
+     *
+     * \return true if the queue was empty, i.e. the consumer may need to be woken up.
+     */
+    bool push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* head = mHead.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!mHead.compare_exchange_weak(
+                head, node, std::memory_order_release, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    bool empty() const {
+        return mHead.load(std::memory_order_acquire) == nullptr;
+    }
+
+    /**
+     * Removes all elements and passes them to f in push order.
+     * Must only be called from one thread at a time.
+     *
+     * \return the number of elements consumed.
+     */
+    template <typename F>
+    size_t consumeAll(F&& f) {
+        Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+        Node* reversed = nullptr;
+        while (node != nullptr) {
+            Node* next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+        size_t count = 0;
+        while (reversed != nullptr) {
+            Node* next = reversed->next;
+            f(std::move(reversed->value));
+            delete reversed;
+            reversed = next;
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    std::atomic<Node*> mHead{nullptr};
+};
+
+} // namespace android::mediametrics
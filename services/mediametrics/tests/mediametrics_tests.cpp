@@ -26,6 +26,7 @@
 #include <media/MediaMetricsItem.h>
 #include <mediametricsservice/AudioTypes.h>
 #include <mediametricsservice/MediaMetricsService.h>
+#include <mediametricsservice/MpscQueue.h>
 #include <mediametricsservice/StringUtils.h>
 #include <mediametricsservice/ValidateId.h>
 #include <system/audio.h>
@@ -1234,6 +1235,86 @@ static std::string generateId(size_t value)
     return std::string(id);
 }
 
+TEST(mediametrics_tests, MpscQueue) {
+    mediametrics::MpscQueue<std::pair<size_t, size_t>> queue;  // { producer, sequence }
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(0u, queue.consumeAll([](auto&&) {}));
+
+    constexpr size_t THREADS = 8;
+    constexpr size_t ITERATIONS = 10000;
+
+    std::vector<size_t> next(THREADS);  // next expected sequence per producer.
+    size_t consumed = 0;
+    auto consume = [&] {
+        consumed += queue.consumeAll([&](std::pair<size_t, size_t>&& value) {
+            // elements from one producer must come out in push order.
+            ASSERT_EQ(next[value.first], value.second);
+            ++next[value.first];
+        });
+    };
+
+    std::atomic<size_t> running = THREADS;
+    std::vector<std::future<void>> threads;
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.push_back(std::async(std::launch::async, [&, i] {
+            for (size_t j = 0; j < ITERATIONS; ++j) {
+                queue.push({i, j});
+            }
+            --running;
+        }));
+    }
+    while (running > 0) {
+        consume();
+    }
+    threads.clear();
+    consume();
+
+    ASSERT_EQ(THREADS * ITERATIONS, consumed);
+    ASSERT_TRUE(queue.empty());
+    for (size_t i = 0; i < THREADS; ++i) {
+        ASSERT_EQ(ITERATIONS, next[i]);
+    }
+}
+
+TEST(mediametrics_tests, MpscQueueArrivalOrder) {
+    mediametrics::MpscQueue<size_t> queue;
+
+    constexpr size_t THREADS = 8;
+    constexpr size_t ITERATIONS = 10000;
+
+    // the lock orders the pushes, which must come out in that order.
+    std::mutex lock;
+    size_t sequence = 0;
+    size_t next = 0;
+    size_t outOfOrder = 0;
+    auto consume = [&] {
+        queue.consumeAll([&](size_t&& value) {
+            if (value != next) ++outOfOrder;
+            next = value + 1;
+        });
+    };
+
+    std::atomic<size_t> running = THREADS;
+    std::vector<std::future<void>> threads;
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.push_back(std::async(std::launch::async, [&] {
+            for (size_t j = 0; j < ITERATIONS; ++j) {
+                std::lock_guard _l(lock);
+                queue.push(sequence++);
+            }
+            --running;
+        }));
+    }
+    while (running > 0) {
+        consume();
+    }
+    threads.clear();
+    consume();
+
+    ASSERT_EQ(0u, outOfOrder);
+    ASSERT_EQ(THREADS * ITERATIONS, next);
+}
+
 TEST(mediametrics_tests, ValidateId) {
     constexpr size_t LRU_SET_SIZE = 3;
     constexpr size_t IDS = 10;
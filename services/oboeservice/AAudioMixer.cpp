@@ -23,6 +23,12 @@
 #include <cstring>
 #include <utils/Trace.h>
 
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #include "AAudioMixer.h"
 
 #ifndef AAUDIO_MIXER_ATRACE_ENABLED
@@ -39,10 +45,11 @@ void AAudioMixer::allocate(int32_t samplesPerFrame, int32_t framesPerBurst) {
     int32_t samplesPerBuffer = samplesPerFrame * framesPerBurst;
     mOutputBuffer = std::make_unique<float[]>(samplesPerBuffer);
     mBufferSizeInBytes = samplesPerBuffer * sizeof(float);
+    mOutputEmpty = true;
 }
 
 void AAudioMixer::clear() {
-    memset(mOutputBuffer.get(), 0, mBufferSizeInBytes);
+    mOutputEmpty = true;
 }
 
 int32_t AAudioMixer::mix(
@@ -88,8 +95,13 @@ int32_t AAudioMixer::mix(
             if (framesToMixFromPart > framesAvailableFromPart) {
                 framesToMixFromPart = framesAvailableFromPart;
             }
-            mixPart(destination, (float *)wrappingBuffer.data[partIndex],
-                    framesToMixFromPart);
+            const auto *source = static_cast<const float *>(wrappingBuffer.data[partIndex]);
+            if (mOutputEmpty) {
+                memcpy(destination, source,
+                       framesToMixFromPart * mSamplesPerFrame * sizeof(float));
+            } else {
+                mixPart(destination, source, framesToMixFromPart);
+            }
 
             destination += framesToMixFromPart * mSamplesPerFrame;
             framesLeft -= framesToMixFromPart;
@@ -98,6 +110,13 @@ int32_t AAudioMixer::mix(
     }
     fifo->advanceReadIndex(framesDesired);
 
+    if (mOutputEmpty) {
+        // Silence the rest of the burst for the streams mixed after this one.
+        int32_t framesRead = framesDesired - framesLeft;
+        memset(destination, 0, (mFramesPerBurst - framesRead) * mSamplesPerFrame * sizeof(float));
+        mOutputEmpty = false;
+    }
+
 #if AAUDIO_MIXER_ATRACE_ENABLED
     ATRACE_END();
 #endif /* AAUDIO_MIXER_ATRACE_ENABLED */
@@ -105,14 +124,37 @@ int32_t AAudioMixer::mix(
     return (framesDesired - framesLeft); // framesRead
 }
 
-void AAudioMixer::mixPart(float *destination, float *source, int32_t numFrames) {
+void AAudioMixer::mixPart(float *destination, const float *source, int32_t numFrames) {
     int32_t numSamples = numFrames * mSamplesPerFrame;
-    // TODO maybe optimize using SIMD
-    for (int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
+    int32_t sampleIndex = 0;
+#if defined(__ARM_NEON__) || defined(__aarch64__)
+    for (; sampleIndex + 8 <= numSamples; sampleIndex += 8) {
+        float32x4_t sum0 = vaddq_f32(vld1q_f32(destination), vld1q_f32(source));
+        float32x4_t sum1 = vaddq_f32(vld1q_f32(destination + 4), vld1q_f32(source + 4));
+        vst1q_f32(destination, sum0);
+        vst1q_f32(destination + 4, sum1);
+        destination += 8;
+        source += 8;
+    }
+#elif defined(__SSE__)
+    for (; sampleIndex + 8 <= numSamples; sampleIndex += 8) {
+        __m128 sum0 = _mm_add_ps(_mm_loadu_ps(destination), _mm_loadu_ps(source));
+        __m128 sum1 = _mm_add_ps(_mm_loadu_ps(destination + 4), _mm_loadu_ps(source + 4));
+        _mm_storeu_ps(destination, sum0);
+        _mm_storeu_ps(destination + 4, sum1);
+        destination += 8;
+        source += 8;
+    }
+#endif
+    for (; sampleIndex < numSamples; sampleIndex++) {
         *destination++ += *source++;
     }
 }
 
 float *AAudioMixer::getOutputBuffer() {
+    if (mOutputEmpty) {
+        memset(mOutputBuffer.get(), 0, mBufferSizeInBytes);
+        mOutputEmpty = false;
+    }
     return mOutputBuffer.get();
 }
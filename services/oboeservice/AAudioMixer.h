@@ -28,6 +28,10 @@ public:
 
     void allocate(int32_t samplesPerFrame, int32_t framesPerBurst);
 
+    /**
+     * Start a new burst. The first stream mixed is copied to the output buffer
+     * instead of being added to it, so the buffer is only zeroed if no stream is mixed.
+     */
     void clear();
 
     /**
@@ -46,12 +50,13 @@ public:
     int32_t getFramesPerBurst() const { return mFramesPerBurst; }
 
 private:
-    void mixPart(float *destination, float *source, int32_t numFrames);
+    void mixPart(float *destination, const float *source, int32_t numFrames);
 
     std::unique_ptr<float[]> mOutputBuffer;
     int32_t  mSamplesPerFrame = 0;
     int32_t  mFramesPerBurst = 0;
     int32_t  mBufferSizeInBytes = 0;
+    bool     mOutputEmpty = true; // nothing mixed since clear()
 };
 
 #endif //AAUDIO_AAUDIO_MIXER_H
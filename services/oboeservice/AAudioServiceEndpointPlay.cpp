@@ -28,6 +28,7 @@
 #include "AAudioServiceEndpoint.h"
 #include <algorithm>
 #include <mutex>
+#include <sstream>
 #include <vector>
 
 #include "core/AudioStreamBuilder.h"
@@ -72,6 +73,7 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
     // result might be a frame count
     while (mCallbackEnabled.load() && getStreamInternal()->isActive() && (result >= 0)) {
         // Mix data from each active stream.
+        const int64_t mixStartNanos = AudioClock::getNanoseconds();
         mMixer.clear();
 
         { // brackets are for lock_guard
@@ -144,7 +146,9 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
         }
 
         // Write mixer output to stream using a blocking write.
-        result = getStreamInternal()->write(mMixer.getOutputBuffer(),
+        float *mixerOutput = mMixer.getOutputBuffer();
+        recordMixTime(AudioClock::getNanoseconds() - mixStartNanos);
+        result = getStreamInternal()->write(mixerOutput,
                                             getFramesPerBurst(), timeoutNanos);
         if (result == AAUDIO_ERROR_DISCONNECTED) {
             ALOGD("%s() write() returned AAUDIO_ERROR_DISCONNECTED", __func__);
@@ -161,3 +165,29 @@ void *AAudioServiceEndpointPlay::callbackLoop() {
           __func__, mCallbackEnabled.load(), getStreamInternal()->getState(), result);
     return nullptr; // TODO review
 }
+
+void AAudioServiceEndpointPlay::recordMixTime(int64_t nanos) {
+    // Do not wait for dump() in the mixer thread, drop the measurement instead.
+    std::unique_lock<std::mutex> lock(mMixTimeLock, std::try_to_lock);
+    if (lock.owns_lock()) {
+        mMixTimeHistogramMicros.add(nanos / AAUDIO_NANOS_PER_MICROSECOND);
+    }
+}
+
+std::string AAudioServiceEndpointPlay::dump() const {
+    std::stringstream result;
+    result << AAudioServiceEndpointShared::dump();
+
+    std::string histogram;
+    {
+        std::lock_guard<std::mutex> lock(mMixTimeLock);
+        histogram = mMixTimeHistogramMicros.dump();
+    }
+    result << "    Mix Time Per Burst (usec):\n";
+    std::istringstream istr(histogram);
+    std::string line;
+    while (std::getline(istr, line)) {
+        result << "      " << line << "\n";
+    }
+    return result.str();
+}
@@ -19,8 +19,12 @@
 
 #include <atomic>
 #include <functional>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include <audio_utils/Histogram.h>
+
 #include "client/AudioStreamInternal.h"
 #include "client/AudioStreamInternalPlay.h"
 #include "binding/AAudioServiceMessage.h"
@@ -43,9 +47,20 @@ public:
 
     void *callbackLoop() override;
 
+    std::string dump() const override;
+
 private:
+    void recordMixTime(int64_t nanos);
+
     bool                     mLatencyTuningEnabled = false; // TODO implement tuning
     AAudioMixer              mMixer;    //
+
+    // Time taken to mix each burst, for dumpsys.
+    static constexpr int32_t kMixTimeBinWidthMicros = 25;
+    static constexpr int32_t kMixTimeBinCount       = 80;
+    mutable std::mutex       mMixTimeLock;
+    android::audio_utils::Histogram mMixTimeHistogramMicros{kMixTimeBinCount,
+                                                            kMixTimeBinWidthMicros};
 };
 
 } /* namespace aaudio */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Mixes one burst from each of N synthetic shared stream clients, the way
+// AAudioServiceEndpointPlay::callbackLoop() does.
+//
+// The client FIFOs are not a multiple of the burst long, so the reads regularly
+// wrap around the end of a FIFO and are mixed in two parts.
+//
+// $ atest aaudio_mixer_benchmark
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fifo/FifoBuffer.h>
+
+#include "AAudioMixer.h"
+
+using android::FifoBuffer;
+using android::FifoBufferAllocated;
+
+namespace {
+
+constexpr int32_t kFifoBursts = 3;
+
+// Arguments: number of clients, frames per burst, channels.
+void BM_MixBurst(benchmark::State& state) {
+    const int32_t numClients = state.range(0);
+    const int32_t framesPerBurst = state.range(1);
+    const int32_t channelCount = state.range(2);
+    const int32_t capacityInFrames = kFifoBursts * framesPerBurst + framesPerBurst / 3;
+
+    std::vector<float> signal(capacityInFrames * channelCount);
+    for (size_t i = 0; i < signal.size(); i++) {
+        signal[i] = static_cast<float>(i % 200) / 100.0f - 1.0f;
+    }
+    std::vector<std::shared_ptr<FifoBuffer>> fifos;
+    for (int32_t client = 0; client < numClients; client++) {
+        auto fifo = std::make_shared<FifoBufferAllocated>(
+                channelCount * sizeof(float), capacityInFrames);
+        // Fill the storage once, the loop below only moves the indices.
+        fifo->write(signal.data(), capacityInFrames);
+        fifo->advanceReadIndex(capacityInFrames);
+        fifos.push_back(fifo);
+    }
+
+    AAudioMixer mixer;
+    mixer.allocate(channelCount, framesPerBurst);
+    for (auto _ : state) {
+        mixer.clear();
+        for (int32_t client = 0; client < numClients; client++) {
+            fifos[client]->advanceWriteIndex(framesPerBurst);
+            mixer.mix(client, fifos[client], false /* allowUnderflow */);
+        }
+        benchmark::DoNotOptimize(mixer.getOutputBuffer());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * numClients * framesPerBurst);
+}
+
+BENCHMARK(BM_MixBurst)
+        ->ArgNames({"clients", "burst", "channels"})
+        ->ArgsProduct({{1, 2, 4, 8, 16}, {96, 192}, {2}})
+        ->Args({4, 192, 8});
+
+}  // namespace
+
+BENCHMARK_MAIN();